@@ -0,0 +1,429 @@
+#include <cogs\RenderBackend.h>
+#include <cogs\Timing.h>
+#include <cogs\Entity.h>
+#include <cogs\Camera.h>
+#include <cogs\Light.h>
+#include <cogs\MeshRenderer.h>
+#include <cogs\ResourceManager.h>
+#include <cogs\Renderer3D.h>
+#include <cogs\MeshPool.h>
+#include <cogs\Mesh.h>
+#include <cogs\Impostor.h>
+#include <cogs\ParticleRenderer.h>
+#include <cogs\ParticleSystem.h>
+#include <cogs\GLTexture2D.h>
+#include <cogs\Frustum.h>
+#include <cogs\OcclusionCuller.h>
+
+#include <string>
+#include <vector>
+#include <random>
+#include <cstdio>
+#include <cstdlib>
+
+namespace
+{
+		/**
+		* Frustum culling of random spheres, one by one with the scalar test against the batched SIMD test
+		*/
+		int runCullingBenchmark(int _numSpheres, int _iterations)
+		{
+				cogs::Frustum frustum;
+				frustum.setCamInternals(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 100.0f);
+				frustum.update(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+				//spread around the camera, so about a tenth of them is visible
+				std::mt19937 random(42);
+				std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+				std::uniform_real_distribution<float> size(0.0f, 5.0f);
+
+				const size_t count = static_cast<size_t>(_numSpheres);
+				std::vector<float> x(count), y(count), z(count), radius(count);
+				for (size_t i = 0; i < count; i++)
+				{
+						x[i] = position(random);
+						y[i] = position(random);
+						z[i] = position(random);
+						radius[i] = size(random);
+				}
+
+				std::vector<uint32_t> visibility((count + 31) / 32);
+				std::vector<unsigned int> visibleIndices;
+				size_t scalarVisible{ 0 }, maskVisible{ 0 }, listVisible{ 0 };
+
+				cogs::HRTimer timer;
+
+				timer.start();
+				for (int i = 0; i < _iterations; i++)
+				{
+						scalarVisible = 0;
+						for (size_t j = 0; j < count; j++)
+						{
+								scalarVisible += frustum.sphereInFrustum(glm::vec3(x[j], y[j], z[j]), radius[j]) ? 1 : 0;
+						}
+				}
+				timer.stop();
+				const float scalarMs = timer.milli() / _iterations;
+
+				timer.start();
+				for (int i = 0; i < _iterations; i++)
+				{
+						maskVisible = frustum.spheresInFrustum(x.data(), y.data(), z.data(), radius.data(), count, visibility.data());
+				}
+				timer.stop();
+				const float maskMs = timer.milli() / _iterations;
+
+				timer.start();
+				for (int i = 0; i < _iterations; i++)
+				{
+						listVisible = frustum.spheresInFrustum(x.data(), y.data(), z.data(), radius.data(), count, visibleIndices);
+				}
+				timer.stop();
+				const float listMs = timer.milli() / _iterations;
+
+				printf("spheres: %d, visible: %zu (bitmask %zu, index list %zu)\n", _numSpheres, scalarVisible, maskVisible, listVisible);
+				printf("scalar %.4f ms, batched bitmask %.4f ms (%.1fx), batched index list %.4f ms (%.1fx)\n",
+						scalarMs, maskMs, scalarMs / maskMs, listMs, scalarMs / listMs);
+
+				return scalarVisible == maskVisible && scalarVisible == listVisible ? 0 : 1;
+		}
+}
+
+/**
+* CPU benchmark of the frame pipeline (update, submit, end, flush) using the null render backend,
+* so it runs without a window or GL context.
+* usage: Benchmark [--cull=N] [--frames=N] [--grid=N] [--particles=N] [--assets=path] [--prepass] [--no-mdi] [--compact] [--compact-instances] [--optimize] [--lods=N] [--meshlets] [--scene-tree] [--gpu-culling] [--occlusion] [--static] [--static-batching] [--material-params] [--cameras=N] [--multi-view] [--impostors=distance]
+* The assets path defaults to the Test project, which holds the models, textures and shaders used.
+* --cull=N only runs the frustum culling microbenchmark with N spheres
+* --compact-instances uploads the instances as 3x4 matrices
+* --cameras=N adds cameras looking at the grid from the sides, --multi-view gathers and culls the scene once for all of them
+* --static marks the grid as static and caches its visibility between frames
+* --static-batching marks the grid as static and draws it from persistent batches, culled by chunk
+* --material-params tints every third object of the grid, without splitting its batches
+* --gpu-culling culls the grid with a compute shader, only its uploads and dispatches are measured with the null backend
+* --occlusion puts a wall occluder in front of the middle of the grid and culls the instances behind it in software
+*/
+int main(int argc, char** argv)
+{
+		int numFrames{ 1000 };
+		int gridSize{ 40 };
+		int maxParticles{ 10000 };
+		std::string assets{ "../Test/" };
+		bool depthPrePass{ false };
+		bool multiDrawIndirect{ true };
+		bool compactVertices{ false };
+		bool compactInstances{ false };
+		bool optimizeMeshes{ false };
+		int numLODs{ 0 };
+		bool buildMeshlets{ false };
+		bool sceneTree{ false };
+		bool gpuCulling{ false };
+		bool occlusion{ false };
+		bool staticGrid{ false };
+		bool staticBatching{ false };
+		bool materialParams{ false };
+		int numCameras{ 1 };
+		bool multiView{ false };
+		float impostorDistance{ 0.0f };
+		int cullSpheres{ 0 };
+
+		for (int i = 1; i < argc; i++)
+		{
+				std::string arg = argv[i];
+				if (arg.find("--frames=") == 0)
+				{
+						numFrames = std::atoi(arg.substr(9).c_str());
+				}
+				else if (arg.find("--grid=") == 0)
+				{
+						gridSize = std::atoi(arg.substr(7).c_str());
+				}
+				else if (arg.find("--particles=") == 0)
+				{
+						maxParticles = std::atoi(arg.substr(12).c_str());
+				}
+				else if (arg.find("--assets=") == 0)
+				{
+						assets = arg.substr(9);
+				}
+				else if (arg == "--prepass")
+				{
+						depthPrePass = true;
+				}
+				else if (arg == "--no-mdi")
+				{
+						multiDrawIndirect = false;
+				}
+				else if (arg == "--compact")
+				{
+						compactVertices = true;
+				}
+				else if (arg.find("--lods=") == 0)
+				{
+						numLODs = std::atoi(arg.substr(7).c_str());
+				}
+				else if (arg == "--scene-tree")
+				{
+						sceneTree = true;
+				}
+				else if (arg == "--compact-instances")
+				{
+						compactInstances = true;
+				}
+				else if (arg == "--gpu-culling")
+				{
+						gpuCulling = true;
+				}
+				else if (arg.find("--cameras=") == 0)
+				{
+						numCameras = std::atoi(arg.substr(10).c_str());
+				}
+				else if (arg == "--multi-view")
+				{
+						multiView = true;
+				}
+				else if (arg == "--material-params")
+				{
+						materialParams = true;
+				}
+				else if (arg == "--static")
+				{
+						staticGrid = true;
+				}
+				else if (arg == "--static-batching")
+				{
+						staticGrid = true;
+						staticBatching = true;
+				}
+				else if (arg == "--occlusion")
+				{
+						occlusion = true;
+				}
+				else if (arg == "--meshlets")
+				{
+						buildMeshlets = true;
+				}
+				else if (arg.find("--impostors=") == 0)
+				{
+						impostorDistance = static_cast<float>(std::atof(arg.substr(12).c_str()));
+				}
+				else if (arg.find("--cull=") == 0)
+				{
+						cullSpheres = std::atoi(arg.substr(7).c_str());
+				}
+				else if (arg == "--optimize")
+				{
+						optimizeMeshes = true;
+				}
+		}
+
+		if (cullSpheres > 0)
+		{
+				return runCullingBenchmark(cullSpheres, numFrames);
+		}
+
+		//must be set before any resource is created
+		cogs::RenderBackend::setType(cogs::RenderBackendType::NULL_BACKEND);
+
+		if (compactVertices)
+		{
+				cogs::MeshPool::setLayout(cogs::VertexLayout::compact());
+		}
+
+		cogs::Mesh::setOptimizeOnLoad(optimizeMeshes);
+		cogs::Mesh::setGeneratedLODs(static_cast<unsigned int>(numLODs));
+		cogs::Mesh::setBuildMeshlets(buildMeshlets);
+		cogs::Mesh::setBuildOccluders(occlusion);
+
+		const glm::vec3 gravity(0.0f, -9.81f, 0.0f);
+
+		std::shared_ptr<cogs::Entity> root = cogs::Entity::create("Root");
+
+		std::weak_ptr<cogs::Entity> mainCamera = root->addChild("Camera");
+		mainCamera.lock()->addComponent<cogs::Camera>(1024, 576, cogs::ProjectionType::PERSPECTIVE);
+		mainCamera.lock()->getComponent<cogs::Transform>().lock()->translate(glm::vec3(0.0f, 0.0f, 55.0f));
+		mainCamera.lock()->getComponent<cogs::Camera>().lock()->setDepthPrePass(depthPrePass);
+
+		//the other cameras orbit the grid, their views overlap the main one in part
+		for (int i = 1; i < numCameras; i++)
+		{
+				const float angle = glm::radians(30.0f) * static_cast<float>((i + 1) / 2) * (i % 2 == 0 ? 1.0f : -1.0f);
+				std::weak_ptr<cogs::Entity> camera = root->addChild("Camera" + std::to_string(i));
+				camera.lock()->addComponent<cogs::Camera>(512, 288, cogs::ProjectionType::PERSPECTIVE);
+				camera.lock()->getComponent<cogs::Transform>().lock()->translate(glm::vec3(glm::sin(angle) * 55.0f, 0.0f, glm::cos(angle) * 55.0f));
+				camera.lock()->getComponent<cogs::Transform>().lock()->setLocalOrientation(glm::vec3(0.0f, angle, 0.0f));
+				camera.lock()->getComponent<cogs::Camera>().lock()->setDepthPrePass(depthPrePass);
+		}
+
+		std::weak_ptr<cogs::Entity> directionalLight = root->addChild("DirectionalLight");
+		directionalLight.lock()->addComponent<cogs::Light>();
+		directionalLight.lock()->getComponent<cogs::Light>().lock()->setLightType(cogs::LightType::DIRECTIONAL);
+		directionalLight.lock()->getComponent<cogs::Transform>().lock()->setLocalOrientation(glm::vec3(-0.2f, -1.0f, -0.3f));
+
+		std::shared_ptr<cogs::Renderer3D> renderer3D = std::make_shared<cogs::Renderer3D>(
+				cogs::ResourceManager::getGLSLProgram("Basic3DShader", assets + "Shaders/Basic3DShader.vert", assets + "Shaders/Basic3DShader.frag"));
+		renderer3D->setDepthPrePassShader(
+				cogs::ResourceManager::getGLSLProgram("DepthPrePass", assets + "Shaders/DepthPrePass.vert", assets + "Shaders/DepthPrePass.frag"));
+		renderer3D->setMultiDrawIndirect(multiDrawIndirect);
+		renderer3D->setCompactInstances(compactInstances);
+		renderer3D->setSceneTree(sceneTree);
+		renderer3D->setGPUCulling(gpuCulling);
+		if (gpuCulling)
+		{
+				renderer3D->setGPUCullingShader(cogs::ResourceManager::getComputeProgram("GPUCulling", assets + "Shaders/GPUCulling.comp"));
+		}
+		renderer3D->setVisibilityCaching(staticGrid);
+		renderer3D->setStaticBatching(staticBatching);
+
+		std::shared_ptr<cogs::OcclusionCuller> occlusionCuller;
+		if (occlusion)
+		{
+				occlusionCuller = std::make_shared<cogs::OcclusionCuller>();
+				renderer3D->setOcclusionCuller(occlusionCuller);
+		}
+
+		if (impostorDistance > 0.0f)
+		{
+				std::weak_ptr<cogs::GLSLProgram> bakeShader = cogs::ResourceManager::getGLSLProgram("ImpostorBake",
+						assets + "Shaders/ImpostorBake.vert", assets + "Shaders/ImpostorBake.frag");
+				for (const char* model : { "Models/TestModels/cube.obj", "Models/TestModels/sphere.obj" })
+				{
+						std::weak_ptr<cogs::Mesh> mesh = cogs::ResourceManager::getMesh(assets + model);
+						mesh.lock()->setImpostor(cogs::Impostor::bake(mesh, bakeShader));
+				}
+
+				renderer3D->setImpostorShader(
+						cogs::ResourceManager::getGLSLProgram("Impostor", assets + "Shaders/Impostor.vert", assets + "Shaders/Impostor.frag"));
+				renderer3D->setImpostorDistance(impostorDistance);
+		}
+
+		std::shared_ptr<cogs::ParticleRenderer> particleRenderer = std::make_shared<cogs::ParticleRenderer>(
+				cogs::ResourceManager::getGLSLProgram("ParticleShader", assets + "Shaders/ParticleShader.vert", assets + "Shaders/ParticleShader.frag"));
+
+		//a grid of cubes and spheres, half of it outside of the view frustum
+		for (int x = 0; x < gridSize; x++)
+		{
+				for (int y = 0; y < gridSize; y++)
+				{
+						std::weak_ptr<cogs::Entity> object = root->addChild("Object" + std::to_string(x) + "_" + std::to_string(y));
+						object.lock()->addComponent<cogs::MeshRenderer>(cogs::ResourceManager::getMesh(
+								assets + ((x + y) % 2 == 0 ? "Models/TestModels/cube.obj" : "Models/TestModels/sphere.obj")), renderer3D);
+						object.lock()->getComponent<cogs::Transform>().lock()->translate(
+								glm::vec3((x - gridSize / 2) * 3.0f, (y - gridSize / 2) * 3.0f, 0.0f));
+						object.lock()->getComponent<cogs::MeshRenderer>().lock()->setStatic(staticGrid);
+
+						if (materialParams && (x * gridSize + y) % 3 == 0)
+						{
+								cogs::MaterialParams params;
+								params.tint = glm::vec4(static_cast<float>(x) / gridSize, static_cast<float>(y) / gridSize, 1.0f, 1.0f);
+								object.lock()->getComponent<cogs::MeshRenderer>().lock()->setMaterialParams(params);
+						}
+				}
+		}
+
+		//a flat box between the camera and the middle of the grid
+		if (occlusion)
+		{
+				std::weak_ptr<cogs::Entity> wall = root->addChild("Wall");
+				wall.lock()->addComponent<cogs::MeshRenderer>(cogs::ResourceManager::getMesh(assets + "Models/TestModels/cube.obj"), renderer3D);
+				wall.lock()->getComponent<cogs::MeshRenderer>().lock()->setOccluder(true);
+				wall.lock()->getComponent<cogs::Transform>().lock()->translate(glm::vec3(0.0f, 0.0f, 20.0f));
+				wall.lock()->getComponent<cogs::Transform>().lock()->setLocalScale(glm::vec3(gridSize * 0.4f, gridSize * 0.4f, 1.0f));
+		}
+
+		std::weak_ptr<cogs::Entity> particleSystem = root->addChild("ParticleSystem");
+		particleSystem.lock()->addComponent<cogs::ParticleSystem>(particleRenderer, maxParticles,
+				5000.0f, 10.0f, 1.0f, 0.5f, true, true, gravity, cogs::Color::white,
+				cogs::ResourceManager::getGLTexture2D(assets + "Textures/particleStar.png", "texture_diffuse"),
+				[](cogs::Particle& _particle, const glm::vec3& _gravity, float _deltaTime)
+		{
+				_particle.m_velocity += _gravity * _deltaTime;
+				_particle.m_position += _particle.m_velocity * _deltaTime;
+		});
+
+		//fixed timestep so runs are comparable
+		const float deltaTime = 1.0f / 60.0f;
+
+		cogs::HRTimer frameTimer;
+		cogs::HRTimer updateTimer;
+		cogs::HRTimer submitTimer;
+		cogs::HRTimer flushTimer;
+
+		float updateMs{ 0.0f };
+		float submitMs{ 0.0f };
+		float flushMs{ 0.0f };
+
+		cogs::RenderBackend::resetStats();
+
+		frameTimer.start();
+
+		for (int frame = 0; frame < numFrames; frame++)
+		{
+				updateTimer.start();
+				root->refreshAll();
+				root->updateAll(deltaTime);
+				updateTimer.stop();
+				updateMs += updateTimer.milli();
+
+				if (multiView)
+				{
+						renderer3D->beginViews(cogs::Camera::getAllCameras());
+				}
+
+				for (std::weak_ptr<cogs::Camera> camera : cogs::Camera::getAllCameras())
+				{
+						if (camera.expired() || !camera.lock()->getEntity().lock()->isActive())
+						{
+								continue;
+						}
+						cogs::Camera::setCurrent(camera);
+
+						submitTimer.start();
+						renderer3D->begin();
+						particleRenderer->begin();
+
+						root->renderAll();
+
+						renderer3D->end();
+						particleRenderer->end();
+						submitTimer.stop();
+						submitMs += submitTimer.milli();
+
+						flushTimer.start();
+						renderer3D->flush();
+						particleRenderer->flush();
+						flushTimer.stop();
+						flushMs += flushTimer.milli();
+				}
+
+				renderer3D->endViews();
+		}
+
+		frameTimer.stop();
+
+		const cogs::RenderStats& stats = cogs::RenderBackend::getStats();
+		float frames = static_cast<float>(numFrames > 0 ? numFrames : 1);
+
+		printf("frames: %d, total: %.3f ms\n", numFrames, frameTimer.milli());
+		printf("per frame: update %.4f ms, submit/end %.4f ms, flush %.4f ms, total %.4f ms\n",
+				updateMs / frames, submitMs / frames, flushMs / frames, frameTimer.milli() / frames);
+		printf("per frame: %.1f draws (%.1f packed in indirect calls), %.1f instances, %.1f triangles, %.1f state changes, %.1f uniforms, %.1f uploads (%.1f bytes)\n",
+				stats.drawCalls / frames, stats.indirectDraws / frames, stats.instances / frames, stats.triangles / frames,
+				stats.stateChanges / frames, stats.uniformUploads / frames, stats.bufferUploads / frames, stats.bytesUploaded / frames);
+
+		if (gpuCulling)
+		{
+				printf("gpu culling: %.1f dispatches per frame, the instances drawn are decided on the gpu and not counted\n", stats.dispatches / frames);
+		}
+
+		if (occlusionCuller)
+		{
+				const cogs::OcclusionStats& occlusionStats = occlusionCuller->getStats();
+				printf("occlusion (last frame): %u occluders, %u triangles, %u of %u instances occluded, rasterize %.4f ms, test %.4f ms\n",
+						occlusionStats.numOccluders, occlusionStats.numTriangles, occlusionStats.numOccluded, occlusionStats.numTested,
+						occlusionStats.rasterizeTime, occlusionStats.testTime);
+		}
+
+		cogs::ResourceManager::clear();
+		return 0;
+}
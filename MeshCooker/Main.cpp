@@ -0,0 +1,157 @@
+#include <cogs\RenderBackend.h>
+#include <cogs\Timing.h>
+#include <cogs\ResourceManager.h>
+#include <cogs\IOManager.h>
+#include <cogs\MeshPool.h>
+#include <cogs\MeshCache.h>
+#include <cogs\Mesh.h>
+
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+
+namespace
+{
+		//the model formats the imported meshes use
+		bool isModelFile(const std::string& _path)
+		{
+				static const char* extensions[] = { ".obj", ".fbx", ".dae", ".3ds", ".blend", ".ply", ".gltf", ".glb" };
+				for (const char* extension : extensions)
+				{
+						std::string ext(extension);
+						if (_path.size() > ext.size() && _path.compare(_path.size() - ext.size(), ext.size(), ext) == 0)
+						{
+								return true;
+						}
+				}
+				return false;
+		}
+
+		void collectModels(const std::string& _path, std::vector<std::string>& _models)
+		{
+				std::vector<cogs::DirEntry> entries;
+				if (!cogs::IOManager::getDirectoryEntries(_path.c_str(), entries))
+				{
+						_models.push_back(_path);
+						return;
+				}
+
+				for (const cogs::DirEntry& entry : entries)
+				{
+						if (entry.isDirectory)
+						{
+								collectModels(entry.path, _models);
+						}
+						else if (isModelFile(entry.path))
+						{
+								_models.push_back(entry.path);
+						}
+				}
+		}
+}
+
+/**
+* Offline cooker writing the .cmesh caches of models, so a shipped game doesn't import them with Assimp at runtime.
+* Runs on the null render backend, no window or GL context is needed.
+* usage: MeshCooker [--compact] [--optimize] [--lods=N] [--meshlets] [--occluders] [--force] <model files or directories...>
+* The settings must match the ones of the game, otherwise it rebuilds the caches on load
+*/
+int main(int argc, char** argv)
+{
+		bool compactVertices{ false };
+		bool optimizeMeshes{ false };
+		bool buildMeshlets{ false };
+		bool buildOccluders{ false };
+		bool force{ false };
+		int numLODs{ 0 };
+		std::vector<std::string> models;
+
+		for (int i = 1; i < argc; i++)
+		{
+				std::string arg = argv[i];
+				if (arg == "--compact")
+				{
+						compactVertices = true;
+				}
+				else if (arg == "--optimize")
+				{
+						optimizeMeshes = true;
+				}
+				else if (arg == "--meshlets")
+				{
+						buildMeshlets = true;
+				}
+				else if (arg == "--occluders")
+				{
+						buildOccluders = true;
+				}
+				else if (arg == "--force")
+				{
+						force = true;
+				}
+				else if (arg.find("--lods=") == 0)
+				{
+						numLODs = std::atoi(arg.substr(7).c_str());
+				}
+				else
+				{
+						collectModels(arg, models);
+				}
+		}
+
+		if (models.empty())
+		{
+				printf("usage: MeshCooker [--compact] [--optimize] [--lods=N] [--meshlets] [--occluders] [--force] <model files or directories...>\n");
+				return 1;
+		}
+
+		//must be set before any resource is created
+		cogs::RenderBackend::setType(cogs::RenderBackendType::NULL_BACKEND);
+
+		if (compactVertices)
+		{
+				cogs::MeshPool::setLayout(cogs::VertexLayout::compact());
+		}
+
+		cogs::Mesh::setOptimizeOnLoad(optimizeMeshes);
+		cogs::Mesh::setGeneratedLODs(static_cast<unsigned int>(numLODs));
+		cogs::Mesh::setBuildMeshlets(buildMeshlets);
+		cogs::Mesh::setBuildOccluders(buildOccluders);
+		cogs::MeshCache::setEnabled(true);
+
+		cogs::HRTimer timer;
+		int failed{ 0 };
+
+		for (const std::string& model : models)
+		{
+				const std::string cachePath = cogs::MeshCache::getCachePath(model);
+				if (force)
+				{
+						std::remove(cachePath.c_str());
+				}
+
+				timer.start();
+				std::weak_ptr<cogs::Mesh> mesh = cogs::ResourceManager::getMesh(model);
+				timer.stop();
+
+				if (mesh.expired() || mesh.lock()->getSubMeshes().empty())
+				{
+						printf("WARNING: failed to cook %s\n", model.c_str());
+						failed++;
+						continue;
+				}
+
+				unsigned int numIndices{ 0 };
+				for (const cogs::SubMesh& subMesh : mesh.lock()->getSubMeshes())
+				{
+						numIndices += subMesh.m_numIndices;
+				}
+
+				printf("%s -> %s (%u indices, %u lods, %u meshlets, %.3f ms)\n", model.c_str(), cachePath.c_str(),
+						numIndices, mesh.lock()->getNumLODs(), static_cast<unsigned int>(mesh.lock()->getMeshlets().size()), timer.milli());
+		}
+
+		cogs::ResourceManager::clear();
+		return failed == 0 ? 0 : 1;
+}
@@ -16,17 +16,54 @@
 #include <cogs\MeshRenderer.h>
 #include <cogs\IOManager.h>
 #include <cogs\BulletDebugRenderer.h>
+#include <cogs\RenderThread.h>
 
 #include "ParticleSystemController.h"
 
 int main(int argc, char** argv)
 {
+		//--headless renders offscreen without a window, --frames=N quits after N frames,
+		//--capture=file saves the last frame (for automated performance and golden-image runs),
+		//--immediate executes the commands on the main thread instead of the render thread
+		bool headless{ false };
+		bool immediate{ false };
+		int maxFrames{ 0 };
+		int frameCount{ 0 };
+		std::string captureFile{ "" };
+		for (int i = 1; i < argc; i++)
+		{
+				std::string arg = argv[i];
+				if (arg == "--headless")
+				{
+						headless = true;
+				}
+				else if (arg.find("--frames=") == 0)
+				{
+						maxFrames = std::atoi(arg.substr(9).c_str());
+				}
+				else if (arg.find("--capture=") == 0)
+				{
+						captureFile = arg.substr(10);
+				}
+				else if (arg == "--immediate")
+				{
+						immediate = true;
+				}
+		}
+
+		cogs::HRTimer runTimer;
+
 		cogs::Window window;
-		window.create("Test", 1024, 576, cogs::WindowCreationFlags::NONE);
+		window.create("Test", 1024, 576, headless ? cogs::WindowCreationFlags::HEADLESS : cogs::WindowCreationFlags::NONE);
 		window.setRelativeMouseMode(true);
 		bool quit{ false };
 		bool debugMode{ false };
 		cogs::FpsLimiter fpsLimiter(6000.0f);
+		if (headless)
+		{
+				//don't throttle automated runs
+				fpsLimiter.setMaxFPS(1000000.0f);
+		}
 
 		const glm::vec3 gravity(0.0f, -9.81f, 0.0f);
 
@@ -72,6 +109,11 @@ int main(int argc, char** argv)
 				_particle.m_position += _particle.m_velocity * _deltaTime;
 		});
 		particleSystem1.lock()->addComponent<ParticleSystemController>(cogs::KeyCode::ALPHA1, cogs::KeyCode::Q);
+		if (headless)
+		{
+				//no input on automated runs, start emitting right away
+				particleSystem1.lock()->getComponent<cogs::ParticleSystem>().lock()->play();
+		}
 
 		//std::weak_ptr<cogs::Entity> particleSystem2 = root->addChild("ParticleSystem2");
 		//particleSystem2.lock()->getComponent<cogs::Transform>().lock()->translate(glm::vec3(-20.0f, 5.0f, 5.0f));
@@ -203,6 +245,31 @@ int main(int argc, char** argv)
 
 		debugRenderer.setDebugMode(debugRenderer.DBG_DrawWireframe);
 
+		//the data the callbacks recorded for the render thread need, copied into the bucket since the render thread runs a frame behind
+		struct DebugDrawData
+		{
+				cogs::BulletDebugRenderer* renderer;
+				glm::mat4 view;
+				glm::mat4 projection;
+		};
+		struct CaptureData
+		{
+				cogs::Window* window;
+				const std::string* file;
+		};
+		CaptureData captureData{ &window, &captureFile };
+
+		//everything is loaded, from here on the main thread only records commands and the render thread owns the GL context.
+		//Without the thread running kick() executes the bucket right away, the renderer records into it either way so the frame runs in order
+		cogs::RenderThread renderThread;
+		particleRenderer->setRenderThread(&renderThread);
+		if (!immediate)
+		{
+				renderThread.start(&window);
+		}
+
+		runTimer.start();
+
 		while (!quit)
 		{
 				numActiveParticlesInScene = 0;
@@ -291,6 +358,9 @@ int main(int argc, char** argv)
 
 				//Render
 
+				//kick() swaps the buckets, so the bucket is fetched again every frame
+				cogs::CommandBucket& bucket = renderThread.getSubmissionBucket();
+
 				for (std::weak_ptr<cogs::Camera> camera : cogs::Camera::getAllCameras())
 				{
 						if (!camera.lock()->getEntity().lock()->isActive() || camera.expired())
@@ -301,11 +371,16 @@ int main(int argc, char** argv)
 						cogs::Camera::setCurrent(camera);
 
 						// set the render target
-						cogs::Framebuffer::setActive(camera.lock()->getRenderTarget());
+						cogs::Framebuffer::recordSetActive(bucket, camera.lock()->getRenderTarget());
 
 						// clear the window with the camera's background color
-						window.setClearColor(camera.lock()->getBackgroundColor());
-						window.clear(true, true);
+						const cogs::Color& backgroundColor = camera.lock()->getBackgroundColor();
+						cogs::commands::Clear* clear = bucket.add<cogs::commands::Clear>();
+						clear->mask = GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT;
+						clear->color[0] = backgroundColor.r / 255.0f;
+						clear->color[1] = backgroundColor.g / 255.0f;
+						clear->color[2] = backgroundColor.b / 255.0f;
+						clear->color[3] = backgroundColor.a / 255.0f;
 
 						particleRenderer->begin();
 
@@ -323,21 +398,55 @@ int main(int argc, char** argv)
 								//use the debug renderer to draw the debug physics world
 								//spatialhash->render(&debugRenderer);
 								//particleSystem1.lock()->getComponent<cogs::ParticleSystem>().lock()->renderBounds(&debugRenderer);
-								debugRenderer.end();
-								debugRenderer.render(camera.lock()->getViewMatrix(), camera.lock()->getProjectionMatrix(), 1.0f);
+								//nothing feeds the debug renderer on the main thread, so it uploads its lines on the render thread
+								DebugDrawData* debugDrawData = static_cast<DebugDrawData*>(bucket.allocateAuxMemory(sizeof(DebugDrawData)));
+								debugDrawData->renderer = &debugRenderer;
+								debugDrawData->view = camera.lock()->getViewMatrix();
+								debugDrawData->projection = camera.lock()->getProjectionMatrix();
+
+								cogs::commands::Callback* debugDraw = bucket.add<cogs::commands::Callback>();
+								debugDraw->function = [](void* _data)
+								{
+										DebugDrawData* data = static_cast<DebugDrawData*>(_data);
+										data->renderer->end();
+										data->renderer->render(data->view, data->projection, 1.0f);
+								};
+								debugDraw->userData = debugDrawData;
 						}
 
 						//render the camera's skybox if it has one
-						camera.lock()->renderSkybox();
+						camera.lock()->recordSkybox(bucket);
 
 						//next transparent objects
 						particleRenderer->flush();
 
 						//set the render target to the default window
-						cogs::Framebuffer::setActive(std::weak_ptr<cogs::Framebuffer>());
+						cogs::Framebuffer::recordSetActive(bucket, std::weak_ptr<cogs::Framebuffer>());
 				}
 
-				window.swapBuffer();
+				frameCount++;
+				if (maxFrames > 0 && frameCount >= maxFrames)
+				{
+						quit = true;
+						if (!captureFile.empty())
+						{
+								//read back on the thread owning the context, before the buffers are swapped
+								cogs::commands::Callback* capture = bucket.add<cogs::commands::Callback>();
+								capture->function = [](void* _data)
+								{
+										CaptureData* data = static_cast<CaptureData*>(_data);
+										data->window->saveFrame(*data->file);
+								};
+								capture->userData = &captureData;
+						}
+				}
+
+				//the render thread swaps the buffers after executing the frame
+				renderThread.kick();
+				if (!renderThread.isRunning())
+				{
+						window.swapBuffer();
+				}
 
 				fpsLimiter.endFrame();
 
@@ -362,6 +471,16 @@ int main(int argc, char** argv)
 				}
 
 		}
+		//finish the last frame and take the context back for the cleanup
+		renderThread.stop();
+		particleRenderer->setRenderThread(nullptr);
+
+		runTimer.stop();
+		if (maxFrames > 0)
+		{
+				printf("frames: %d, average frame time: %.4f ms\n", frameCount, runTimer.milli() / frameCount);
+		}
+
 		cogs::ResourceManager::clear();
 		window.close();
 		return 0;
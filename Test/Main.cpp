@@ -2,6 +2,8 @@
 #include <cogs\Camera.h>
 #include <cogs\Timing.h>
 #include <cogs\MeshRenderer.h>
+#include <cogs\Mesh.h>
+#include <cogs\Impostor.h>
 #include <cogs\KeyCode.h>
 #include <cogs\Input.h>
 #include <cogs\Random.h>
@@ -24,6 +26,8 @@
 #include <cogs\GLTexture2D.h>
 #include <cogs\SpatialHash.h>
 #include <cogs\Button.h>
+#include <cogs\RenderGraph.h>
+#include <cogs\Framebuffer.h>
 
 #include "PaddleController.h"
 #include "BallBehavior.h"
@@ -32,15 +36,48 @@
 
 int main(int argc, char** argv)
 {
+		//--headless renders offscreen without a window, --frames=N quits after N frames,
+		//--capture=file saves the last frame (for automated performance and golden-image runs)
+		bool headless{ false };
+		int maxFrames{ 0 };
+		int frameCount{ 0 };
+		std::string captureFile{ "" };
+		for (int i = 1; i < argc; i++)
+		{
+				std::string arg = argv[i];
+				if (arg == "--headless")
+				{
+						headless = true;
+				}
+				else if (arg.find("--frames=") == 0)
+				{
+						maxFrames = std::atoi(arg.substr(9).c_str());
+				}
+				else if (arg.find("--capture=") == 0)
+				{
+						captureFile = arg.substr(10);
+				}
+		}
+
+		cogs::HRTimer runTimer;
+
 		cogs::Window window;
-		window.create("Test", 1024, 576, cogs::WindowCreationFlags::NONE);
+		window.create("Test", 1024, 576, headless ? cogs::WindowCreationFlags::HEADLESS : cogs::WindowCreationFlags::NONE);
 		//window.setRelativeMouseMode(true);
 		bool quit{ false };
 		bool debugMode{ false };
 		cogs::FpsLimiter fpsLimiter(600.0f);
+		if (headless)
+		{
+				//don't throttle automated runs
+				fpsLimiter.setMaxFPS(1000000.0f);
+		}
 
 		const glm::vec3 gravity(0.0f, -9.81f, 0.0f);
 
+		//simplified versions of the meshes for distant instances
+		cogs::Mesh::setGeneratedLODs(3);
+
 		cogs::GUI::init("GUI");
 		cogs::GUI::loadScheme("TaharezLook.scheme");
 		cogs::GUI::setFont("DejaVuSans-10");
@@ -94,6 +131,19 @@ int main(int argc, char** argv)
 
 		std::shared_ptr<cogs::Renderer3D> renderer3D = std::make_shared<cogs::Renderer3D>(
 				cogs::ResourceManager::getGLSLProgram("Basic3DShader", "Shaders/Basic3DShader.vert", "Shaders/Basic3DShader.frag"));
+		renderer3D->setDepthPrePassShader(
+				cogs::ResourceManager::getGLSLProgram("DepthPrePass", "Shaders/DepthPrePass.vert", "Shaders/DepthPrePass.frag"));
+		renderer3D->setImpostorShader(
+				cogs::ResourceManager::getGLSLProgram("Impostor", "Shaders/Impostor.vert", "Shaders/Impostor.frag"));
+		renderer3D->setImpostorDistance(80.0f);
+
+		//billboards for the distant bricks and balls
+		for (const char* model : { "Models/TestModels/cube.obj", "Models/TestModels/sphere.obj" })
+		{
+				std::weak_ptr<cogs::Mesh> mesh = cogs::ResourceManager::getMesh(model);
+				mesh.lock()->setImpostor(cogs::Impostor::bake(mesh,
+						cogs::ResourceManager::getGLSLProgram("ImpostorBake", "Shaders/ImpostorBake.vert", "Shaders/ImpostorBake.frag")));
+		}
 
 		std::shared_ptr<cogs::ParticleRenderer> particleRenderer = std::make_shared<cogs::ParticleRenderer>(
 				cogs::ResourceManager::getGLSLProgram("ParticleShader", "Shaders/ParticleShader.vert", "Shaders/ParticleShader.frag"));
@@ -251,6 +301,10 @@ int main(int argc, char** argv)
 		debugRenderer.setDebugMode(debugRenderer.DBG_DrawWireframe);
 		physicsWorld->setDebugDrawer(&debugRenderer);
 
+		cogs::RenderGraph renderGraph;
+
+		runTimer.start();
+
 		while (!quit)
 		{
 				fpsLimiter.beginFrame();
@@ -319,6 +373,11 @@ int main(int argc, char** argv)
 				{
 						debugMode = !debugMode;
 				}
+				if (cogs::Input::isKeyPressed(cogs::KeyCode::ALPHA8))
+				{
+						std::weak_ptr<cogs::Camera> cam = mainCamera.lock()->getComponent<cogs::Camera>();
+						cam.lock()->setDepthPrePass(!cam.lock()->hasDepthPrePass());
+				}
 				if (cogs::Input::isKeyPressed(cogs::KeyCode::ALPHA9))
 				{
 						camera2.lock()->getComponent<cogs::Transform>().lock()->setWorldPosition(mainCamera.lock()->getComponent<cogs::Transform>().lock()->worldPosition());
@@ -344,58 +403,118 @@ int main(int argc, char** argv)
 
 				root->renderAll(mainCam);*/
 
-				//other cameras
+				//declare this frame's passes, the graph orders them and binds their render targets
+				renderGraph.reset();
+
+				cogs::RenderResource backbuffer = renderGraph.importFramebuffer("Backbuffer", std::weak_ptr<cogs::Framebuffer>());
+				std::vector<cogs::RenderResource> cameraTargets;
+
+				//the 3d scene is gathered and culled once for all cameras, the first pass does it, the others only draw their view
+				std::vector<std::weak_ptr<cogs::Camera>> activeCameras;
 				for (std::weak_ptr<cogs::Camera> camera : cogs::Camera::getAllCameras())
 				{
-						if (!camera.lock()->getEntity().lock()->isActive() || camera.expired())
+						if (!camera.expired() && camera.lock()->getEntity().lock()->isActive())
 						{
-								continue;
+								activeCameras.push_back(camera);
 						}
-						// set the current camera
-						cogs::Camera::setCurrent(camera);
-
-						// set the render target
-						cogs::Framebuffer::setActive(camera.lock()->getRenderTarget());
-
-						// clear the window with the camera's background color
-						window.setClearColor(camera.lock()->getBackgroundColor());
-						window.clear(true, true);
+				}
+				renderer3D->beginViews(activeCameras);
 
-						renderer3D->begin();
-						renderer2D->begin();
-						particleRenderer->begin();
+				for (std::weak_ptr<cogs::Camera> camera : activeCameras)
+				{
 
-						// call the render function of all entities (submits all entities with sprite and mesh renderers)
-						root->renderAll();
+						// the camera renders to its render target, or the window if it doesn't have one
+						cogs::RenderResource target = backbuffer;
+						if (!camera.lock()->getRenderTarget().expired())
+						{
+								target = renderGraph.importFramebuffer(camera.lock()->getEntity().lock()->getName(), camera.lock()->getRenderTarget());
+								cameraTargets.push_back(target);
+						}
 
-						renderer3D->end();
-						renderer2D->end();
-						particleRenderer->end();
+						renderGraph.addPass(camera.lock()->getEntity().lock()->getName(),
+								[target](cogs::RenderGraph::PassBuilder& _builder)
+						{
+								_builder.write(target);
+						},
+								[&, camera](const cogs::RenderGraph&)
+						{
+								// set the current camera
+								cogs::Camera::setCurrent(camera);
+
+								// clear the window with the camera's background color
+								window.setClearColor(camera.lock()->getBackgroundColor());
+								window.clear(true, true);
+
+								renderer3D->begin();
+								renderer2D->begin();
+								particleRenderer->begin();
+
+								// call the render function of all entities (submits all entities with sprite and mesh renderers)
+								root->renderAll();
+
+								renderer3D->end();
+								renderer2D->end();
+								particleRenderer->end();
+
+								renderer3D->flush();
+
+								if (debugMode)
+								{
+										//use the debug renderer to draw the debug physics world
+										physicsWorld->debugDrawWorld();
+										camera2.lock()->getComponent<cogs::Camera>().lock()->renderFrustum(&debugRenderer);
+										//debugRenderer.drawMeshSphereBounds(nanosuit);
+										debugRenderer.end();
+										debugRenderer.render(camera.lock()->getViewMatrix(), camera.lock()->getProjectionMatrix(), 5.0f);
+								}
+
+								//render the camera's skybox if it has one
+								camera.lock()->renderSkybox();
+
+								particleRenderer->flush();
+								renderer2D->flush();
+						});
+				}
 
-						renderer3D->flush();
+				renderGraph.addPass("GUI",
+						[backbuffer](cogs::RenderGraph::PassBuilder& _builder)
+				{
+						_builder.write(backbuffer);
+				},
+						[](const cogs::RenderGraph&)
+				{
+						cogs::GUI::render();
+				});
 
-						if (debugMode)
+				//post processing samples the cameras' render targets
+				renderGraph.addPass("PostProcess",
+						[backbuffer, &cameraTargets](cogs::RenderGraph::PassBuilder& _builder)
+				{
+						for (cogs::RenderResource target : cameraTargets)
 						{
-								//use the debug renderer to draw the debug physics world
-								physicsWorld->debugDrawWorld();
-								camera2.lock()->getComponent<cogs::Camera>().lock()->renderFrustum(&debugRenderer);
-								//debugRenderer.drawMeshSphereBounds(nanosuit);
-								debugRenderer.end();
-								debugRenderer.render(camera.lock()->getViewMatrix(), camera.lock()->getProjectionMatrix(), 5.0f);
+								_builder.read(target);
 						}
+						_builder.write(backbuffer);
+				},
+						[&root](const cogs::RenderGraph&)
+				{
+						root->postProcessAll();
+				});
 
-						//render the camera's skybox if it has one
-						camera.lock()->renderSkybox();
+				renderGraph.compile();
+				renderGraph.execute();
 
-						particleRenderer->flush();
-						renderer2D->flush();
-						//set the render target to the default window
-						cogs::Framebuffer::setActive(std::weak_ptr<cogs::Framebuffer>());
-				}
+				renderer3D->endViews();
 
-				cogs::GUI::render();
-				
-				root->postProcessAll();
+				frameCount++;
+				if (maxFrames > 0 && frameCount >= maxFrames)
+				{
+						quit = true;
+						if (!captureFile.empty())
+						{
+								window.saveFrame(captureFile);
+						}
+				}
 
 				window.swapBuffer();
 
@@ -413,7 +532,9 @@ int main(int argc, char** argv)
 				{
 						fps /= 100.0f;
 						dt /= 100.0f;
-						window.setWindowTitle("FPS: " + std::to_string(fps) + " DT: " + std::to_string(dt));
+						window.setWindowTitle("FPS: " + std::to_string(fps) + " DT: " + std::to_string(dt) +
+								" Z-prepass: " + std::to_string(renderer3D->getDepthPrePassTime()) + " ms" +
+								" 3D: " + std::to_string(renderer3D->getMainPassTime()) + " ms");
 						counter = 0;
 				}
 				else
@@ -423,6 +544,12 @@ int main(int argc, char** argv)
 
 		}
 		cogs::GUI::destroy();
+		runTimer.stop();
+		if (maxFrames > 0)
+		{
+				printf("frames: %d, average frame time: %.4f ms\n", frameCount, runTimer.milli() / frameCount);
+		}
+
 		cogs::ResourceManager::clear();
 		window.close();
 		return 0;
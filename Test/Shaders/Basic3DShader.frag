@@ -12,6 +12,9 @@ in VS_OUT
 
 flat in int instanceID;
 
+flat in vec4 tint;
+flat in vec3 emissive;
+
 struct Material
 {
 	sampler2D texture_diffuse;
@@ -101,7 +104,7 @@ void main()
 	
 	vec3 viewDir = normalize(fs_in.cameraPos - fs_in.position);
 	
-	vec3 textureColor = texture(material.texture_diffuse, fs_in.uv).rgb;
+	vec3 textureColor = texture(material.texture_diffuse, fs_in.uv).rgb * tint.rgb;
 	vec3 specularColor = texture(material.texture_specular, fs_in.uv).rgb;
 	
 	vec3 result = vec3(0.0f, 0.0f, 0.0f);
@@ -124,7 +127,7 @@ void main()
 		result += CalcSpotLight(spotLights[i], normal, fs_in.position, viewDir, textureColor, specularColor);
 	}
 	
-	color = vec4(result, 1.0f);
+	color = vec4(result + emissive, 1.0f);
 }
 
 vec3 CalcPointLight(PointLight _light, vec3 _normal, vec3 _fragPos, vec3 _viewDir, vec3 _textureColor, vec3 _specularColor)
@@ -2,9 +2,10 @@
 
 layout (location = 0) in vec3 position;
 layout (location = 1) in vec2 uv;
-layout (location = 2) in vec3 normal;
-layout (location = 3) in vec3 tangent;
-layout (location = 4) in mat4 toWorldMat;
+layout (location = 2) in vec4 normal;
+layout (location = 3) in vec4 tangent;
+layout (location = 4) in mat4 instance;
+layout (location = 8) in uint materialParamsIndex;
 
 out VS_OUT
 {
@@ -16,12 +17,50 @@ out VS_OUT
 
 flat out int instanceID;
 
+//the material overrides of the instance
+flat out vec4 tint;
+flat out vec3 emissive;
+
+//the depth pre-pass shader transforms positions the same way, keep them bit-identical
+invariant gl_Position;
+
 uniform mat4 projection;
 uniform mat4 view;
 // uniform mat4 model;
 
+//the material params blocks of the instances, three texels each: tint, emissive and uv transform. Block 0 changes nothing
+uniform samplerBuffer materialParams;
+
+//directions from compact vertex layouts are octahedral encoded in xy with w = 0, float ones get the default w = 1
+vec3 decodeDirection(vec4 _direction)
+{
+	if (_direction.w > 0.5)
+	{
+		return _direction.xyz;
+	}
+	vec3 n = vec3(_direction.xy, 1.0 - abs(_direction.x) - abs(_direction.y));
+	if (n.z < 0.0)
+	{
+		n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+	}
+	return normalize(n);
+}
+
+//compact instances are the first three rows of an affine matrix with the fourth column read as (0, 0, 0, 0),
+//full ones are the columns of the matrix and always end in w = 1
+mat4 decodeWorldMat(mat4 _instance)
+{
+	if (_instance[3].w > 0.5)
+	{
+		return _instance;
+	}
+	return transpose(mat4(_instance[0], _instance[1], _instance[2], vec4(0.0, 0.0, 0.0, 1.0)));
+}
+
 void main() 
 {
+	mat4 toWorldMat = decodeWorldMat(instance);
+
     //transform the world space coordinates from the spritebatch to clip coordinates with the ortho projection matrix
     gl_Position = projection * view * toWorldMat * vec4(position, 1.0);
 
@@ -33,14 +72,18 @@ void main()
  
 	vs_out.cameraPos = -d * rotMat;
 	
-    vs_out.uv = uv;
+	int paramsBlock = int(materialParamsIndex) * 3;
+	vec4 uvTransform = texelFetch(materialParams, paramsBlock + 2);
+    vs_out.uv = uv * uvTransform.xy + uvTransform.zw;
+	tint = texelFetch(materialParams, paramsBlock);
+	emissive = texelFetch(materialParams, paramsBlock + 1).rgb;
 	
 	mat3 normalMatrix = transpose(inverse(mat3(toWorldMat)));	
 	
 	//the tangent vector
-	vec3 T = normalize(normalMatrix * tangent);
+	vec3 T = normalize(normalMatrix * decodeDirection(tangent));
 	
-	vec3 N = normalize(normalMatrix * normal);
+	vec3 N = normalize(normalMatrix * decodeDirection(normal));
 	
 	// re-orthogonalize T with respect to N
 	T = normalize(T - dot(T, N) * N);
@@ -0,0 +1,6 @@
+#version 330 core
+
+void main() 
+{
+	//depth only, color writes are masked off
+}
@@ -0,0 +1,27 @@
+#version 330 core
+
+layout (location = 0) in vec3 position;
+layout (location = 4) in mat4 instance;
+
+//must match the position transform of Basic3DShader.vert exactly for the GL_EQUAL depth test of the main pass
+invariant gl_Position;
+
+uniform mat4 projection;
+uniform mat4 view;
+
+//compact instances are the first three rows of an affine matrix with the fourth column read as (0, 0, 0, 0),
+//full ones are the columns of the matrix and always end in w = 1
+mat4 decodeWorldMat(mat4 _instance)
+{
+    if (_instance[3].w > 0.5)
+    {
+        return _instance;
+    }
+    return transpose(mat4(_instance[0], _instance[1], _instance[2], vec4(0.0, 0.0, 0.0, 1.0)));
+}
+
+void main() 
+{
+    mat4 toWorldMat = decodeWorldMat(instance);
+    gl_Position = projection * view * toWorldMat * vec4(position, 1.0);
+}
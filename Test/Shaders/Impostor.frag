@@ -0,0 +1,22 @@
+#version 330 core
+
+out vec4 color;
+
+in VS_OUT
+{
+	vec2 uv;
+} fs_in;
+
+uniform sampler2D atlas;
+
+void main() 
+{
+	vec4 texel = texture(atlas, fs_in.uv);
+
+	//cut out the background, the quads write depth like opaque geometry
+	if (texel.a < 0.5)
+	{
+		discard;
+	}
+	color = vec4(texel.rgb, 1.0);
+}
@@ -0,0 +1,77 @@
+#version 330 core
+
+//corner of the quad in [-0.5, 0.5]
+layout (location = 0) in vec3 position;
+layout (location = 4) in mat4 instance;
+
+out VS_OUT
+{
+	vec2 uv;
+} vs_out;
+
+uniform mat4 projection;
+uniform mat4 view;
+
+//bounding sphere of the mesh in model space and the layout of the atlas
+uniform vec3 impostorCenter;
+uniform float impostorRadius;
+uniform float framesPerSide;
+
+vec2 octEncode(vec3 _direction)
+{
+	vec3 n = _direction / (abs(_direction.x) + abs(_direction.y) + abs(_direction.z));
+	if (n.z < 0.0)
+	{
+		return (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+	}
+	return n.xy;
+}
+
+//must match octDecode of Impostor.cpp
+vec3 octDecode(vec2 _encoded)
+{
+	vec3 n = vec3(_encoded, 1.0 - abs(_encoded.x) - abs(_encoded.y));
+	if (n.z < 0.0)
+	{
+		n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+	}
+	return normalize(n);
+}
+
+//compact instances are the first three rows of an affine matrix with the fourth column read as (0, 0, 0, 0),
+//full ones are the columns of the matrix and always end in w = 1
+mat4 decodeWorldMat(mat4 _instance)
+{
+	if (_instance[3].w > 0.5)
+	{
+		return _instance;
+	}
+	return transpose(mat4(_instance[0], _instance[1], _instance[2], vec4(0.0, 0.0, 0.0, 1.0)));
+}
+
+void main() 
+{
+	mat4 toWorldMat = decodeWorldMat(instance);
+
+	mat3 rotMat = mat3(view);
+	vec3 d = vec3(view[3][0], view[3][1], view[3][2]);
+	vec3 cameraPos = -d * rotMat;
+
+	//the direction to the camera in model space, assuming a uniform scale
+	vec3 center_worldSpace = vec3(toWorldMat * vec4(impostorCenter, 1.0));
+	vec3 toCamera = normalize(transpose(mat3(toWorldMat)) * (cameraPos - center_worldSpace));
+
+	//the frame baked from the closest direction
+	vec2 cell = clamp(floor((octEncode(toCamera) * 0.5 + 0.5) * framesPerSide), vec2(0.0), vec2(framesPerSide - 1.0));
+	vec3 frameDirection = octDecode((cell + 0.5) / framesPerSide * 2.0 - 1.0);
+
+	//orient the quad like the baking camera of that frame
+	vec3 up = abs(frameDirection.y) > 0.999 ? vec3(0.0, 0.0, 1.0) : vec3(0.0, 1.0, 0.0);
+	vec3 right = normalize(cross(up, frameDirection));
+	vec3 frameUp = cross(frameDirection, right);
+
+	vec3 corner = impostorCenter + (right * position.x + frameUp * position.y) * 2.0 * impostorRadius;
+	gl_Position = projection * view * toWorldMat * vec4(corner, 1.0);
+
+	vs_out.uv = (cell + position.xy + 0.5) / framesPerSide;
+}
@@ -0,0 +1,26 @@
+#version 330 core
+
+out vec4 color;
+
+in VS_OUT
+{
+	vec2 uv;
+	vec3 normal;
+} fs_in;
+
+//model space direction towards the baking camera
+uniform vec3 viewDirection;
+
+uniform int hasDiffuseMap;
+uniform sampler2D diffuseMap;
+
+void main() 
+{
+	vec3 albedo = hasDiffuseMap != 0 ? texture(diffuseMap, fs_in.uv).rgb : vec3(1.0);
+
+	//the impostor can't be lit by the scene, bake a soft light from the viewer's side instead
+	float light = 0.35 + 0.65 * max(dot(normalize(fs_in.normal), viewDirection), 0.0);
+
+	//alpha marks the covered texels
+	color = vec4(albedo * light, 1.0);
+}
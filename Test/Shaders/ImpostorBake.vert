@@ -0,0 +1,39 @@
+#version 330 core
+
+layout (location = 0) in vec3 position;
+layout (location = 1) in vec2 uv;
+layout (location = 2) in vec4 normal;
+
+out VS_OUT
+{
+	vec2 uv;
+	vec3 normal;
+} vs_out;
+
+uniform mat4 projection;
+uniform mat4 view;
+//the dequantization of the mesh, a uniform scale and translation
+uniform mat4 model;
+
+//same decoding as Basic3DShader.vert
+vec3 decodeDirection(vec4 _direction)
+{
+	if (_direction.w > 0.5)
+	{
+		return _direction.xyz;
+	}
+	vec3 n = vec3(_direction.xy, 1.0 - abs(_direction.x) - abs(_direction.y));
+	if (n.z < 0.0)
+	{
+		n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+	}
+	return normalize(n);
+}
+
+void main() 
+{
+	gl_Position = projection * view * model * vec4(position, 1.0);
+
+	vs_out.uv = uv;
+	vs_out.normal = decodeDirection(normal);
+}
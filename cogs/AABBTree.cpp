@@ -0,0 +1,495 @@
+#include "AABBTree.h"
+#include "Frustum.h"
+#include "BulletDebugRenderer.h"
+
+#include <glm\glm.hpp>
+
+namespace cogs
+{
+		namespace
+		{
+				//enough for the balanced trees of millions of objects
+				const size_t STACK_SIZE = 64;
+
+				AABB unite(const AABB& _a, const AABB& _b)
+				{
+						return AABB{ glm::min(_a.m_min, _b.m_min), glm::max(_a.m_max, _b.m_max) };
+				}
+
+				//half the surface area, the cost of a node is how likely a query hits it
+				float surfaceArea(const AABB& _bounds)
+				{
+						glm::vec3 size = _bounds.m_max - _bounds.m_min;
+						return size.x * size.y + size.y * size.z + size.z * size.x;
+				}
+
+				bool contains(const AABB& _outer, const AABB& _inner)
+				{
+						return glm::all(glm::lessThanEqual(_outer.m_min, _inner.m_min)) && glm::all(glm::lessThanEqual(_inner.m_max, _outer.m_max));
+				}
+
+				bool overlaps(const AABB& _a, const AABB& _b)
+				{
+						return glm::all(glm::lessThanEqual(_a.m_min, _b.m_max)) && glm::all(glm::lessThanEqual(_b.m_min, _a.m_max));
+				}
+
+				bool overlaps(const AABB& _bounds, const glm::vec3& _center, float _radius)
+				{
+						glm::vec3 closest = glm::clamp(_center, _bounds.m_min, _bounds.m_max);
+						glm::vec3 offset = closest - _center;
+						return glm::dot(offset, offset) <= _radius * _radius;
+				}
+
+				//slab test, _entry is where the ray enters the box, 0 if it starts inside
+				bool intersects(const AABB& _bounds, const glm::vec3& _origin, const glm::vec3& _inverseDirection, float _maxDistance, float& _entry)
+				{
+						glm::vec3 t1 = (_bounds.m_min - _origin) * _inverseDirection;
+						glm::vec3 t2 = (_bounds.m_max - _origin) * _inverseDirection;
+						glm::vec3 entries = glm::min(t1, t2);
+						glm::vec3 exits = glm::max(t1, t2);
+
+						_entry = glm::max(glm::max(entries.x, entries.y), glm::max(entries.z, 0.0f));
+						float exit = glm::min(glm::min(exits.x, exits.y), glm::min(exits.z, _maxDistance));
+						return _entry <= exit;
+				}
+		}
+
+		AABBTree::AABBTree(float _margin) :
+				m_margin(_margin)
+		{
+		}
+
+		AABBTree::~AABBTree()
+		{
+		}
+
+		int AABBTree::insert(const AABB& _bounds, void* _userData)
+		{
+				int leaf = allocateNode();
+
+				float margin = glm::length(_bounds.m_max - _bounds.m_min) * m_margin;
+				m_nodes[leaf].m_bounds = AABB{ _bounds.m_min - margin, _bounds.m_max + margin };
+				m_nodes[leaf].m_tightBounds = _bounds;
+				m_nodes[leaf].m_userData = _userData;
+				m_nodes[leaf].m_height = 0;
+
+				insertLeaf(leaf);
+				m_numProxies++;
+
+				return leaf;
+		}
+
+		void AABBTree::remove(int _proxy)
+		{
+				removeLeaf(_proxy);
+				freeNode(_proxy);
+				m_numProxies--;
+		}
+
+		bool AABBTree::move(int _proxy, const AABB& _bounds)
+		{
+				m_nodes[_proxy].m_tightBounds = _bounds;
+				if (contains(m_nodes[_proxy].m_bounds, _bounds))
+				{
+						return false;
+				}
+
+				removeLeaf(_proxy);
+
+				float margin = glm::length(_bounds.m_max - _bounds.m_min) * m_margin;
+				m_nodes[_proxy].m_bounds = AABB{ _bounds.m_min - margin, _bounds.m_max + margin };
+
+				insertLeaf(_proxy);
+				return true;
+		}
+
+		void AABBTree::clear()
+		{
+				m_nodes.clear();
+				m_root = NULL_NODE;
+				m_freeList = NULL_NODE;
+				m_numProxies = 0;
+		}
+
+		void AABBTree::queryFrustum(const Frustum& _frustum, const std::function<void(int, unsigned int)>& _callback) const
+		{
+				if (m_root == NULL_NODE)
+				{
+						return;
+				}
+
+				//the node and the planes left to test it against
+				std::pair<int, unsigned int> stack[STACK_SIZE];
+				size_t size{ 0 };
+				stack[size++] = std::make_pair(m_root, Frustum::ALL_PLANES);
+
+				//siblings are close to each other, so they are mostly culled by the same plane
+				unsigned int lastPlane{ 0 };
+
+				while (size > 0)
+				{
+						const int index = stack[--size].first;
+						unsigned int planeMask = stack[size].second;
+						const Node& node = m_nodes[index];
+
+						if (planeMask != 0)
+						{
+								const AABB& bounds = node.isLeaf() ? node.m_tightBounds : node.m_bounds;
+								if (_frustum.boxInFrustum(bounds.m_min, bounds.m_max, planeMask, lastPlane) == Containment::OUTSIDE)
+								{
+										continue;
+								}
+						}
+
+						if (node.isLeaf())
+						{
+								_callback(index, planeMask);
+						}
+						else
+						{
+								stack[size++] = std::make_pair(node.m_child1, planeMask);
+								stack[size++] = std::make_pair(node.m_child2, planeMask);
+						}
+				}
+		}
+
+		void AABBTree::queryBox(const AABB& _bounds, const std::function<void(int)>& _callback) const
+		{
+				if (m_root == NULL_NODE)
+				{
+						return;
+				}
+
+				int stack[STACK_SIZE];
+				size_t size{ 0 };
+				stack[size++] = m_root;
+
+				while (size > 0)
+				{
+						const int index = stack[--size];
+						const Node& node = m_nodes[index];
+						if (node.isLeaf())
+						{
+								if (overlaps(node.m_tightBounds, _bounds))
+								{
+										_callback(index);
+								}
+						}
+						else if (overlaps(node.m_bounds, _bounds))
+						{
+								stack[size++] = node.m_child1;
+								stack[size++] = node.m_child2;
+						}
+				}
+		}
+
+		void AABBTree::querySphere(const glm::vec3& _center, float _radius, const std::function<void(int)>& _callback) const
+		{
+				if (m_root == NULL_NODE)
+				{
+						return;
+				}
+
+				int stack[STACK_SIZE];
+				size_t size{ 0 };
+				stack[size++] = m_root;
+
+				while (size > 0)
+				{
+						const int index = stack[--size];
+						const Node& node = m_nodes[index];
+						if (node.isLeaf())
+						{
+								if (overlaps(node.m_tightBounds, _center, _radius))
+								{
+										_callback(index);
+								}
+						}
+						else if (overlaps(node.m_bounds, _center, _radius))
+						{
+								stack[size++] = node.m_child1;
+								stack[size++] = node.m_child2;
+						}
+				}
+		}
+
+		int AABBTree::raycast(const glm::vec3& _origin, const glm::vec3& _direction, float _maxDistance, float& _distance) const
+		{
+				int closest = NULL_NODE;
+				if (m_root == NULL_NODE)
+				{
+						return closest;
+				}
+
+				const glm::vec3 inverseDirection = 1.0f / _direction;
+				float maxDistance = _maxDistance;
+
+				int stack[STACK_SIZE];
+				size_t size{ 0 };
+				stack[size++] = m_root;
+
+				while (size > 0)
+				{
+						const int index = stack[--size];
+						const Node& node = m_nodes[index];
+
+						//only boxes closer than the closest hit so far can hold a closer one
+						float entry{ 0.0f };
+						if (!intersects(node.isLeaf() ? node.m_tightBounds : node.m_bounds, _origin, inverseDirection, maxDistance, entry))
+						{
+								continue;
+						}
+
+						if (node.isLeaf())
+						{
+								closest = index;
+								maxDistance = entry;
+						}
+						else
+						{
+								stack[size++] = node.m_child1;
+								stack[size++] = node.m_child2;
+						}
+				}
+
+				_distance = maxDistance;
+				return closest;
+		}
+
+		void AABBTree::render(BulletDebugRenderer* _renderer) const
+		{
+				for (const Node& node : m_nodes)
+				{
+						if (node.m_height < 0)
+						{
+								continue;
+						}
+
+						//the leaves are drawn in green, the rest in white
+						const AABB& bounds = node.m_bounds;
+						_renderer->drawBox(btVector3(bounds.m_min.x, bounds.m_min.y, bounds.m_min.z),
+								btVector3(bounds.m_max.x, bounds.m_max.y, bounds.m_max.z),
+								node.isLeaf() ? btVector3(0.0f, 1.0f, 0.0f) : btVector3(1.0f, 1.0f, 1.0f));
+				}
+		}
+
+		int AABBTree::allocateNode()
+		{
+				if (m_freeList == NULL_NODE)
+				{
+						m_nodes.push_back(Node());
+						return static_cast<int>(m_nodes.size()) - 1;
+				}
+
+				int node = m_freeList;
+				m_freeList = m_nodes[node].m_parent;
+				m_nodes[node] = Node();
+				return node;
+		}
+
+		void AABBTree::freeNode(int _node)
+		{
+				m_nodes[_node].m_height = -1;
+				m_nodes[_node].m_userData = nullptr;
+				m_nodes[_node].m_parent = m_freeList;
+				m_freeList = _node;
+		}
+
+		void AABBTree::insertLeaf(int _leaf)
+		{
+				if (m_root == NULL_NODE)
+				{
+						m_root = _leaf;
+						m_nodes[_leaf].m_parent = NULL_NODE;
+						return;
+				}
+
+				//walk down to the sibling which makes the tree grow the least in surface area
+				const AABB leafBounds = m_nodes[_leaf].m_bounds;
+				int index = m_root;
+				while (!m_nodes[index].isLeaf())
+				{
+						const Node& node = m_nodes[index];
+						const float area = surfaceArea(node.m_bounds);
+						const float combinedArea = surfaceArea(unite(node.m_bounds, leafBounds));
+
+						//pairing the leaf with this node makes a new parent
+						const float cost = 2.0f * combinedArea;
+						//descending grows this node in any case
+						const float inheritanceCost = 2.0f * (combinedArea - area);
+
+						auto descendCost = [&](int _child)
+						{
+								const Node& child = m_nodes[_child];
+								float grownArea = surfaceArea(unite(child.m_bounds, leafBounds));
+								return (child.isLeaf() ? grownArea : grownArea - surfaceArea(child.m_bounds)) + inheritanceCost;
+						};
+						const float cost1 = descendCost(node.m_child1);
+						const float cost2 = descendCost(node.m_child2);
+
+						if (cost < cost1 && cost < cost2)
+						{
+								break;
+						}
+						index = cost1 < cost2 ? node.m_child1 : node.m_child2;
+				}
+
+				const int sibling = index;
+				const int oldParent = m_nodes[sibling].m_parent;
+				const int newParent = allocateNode();
+
+				m_nodes[newParent].m_parent = oldParent;
+				m_nodes[newParent].m_bounds = unite(leafBounds, m_nodes[sibling].m_bounds);
+				m_nodes[newParent].m_height = m_nodes[sibling].m_height + 1;
+				m_nodes[newParent].m_child1 = sibling;
+				m_nodes[newParent].m_child2 = _leaf;
+				m_nodes[sibling].m_parent = newParent;
+				m_nodes[_leaf].m_parent = newParent;
+
+				if (oldParent == NULL_NODE)
+				{
+						m_root = newParent;
+				}
+				else if (m_nodes[oldParent].m_child1 == sibling)
+				{
+						m_nodes[oldParent].m_child1 = newParent;
+				}
+				else
+				{
+						m_nodes[oldParent].m_child2 = newParent;
+				}
+
+				//refit and rebalance the ancestors
+				index = m_nodes[_leaf].m_parent;
+				while (index != NULL_NODE)
+				{
+						index = balance(index);
+
+						Node& node = m_nodes[index];
+						node.m_height = 1 + glm::max(m_nodes[node.m_child1].m_height, m_nodes[node.m_child2].m_height);
+						node.m_bounds = unite(m_nodes[node.m_child1].m_bounds, m_nodes[node.m_child2].m_bounds);
+
+						index = node.m_parent;
+				}
+		}
+
+		void AABBTree::removeLeaf(int _leaf)
+		{
+				if (_leaf == m_root)
+				{
+						m_root = NULL_NODE;
+						return;
+				}
+
+				const int parent = m_nodes[_leaf].m_parent;
+				const int grandParent = m_nodes[parent].m_parent;
+				const int sibling = m_nodes[parent].m_child1 == _leaf ? m_nodes[parent].m_child2 : m_nodes[parent].m_child1;
+
+				//the sibling takes the place of the parent
+				freeNode(parent);
+				m_nodes[sibling].m_parent = grandParent;
+
+				if (grandParent == NULL_NODE)
+				{
+						m_root = sibling;
+						return;
+				}
+
+				if (m_nodes[grandParent].m_child1 == parent)
+				{
+						m_nodes[grandParent].m_child1 = sibling;
+				}
+				else
+				{
+						m_nodes[grandParent].m_child2 = sibling;
+				}
+
+				int index = grandParent;
+				while (index != NULL_NODE)
+				{
+						index = balance(index);
+
+						Node& node = m_nodes[index];
+						node.m_height = 1 + glm::max(m_nodes[node.m_child1].m_height, m_nodes[node.m_child2].m_height);
+						node.m_bounds = unite(m_nodes[node.m_child1].m_bounds, m_nodes[node.m_child2].m_bounds);
+
+						index = node.m_parent;
+				}
+		}
+
+		int AABBTree::balance(int _node)
+		{
+				const int iA = _node;
+				Node& a = m_nodes[iA];
+				if (a.isLeaf() || a.m_height < 2)
+				{
+						return iA;
+				}
+
+				const int iB = a.m_child1;
+				const int iC = a.m_child2;
+				Node& b = m_nodes[iB];
+				Node& c = m_nodes[iC];
+
+				//the child taking the place of A, and its children
+				auto rotateUp = [&](int _iUp, Node& _up, Node& _other, bool _upIsChild1) -> int
+				{
+						const int iF = _up.m_child1;
+						const int iG = _up.m_child2;
+						Node& f = m_nodes[iF];
+						Node& g = m_nodes[iG];
+
+						_up.m_child1 = iA;
+						_up.m_parent = a.m_parent;
+						a.m_parent = _iUp;
+
+						if (_up.m_parent == NULL_NODE)
+						{
+								m_root = _iUp;
+						}
+						else if (m_nodes[_up.m_parent].m_child1 == iA)
+						{
+								m_nodes[_up.m_parent].m_child1 = _iUp;
+						}
+						else
+						{
+								m_nodes[_up.m_parent].m_child2 = _iUp;
+						}
+
+						//the higher grandchild stays with the rotated node, the lower one moves to A
+						const int iHigh = f.m_height > g.m_height ? iF : iG;
+						const int iLow = f.m_height > g.m_height ? iG : iF;
+						Node& high = m_nodes[iHigh];
+						Node& low = m_nodes[iLow];
+
+						_up.m_child2 = iHigh;
+						if (_upIsChild1)
+						{
+								a.m_child1 = iLow;
+						}
+						else
+						{
+								a.m_child2 = iLow;
+						}
+						low.m_parent = iA;
+
+						a.m_bounds = unite(_other.m_bounds, low.m_bounds);
+						a.m_height = 1 + glm::max(_other.m_height, low.m_height);
+						_up.m_bounds = unite(a.m_bounds, high.m_bounds);
+						_up.m_height = 1 + glm::max(a.m_height, high.m_height);
+
+						return _iUp;
+				};
+
+				const int difference = c.m_height - b.m_height;
+				if (difference > 1)
+				{
+						return rotateUp(iC, c, b, false);
+				}
+				if (difference < -1)
+				{
+						return rotateUp(iB, b, c, true);
+				}
+				return iA;
+		}
+}
@@ -0,0 +1,128 @@
+#ifndef AABB_TREE_H
+#define AABB_TREE_H
+
+#include <glm\vec3.hpp>
+#include <vector>
+#include <functional>
+
+namespace cogs
+{
+		class Frustum;
+		class BulletDebugRenderer;
+
+		/* An axis aligned box in world space */
+		struct AABB
+		{
+				glm::vec3 m_min{ 0.0f };
+				glm::vec3 m_max{ 0.0f };
+		};
+
+		/**
+		* \brief A dynamic bounding volume hierarchy of axis aligned boxes.
+		* Every object is a leaf with its box grown by a margin, so small movements don't touch the tree.
+		* Leaves are inserted next to the sibling which grows the surface area the least,
+		* and the tree is kept balanced with rotations, queries only descend into the nodes they overlap
+		*/
+		class AABBTree
+		{
+		public:
+				static const int NULL_NODE = -1;
+
+				/**
+				* \param _margin - how much the boxes of the leaves are grown, relative to the diagonal of the object's box
+				*/
+				AABBTree(float _margin = 0.1f);
+				~AABBTree();
+
+				/**
+				* \brief adds an object to the tree
+				* \return the proxy of the object, valid until it gets removed
+				*/
+				int insert(const AABB& _bounds, void* _userData);
+
+				/**
+				* \brief removes the object of the proxy
+				*/
+				void remove(int _proxy);
+
+				/**
+				* \brief updates the box of an object, it's only reinserted if it left its grown box
+				* \return true if the tree has changed
+				*/
+				bool move(int _proxy, const AABB& _bounds);
+
+				/**
+				* \brief removes every object
+				*/
+				void clear();
+
+				inline void* getUserData(int _proxy)			const { return m_nodes[_proxy].m_userData; }
+				inline const AABB& getBounds(int _proxy)	const { return m_nodes[_proxy].m_tightBounds; }
+				inline size_t getNumProxies()							const noexcept { return m_numProxies; }
+				inline int getHeight()												const noexcept { return m_root == NULL_NODE ? 0 : m_nodes[m_root].m_height; }
+
+				/**
+				* \brief calls _callback with the proxy of every object in the frustum and the planes its box crosses,
+				* 0 if it's inside. The objects of a node inside the frustum are reported without further tests
+				*/
+				void queryFrustum(const Frustum& _frustum, const std::function<void(int, unsigned int)>& _callback) const;
+
+				/**
+				* \brief calls _callback with the proxy of every object overlapping the box
+				*/
+				void queryBox(const AABB& _bounds, const std::function<void(int)>& _callback) const;
+
+				/**
+				* \brief calls _callback with the proxy of every object overlapping the sphere
+				*/
+				void querySphere(const glm::vec3& _center, float _radius, const std::function<void(int)>& _callback) const;
+
+				/**
+				* \brief finds the closest object a ray hits
+				* \param _origin, _direction - the ray, the direction doesn't have to be normalized
+				* \param _maxDistance - the length of the ray in units of _direction
+				* \param[out] _distance - where the ray enters the box of the object hit
+				* \return the proxy of the object hit, NULL_NODE if nothing is hit
+				*/
+				int raycast(const glm::vec3& _origin, const glm::vec3& _direction, float _maxDistance, float& _distance) const;
+
+				/**
+				* \brief draws the boxes of all the nodes, for debugging
+				*/
+				void render(BulletDebugRenderer* _renderer) const;
+
+		private:
+				struct Node
+				{
+						AABB m_bounds; ///< the grown box of a leaf, or the union of the children
+						AABB m_tightBounds; ///< the box of the object of a leaf
+						void* m_userData{ nullptr };
+						int m_parent{ NULL_NODE }; ///< the next free node while the node is unused
+						int m_child1{ NULL_NODE };
+						int m_child2{ NULL_NODE };
+						int m_height{ -1 }; ///< 0 for leaves, -1 for unused nodes
+
+						inline bool isLeaf() const noexcept { return m_child1 == NULL_NODE; }
+				};
+
+				int allocateNode();
+				void freeNode(int _node);
+
+				void insertLeaf(int _leaf);
+				void removeLeaf(int _leaf);
+
+				/**
+				* \brief rotates the higher child of the node up if the heights of its children differ by more than 1
+				* \return the node which took the place of _node
+				*/
+				int balance(int _node);
+
+				std::vector<Node> m_nodes;
+				int m_root{ NULL_NODE };
+				int m_freeList{ NULL_NODE };
+				size_t m_numProxies{ 0 };
+				float m_margin{ 0.1f };
+		};
+}
+
+#endif // !AABB_TREE_H
@@ -175,16 +175,21 @@ namespace cogs
 				}
 		}
 
+		void Camera::recordSkybox(CommandBucket& _bucket)
+		{
+				if (!m_skybox.expired())
+				{
+						m_skybox.lock()->recordRender(_bucket);
+				}
+		}
+
 		void Camera::updateView()
 		{
 				m_oldTransform = *m_transform.lock();
 
 				m_viewMatrix = glm::inverse(m_oldTransform.worldTransform());
 
-				m_frustum.update(m_oldTransform.worldPosition(),
-						m_oldTransform.worldForwardAxis(),
-						m_oldTransform.worldRightAxis(),
-						m_oldTransform.worldUpAxis());
+				m_frustum.update(getProjectionMatrix() * m_viewMatrix);
 		}
 
 		void Camera::updateProjection()
@@ -193,14 +198,14 @@ namespace cogs
 				{
 						m_perspMatrix = glm::perspective(glm::radians(static_cast<float>(m_fov)),
 								getAspectRatio(), m_nearPlane, m_farPlane);
-
-						//update the frustum
-						m_frustum.setCamInternals(glm::radians((float)m_fov), getAspectRatio(), m_nearPlane, m_farPlane);
 				}
 				else
 				{
 						m_orthoMatrix = glm::ortho(0.0f, static_cast<float>(m_cameraWidth) * m_size,
 								0.0f, static_cast<float>(m_cameraHeight) * m_size, m_nearPlane, m_farPlane);
 				}
+
+				//the planes come from the matrices, so both projection types get culled
+				m_frustum.update(getProjectionMatrix() * m_viewMatrix);
 		}
 }
\ No newline at end of file
@@ -9,6 +9,7 @@
 namespace cogs
 {
 		class Framebuffer;
+		class CommandBucket;
 		class Skybox;
 		class BulletDebugRenderer;
 		/**
@@ -125,6 +126,11 @@ namespace cogs
 
 				bool sphereInFrustum(const glm::vec3& _pos, float _radius) { return m_frustum.sphereInFrustum(_pos, _radius); }
 
+				/**
+				* \brief the view frustum, for the batched tests
+				*/
+				const Frustum& getFrustum() const noexcept { return m_frustum; }
+
 				void renderFrustum(BulletDebugRenderer* _renderer);
 				/**
 				* \brief get and set the target framebuffer this camera renders to
@@ -138,6 +144,8 @@ namespace cogs
 				void setSkybox(std::weak_ptr<Skybox> _skybox) { m_skybox = _skybox; }
 				std::weak_ptr<Skybox> getSkybox() { return m_skybox; }
 				void renderSkybox();
+				/** \brief records the skybox into a bucket executed by the render thread (see Skybox::recordRender) */
+				void recordSkybox(CommandBucket& _bucket);
 
 				/**
 				* \brief get and set the background color
@@ -145,9 +153,18 @@ namespace cogs
 				void setBackgroundColor(const Color& _color) { m_backgroundColor = _color; }
 				const Color& getBackgroundColor() const noexcept { return m_backgroundColor; }
 
+				/**
+				* \brief enable or disable the depth-only pre-pass of the 3D renderer for this camera.
+				* Pays off in scenes with heavy overdraw and expensive fragment shading,
+				* compare the renderer's GPU timings with it on and off
+				*/
+				void setDepthPrePass(bool _enabled) { m_depthPrePass = _enabled; }
+				bool hasDepthPrePass() const noexcept { return m_depthPrePass; }
+
 				/**
 				* Some basic getters
 				*/
+				const ProjectionType& getProjectionType() const noexcept { return m_projType; }
 				float getSize() const noexcept { return m_size; }
 				float getNear()	const noexcept { return m_nearPlane; }
 				float getFar()		const noexcept { return m_farPlane;; }
@@ -217,6 +234,8 @@ namespace cogs
 
 				Color m_backgroundColor{ Color::white }; ///< background color to clear to 
 
+				bool m_depthPrePass{ false }; ///< whether opaque geometry gets a depth-only pass before shading
+
 				Frustum m_frustum;
 		};
 }
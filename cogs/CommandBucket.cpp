@@ -0,0 +1,78 @@
+#include "CommandBucket.h"
+
+#include <cstring>
+
+namespace cogs
+{
+		CommandBucket::CommandBucket(size_t _blockSize) : m_blockSize(_blockSize)
+		{
+		}
+
+		CommandBucket::~CommandBucket()
+		{
+		}
+
+		const void* CommandBucket::copyAuxMemory(const void* _data, size_t _size)
+		{
+				void* memory = allocateAuxMemory(_size);
+				if (_size > 0)
+				{
+						std::memcpy(memory, _data, _size);
+				}
+				return memory;
+		}
+
+		void* CommandBucket::allocateAuxMemory(size_t _size)
+		{
+				return allocate(_size, 16);
+		}
+
+		void CommandBucket::submit() const
+		{
+				for (const Packet& packet : m_packets)
+				{
+						packet.dispatch(packet.command);
+				}
+		}
+
+		void CommandBucket::clear()
+		{
+				m_packets.clear();
+				for (Block& block : m_blocks)
+				{
+						block.used = 0;
+				}
+				m_currentBlock = 0;
+		}
+
+		void* CommandBucket::allocate(size_t _size, size_t _alignment)
+		{
+				//try to fit the allocation in the current block, or any block after it
+				while (m_currentBlock < m_blocks.size())
+				{
+						Block& block = m_blocks[m_currentBlock];
+
+						size_t alignedOffset = (block.used + _alignment - 1) & ~(_alignment - 1);
+						if (alignedOffset + _size <= block.size)
+						{
+								block.used = alignedOffset + _size;
+								return block.memory.get() + alignedOffset;
+						}
+						m_currentBlock++;
+				}
+
+				//no space left, allocate a new block (big enough for oversized allocations)
+				Block newBlock;
+				newBlock.size = _size + _alignment > m_blockSize ? _size + _alignment : m_blockSize;
+				newBlock.memory.reset(new unsigned char[newBlock.size]);
+
+				size_t alignment = reinterpret_cast<size_t>(newBlock.memory.get()) & (_alignment - 1);
+				size_t alignedOffset = alignment == 0 ? 0 : _alignment - alignment;
+				newBlock.used = alignedOffset + _size;
+
+				m_blocks.push_back(std::move(newBlock));
+				m_currentBlock = m_blocks.size() - 1;
+
+				return m_blocks.back().memory.get() + alignedOffset;
+		}
+}
@@ -0,0 +1,98 @@
+#ifndef COMMAND_BUCKET_H
+#define COMMAND_BUCKET_H
+
+#include "RenderCommands.h"
+
+#include <vector>
+#include <memory>
+#include <new>
+
+namespace cogs
+{
+		/**
+		* \brief A bucket of recorded render commands.
+		* Commands and the data they reference are stored in memory blocks owned by the bucket,
+		* which never move while recording, so a bucket can be filled on one thread and executed on another.
+		* Blocks are kept after clear() so steady-state frames don't allocate
+		*/
+		class CommandBucket
+		{
+		public:
+				/**
+				* \brief A single recorded command
+				*/
+				struct Packet
+				{
+						BackendDispatchFunction dispatch; ///< the function executing the command on the GL backend
+						CommandType type; ///< the type of the command
+						const void* command; ///< pointer to the command data
+				};
+
+				/**
+				* \brief Construct the bucket
+				* \param[in] _blockSize - the size of a single memory block in bytes
+				*/
+				CommandBucket(size_t _blockSize = 64 * 1024);
+				~CommandBucket();
+
+				CommandBucket(const CommandBucket&) = delete;
+				CommandBucket& operator=(const CommandBucket&) = delete;
+
+				/**
+				* \brief Adds a command of type T to the end of the bucket
+				* \return pointer to the command to fill in, valid until the bucket is cleared
+				*/
+				template<typename T>
+				T* add()
+				{
+						T* command = new (allocate(sizeof(T), alignof(T))) T();
+						m_packets.push_back(Packet{ T::DISPATCH_FUNCTION, T::TYPE, command });
+						return command;
+				}
+
+				/**
+				* \brief Copies _size bytes of _data into the bucket's memory
+				* \return pointer to the copy, valid until the bucket is cleared
+				*/
+				const void* copyAuxMemory(const void* _data, size_t _size);
+
+				/**
+				* \brief Allocates _size bytes of uninitialized memory in the bucket
+				*/
+				void* allocateAuxMemory(size_t _size);
+
+				/**
+				* \brief Executes all recorded commands in order on the GL backend
+				*/
+				void submit() const;
+
+				/**
+				* \brief Removes all commands, keeping the memory blocks for reuse
+				*/
+				void clear();
+
+				/**
+				* \brief getters
+				*/
+				const std::vector<Packet>& getPackets() const noexcept { return m_packets; }
+				size_t getNumCommands() const noexcept { return m_packets.size(); }
+				bool isEmpty() const noexcept { return m_packets.empty(); }
+
+		private:
+				void* allocate(size_t _size, size_t _alignment);
+
+				struct Block
+				{
+						std::unique_ptr<unsigned char[]> memory;
+						size_t size{ 0 };
+						size_t used{ 0 };
+				};
+
+				size_t m_blockSize{ 0 }; ///< default size of a memory block
+				size_t m_currentBlock{ 0 }; ///< index of the block currently being filled
+				std::vector<Block> m_blocks; ///< the memory blocks
+				std::vector<Packet> m_packets; ///< the recorded commands in submission order
+		};
+}
+
+#endif // !COMMAND_BUCKET_H
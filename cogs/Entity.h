@@ -311,6 +311,10 @@ namespace cogs
 				//sets the active state of the entity
 				void setActive(bool _active)
 				{
+						if (m_isActive != _active)
+						{
+								activeChanges()++;
+						}
 						m_isActive = _active;
 						/*if (!m_isActive)
 						{
@@ -324,7 +328,37 @@ namespace cogs
 				//gets the active state of the entity
 				bool isActive() const noexcept { return m_isActive; }
 
+				/**
+				* \brief whether the entity and all its parents are active, so renderAll() reaches it
+				*/
+				bool isActiveInHierarchy() const
+				{
+						const Entity* entity = this;
+						while (entity != nullptr)
+						{
+								if (!entity->m_isActive)
+								{
+										return false;
+								}
+								std::weak_ptr<Transform> parent = entity->getComponent<Transform>().lock()->getParent();
+								entity = parent.expired() ? nullptr : parent.lock()->getEntity().lock().get();
+						}
+						return true;
+				}
+
+				/**
+				* \brief counts the changes of the active flag of any entity, renderers keeping entities between frames
+				* compare it to the count they last saw to know when to check their active states again
+				*/
+				static unsigned int getNumActiveChanges() noexcept { return activeChanges(); }
+
 		private:
+				static unsigned int& activeChanges() noexcept
+				{
+						static unsigned int s_activeChanges{ 0 };
+						return s_activeChanges;
+				}
+
 				/* Update this entity (all its components) */
 				inline void update(float _deltaTime) { for (auto& component : m_components) { component->update(_deltaTime); } }
 
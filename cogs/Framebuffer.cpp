@@ -1,12 +1,19 @@
 #include "Framebuffer.h"
 #include "Window.h"
+#include "RenderBackend.h"
+#include "CommandBucket.h"
 
 namespace cogs
 {
 		std::weak_ptr<Framebuffer> Framebuffer::s_currentActive;
+		std::weak_ptr<Framebuffer> Framebuffer::s_default;
 
 		Framebuffer::~Framebuffer()
 		{
+				if (RenderBackend::isNull())
+				{
+						return;
+				}
 				if (m_fboID != 0)
 				{
 						glDeleteFramebuffers(1, &m_fboID);
@@ -26,12 +33,25 @@ namespace cogs
 
 		void Framebuffer::bind() const
 		{
+				if (RenderBackend::isNull())
+				{
+						return;
+				}
 				glBindFramebuffer(GL_FRAMEBUFFER, m_fboID);
 				glViewport(0, 0, m_width, m_height);
 		}
 
 		void Framebuffer::unbind() const
 		{
+				if (RenderBackend::isNull())
+				{
+						return;
+				}
+				if (!s_default.expired() && s_default.lock().get() != this)
+				{
+						s_default.lock()->bind();
+						return;
+				}
 				glBindFramebuffer(GL_FRAMEBUFFER, 0);
 				glViewport(0, 0, Window::getWidth(), Window::getHeight());
 		}
@@ -43,6 +63,14 @@ namespace cogs
 				newFramebuffer->m_width = _width;
 				newFramebuffer->m_height = _height;
 
+				if (RenderBackend::isNull())
+				{
+						newFramebuffer->m_fboID = RenderBackend::generateNullHandle();
+						newFramebuffer->m_id = RenderBackend::generateNullHandle();
+						newFramebuffer->m_rboID = RenderBackend::generateNullHandle();
+						return std::move(newFramebuffer);
+				}
+
 				glGenFramebuffers(1, &newFramebuffer->m_fboID);
 				glBindFramebuffer(GL_FRAMEBUFFER, newFramebuffer->m_fboID);
 
@@ -91,7 +119,11 @@ namespace cogs
 				{
 						_fb.lock()->bind();
 				}
-				else
+				else if (!s_default.expired())
+				{
+						s_default.lock()->bind();
+				}
+				else if (!RenderBackend::isNull())
 				{
 						glBindFramebuffer(GL_FRAMEBUFFER, 0);
 						glViewport(0, 0, Window::getWidth(), Window::getHeight());
@@ -99,4 +131,14 @@ namespace cogs
 
 				s_currentActive = _fb;
 		}
+
+		void Framebuffer::recordSetActive(CommandBucket& _bucket, std::weak_ptr<Framebuffer> _fb)
+		{
+				std::shared_ptr<Framebuffer> fb = !_fb.expired() ? _fb.lock() : s_default.lock();
+
+				commands::BindFramebuffer* bindFramebuffer = _bucket.add<commands::BindFramebuffer>();
+				bindFramebuffer->fbo = fb ? fb->getFBO() : 0;
+				bindFramebuffer->width = fb ? fb->getWidth() : Window::getWidth();
+				bindFramebuffer->height = fb ? fb->getHeight() : Window::getHeight();
+		}
 }
\ No newline at end of file
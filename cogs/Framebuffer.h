@@ -7,6 +7,8 @@
 
 namespace cogs
 {
+		class CommandBucket;
+
 		/**
 		* \brief Framebuffer class for handling rendertargets
 		*/
@@ -45,8 +47,26 @@ namespace cogs
 				*/
 				static void setActive(std::weak_ptr<Framebuffer> _fb);
 
+				/**
+				* \brief records binding a framebuffer, the default one if it's empty, for frames executed by the render thread.
+				* Doesn't change the current active framebuffer, that one tracks the GL state of the calling thread
+				*/
+				static void recordSetActive(CommandBucket& _bucket, std::weak_ptr<Framebuffer> _fb);
+
+				/**
+				* \brief sets the framebuffer which is bound instead of the window's when no render target is active
+				* (used by headless windows), an empty pointer restores the window's framebuffer
+				*/
+				static void setDefault(std::weak_ptr<Framebuffer> _fb) { s_default = _fb; }
+
+				/**
+				* \brief gets the default framebuffer (empty if it's the window's)
+				*/
+				static std::weak_ptr<Framebuffer> getDefault() { return s_default; }
+
 		private:
 				static std::weak_ptr<Framebuffer> s_currentActive; ///< the current active framebuffer
+				static std::weak_ptr<Framebuffer> s_default; ///< the framebuffer used in place of the window's
 
 				uint m_fboID{ 0 }; ///< this framebuffer's fbo id
 				uint m_rboID{ 0 }; ///< this framebuffer's rbo id
@@ -1,8 +1,210 @@
 #include "Frustum.h"
 #include "BulletDebugRenderer.h"
+#include "Parallel.h"
+#include "Simd.h"
+
+#include <algorithm>
+#include <glm\glm.hpp>
 
 namespace cogs
 {
+		namespace
+		{
+				//words of the visibility mask culled per batch of the worker pool at least (32 tests each).
+				//A batch of 16k spheres takes about as long as waking the workers, so smaller sets stay on the calling thread
+				const size_t CULL_BATCH_WORDS = 512;
+
+				struct PlaneSet
+				{
+						float x[6];
+						float y[6];
+						float z[6];
+						float d[6];
+				};
+
+				struct SphereArrays
+				{
+						const float* x;
+						const float* y;
+						const float* z;
+						const float* radius;
+				};
+
+				struct BoxArrays
+				{
+						const float* min[3];
+						const float* max[3];
+				};
+
+				/* one instruction set each, the kernels below are written once against this interface */
+				struct Scalar
+				{
+						static const size_t WIDTH = 1;
+						typedef float Vec;
+						typedef bool Mask;
+						static Vec load(const float* _p) { return *_p; }
+						static Vec set1(float _v) { return _v; }
+						static Vec add(Vec _a, Vec _b) { return _a + _b; }
+						static Vec sub(Vec _a, Vec _b) { return _a - _b; }
+						static Vec mul(Vec _a, Vec _b) { return _a * _b; }
+						static Mask greater(Vec _a, Vec _b) { return _a > _b; }
+						static Mask both(Mask _a, Mask _b) { return _a && _b; }
+						static uint32_t bits(Mask _m) { return _m ? 1u : 0u; }
+				};
+
+#ifdef COGS_SSE
+				struct Sse
+				{
+						static const size_t WIDTH = 4;
+						typedef __m128 Vec;
+						typedef __m128 Mask;
+						static Vec load(const float* _p) { return _mm_loadu_ps(_p); }
+						static Vec set1(float _v) { return _mm_set1_ps(_v); }
+						static Vec add(Vec _a, Vec _b) { return _mm_add_ps(_a, _b); }
+						static Vec sub(Vec _a, Vec _b) { return _mm_sub_ps(_a, _b); }
+						static Vec mul(Vec _a, Vec _b) { return _mm_mul_ps(_a, _b); }
+						static Mask greater(Vec _a, Vec _b) { return _mm_cmpgt_ps(_a, _b); }
+						static Mask both(Mask _a, Mask _b) { return _mm_and_ps(_a, _b); }
+						static uint32_t bits(Mask _m) { return static_cast<uint32_t>(_mm_movemask_ps(_m)); }
+				};
+#endif
+
+#ifdef COGS_AVX
+				struct Avx
+				{
+						static const size_t WIDTH = 8;
+						typedef __m256 Vec;
+						typedef __m256 Mask;
+						static Vec load(const float* _p) { return _mm256_loadu_ps(_p); }
+						static Vec set1(float _v) { return _mm256_set1_ps(_v); }
+						static Vec add(Vec _a, Vec _b) { return _mm256_add_ps(_a, _b); }
+						static Vec sub(Vec _a, Vec _b) { return _mm256_sub_ps(_a, _b); }
+						static Vec mul(Vec _a, Vec _b) { return _mm256_mul_ps(_a, _b); }
+						static Mask greater(Vec _a, Vec _b) { return _mm256_cmp_ps(_a, _b, _CMP_GT_OQ); }
+						static Mask both(Mask _a, Mask _b) { return _mm256_and_ps(_a, _b); }
+						static uint32_t bits(Mask _m) { return static_cast<uint32_t>(_mm256_movemask_ps(_m)); }
+				};
+#endif
+
+#ifdef COGS_AVX512
+				struct Avx512
+				{
+						static const size_t WIDTH = 16;
+						typedef __m512 Vec;
+						typedef __mmask16 Mask;
+						static Vec load(const float* _p) { return _mm512_loadu_ps(_p); }
+						static Vec set1(float _v) { return _mm512_set1_ps(_v); }
+						static Vec add(Vec _a, Vec _b) { return _mm512_add_ps(_a, _b); }
+						static Vec sub(Vec _a, Vec _b) { return _mm512_sub_ps(_a, _b); }
+						static Vec mul(Vec _a, Vec _b) { return _mm512_mul_ps(_a, _b); }
+						static Mask greater(Vec _a, Vec _b) { return _mm512_cmp_ps_mask(_a, _b, _CMP_GT_OQ); }
+						static Mask both(Mask _a, Mask _b) { return static_cast<Mask>(_a & _b); }
+						static uint32_t bits(Mask _m) { return static_cast<uint32_t>(_m); }
+				};
+#endif
+
+#if defined(COGS_AVX512)
+				typedef Avx512 Widest;
+#elif defined(COGS_AVX)
+				typedef Avx Widest;
+#elif defined(COGS_SSE)
+				typedef Sse Widest;
+#else
+				typedef Scalar Widest;
+#endif
+
+				//the signed distances of the centers to every plane have to be larger than minus the radii
+				template<typename S>
+				uint32_t sphereBits(const PlaneSet& _planes, const SphereArrays& _spheres, size_t _first)
+				{
+						typename S::Vec x = S::load(_spheres.x + _first);
+						typename S::Vec y = S::load(_spheres.y + _first);
+						typename S::Vec z = S::load(_spheres.z + _first);
+						typename S::Vec negativeRadius = S::sub(S::set1(0.0f), S::load(_spheres.radius + _first));
+
+						typename S::Mask visible{};
+						for (int p = 0; p < 6; p++)
+						{
+								typename S::Vec distance = S::add(S::add(S::mul(x, S::set1(_planes.x[p])), S::mul(y, S::set1(_planes.y[p]))),
+										S::add(S::mul(z, S::set1(_planes.z[p])), S::set1(_planes.d[p])));
+								typename S::Mask inside = S::greater(distance, negativeRadius);
+								visible = p == 0 ? inside : S::both(visible, inside);
+						}
+						return S::bits(visible);
+				}
+
+				//the corner furthest along the normal of every plane has to be in front of it
+				template<typename S>
+				uint32_t boxBits(const PlaneSet& _planes, const BoxArrays& _boxes, size_t _first)
+				{
+						typename S::Mask visible{};
+						for (int p = 0; p < 6; p++)
+						{
+								typename S::Vec x = S::load((_planes.x[p] > 0.0f ? _boxes.max[0] : _boxes.min[0]) + _first);
+								typename S::Vec y = S::load((_planes.y[p] > 0.0f ? _boxes.max[1] : _boxes.min[1]) + _first);
+								typename S::Vec z = S::load((_planes.z[p] > 0.0f ? _boxes.max[2] : _boxes.min[2]) + _first);
+
+								typename S::Vec distance = S::add(S::add(S::mul(x, S::set1(_planes.x[p])), S::mul(y, S::set1(_planes.y[p]))),
+										S::add(S::mul(z, S::set1(_planes.z[p])), S::set1(_planes.d[p])));
+								typename S::Mask inside = S::greater(distance, S::set1(0.0f));
+								visible = p == 0 ? inside : S::both(visible, inside);
+						}
+						return S::bits(visible);
+				}
+
+				uint32_t countBits(uint32_t _word)
+				{
+						_word = _word - ((_word >> 1) & 0x55555555u);
+						_word = (_word & 0x33333333u) + ((_word >> 2) & 0x33333333u);
+						return (((_word + (_word >> 4)) & 0x0F0F0F0Fu) * 0x01010101u) >> 24;
+				}
+
+				/**
+				* Fills the visibility words, the batches of the threads are whole words so they never write the same one.
+				* The full vectors of a word go through the widest kernel, the rest of the last word one by one
+				*/
+				template<typename Arrays,
+						uint32_t(*WideKernel)(const PlaneSet&, const Arrays&, size_t),
+						uint32_t(*ScalarKernel)(const PlaneSet&, const Arrays&, size_t)>
+				size_t cull(const PlaneSet& _planes, const Arrays& _arrays, size_t _count, uint32_t* _visibility)
+				{
+						const size_t numWords = (_count + 31) / 32;
+						std::vector<size_t> counts(std::max(getNumBatches(numWords, CULL_BATCH_WORDS), 1u), 0);
+
+						parallelFor(numWords, CULL_BATCH_WORDS, [&](size_t _begin, size_t _end, unsigned int _batch)
+						{
+								size_t count{ 0 };
+								for (size_t w = _begin; w < _end; w++)
+								{
+										const size_t first = w * 32;
+										const size_t last = std::min(first + 32, _count);
+										uint32_t word{ 0 };
+
+										size_t i = first;
+										for (; i + Widest::WIDTH <= last; i += Widest::WIDTH)
+										{
+												word |= WideKernel(_planes, _arrays, i) << (i - first);
+										}
+										for (; i < last; i++)
+										{
+												word |= ScalarKernel(_planes, _arrays, i) << (i - first);
+										}
+
+										_visibility[w] = word;
+										count += countBits(word);
+								}
+								counts[_batch] = count;
+						});
+
+						size_t numVisible{ 0 };
+						for (size_t count : counts)
+						{
+								numVisible += count;
+						}
+						return numVisible;
+				}
+		}
+
 		Frustum::Frustum()
 		{
 		}
@@ -80,6 +282,43 @@ namespace cogs
 				//m_planes[RIGHT].setNormalAndPoint(normal, m_nearCenter + _right * m_nearWidth);
 		}
 
+		void Frustum::update(const glm::mat4& _viewProjection)
+		{
+				//rows of the matrix, glm stores columns
+				const glm::vec4 row0(_viewProjection[0][0], _viewProjection[1][0], _viewProjection[2][0], _viewProjection[3][0]);
+				const glm::vec4 row1(_viewProjection[0][1], _viewProjection[1][1], _viewProjection[2][1], _viewProjection[3][1]);
+				const glm::vec4 row2(_viewProjection[0][2], _viewProjection[1][2], _viewProjection[2][2], _viewProjection[3][2]);
+				const glm::vec4 row3(_viewProjection[0][3], _viewProjection[1][3], _viewProjection[2][3], _viewProjection[3][3]);
+
+				//a point is inside when -w <= x, y, z <= w in clip space
+				const glm::vec4 planes[6] = { row3 - row0, row3 + row0, row3 + row1, row3 - row1, row3 - row2, row3 + row2 };
+				for (int i = 0; i < 6; i++)
+				{
+						m_planes[i].setCoefficients(planes[i].x, planes[i].y, planes[i].z, planes[i].w);
+				}
+
+				//the corners are only drawn by render()
+				const glm::mat4 inverse = glm::inverse(_viewProjection);
+				auto corner = [&inverse](float _x, float _y, float _z)
+				{
+						glm::vec4 corner = inverse * glm::vec4(_x, _y, _z, 1.0f);
+						return glm::vec3(corner) / corner.w;
+				};
+
+				m_nearTopLeft = corner(-1.0f, 1.0f, -1.0f);
+				m_nearBottomLeft = corner(-1.0f, -1.0f, -1.0f);
+				m_nearTopRight = corner(1.0f, 1.0f, -1.0f);
+				m_nearBottomRight = corner(1.0f, -1.0f, -1.0f);
+
+				m_farTopLeft = corner(-1.0f, 1.0f, 1.0f);
+				m_farBottomLeft = corner(-1.0f, -1.0f, 1.0f);
+				m_farTopRight = corner(1.0f, 1.0f, 1.0f);
+				m_farBottomRight = corner(1.0f, -1.0f, 1.0f);
+
+				m_nearCenter = (m_nearTopLeft + m_nearBottomRight) * 0.5f;
+				m_farCenter = (m_farTopLeft + m_farBottomRight) * 0.5f;
+		}
+
 		bool Frustum::pointInFrustum(const glm::vec3 & _pos) const
 		{
 				for (size_t i = 0; i < 6; i++)
@@ -105,6 +344,127 @@ namespace cogs
 				}
 				return true;
 		}
+		bool Frustum::boxInFrustum(const glm::vec3& _min, const glm::vec3& _max) const
+		{
+				unsigned int planeMask = ALL_PLANES;
+				unsigned int lastPlane = 0;
+				return boxInFrustum(_min, _max, planeMask, lastPlane) != Containment::OUTSIDE;
+		}
+
+		template<typename Extent>
+		Containment Frustum::classify(const glm::vec3& _center, Extent _extent, unsigned int& _planeMask, unsigned int& _lastPlane) const
+		{
+				unsigned int crossed{ 0 };
+				for (unsigned int i = 0; i < 6; i++)
+				{
+						//start with the plane which rejected the object last time, it most likely still does
+						const unsigned int plane = (_lastPlane + i) % 6;
+						if ((_planeMask & (1u << plane)) == 0)
+						{
+								continue;
+						}
+
+						const float distance = m_planes[plane].distance(_center);
+						const float extent = _extent(m_planes[plane].normal);
+						if (distance + extent <= 0.0f)
+						{
+								_lastPlane = plane;
+								return Containment::OUTSIDE;
+						}
+						if (distance - extent < 0.0f)
+						{
+								crossed |= 1u << plane;
+						}
+				}
+
+				_planeMask = crossed;
+				return crossed == 0 ? Containment::INSIDE : Containment::INTERSECTS;
+		}
+
+		Containment Frustum::sphereInFrustum(const glm::vec3& _pos, float _radius, unsigned int& _planeMask, unsigned int& _lastPlane) const
+		{
+				return classify(_pos, [_radius](const glm::vec3&) { return _radius; }, _planeMask, _lastPlane);
+		}
+
+		Containment Frustum::boxInFrustum(const glm::vec3& _min, const glm::vec3& _max, unsigned int& _planeMask, unsigned int& _lastPlane) const
+		{
+				const glm::vec3 halfSize = (_max - _min) * 0.5f;
+				return classify((_min + _max) * 0.5f,
+						[&halfSize](const glm::vec3& _normal) { return glm::dot(glm::abs(_normal), halfSize); },
+						_planeMask, _lastPlane);
+		}
+
+		Containment Frustum::boxInFrustum(const glm::vec3& _min, const glm::vec3& _max, const glm::mat4& _world,
+				unsigned int& _planeMask, unsigned int& _lastPlane) const
+		{
+				//the half size along every axis of the box in world space
+				const glm::vec3 halfSize = (_max - _min) * 0.5f;
+				const glm::vec3 axisX = glm::vec3(_world[0]) * halfSize.x;
+				const glm::vec3 axisY = glm::vec3(_world[1]) * halfSize.y;
+				const glm::vec3 axisZ = glm::vec3(_world[2]) * halfSize.z;
+
+				return classify(glm::vec3(_world * glm::vec4((_min + _max) * 0.5f, 1.0f)),
+						[&axisX, &axisY, &axisZ](const glm::vec3& _normal)
+				{
+						return glm::abs(glm::dot(_normal, axisX)) + glm::abs(glm::dot(_normal, axisY)) + glm::abs(glm::dot(_normal, axisZ));
+				},
+						_planeMask, _lastPlane);
+		}
+
+		size_t Frustum::spheresInFrustum(const float* _x, const float* _y, const float* _z, const float* _radius,
+				size_t _count, uint32_t* _visibility) const
+		{
+				PlaneSet planes;
+				for (int i = 0; i < 6; i++)
+				{
+						planes.x[i] = m_planes[i].normal.x;
+						planes.y[i] = m_planes[i].normal.y;
+						planes.z[i] = m_planes[i].normal.z;
+						planes.d[i] = m_planes[i].d;
+				}
+
+				SphereArrays spheres = { _x, _y, _z, _radius };
+				return cull<SphereArrays, sphereBits<Widest>, sphereBits<Scalar>>(planes, spheres, _count, _visibility);
+		}
+
+		size_t Frustum::spheresInFrustum(const float* _x, const float* _y, const float* _z, const float* _radius,
+				size_t _count, std::vector<unsigned int>& _visibleIndices) const
+		{
+				std::vector<uint32_t> visibility((_count + 31) / 32);
+				size_t numVisible = spheresInFrustum(_x, _y, _z, _radius, _count, visibility.data());
+
+				_visibleIndices.resize(numVisible);
+				size_t next{ 0 };
+				for (size_t w = 0; w < visibility.size(); w++)
+				{
+						for (uint32_t word = visibility[w], bit = 0; word != 0; word >>= 1, bit++)
+						{
+								if (word & 1)
+								{
+										_visibleIndices[next++] = static_cast<unsigned int>(w * 32 + bit);
+								}
+						}
+				}
+				return numVisible;
+		}
+
+		size_t Frustum::boxesInFrustum(const float* _minX, const float* _minY, const float* _minZ,
+				const float* _maxX, const float* _maxY, const float* _maxZ,
+				size_t _count, uint32_t* _visibility) const
+		{
+				PlaneSet planes;
+				for (int i = 0; i < 6; i++)
+				{
+						planes.x[i] = m_planes[i].normal.x;
+						planes.y[i] = m_planes[i].normal.y;
+						planes.z[i] = m_planes[i].normal.z;
+						planes.d[i] = m_planes[i].d;
+				}
+
+				BoxArrays boxes = { { _minX, _minY, _minZ }, { _maxX, _maxY, _maxZ } };
+				return cull<BoxArrays, boxBits<Widest>, boxBits<Scalar>>(planes, boxes, _count, _visibility);
+		}
+
 		void Frustum::render(BulletDebugRenderer * _renderer)
 		{
 				//submit near plane
@@ -2,17 +2,33 @@
 #define FRUSTUM_H
 
 #include <glm\vec3.hpp>
+#include <glm\vec4.hpp>
 #include <glm\mat4x4.hpp>
+#include <vector>
+#include <cstdint>
 
 namespace cogs
 {
 		class BulletDebugRenderer;
+
+		/**
+		* \brief How a bounding volume lies relative to the frustum
+		*/
+		enum class Containment
+		{
+				OUTSIDE,
+				INTERSECTS,
+				INSIDE
+		};
+
 		/**
 		* \brief Defines a frustum, useful for culling and view detection
 		*/
 		class Frustum
 		{
 		public:
+				static const unsigned int ALL_PLANES = 0x3F; ///< plane mask testing every plane
+
 				Frustum();
 				~Frustum();
 
@@ -33,6 +49,13 @@ namespace cogs
 						const glm::vec3& _right,
 						const glm::vec3& _up);
 
+				/**
+				* \brief Extracts the planes from the combined projection * view matrix,
+				* works the same for perspective and orthographic projections
+				* \param[in] _viewProjection - the camera's projection matrix times its view matrix
+				*/
+				void update(const glm::mat4& _viewProjection);
+
 				/**
 				* \brief Checks if a point is in the frustum
 				* \param[in] _pos - The position of the point
@@ -48,6 +71,70 @@ namespace cogs
 				*/
 				bool sphereInFrustum(const glm::vec3& _pos, float _radius) const;
 
+				/**
+				* \brief Checks if an axis aligned box is in the frustum
+				* \param[in] _min, _max - the corners of the box
+				* \return true if it is in the frustum
+				*/
+				bool boxInFrustum(const glm::vec3& _min, const glm::vec3& _max) const;
+
+				/**
+				* \brief Classifies a sphere, testing only the planes left in the mask and starting with the one which rejected the object last time.
+				* \param[in,out] _planeMask - bit i set if plane i has to be tested, ALL_PLANES for a root.
+				* Gets the planes the sphere crosses, so the volumes inside it only test those
+				* \param[in,out] _lastPlane - the plane tested first, kept per object between frames. Gets the plane which rejected the sphere
+				* \return OUTSIDE, INSIDE of every masked plane, or INTERSECTS
+				*/
+				Containment sphereInFrustum(const glm::vec3& _pos, float _radius, unsigned int& _planeMask, unsigned int& _lastPlane) const;
+
+				/**
+				* \brief Classifies an axis aligned box like the sphere above
+				*/
+				Containment boxInFrustum(const glm::vec3& _min, const glm::vec3& _max, unsigned int& _planeMask, unsigned int& _lastPlane) const;
+
+				/**
+				* \brief Classifies a box given in model space, oriented by the model's world matrix, like the sphere above
+				* \param[in] _min, _max - the corners of the box in model space
+				* \param[in] _world - the model to world matrix, may scale
+				*/
+				Containment boxInFrustum(const glm::vec3& _min, const glm::vec3& _max, const glm::mat4& _world,
+						unsigned int& _planeMask, unsigned int& _lastPlane) const;
+
+				/**
+				* \brief Checks a batch of spheres, their components given in separate arrays.
+				* 4, 8 or 16 spheres are tested at once against the broadcast planes, depending on the widest instruction set
+				* the build targets (SSE, AVX, AVX-512), large sets are spread over the worker pool (see parallelFor)
+				* \param[in] _x, _y, _z - the centers of the spheres
+				* \param[in] _radius - the radii of the spheres
+				* \param[in] _count - the number of spheres
+				* \param[out] _visibility - bit i % 32 of word i / 32 is set if sphere i is in the frustum, (_count + 31) / 32 words
+				* \return the number of visible spheres
+				*/
+				size_t spheresInFrustum(const float* _x, const float* _y, const float* _z, const float* _radius,
+						size_t _count, uint32_t* _visibility) const;
+
+				/**
+				* \brief Checks a batch of spheres like above, but lists the indices of the visible ones
+				* \param[out] _visibleIndices - cleared and filled with the indices of the visible spheres in ascending order
+				*/
+				size_t spheresInFrustum(const float* _x, const float* _y, const float* _z, const float* _radius,
+						size_t _count, std::vector<unsigned int>& _visibleIndices) const;
+
+				/**
+				* \brief Checks a batch of axis aligned boxes like spheresInFrustum, given by the components of their corners
+				* \param[out] _visibility - bit i % 32 of word i / 32 is set if box i is in the frustum, (_count + 31) / 32 words
+				* \return the number of visible boxes
+				*/
+				size_t boxesInFrustum(const float* _minX, const float* _minY, const float* _minZ,
+						const float* _maxX, const float* _maxY, const float* _maxZ,
+						size_t _count, uint32_t* _visibility) const;
+
+				/**
+				* \brief plane i as (normal, d), points with dot(normal, p) + d >= 0 are on its inner side.
+				* The planes are in the order right, left, bottom, top, far, near, e.g. to upload them to a culling shader
+				*/
+				glm::vec4 getPlane(unsigned int _index) const { return glm::vec4(m_planes[_index].normal, m_planes[_index].d); }
+
 				void render(BulletDebugRenderer* _renderer);
 
 		private:
@@ -72,6 +159,12 @@ namespace cogs
 						float distance(const glm::vec3& _p) const;
 				};
 
+				/**
+				* \brief the masked, coherent test shared by the volumes, _extent gives the radius of the volume projected on a plane normal
+				*/
+				template<typename Extent>
+				Containment classify(const glm::vec3& _center, Extent _extent, unsigned int& _planeMask, unsigned int& _lastPlane) const;
+
 		private:
 				float m_fov{ 0 }; ///< Vertical field of view in radians
 				float m_aspectRatio{ 0.0f }; ///< Screen aspect ratio
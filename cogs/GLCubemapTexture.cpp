@@ -1,5 +1,6 @@
 #include "GLCubemapTexture.h"
 #include "Utils.h"
+#include "RenderBackend.h"
 
 #include <GL\glew.h>
 #include <SOIL2\SOIL2.h>
@@ -15,7 +16,7 @@ namespace cogs
 		}
 		GLCubemapTexture::~GLCubemapTexture()
 		{
-				if (m_id != 0)
+				if (m_id != 0 && !RenderBackend::isNull())
 				{
 						glDeleteTextures(1, &m_id);
 						m_id = 0;
@@ -23,17 +24,29 @@ namespace cogs
 		}
 		void GLCubemapTexture::bind() const
 		{
-				glBindTexture(GL_TEXTURE_CUBE_MAP, m_id);
+				if (!RenderBackend::isNull())
+				{
+						glBindTexture(GL_TEXTURE_CUBE_MAP, m_id);
+				}
 		}
 		void GLCubemapTexture::unbind() const
 		{
-				glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+				if (!RenderBackend::isNull())
+				{
+						glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+				}
 		}
 		void GLCubemapTexture::load(const std::string & _name, const std::vector<std::string>& _fileNames)
 		{
 				m_name = _name;
 				m_fileNames = _fileNames;
 
+				if (RenderBackend::isNull())
+				{
+						m_id = RenderBackend::generateNullHandle();
+						return;
+				}
+
 				m_id = SOIL_load_OGL_cubemap
 				(
 						_fileNames.at(0).c_str(),
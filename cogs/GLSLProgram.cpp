@@ -4,6 +4,8 @@
 #include "GLTexture2D.h"
 #include "GLCubemapTexture.h"
 #include "Light.h"
+#include "CommandBucket.h"
+#include "RenderBackend.h"
 
 #include <fstream>
 #include <string>
@@ -51,6 +53,13 @@ namespace cogs
 
 		void GLSLProgram::compileShadersFromSource(const char* _vertexSource, const char* _fragmentSource, const char* _geometrySource /*= nullptr*/)
 		{
+				if (RenderBackend::isNull())
+				{
+						//nothing to compile, uniform locations get assigned as they are requested
+						m_programID = RenderBackend::generateNullHandle();
+						return;
+				}
+
 				//Create the GLSL program ID
 				m_programID = glCreateProgram();
 
@@ -90,11 +99,48 @@ namespace cogs
 				linkShaders();
 		}
 
+		void GLSLProgram::compileComputeShader(const std::string& _name, const std::string& _csFilePath)
+		{
+				m_programName = _name;
+
+				std::string csSource;
+				IOManager::readFileToBuffer(_csFilePath, csSource);
+				compileComputeShaderFromSource(csSource.c_str());
+		}
+
+		void GLSLProgram::compileComputeShaderFromSource(const char* _computeSource)
+		{
+				if (RenderBackend::isNull())
+				{
+						m_programID = RenderBackend::generateNullHandle();
+						return;
+				}
+
+				m_programID = glCreateProgram();
+
+				m_computeShaderID = glCreateShader(GL_COMPUTE_SHADER);
+				if (m_computeShaderID == 0)
+				{
+						throw std::runtime_error("Compute shader failed to be created");
+				}
+
+				compileShader(_computeSource, "Compute Shader", m_computeShaderID);
+
+				linkShaders();
+		}
+
 		void GLSLProgram::linkShaders()
 		{
-				//Attach our shaders to our program
-				glAttachShader(m_programID, m_vertexShaderID);
-				glAttachShader(m_programID, m_fragmentShaderID);
+				//Attach our shaders to our program, a compute program only has the compute shader
+				if (m_computeShaderID != 0)
+				{
+						glAttachShader(m_programID, m_computeShaderID);
+				}
+				else
+				{
+						glAttachShader(m_programID, m_vertexShaderID);
+						glAttachShader(m_programID, m_fragmentShaderID);
+				}
 				if (m_geometryShaderID != 0)
 				{
 						glAttachShader(m_programID, m_geometryShaderID);
@@ -124,6 +170,7 @@ namespace cogs
 						glDeleteShader(m_vertexShaderID);
 						glDeleteShader(m_fragmentShaderID);
 						glDeleteShader(m_geometryShaderID);
+						glDeleteShader(m_computeShaderID);
 
 						//print the error log and quit
 						std::printf("%s\n", &errorLog[0]);
@@ -133,13 +180,66 @@ namespace cogs
 				glDetachShader(m_programID, m_vertexShaderID);
 				glDetachShader(m_programID, m_fragmentShaderID);
 				glDetachShader(m_programID, m_geometryShaderID);
+				glDetachShader(m_programID, m_computeShaderID);
 				glDeleteShader(m_vertexShaderID);
 				glDeleteShader(m_fragmentShaderID);
 				glDeleteShader(m_geometryShaderID);
+				glDeleteShader(m_computeShaderID);
+
+				registerActiveUniforms();
+		}
+
+		void GLSLProgram::registerActiveUniforms()
+		{
+				m_unifLocationList.clear();
+
+				GLint numUniforms{ 0 };
+				GLint maxNameLength{ 0 };
+				glGetProgramiv(m_programID, GL_ACTIVE_UNIFORMS, &numUniforms);
+				glGetProgramiv(m_programID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+
+				std::vector<char> nameBuffer(maxNameLength + 1);
+
+				for (GLint i = 0; i < numUniforms; i++)
+				{
+						GLsizei length{ 0 };
+						GLint size{ 0 };
+						GLenum type{ 0 };
+						glGetActiveUniform(m_programID, i, (GLsizei)nameBuffer.size(), &length, &size, &type, nameBuffer.data());
+
+						std::string name(nameBuffer.data(), length);
+
+						//uniforms inside blocks don't have a location
+						GLint location = glGetUniformLocation(m_programID, name.c_str());
+						if (location < 0)
+						{
+								continue;
+						}
+						m_unifLocationList[name] = location;
+
+						//arrays of basic types are reported as "name[0]", register the other elements as well
+						size_t bracket = name.rfind("[0]");
+						if (bracket != std::string::npos && bracket + 3 == name.size())
+						{
+								std::string baseName = name.substr(0, bracket);
+								m_unifLocationList[baseName] = location;
+
+								for (GLint element = 1; element < size; element++)
+								{
+										std::string elementName = baseName + "[" + std::to_string(element) + "]";
+										m_unifLocationList[elementName] = glGetUniformLocation(m_programID, elementName.c_str());
+								}
+						}
+				}
 		}
 
 		AttribLocation GLSLProgram::getAttribLoc(const std::string & _attributeName)
 		{
+				if (RenderBackend::isNull())
+				{
+						return static_cast<AttribLocation>(m_attribList.size());
+				}
+
 				AttribLocation location = glGetAttribLocation(m_programID, _attributeName.c_str());
 				//error check
 				if (location == GL_INVALID_INDEX)
@@ -152,6 +252,11 @@ namespace cogs
 
 		UniformLocation GLSLProgram::getUniformLoc(const std::string & _uniformName)
 		{
+				if (RenderBackend::isNull())
+				{
+						return static_cast<UniformLocation>(m_unifLocationList.size());
+				}
+
 				//get the uniform location
 				UniformLocation location = glGetUniformLocation(m_programID, _uniformName.c_str());
 				//error check
@@ -209,7 +314,7 @@ namespace cogs
 		{
 				GLint location = glGetSubroutineUniformLocation(m_programID, _shaderType, _name.c_str());
 				//error check
-				if (location == GL_INVALID_INDEX)
+				if (location == -1)
 				{
 						throw std::runtime_error("Uniform subroutine" + _name + " not found in shader!");
 				}
@@ -242,12 +347,20 @@ namespace cogs
 		//enable the shader
 		void GLSLProgram::use()  const
 		{
+				if (RenderBackend::isNull())
+				{
+						return;
+				}
 				glUseProgram(m_programID);
 		}
 
 		//disable the shader
 		void GLSLProgram::unUse() const
 		{
+				if (RenderBackend::isNull())
+				{
+						return;
+				}
 				glUseProgram(0);
 		}
 
@@ -458,4 +571,156 @@ namespace cogs
 						throw std::runtime_error("Shader " + _name + " failed to compile");
 				}
 		}
+
+		void GLSLProgram::recordUse(CommandBucket& _bucket) const
+		{
+				_bucket.add<commands::UseProgram>()->program = m_programID;
+		}
+
+		void GLSLProgram::recordUnUse(CommandBucket& _bucket) const
+		{
+				_bucket.add<commands::UseProgram>()->program = 0;
+		}
+
+		void GLSLProgram::recordValue(CommandBucket& _bucket, const std::string& _uniformName, const glm::mat4& _matrix)
+		{
+				commands::SetUniformMat4* cmd = _bucket.add<commands::SetUniformMat4>();
+				cmd->location = getUniformLocation(_uniformName);
+				memcpy(cmd->value, glm::value_ptr(_matrix), sizeof(cmd->value));
+		}
+
+		void GLSLProgram::recordValue(CommandBucket& _bucket, const std::string& _uniformName, const float& _float)
+		{
+				commands::SetUniformFloat* cmd = _bucket.add<commands::SetUniformFloat>();
+				cmd->location = getUniformLocation(_uniformName);
+				cmd->value = _float;
+		}
+
+		void GLSLProgram::recordValue(CommandBucket& _bucket, const std::string& _uniformName, const int& _int)
+		{
+				commands::SetUniformInt* cmd = _bucket.add<commands::SetUniformInt>();
+				cmd->location = getUniformLocation(_uniformName);
+				cmd->value = _int;
+		}
+
+		void GLSLProgram::recordValue(CommandBucket& _bucket, const std::string& _uniformName, const glm::vec2& _vec2)
+		{
+				commands::SetUniformVec2* cmd = _bucket.add<commands::SetUniformVec2>();
+				cmd->location = getUniformLocation(_uniformName);
+				memcpy(cmd->value, glm::value_ptr(_vec2), sizeof(cmd->value));
+		}
+
+		void GLSLProgram::recordValue(CommandBucket& _bucket, const std::string& _uniformName, const glm::vec3& _vec3)
+		{
+				commands::SetUniformVec3* cmd = _bucket.add<commands::SetUniformVec3>();
+				cmd->location = getUniformLocation(_uniformName);
+				memcpy(cmd->value, glm::value_ptr(_vec3), sizeof(cmd->value));
+		}
+
+		void GLSLProgram::recordValue(CommandBucket& _bucket, const std::string& _uniformName, const glm::vec4& _vec4)
+		{
+				commands::SetUniformVec4* cmd = _bucket.add<commands::SetUniformVec4>();
+				cmd->location = getUniformLocation(_uniformName);
+				memcpy(cmd->value, glm::value_ptr(_vec4), sizeof(cmd->value));
+		}
+
+		void GLSLProgram::recordValue(CommandBucket& _bucket, const std::string& _uniformName, uint _slot, std::weak_ptr<GLTexture2D> _texture)
+		{
+				commands::BindTexture* bind = _bucket.add<commands::BindTexture>();
+				bind->slot = _slot;
+				bind->target = GL_TEXTURE_2D;
+				bind->texture = _texture.lock()->getTextureID();
+
+				recordValue(_bucket, _uniformName, (int)_slot);
+		}
+
+		void GLSLProgram::recordValue(CommandBucket& _bucket, const std::string& _uniformName, uint _slot, std::weak_ptr<GLCubemapTexture> _texture)
+		{
+				commands::BindTexture* bind = _bucket.add<commands::BindTexture>();
+				bind->slot = _slot;
+				bind->target = GL_TEXTURE_CUBE_MAP;
+				bind->texture = _texture.lock()->getTextureID();
+
+				recordValue(_bucket, _uniformName, (int)_slot);
+		}
+
+		void GLSLProgram::recordValue(CommandBucket& _bucket, const std::string& _uniformName, std::weak_ptr<Light> _light)
+		{
+				switch (_light.lock()->getLightType())
+				{
+				case LightType::POINT:
+				{
+						recordValue(_bucket, _uniformName + ".position", _light.lock()->getPosition());
+						recordValue(_bucket, _uniformName + ".ambient", _light.lock()->getAmbientIntensity());
+						recordValue(_bucket, _uniformName + ".diffuse", _light.lock()->getDiffuseIntensity());
+						recordValue(_bucket, _uniformName + ".specular", _light.lock()->getSpecularIntensity());
+						recordValue(_bucket, _uniformName + ".constant", _light.lock()->getAttenuation().m_constant);
+						recordValue(_bucket, _uniformName + ".linear", _light.lock()->getAttenuation().m_linear);
+						recordValue(_bucket, _uniformName + ".quadratic", _light.lock()->getAttenuation().m_quadratic);
+						recordValue(_bucket, _uniformName + ".color", _light.lock()->getColor());
+						break;
+				}
+				case LightType::SPOT:
+				{
+						recordValue(_bucket, _uniformName + ".position", _light.lock()->getPosition());
+						recordValue(_bucket, _uniformName + ".direction", _light.lock()->getDirection());
+						recordValue(_bucket, _uniformName + ".ambient", _light.lock()->getAmbientIntensity());
+						recordValue(_bucket, _uniformName + ".diffuse", _light.lock()->getDiffuseIntensity());
+						recordValue(_bucket, _uniformName + ".specular", _light.lock()->getSpecularIntensity());
+						recordValue(_bucket, _uniformName + ".constant", _light.lock()->getAttenuation().m_constant);
+						recordValue(_bucket, _uniformName + ".linear", _light.lock()->getAttenuation().m_linear);
+						recordValue(_bucket, _uniformName + ".quadratic", _light.lock()->getAttenuation().m_quadratic);
+						recordValue(_bucket, _uniformName + ".cutOff", _light.lock()->getCutOff());
+						recordValue(_bucket, _uniformName + ".outerCutOff", _light.lock()->getOuterCutOff());
+						recordValue(_bucket, _uniformName + ".color", _light.lock()->getColor());
+						break;
+				}
+				case LightType::DIRECTIONAL:
+				{
+						recordValue(_bucket, _uniformName + ".direction", _light.lock()->getDirection());
+						recordValue(_bucket, _uniformName + ".ambient", _light.lock()->getAmbientIntensity());
+						recordValue(_bucket, _uniformName + ".diffuse", _light.lock()->getDiffuseIntensity());
+						recordValue(_bucket, _uniformName + ".specular", _light.lock()->getSpecularIntensity());
+						recordValue(_bucket, _uniformName + ".color", _light.lock()->getColor());
+						break;
+				}
+				default:
+						printf("Invalid Light");
+						break;
+				}
+		}
+
+		void GLSLProgram::recordMaterial(CommandBucket& _bucket, std::weak_ptr<Material> _material)
+		{
+				if (!_material.expired())
+				{
+						uint slot{ 0 };
+
+						std::weak_ptr<GLTexture2D> diffuse = _material.lock()->getDiffuseMap();
+						if (!diffuse.expired())
+						{
+								recordValue(_bucket, "material." + diffuse.lock()->getName(), slot++, diffuse);
+						}
+
+						std::weak_ptr<GLTexture2D> specular = _material.lock()->getSpecularMap();
+						if (!specular.expired())
+						{
+								recordValue(_bucket, "material." + specular.lock()->getName(), slot++, specular);
+						}
+
+						std::weak_ptr<GLTexture2D> reflection = _material.lock()->getReflectionMap();
+						if (!reflection.expired())
+						{
+								recordValue(_bucket, "material." + reflection.lock()->getName(), slot++, reflection);
+						}
+
+						std::weak_ptr<GLTexture2D> normal = _material.lock()->getNormalMap();
+						if (!normal.expired())
+						{
+								recordValue(_bucket, "material." + normal.lock()->getName(), slot++, normal);
+						}
+
+						recordValue(_bucket, "material.shininess", _material.lock()->getShininess());
+				}
+		}
 }
\ No newline at end of file
@@ -12,6 +12,7 @@ namespace cogs
 		class Material;
 		class GLTexture2D;
 		class GLCubemapTexture;
+		class CommandBucket;
 
 		using uint = unsigned int;
 		using AttribLocation = uint;
@@ -41,6 +42,13 @@ namespace cogs
 				*/
 				void compileShadersFromSource(const char* _vertexSource, const char* _fragmentSource, const char* _geometrySource = nullptr);
 
+				/**
+				* \brief Compiles a program made of a single compute shader, needs RenderCaps::computeShaders
+				* \param[in] _csFilePath, _computeSource the file or the source code of the compute shader
+				*/
+				void compileComputeShader(const std::string& _name, const std::string& _csFilePath);
+				void compileComputeShaderFromSource(const char* _computeSource);
+
 				/**
 				* \brief Returns the index of the named uniform block specified by uniformBlockName associated with the shader program.
 				* If uniformBlockName is not a valid uniform block of the shader program, GL_INVALID_INDEX is returned
@@ -147,6 +155,28 @@ namespace cogs
 
 				void uploadMaterial(std::weak_ptr<Material> _material);
 
+				/**
+				* \brief Record the same operations as use()/uploadValue()/uploadMaterial() into a command bucket instead of executing them.
+				* Uniform locations are resolved while recording (active uniforms are registered at link time),
+				* so recording doesn't need the GL context as long as the uniform is active
+				*/
+				void recordUse(CommandBucket& _bucket) const;
+				void recordUnUse(CommandBucket& _bucket) const;
+				void recordValue(CommandBucket& _bucket, const std::string& _uniformName, const glm::mat4& _matrix);
+				void recordValue(CommandBucket& _bucket, const std::string& _uniformName, const float& _float);
+				void recordValue(CommandBucket& _bucket, const std::string& _uniformName, const int& _int);
+				void recordValue(CommandBucket& _bucket, const std::string& _uniformName, const glm::vec2& _vec2);
+				void recordValue(CommandBucket& _bucket, const std::string& _uniformName, const glm::vec3& _vec3);
+				void recordValue(CommandBucket& _bucket, const std::string& _uniformName, const glm::vec4& _vec4);
+				void recordValue(CommandBucket& _bucket, const std::string& _uniformName, uint _slot, std::weak_ptr<GLTexture2D> _texture);
+				void recordValue(CommandBucket& _bucket, const std::string& _uniformName, uint _slot, std::weak_ptr<GLCubemapTexture> _texture);
+				void recordValue(CommandBucket& _bucket, const std::string& _uniformName, std::weak_ptr<Light> _light);
+
+				void recordMaterial(CommandBucket& _bucket, std::weak_ptr<Material> _material);
+
+				/** \brief getter for the program id */
+				ProgramID getProgramID() const noexcept { return m_programID; }
+
 		private:
 				/* Compile a single shader program */
 				void compileShader(const char* _source, const std::string& _name, uint _id);
@@ -154,6 +184,9 @@ namespace cogs
 				/** Links the shaders together */
 				void linkShaders();
 
+				/** Registers the locations of all the active uniforms of the linked program */
+				void registerActiveUniforms();
+
 				/**
 				* \brief Gets the location of a specific attribute in the shader program
 				* \param[in] _attributeName The name of the searched attribute
@@ -178,6 +211,7 @@ namespace cogs
 				ShaderID m_vertexShaderID{ 0 };
 				ShaderID m_fragmentShaderID{ 0 };
 				ShaderID m_geometryShaderID{ 0 };
+				ShaderID m_computeShaderID{ 0 };
 
 				/* a map of the locations in the shader for ease of access */
 				std::unordered_map<std::string, AttribLocation> m_attribList;
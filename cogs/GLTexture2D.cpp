@@ -1,5 +1,6 @@
 #include "GLTexture2D.h"
 #include "Utils.h"
+#include "RenderBackend.h"
 
 #include <SOIL2\SOIL2.h>
 #include <GL\glew.h>
@@ -13,7 +14,7 @@ namespace cogs
 
 		GLTexture2D::~GLTexture2D()
 		{
-				if (m_id != 0)
+				if (m_id != 0 && !RenderBackend::isNull())
 				{
 						glDeleteTextures(1, &m_id);
 						m_id = 0;
@@ -25,6 +26,12 @@ namespace cogs
 				m_name = _name;
 				m_filePath = _filePath;
 
+				if (RenderBackend::isNull())
+				{
+						m_id = RenderBackend::generateNullHandle();
+						return;
+				}
+
 				m_id = SOIL_load_OGL_texture(m_filePath.c_str(), SOIL_LOAD_AUTO, m_id,
 						SOIL_FLAG_POWER_OF_TWO
 						| SOIL_FLAG_MIPMAPS
@@ -45,11 +52,17 @@ namespace cogs
 		}
 		void GLTexture2D::bind() const
 		{
-				glBindTexture(GL_TEXTURE_2D, m_id);
+				if (!RenderBackend::isNull())
+				{
+						glBindTexture(GL_TEXTURE_2D, m_id);
+				}
 		}
 		void GLTexture2D::unbind() const
 		{
-				glBindTexture(GL_TEXTURE_2D, 0);
+				if (!RenderBackend::isNull())
+				{
+						glBindTexture(GL_TEXTURE_2D, 0);
+				}
 		}
 
 		glm::vec4 GLTexture2D::getTexCoords(int _index)
@@ -0,0 +1,536 @@
+#include "GPUScene.h"
+
+#include "CommandBucket.h"
+#include "GLSLProgram.h"
+#include "Frustum.h"
+#include "Mesh.h"
+#include "MeshRenderer.h"
+#include "Entity.h"
+#include "RenderBackend.h"
+
+#include <GL\glew.h>
+#include <glm\geometric.hpp>
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <map>
+#include <string>
+
+namespace cogs
+{
+		namespace
+		{
+				/**
+				* \brief the local size of GPUCulling.comp
+				*/
+				const uint CULLING_GROUP_SIZE = 64;
+
+				uint numGroups(size_t _count)
+				{
+						return static_cast<uint>((_count + CULLING_GROUP_SIZE - 1) / CULLING_GROUP_SIZE);
+				}
+		}
+
+		GPUScene::GPUScene()
+		{
+				if (RenderBackend::isNull())
+				{
+						m_instanceBuffer = RenderBackend::generateNullHandle();
+						m_batchBuffer = RenderBackend::generateNullHandle();
+						m_visibleBuffer = RenderBackend::generateNullHandle();
+						m_drawBuffer = RenderBackend::generateNullHandle();
+						m_drawBatchBuffer = RenderBackend::generateNullHandle();
+						return;
+				}
+
+				glGenBuffers(1, &m_instanceBuffer);
+				glGenBuffers(1, &m_batchBuffer);
+				glGenBuffers(1, &m_visibleBuffer);
+				glGenBuffers(1, &m_drawBuffer);
+				glGenBuffers(1, &m_drawBatchBuffer);
+		}
+
+		GPUScene::~GPUScene()
+		{
+				dispose();
+		}
+
+		int GPUScene::add(std::weak_ptr<Mesh> _mesh, const glm::mat4& _toWorldMat)
+		{
+				int instance;
+				if (!m_freeInstances.empty())
+				{
+						instance = m_freeInstances.back();
+						m_freeInstances.pop_back();
+				}
+				else
+				{
+						instance = static_cast<int>(m_instances.size());
+						m_instances.emplace_back();
+				}
+
+				setInstance(instance, _mesh, _toWorldMat);
+				m_batchInfos[m_instances[instance].batch].numInstances++;
+				m_numInstances++;
+				m_layoutChanged = true;
+
+				return instance;
+		}
+
+		void GPUScene::update(int _instance, std::weak_ptr<Mesh> _mesh, const glm::mat4& _toWorldMat)
+		{
+				const uint oldBatch = m_instances[_instance].batch;
+
+				setInstance(_instance, _mesh, _toWorldMat);
+
+				//the instance moved to the batch of another mesh
+				const uint newBatch = m_instances[_instance].batch;
+				if (newBatch != oldBatch)
+				{
+						m_batchInfos[oldBatch].numInstances--;
+						m_batchInfos[newBatch].numInstances++;
+						m_layoutChanged = true;
+				}
+		}
+
+		void GPUScene::remove(int _instance)
+		{
+				GPUInstance& instance = m_instances[_instance];
+				m_batchInfos[instance.batch].numInstances--;
+
+				//free slots stay in the buffer, the culling skips them
+				instance.active = 0;
+				m_dirtyInstances.push_back(_instance);
+				m_freeInstances.push_back(_instance);
+
+				m_numInstances--;
+				m_layoutChanged = true;
+		}
+
+		void GPUScene::setActive(int _instance, bool _active)
+		{
+				const uint active = _active ? 1 : 0;
+				if (m_instances[_instance].active != active)
+				{
+						m_instances[_instance].active = active;
+						m_dirtyInstances.push_back(_instance);
+				}
+		}
+
+		void GPUScene::syncEntity(int _key, const Entity* _entity)
+		{
+				std::weak_ptr<Mesh> mesh = _entity->getComponent<MeshRenderer>().lock()->getMesh();
+
+				auto entityInstance = m_entityInstances.find(_key);
+				if (mesh.expired())
+				{
+						if (entityInstance != m_entityInstances.end())
+						{
+								remove(entityInstance->second.first);
+								m_entityInstances.erase(entityInstance);
+						}
+						return;
+				}
+
+				const glm::mat4 toWorldMat = _entity->getComponent<Transform>().lock()->worldTransform();
+				if (entityInstance == m_entityInstances.end())
+				{
+						entityInstance = m_entityInstances.insert(std::make_pair(_key, std::make_pair(add(mesh, toWorldMat), _entity))).first;
+				}
+				else
+				{
+						update(entityInstance->second.first, mesh, toWorldMat);
+				}
+
+				//a moved entity may have been attached to an inactive parent
+				setActive(entityInstance->second.first, _entity->isActiveInHierarchy());
+		}
+
+		void GPUScene::removeEntity(int _key)
+		{
+				auto entityInstance = m_entityInstances.find(_key);
+				if (entityInstance != m_entityInstances.end())
+				{
+						remove(entityInstance->second.first);
+						m_entityInstances.erase(entityInstance);
+				}
+		}
+
+		void GPUScene::refreshActiveStates()
+		{
+				for (const auto& entityInstance : m_entityInstances)
+				{
+						setActive(entityInstance.second.first, entityInstance.second.second->isActiveInHierarchy());
+				}
+		}
+
+		uint GPUScene::findBatch(std::weak_ptr<Mesh> _mesh)
+		{
+				auto it = m_batchLookup.find(_mesh.lock().get());
+				if (it != m_batchLookup.end())
+				{
+						//a new mesh at the address of a deleted one takes over its batch
+						if (m_batchInfos[it->second].mesh.expired())
+						{
+								m_batchInfos[it->second].mesh = _mesh;
+								m_layoutChanged = true;
+						}
+						return it->second;
+				}
+
+				BatchInfo batch;
+				batch.mesh = _mesh;
+				m_batchInfos.push_back(batch);
+
+				const uint index = static_cast<uint>(m_batchInfos.size() - 1);
+				m_batchLookup.insert(std::make_pair(_mesh.lock().get(), index));
+				return index;
+		}
+
+		void GPUScene::setInstance(int _instance, std::weak_ptr<Mesh> _mesh, const glm::mat4& _toWorldMat)
+		{
+				const std::shared_ptr<Mesh> mesh = _mesh.lock();
+				GPUInstance& instance = m_instances[_instance];
+
+				//normalized positions are scaled back to model space as part of the world matrix
+				instance.worldmat = mesh->hasDequantization() ? _toWorldMat * mesh->getDequantization() : _toWorldMat;
+
+				const MeshBoundingSphere& sphereBounds = mesh->getSphereBounds();
+				const float maxScale = glm::sqrt(glm::max(glm::dot(glm::vec3(_toWorldMat[0]), glm::vec3(_toWorldMat[0])),
+						glm::max(glm::dot(glm::vec3(_toWorldMat[1]), glm::vec3(_toWorldMat[1])),
+								glm::dot(glm::vec3(_toWorldMat[2]), glm::vec3(_toWorldMat[2])))));
+				instance.sphere = glm::vec4(glm::vec3(_toWorldMat * glm::vec4(sphereBounds.m_center, 1.0f)), sphereBounds.m_radius * maxScale);
+
+				instance.batch = findBatch(_mesh);
+				instance.active = 1;
+
+				m_dirtyInstances.push_back(_instance);
+		}
+
+		void GPUScene::rebuildDraws()
+		{
+				m_layoutChanged = false;
+
+				m_batches.resize(m_batchInfos.size());
+				m_draws.clear();
+				m_drawBatches.clear();
+				m_drawGroups.clear();
+
+				struct UnsortedDraw
+				{
+						uint group;
+						uint batch;
+						DrawElementsIndirectCommand draw;
+				};
+				std::vector<UnsortedDraw> unsortedDraws;
+				std::map<std::pair<VAO, const Material*>, uint> groupLookup;
+
+				//every batch gets room for all of its instances in the visible buffer, its draws start there
+				uint firstInstance{ 0 };
+				for (size_t i = 0; i < m_batchInfos.size(); i++)
+				{
+						const BatchInfo& info = m_batchInfos[i];
+						m_batches[i].firstInstance = firstInstance;
+						m_batches[i].numVisible = 0;
+						firstInstance += info.numInstances;
+
+						if (info.numInstances == 0 || info.mesh.expired())
+						{
+								continue;
+						}
+
+						const std::shared_ptr<Mesh> mesh = info.mesh.lock();
+						const std::vector<std::weak_ptr<Material>>& materials = mesh->getMaterials();
+
+						for (const SubMesh& subMesh : mesh->getSubMeshes(0))
+						{
+								assert(subMesh.m_materialIndex < materials.size());
+								const std::weak_ptr<Material>& material = materials.at(subMesh.m_materialIndex);
+
+								auto groupKey = std::make_pair(mesh->getVAO(), material.lock().get());
+								auto iter = groupLookup.find(groupKey);
+								if (iter == groupLookup.end())
+								{
+										DrawGroup group;
+										group.vao = mesh->getVAO();
+										group.material = material;
+										iter = groupLookup.insert(std::make_pair(groupKey, static_cast<uint>(m_drawGroups.size()))).first;
+										m_drawGroups.push_back(group);
+								}
+								m_drawGroups[iter->second].numDraws++;
+
+								UnsortedDraw unsorted;
+								unsorted.group = iter->second;
+								unsorted.batch = static_cast<uint>(i);
+								unsorted.draw.count = subMesh.m_numIndices;
+								unsorted.draw.instanceCount = 0;
+								unsorted.draw.firstIndex = mesh->getBaseIndex() + subMesh.m_baseIndex;
+								unsorted.draw.baseVertex = static_cast<int>(mesh->getBaseVertex() + subMesh.m_baseVertex);
+								unsorted.draw.baseInstance = m_batches[i].firstInstance;
+								unsortedDraws.push_back(unsorted);
+						}
+				}
+
+				//lay the draws of each group out contiguously
+				uint firstDraw{ 0 };
+				for (DrawGroup& group : m_drawGroups)
+				{
+						group.firstDraw = firstDraw;
+						firstDraw += group.numDraws;
+						group.numDraws = 0;
+				}
+
+				m_draws.resize(unsortedDraws.size());
+				m_drawBatches.resize(unsortedDraws.size());
+				for (const UnsortedDraw& unsorted : unsortedDraws)
+				{
+						DrawGroup& group = m_drawGroups[unsorted.group];
+						const uint index = group.firstDraw + group.numDraws++;
+						m_draws[index] = unsorted.draw;
+						m_drawBatches[index] = unsorted.batch;
+				}
+				m_visibleCapacity = firstInstance;
+		}
+
+		void GPUScene::recordUploads(CommandBucket& _bucket)
+		{
+				if (!m_dirtyInstances.empty())
+				{
+						std::sort(m_dirtyInstances.begin(), m_dirtyInstances.end());
+						m_dirtyInstances.erase(std::unique(m_dirtyInstances.begin(), m_dirtyInstances.end()), m_dirtyInstances.end());
+
+						if (m_instances.size() > m_instanceCapacity)
+						{
+								//respecify the buffer with room to grow, the slots past the instances are zero and so inactive
+								m_instanceCapacity = std::max(static_cast<uint>(m_instances.size() * 2), 64u);
+
+								const size_t size = sizeof(GPUInstance) * m_instanceCapacity;
+								void* data = _bucket.allocateAuxMemory(size);
+								std::memset(data, 0, size);
+								std::memcpy(data, m_instances.data(), sizeof(GPUInstance) * m_instances.size());
+
+								commands::UploadBuffer* upload = _bucket.add<commands::UploadBuffer>();
+								upload->target = GL_SHADER_STORAGE_BUFFER;
+								upload->buffer = m_instanceBuffer;
+								upload->offset = 0;
+								upload->size = static_cast<uint>(size);
+								upload->usage = GL_DYNAMIC_DRAW;
+								upload->reallocate = true;
+								upload->data = data;
+						}
+						else
+						{
+								//only the runs of changed slots
+								size_t first{ 0 };
+								while (first < m_dirtyInstances.size())
+								{
+										size_t last = first;
+										while (last + 1 < m_dirtyInstances.size() && m_dirtyInstances[last + 1] == m_dirtyInstances[last] + 1)
+										{
+												last++;
+										}
+
+										const size_t numSlots = last - first + 1;
+										commands::UploadBuffer* upload = _bucket.add<commands::UploadBuffer>();
+										upload->target = GL_SHADER_STORAGE_BUFFER;
+										upload->buffer = m_instanceBuffer;
+										upload->offset = static_cast<uint>(sizeof(GPUInstance) * m_dirtyInstances[first]);
+										upload->size = static_cast<uint>(sizeof(GPUInstance) * numSlots);
+										upload->usage = GL_DYNAMIC_DRAW;
+										upload->reallocate = false;
+										upload->data = _bucket.copyAuxMemory(&m_instances[m_dirtyInstances[first]], upload->size);
+
+										first = last + 1;
+								}
+						}
+
+						m_dirtyInstances.clear();
+				}
+
+				//a compaction of the mesh pool moves the geometry the draws point at
+				if (MeshPool::getNumCompactions() != m_numCompactions)
+				{
+						m_numCompactions = MeshPool::getNumCompactions();
+						m_layoutChanged = true;
+				}
+
+				if (!m_layoutChanged)
+				{
+						return;
+				}
+
+				rebuildDraws();
+
+				commands::UploadBuffer* batchUpload = _bucket.add<commands::UploadBuffer>();
+				batchUpload->target = GL_SHADER_STORAGE_BUFFER;
+				batchUpload->buffer = m_batchBuffer;
+				batchUpload->offset = 0;
+				batchUpload->size = static_cast<uint>(sizeof(GPUBatch) * m_batches.size());
+				batchUpload->usage = GL_DYNAMIC_DRAW;
+				batchUpload->reallocate = true;
+				batchUpload->data = _bucket.copyAuxMemory(m_batches.data(), batchUpload->size);
+
+				//only written by the culling
+				commands::UploadBuffer* visibleUpload = _bucket.add<commands::UploadBuffer>();
+				visibleUpload->target = GL_ARRAY_BUFFER;
+				visibleUpload->buffer = m_visibleBuffer;
+				visibleUpload->offset = 0;
+				visibleUpload->size = static_cast<uint>(sizeof(glm::mat4) * m_visibleCapacity);
+				visibleUpload->usage = GL_DYNAMIC_COPY;
+				visibleUpload->reallocate = true;
+				visibleUpload->data = nullptr;
+
+				commands::UploadBuffer* drawUpload = _bucket.add<commands::UploadBuffer>();
+				drawUpload->target = GL_DRAW_INDIRECT_BUFFER;
+				drawUpload->buffer = m_drawBuffer;
+				drawUpload->offset = 0;
+				drawUpload->size = static_cast<uint>(sizeof(DrawElementsIndirectCommand) * m_draws.size());
+				drawUpload->usage = GL_DYNAMIC_DRAW;
+				drawUpload->reallocate = true;
+				drawUpload->data = _bucket.copyAuxMemory(m_draws.data(), drawUpload->size);
+
+				commands::UploadBuffer* drawBatchUpload = _bucket.add<commands::UploadBuffer>();
+				drawBatchUpload->target = GL_SHADER_STORAGE_BUFFER;
+				drawBatchUpload->buffer = m_drawBatchBuffer;
+				drawBatchUpload->offset = 0;
+				drawBatchUpload->size = static_cast<uint>(sizeof(uint) * m_drawBatches.size());
+				drawBatchUpload->usage = GL_DYNAMIC_DRAW;
+				drawBatchUpload->reallocate = true;
+				drawBatchUpload->data = _bucket.copyAuxMemory(m_drawBatches.data(), drawBatchUpload->size);
+		}
+
+		void GPUScene::recordCulling(CommandBucket& _bucket, GLSLProgram& _cullingShader, const Frustum& _frustum)
+		{
+				recordUploads(_bucket);
+
+				m_recordedDraws = nullptr;
+				if (m_draws.empty())
+				{
+						return;
+				}
+
+				//the draws as the cpu knows them, for the stats
+				m_recordedDraws = static_cast<const DrawElementsIndirectCommand*>(_bucket.copyAuxMemory(m_draws.data(),
+						sizeof(DrawElementsIndirectCommand) * m_draws.size()));
+
+				_cullingShader.recordUse(_bucket);
+
+				for (unsigned int i = 0; i < 6; i++)
+				{
+						_cullingShader.recordValue(_bucket, "frustumPlanes[" + std::to_string(i) + "]", _frustum.getPlane(i));
+				}
+
+				const uint buffers[] = { m_instanceBuffer, m_batchBuffer, m_visibleBuffer, m_drawBuffer, m_drawBatchBuffer };
+				for (uint i = 0; i < 5; i++)
+				{
+						commands::BindBufferBase* bind = _bucket.add<commands::BindBufferBase>();
+						bind->target = GL_SHADER_STORAGE_BUFFER;
+						bind->index = i;
+						bind->buffer = buffers[i];
+				}
+
+				//reset the counts of the batches
+				_cullingShader.recordValue(_bucket, "stage", 0);
+				_cullingShader.recordValue(_bucket, "count", static_cast<int>(m_batches.size()));
+				commands::DispatchCompute* reset = _bucket.add<commands::DispatchCompute>();
+				reset->numGroupsX = numGroups(m_batches.size());
+				reset->numGroupsY = 1;
+				reset->numGroupsZ = 1;
+				_bucket.add<commands::SetMemoryBarrier>()->barriers = GL_SHADER_STORAGE_BARRIER_BIT;
+
+				//test the instances and pack the visible ones per batch
+				_cullingShader.recordValue(_bucket, "stage", 1);
+				_cullingShader.recordValue(_bucket, "count", static_cast<int>(m_instances.size()));
+				commands::DispatchCompute* cull = _bucket.add<commands::DispatchCompute>();
+				cull->numGroupsX = numGroups(m_instances.size());
+				cull->numGroupsY = 1;
+				cull->numGroupsZ = 1;
+				_bucket.add<commands::SetMemoryBarrier>()->barriers = GL_SHADER_STORAGE_BARRIER_BIT;
+
+				//write the counts into the draws
+				_cullingShader.recordValue(_bucket, "stage", 2);
+				_cullingShader.recordValue(_bucket, "count", static_cast<int>(m_draws.size()));
+				commands::DispatchCompute* write = _bucket.add<commands::DispatchCompute>();
+				write->numGroupsX = numGroups(m_draws.size());
+				write->numGroupsY = 1;
+				write->numGroupsZ = 1;
+
+				//the draws and the instances are read by the following indirect draws
+				_bucket.add<commands::SetMemoryBarrier>()->barriers = GL_COMMAND_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT;
+
+				_cullingShader.recordUnUse(_bucket);
+		}
+
+		void GPUScene::recordDraws(CommandBucket& _bucket, GLSLProgram* _shader)
+		{
+				if (m_recordedDraws == nullptr)
+				{
+						return;
+				}
+
+				VAO boundVAO{ 0 };
+				const Material* boundMaterial{ nullptr };
+
+				for (size_t i = 0; i < m_drawGroups.size(); i++)
+				{
+						const DrawGroup& group = m_drawGroups[i];
+						uint numDraws = group.numDraws;
+
+						if (_shader == nullptr)
+						{
+								//without materials the following groups of the same vao are merged, they are contiguous in the buffer
+								while (i + 1 < m_drawGroups.size() && m_drawGroups[i + 1].vao == group.vao)
+								{
+										numDraws += m_drawGroups[++i].numDraws;
+								}
+						}
+
+						if (group.vao != boundVAO)
+						{
+								_bucket.add<commands::BindVertexArray>()->vao = group.vao;
+
+								commands::BindInstanceMat4* instanceAttribute = _bucket.add<commands::BindInstanceMat4>();
+								instanceAttribute->location = Mesh::BufferObject::WORLDMAT;
+								instanceAttribute->buffer = m_visibleBuffer;
+								instanceAttribute->offset = 0;
+								instanceAttribute->compact = false;
+								instanceAttribute->materialParams = false;
+
+								boundVAO = group.vao;
+						}
+
+						if (_shader != nullptr && !group.material.expired() && group.material.lock().get() != boundMaterial)
+						{
+								_shader->recordMaterial(_bucket, group.material);
+								boundMaterial = group.material.lock().get();
+						}
+
+						commands::MultiDrawElementsIndirect* draw = _bucket.add<commands::MultiDrawElementsIndirect>();
+						draw->mode = GL_TRIANGLES;
+						draw->buffer = m_drawBuffer;
+						draw->offset = static_cast<uint>(sizeof(DrawElementsIndirectCommand) * group.firstDraw);
+						draw->drawCount = numDraws;
+						draw->draws = m_recordedDraws + group.firstDraw;
+				}
+
+				_bucket.add<commands::BindVertexArray>()->vao = 0;
+		}
+
+		void GPUScene::dispose()
+		{
+				if (!RenderBackend::isNull() && m_instanceBuffer != 0)
+				{
+						glDeleteBuffers(1, &m_instanceBuffer);
+						glDeleteBuffers(1, &m_batchBuffer);
+						glDeleteBuffers(1, &m_visibleBuffer);
+						glDeleteBuffers(1, &m_drawBuffer);
+						glDeleteBuffers(1, &m_drawBatchBuffer);
+				}
+				m_instanceBuffer = 0;
+				m_batchBuffer = 0;
+				m_visibleBuffer = 0;
+				m_drawBuffer = 0;
+				m_drawBatchBuffer = 0;
+				m_instanceCapacity = 0;
+		}
+}
@@ -0,0 +1,162 @@
+#ifndef GPU_SCENE_H
+#define GPU_SCENE_H
+
+#include "RenderCommands.h"
+
+#include <glm\vec4.hpp>
+#include <glm\mat4x4.hpp>
+#include <memory>
+#include <vector>
+#include <unordered_map>
+
+namespace cogs
+{
+		class Mesh;
+		class Material;
+		class GLSLProgram;
+		class CommandBucket;
+		class Frustum;
+		class Entity;
+
+		using VAO = uint;
+
+		/**
+		* \brief The instances culled on the gpu. Their world matrices and bounding spheres stay in a shader storage buffer
+		* which is only written where instances were added, moved or removed. Every frame a compute shader (see Test/Shaders/GPUCulling.comp)
+		* tests them against the frustum, packs the world matrices of the visible ones per mesh into the instance buffer
+		* and writes their counts into the indirect draws, the cpu only records the dispatches and the draws.
+		* Meshes are drawn at their full detail. The render stats can't count the instances, their numbers never come back to the cpu
+		*/
+		class GPUScene
+		{
+		public:
+				GPUScene();
+				~GPUScene();
+
+				/**
+				* \brief adds an instance of a mesh
+				* \param _toWorldMat - the transform of the entity
+				* \return the id of the instance
+				*/
+				int add(std::weak_ptr<Mesh> _mesh, const glm::mat4& _toWorldMat);
+
+				/**
+				* \brief refreshes an instance after its entity moved or changed its mesh
+				*/
+				void update(int _instance, std::weak_ptr<Mesh> _mesh, const glm::mat4& _toWorldMat);
+				void remove(int _instance);
+
+				/**
+				* \brief masks an instance while its entity is inactive, the culling skips it
+				*/
+				void setActive(int _instance, bool _active);
+
+				/**
+				* \brief adds, refreshes or removes the instance of an entity with a mesh renderer after it joined, moved or changed its mesh.
+				* The instance is masked while the entity or a parent is inactive
+				* \param _key - identifies the entity, e.g. its proxy in the scene tree
+				*/
+				void syncEntity(int _key, const Entity* _entity);
+				void removeEntity(int _key);
+				bool hasEntities() const noexcept { return !m_entityInstances.empty(); }
+
+				/**
+				* \brief masks the instances of the entities which became inactive or have an inactive parent, and unmasks the reactivated ones
+				*/
+				void refreshActiveStates();
+
+				unsigned int getNumInstances() const noexcept { return m_numInstances; }
+
+				/**
+				* \brief uploads the changes since the last frame, then records the dispatches culling the instances against a frustum
+				*/
+				void recordCulling(CommandBucket& _bucket, GLSLProgram& _cullingShader, const Frustum& _frustum);
+
+				/**
+				* \brief records the indirect draws of the culled instances, one multi draw per vao and material.
+				* The shader sets the materials, without one they are left out (depth pre-pass)
+				*/
+				void recordDraws(CommandBucket& _bucket, GLSLProgram* _shader);
+
+				/**
+				* \brief deletes the buffers
+				*/
+				void dispose();
+
+		private:
+				/**
+				* \brief an instance as the compute shader reads it (std430)
+				*/
+				struct GPUInstance
+				{
+						glm::mat4 worldmat{ 1.0f }; ///< the world matrix drawn with, including the dequantization of the mesh
+						glm::vec4 sphere{ 0.0f }; ///< the world bounding sphere, center and radius
+						uint batch{ 0 };
+						uint active{ 0 }; ///< 0 for free slots and inactive entities
+						uint padding[2] = { 0 };
+				};
+
+				/**
+				* \brief the instances of a mesh as the compute shader reads it (std430)
+				*/
+				struct GPUBatch
+				{
+						uint firstInstance{ 0 }; ///< where the visible instances are packed in the instance buffer
+						uint numVisible{ 0 }; ///< counted up by the culling, reset every frame
+						uint padding[2] = { 0 };
+				};
+
+				struct BatchInfo
+				{
+						std::weak_ptr<Mesh> mesh;
+						uint numInstances{ 0 };
+				};
+
+				/**
+				* \brief consecutive draws sharing a vao and a material
+				*/
+				struct DrawGroup
+				{
+						VAO vao{ 0 };
+						std::weak_ptr<Material> material;
+						uint firstDraw{ 0 };
+						uint numDraws{ 0 };
+				};
+
+				uint findBatch(std::weak_ptr<Mesh> _mesh);
+				void setInstance(int _instance, std::weak_ptr<Mesh> _mesh, const glm::mat4& _toWorldMat);
+
+				/**
+				* \brief lays out the packed instances of the batches and rebuilds the draws after instances were added, removed or changed their mesh
+				*/
+				void rebuildDraws();
+				void recordUploads(CommandBucket& _bucket);
+
+				std::vector<GPUInstance> m_instances; ///< the cpu copy of the instance buffer
+				std::vector<int> m_freeInstances;
+				std::vector<int> m_dirtyInstances; ///< the slots to upload in the next frame
+				std::unordered_map<int, std::pair<int, const Entity*>> m_entityInstances; ///< the instance and the entity of every key of syncEntity
+				uint m_numInstances{ 0 };
+				uint m_instanceCapacity{ 0 }; ///< the slots the instance buffer has room for
+
+				std::vector<BatchInfo> m_batchInfos;
+				std::unordered_map<const Mesh*, uint> m_batchLookup;
+				std::vector<GPUBatch> m_batches;
+
+				std::vector<DrawElementsIndirectCommand> m_draws; ///< grouped by vao and material, the instance counts are written by the gpu
+				std::vector<uint> m_drawBatches; ///< the batch of every draw
+				std::vector<DrawGroup> m_drawGroups;
+				const DrawElementsIndirectCommand* m_recordedDraws{ nullptr }; ///< the bucket's copy of the draws of this frame
+				uint m_visibleCapacity{ 0 }; ///< the instances the visible buffer has room for
+				bool m_layoutChanged{ false }; ///< whether the draws need rebuilding
+				uint m_numCompactions{ 0 }; ///< the compactions of the mesh pool when the draws were built, their offsets are stale after another
+
+				uint m_instanceBuffer{ 0 }; ///< the instances, binding 0 of the culling shader
+				uint m_batchBuffer{ 0 }; ///< the batches, binding 1
+				uint m_visibleBuffer{ 0 }; ///< the world matrices of the visible instances, binding 2 and the instance attribute
+				uint m_drawBuffer{ 0 }; ///< the GL_DRAW_INDIRECT_BUFFER, binding 3
+				uint m_drawBatchBuffer{ 0 }; ///< the batch of every draw, binding 4
+		};
+}
+
+#endif // !GPU_SCENE_H
@@ -0,0 +1,103 @@
+#include "GPUTimer.h"
+#include "CommandBucket.h"
+#include "RenderBackend.h"
+
+#include <GL\glew.h>
+
+namespace cogs
+{
+		GPUTimer::GPUTimer()
+		{
+		}
+
+		GPUTimer::~GPUTimer()
+		{
+				if (m_created && !RenderBackend::isNull())
+				{
+						glDeleteQueries(s_numQueries, m_queries);
+				}
+		}
+
+		void GPUTimer::begin(CommandBucket& _bucket)
+		{
+				commands::Callback* callback = _bucket.add<commands::Callback>();
+				callback->function = &GPUTimer::onBegin;
+				callback->userData = this;
+		}
+
+		void GPUTimer::end(CommandBucket& _bucket)
+		{
+				commands::Callback* callback = _bucket.add<commands::Callback>();
+				callback->function = &GPUTimer::onEnd;
+				callback->userData = this;
+		}
+
+		void GPUTimer::onBegin(void* _timer)
+		{
+				GPUTimer* timer = static_cast<GPUTimer*>(_timer);
+
+				//queries are generated lazily so they belong to the context executing the commands
+				if (!timer->m_created)
+				{
+						glGenQueries(s_numQueries, timer->m_queries);
+						timer->m_created = true;
+				}
+
+				timer->resolve();
+
+				//skip this measurement rather than stall if the gpu hasn't caught up with the ring yet
+				if (timer->m_issued[timer->m_next] != 0)
+				{
+						timer->m_active = -1;
+						return;
+				}
+
+				timer->m_active = timer->m_next;
+				timer->m_next = (timer->m_next + 1) % s_numQueries;
+
+				glBeginQuery(GL_TIME_ELAPSED, timer->m_queries[timer->m_active]);
+		}
+
+		void GPUTimer::onEnd(void* _timer)
+		{
+				GPUTimer* timer = static_cast<GPUTimer*>(_timer);
+
+				if (timer->m_active < 0)
+				{
+						return;
+				}
+
+				glEndQuery(GL_TIME_ELAPSED);
+
+				timer->m_issued[timer->m_active] = ++timer->m_frame;
+				timer->m_active = -1;
+		}
+
+		void GPUTimer::resolve()
+		{
+				for (int i = 0; i < s_numQueries; i++)
+				{
+						if (m_issued[i] == 0)
+						{
+								continue;
+						}
+
+						GLint available = 0;
+						glGetQueryObjectiv(m_queries[i], GL_QUERY_RESULT_AVAILABLE, &available);
+
+						if (available)
+						{
+								GLuint64 nanoseconds = 0;
+								glGetQueryObjectui64v(m_queries[i], GL_QUERY_RESULT, &nanoseconds);
+
+								//only keep the most recent result, older ones can resolve out of order
+								if (m_issued[i] > m_lastResolved)
+								{
+										m_lastResolved = m_issued[i];
+										m_milliseconds.store(static_cast<float>(nanoseconds / 1000000.0));
+								}
+								m_issued[i] = 0;
+						}
+				}
+		}
+}
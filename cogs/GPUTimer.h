@@ -0,0 +1,61 @@
+#ifndef GPU_TIMER_H
+#define GPU_TIMER_H
+
+#include <atomic>
+
+namespace cogs
+{
+		class CommandBucket;
+
+		/**
+		* \brief Measures the GPU time of a range of recorded commands with GL_TIME_ELAPSED queries.
+		* The queries are created, started and resolved by callbacks on the thread executing the bucket,
+		* and a small ring of queries is used so reading the results never stalls the pipeline.
+		* The measured time lags a few frames behind
+		*/
+		class GPUTimer
+		{
+		public:
+				GPUTimer();
+				~GPUTimer();
+
+				GPUTimer(const GPUTimer&) = delete;
+				GPUTimer& operator=(const GPUTimer&) = delete;
+
+				/**
+				* \brief Records the start of the timed range, only one timer can be running at a time
+				*/
+				void begin(CommandBucket& _bucket);
+
+				/**
+				* \brief Records the end of the timed range
+				*/
+				void end(CommandBucket& _bucket);
+
+				/**
+				* \brief Gets the latest resolved GPU time of the range in milliseconds
+				*/
+				float getMilliseconds() const noexcept { return m_milliseconds.load(); }
+
+		private:
+				static void onBegin(void* _timer);
+				static void onEnd(void* _timer);
+
+				void resolve();
+
+		private:
+				static const int s_numQueries = 4; ///< number of queries in flight
+
+				unsigned int m_queries[s_numQueries]{ 0 }; ///< the query objects
+				unsigned int m_issued[s_numQueries]{ 0 }; ///< frame the query was issued in, 0 if it's not pending
+				unsigned int m_frame{ 0 }; ///< counter of timed ranges
+				unsigned int m_lastResolved{ 0 }; ///< frame of the latest resolved result
+				int m_next{ 0 }; ///< the next query in the ring to use
+				int m_active{ -1 }; ///< the query currently running, -1 if none
+				bool m_created{ false }; ///< whether the query objects have been generated
+
+				std::atomic<float> m_milliseconds{ 0.0f }; ///< latest resolved time
+		};
+}
+
+#endif // !GPU_TIMER_H
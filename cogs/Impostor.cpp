@@ -0,0 +1,121 @@
+#include "Impostor.h"
+
+#include "Mesh.h"
+#include "Material.h"
+#include "GLSLProgram.h"
+#include "RenderBackend.h"
+
+#include <GL\glew.h>
+#include <glm\glm.hpp>
+#include <glm\gtc\matrix_transform.hpp>
+
+namespace cogs
+{
+		namespace
+		{
+				//must match octDecode of Impostor.vert
+				glm::vec3 octDecode(const glm::vec2& _encoded)
+				{
+						glm::vec3 n(_encoded.x, _encoded.y, 1.0f - glm::abs(_encoded.x) - glm::abs(_encoded.y));
+						if (n.z < 0.0f)
+						{
+								n = glm::vec3((1.0f - glm::abs(n.y)) * (n.x >= 0.0f ? 1.0f : -1.0f), (1.0f - glm::abs(n.x)) * (n.y >= 0.0f ? 1.0f : -1.0f), n.z);
+						}
+						return glm::normalize(n);
+				}
+		}
+
+		std::shared_ptr<Impostor> Impostor::bake(std::weak_ptr<Mesh> _mesh,
+				std::weak_ptr<GLSLProgram> _bakeShader,
+				unsigned int _framesPerSide,
+				unsigned int _frameSize)
+		{
+				std::shared_ptr<Impostor> newImpostor = std::make_shared<Impostor>();
+
+				//the bounding sphere of the mesh only covers the largest extent, the frames have to hold the whole box
+				const MeshBoundingBox& box = _mesh.lock()->getBoxBounds();
+				newImpostor->m_center = (box.m_min + box.m_max) * 0.5f;
+				newImpostor->m_radius = glm::max(glm::length(box.m_max - box.m_min) * 0.5f, 0.0001f);
+				newImpostor->m_framesPerSide = glm::max(_framesPerSide, 1u);
+
+				const unsigned int framesPerSide = newImpostor->m_framesPerSide;
+				newImpostor->m_atlas = Framebuffer::create(framesPerSide * _frameSize, framesPerSide * _frameSize);
+
+				if (RenderBackend::isNull())
+				{
+						return newImpostor;
+				}
+
+				const glm::vec3& center = newImpostor->m_center;
+				const float radius = newImpostor->m_radius;
+
+				std::weak_ptr<Framebuffer> previousTarget = Framebuffer::getCurrentActive();
+				Framebuffer::setActive(newImpostor->m_atlas);
+
+				//transparent background, the impostor shader discards it
+				float clearColor[4];
+				glGetFloatv(GL_COLOR_CLEAR_VALUE, clearColor);
+				glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+				glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+				std::shared_ptr<GLSLProgram> shader = _bakeShader.lock();
+				shader->use();
+
+				//the camera sits at twice the radius, so the sphere spans depths from radius to three times the radius
+				shader->uploadValue("projection", glm::ortho(-radius, radius, -radius, radius, 0.0f, radius * 4.0f));
+				shader->uploadValue("model", _mesh.lock()->getDequantization());
+
+				const std::vector<SubMesh>& subMeshes = _mesh.lock()->getSubMeshes();
+				const std::vector<std::weak_ptr<Material>>& materials = _mesh.lock()->getMaterials();
+
+				glBindVertexArray(_mesh.lock()->getVAO());
+
+				for (unsigned int y = 0; y < framesPerSide; y++)
+				{
+						for (unsigned int x = 0; x < framesPerSide; x++)
+						{
+								glViewport(x * _frameSize, y * _frameSize, _frameSize, _frameSize);
+
+								//the direction the frame is seen from, the center of its cell in the octahedral map
+								glm::vec2 encoded((x + 0.5f) / framesPerSide * 2.0f - 1.0f, (y + 0.5f) / framesPerSide * 2.0f - 1.0f);
+								glm::vec3 direction = octDecode(encoded);
+								glm::vec3 up = glm::abs(direction.y) > 0.999f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+
+								shader->uploadValue("view", glm::lookAt(center + direction * radius * 2.0f, center, up));
+								shader->uploadValue("viewDirection", direction);
+
+								for (const SubMesh& subMesh : subMeshes)
+								{
+										std::weak_ptr<GLTexture2D> diffuse;
+										if (subMesh.m_materialIndex < materials.size() && !materials.at(subMesh.m_materialIndex).expired())
+										{
+												diffuse = materials.at(subMesh.m_materialIndex).lock()->getDiffuseMap();
+										}
+
+										shader->uploadValue("hasDiffuseMap", diffuse.expired() ? 0 : 1);
+										if (!diffuse.expired())
+										{
+												shader->uploadValue("diffuseMap", 0, diffuse);
+										}
+
+										glDrawElementsBaseVertex(GL_TRIANGLES, subMesh.m_numIndices, GL_UNSIGNED_INT,
+												(const void*)(sizeof(unsigned int) * (_mesh.lock()->getBaseIndex() + subMesh.m_baseIndex)),
+												_mesh.lock()->getBaseVertex() + subMesh.m_baseVertex);
+								}
+						}
+				}
+
+				glBindVertexArray(0);
+				shader->unUse();
+
+				glClearColor(clearColor[0], clearColor[1], clearColor[2], clearColor[3]);
+				Framebuffer::setActive(previousTarget);
+
+				//the atlas gets minified a lot in the distance
+				glBindTexture(GL_TEXTURE_2D, newImpostor->m_atlas->getTextureID());
+				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+				glBindTexture(GL_TEXTURE_2D, 0);
+
+				return newImpostor;
+		}
+}
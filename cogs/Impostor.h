@@ -0,0 +1,55 @@
+#ifndef IMPOSTOR_H
+#define IMPOSTOR_H
+
+#include "Framebuffer.h"
+
+#include <memory>
+#include <glm\vec3.hpp>
+
+namespace cogs
+{
+		class Mesh;
+		class GLSLProgram;
+
+		/**
+		* \brief Billboard stand-in for a mesh far away from the camera.
+		* The mesh is rendered from a grid of directions spread over the sphere with an octahedral mapping,
+		* every direction into its own frame of an atlas. A distant instance is drawn as a single quad
+		* showing the frame closest to the direction it is seen from
+		*/
+		class Impostor
+		{
+		public:
+				Impostor() {}
+				~Impostor() {}
+
+				/**
+				* \brief renders the views of a mesh into a new atlas, needs the GL context
+				* \param[in] _mesh - the mesh to bake
+				* \param[in] _bakeShader - shader rendering a single view, gets the uniforms projection, view, model,
+				* viewDirection, hasDiffuseMap and diffuseMap (see Test/Shaders/ImpostorBake.vert/.frag)
+				* \param[in] _framesPerSide - the atlas holds _framesPerSide * _framesPerSide views
+				* \param[in] _frameSize - the size of a view in pixels
+				*/
+				static std::shared_ptr<Impostor> bake(std::weak_ptr<Mesh> _mesh,
+						std::weak_ptr<GLSLProgram> _bakeShader,
+						unsigned int _framesPerSide = 8,
+						unsigned int _frameSize = 128);
+
+				/**
+				* \brief getters
+				*/
+				uint getTextureID()											const noexcept { return m_atlas ? m_atlas->getTextureID() : 0; }
+				unsigned int getFramesPerSide() const noexcept { return m_framesPerSide; }
+				const glm::vec3& getCenter()				const noexcept { return m_center; }
+				float getRadius()																const noexcept { return m_radius; }
+
+		private:
+				std::shared_ptr<Framebuffer> m_atlas; ///< the baked views
+				unsigned int m_framesPerSide{ 0 }; ///< the views per row and column of the atlas
+				glm::vec3 m_center{ 0.0f }; ///< the center of the mesh's bounding sphere in model space
+				float m_radius{ 0.0f }; ///< the radius of the mesh's bounding sphere, a frame covers its diameter
+		};
+}
+
+#endif // !IMPOSTOR_H
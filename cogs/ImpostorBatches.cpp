@@ -0,0 +1,147 @@
+#include "ImpostorBatches.h"
+
+#include "Camera.h"
+#include "CommandBucket.h"
+#include "GLSLProgram.h"
+#include "Impostor.h"
+#include "Mesh.h"
+#include "RenderBackend.h"
+
+#include <GL\glew.h>
+
+namespace cogs
+{
+		ImpostorBatches::ImpostorBatches()
+		{
+				if (RenderBackend::isNull())
+				{
+						m_VAO = RenderBackend::generateNullHandle();
+						RenderBackend::generateNullHandles(2, m_VBOs);
+						return;
+				}
+
+				//the quad of the impostors, the instance matrices come from the instance buffer of the renderer
+				glGenVertexArrays(1, &m_VAO);
+				glGenBuffers(2, m_VBOs);
+
+				glBindVertexArray(m_VAO);
+
+				float vertices[] =
+				{ -0.5f,  0.5f, 0.0f,	 // top left corner
+						-0.5f, -0.5f, 0.0f,		// bottom left corner
+						0.5f, -0.5f, 0.0f,	 	// bottom right corner
+						0.5f,  0.5f, 0.0f }; // top right corner
+
+				glBindBuffer(GL_ARRAY_BUFFER, m_VBOs[0]);
+				glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+				glEnableVertexAttribArray(Mesh::BufferObject::POSITION);
+				glVertexAttribPointer(Mesh::BufferObject::POSITION, 3, GL_FLOAT, GL_FALSE, 0, nullptr);
+
+				unsigned int indices[] = { 0, 1, 2, 0, 2, 3 };
+
+				glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_VBOs[1]);
+				glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+
+				//the pointers are set by BindInstanceMat4 when drawing
+				for (uint i = 0; i < 4; i++)
+				{
+						glEnableVertexAttribArray(Mesh::BufferObject::WORLDMAT + i);
+						glVertexAttribDivisor(Mesh::BufferObject::WORLDMAT + i, 1);
+				}
+
+				glBindVertexArray(0);
+		}
+
+		ImpostorBatches::~ImpostorBatches()
+		{
+				dispose();
+		}
+
+		bool ImpostorBatches::add(const Mesh& _mesh, const glm::mat4& _toWorldMat, float _nearDepth)
+		{
+				if (m_distance <= 0.0f || m_shader.expired() || _nearDepth <= m_distance)
+				{
+						return false;
+				}
+
+				std::shared_ptr<Impostor> impostor = _mesh.getImpostor().lock();
+				if (!impostor)
+				{
+						return false;
+				}
+
+				auto lookup = m_batchLookup.insert(std::make_pair(impostor.get(), m_batches.size()));
+				if (lookup.second)
+				{
+						m_batches.emplace_back();
+						m_batches.back().impostor = impostor;
+				}
+				m_batches[lookup.first->second].worldmats.push_back(_toWorldMat);
+				m_numInstances++;
+				return true;
+		}
+
+		void ImpostorBatches::clear()
+		{
+				m_batches.clear();
+				m_batchLookup.clear();
+				m_numInstances = 0;
+		}
+
+		void ImpostorBatches::recordDraws(CommandBucket& _bucket, const Camera& _camera, uint _instanceBuffer, uint _firstInstance, uint _instanceSize,
+				bool _compact, bool _materialParams) const
+		{
+				m_shader.lock()->recordUse(_bucket);
+				m_shader.lock()->recordValue(_bucket, "projection", _camera.getProjectionMatrix());
+				m_shader.lock()->recordValue(_bucket, "view", _camera.getViewMatrix());
+
+				_bucket.add<commands::BindVertexArray>()->vao = m_VAO;
+
+				//same order as the upload
+				uint baseInstance = _firstInstance;
+				for (const Batch& batch : m_batches)
+				{
+						std::shared_ptr<Impostor> impostor = batch.impostor.lock();
+
+						commands::BindInstanceMat4* instanceAttribute = _bucket.add<commands::BindInstanceMat4>();
+						instanceAttribute->location = Mesh::BufferObject::WORLDMAT;
+						instanceAttribute->buffer = _instanceBuffer;
+						instanceAttribute->offset = _instanceSize * baseInstance;
+						instanceAttribute->compact = _compact;
+						instanceAttribute->materialParams = _materialParams;
+
+						m_shader.lock()->recordValue(_bucket, "impostorCenter", impostor->getCenter());
+						m_shader.lock()->recordValue(_bucket, "impostorRadius", impostor->getRadius());
+						m_shader.lock()->recordValue(_bucket, "framesPerSide", static_cast<float>(impostor->getFramesPerSide()));
+
+						commands::BindTexture* bind = _bucket.add<commands::BindTexture>();
+						bind->slot = 0;
+						bind->target = GL_TEXTURE_2D;
+						bind->texture = impostor->getTextureID();
+
+						commands::DrawElementsInstanced* draw = _bucket.add<commands::DrawElementsInstanced>();
+						draw->mode = GL_TRIANGLES;
+						draw->indexCount = 6;
+						draw->indexOffset = 0;
+						draw->instanceCount = static_cast<uint>(batch.worldmats.size());
+						draw->baseVertex = 0;
+
+						baseInstance += static_cast<uint>(batch.worldmats.size());
+				}
+
+				_bucket.add<commands::BindVertexArray>()->vao = 0;
+
+				m_shader.lock()->recordUnUse(_bucket);
+		}
+
+		void ImpostorBatches::dispose()
+		{
+				if (!RenderBackend::isNull() && m_VAO != 0)
+				{
+						glDeleteVertexArrays(1, &m_VAO);
+						glDeleteBuffers(2, m_VBOs);
+				}
+				m_VAO = 0;
+				m_VBOs[0] = m_VBOs[1] = 0;
+		}
+}
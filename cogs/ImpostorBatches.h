@@ -0,0 +1,88 @@
+#ifndef IMPOSTOR_BATCHES_H
+#define IMPOSTOR_BATCHES_H
+
+#include "RenderCommands.h"
+
+#include <glm\mat4x4.hpp>
+#include <memory>
+#include <vector>
+#include <unordered_map>
+
+namespace cogs
+{
+		class Mesh;
+		class Impostor;
+		class GLSLProgram;
+		class CommandBucket;
+		class Camera;
+
+		using VAO = uint;
+
+		/**
+		* \brief The distant instances of the frame drawn as billboards, batched per impostor.
+		* Their world matrices are uploaded into the instance buffer of the renderer, behind the instances of the meshes
+		*/
+		class ImpostorBatches
+		{
+		public:
+				/**
+				* \brief the instances of a mesh with an impostor
+				*/
+				struct Batch
+				{
+						std::weak_ptr<Impostor> impostor;
+						std::vector<glm::mat4> worldmats;
+				};
+
+				ImpostorBatches();
+				~ImpostorBatches();
+
+				/**
+				* \brief set the shader drawing the billboards (see Test/Shaders/Impostor.vert/.frag)
+				*/
+				void setShader(std::weak_ptr<GLSLProgram> _shader) { m_shader = _shader; }
+
+				/**
+				* \brief instances further away than this are drawn as billboards if their mesh has an impostor, 0 disables them
+				*/
+				void setDistance(float _distance) { m_distance = _distance; }
+				float getDistance() const noexcept { return m_distance; }
+
+				/**
+				* \brief adds an instance as a billboard if it's far enough away and its mesh has an impostor
+				* \param _nearDepth - the view space depth of the closest point of the bounding sphere
+				* \return whether the instance was added
+				*/
+				bool add(const Mesh& _mesh, const glm::mat4& _toWorldMat, float _nearDepth);
+
+				void clear();
+				bool empty() const noexcept { return m_batches.empty(); }
+				unsigned int getNumInstances() const noexcept { return m_numInstances; }
+				const std::vector<Batch>& getBatches() const noexcept { return m_batches; }
+
+				/**
+				* \brief records the billboards of all batches, their instances are read from the instance buffer of the renderer
+				* \param _firstInstance - where the instances of the first batch start in the buffer, the others follow in order
+				* \param _instanceSize - the bytes of an instance in the buffer
+				*/
+				void recordDraws(CommandBucket& _bucket, const Camera& _camera, uint _instanceBuffer, uint _firstInstance, uint _instanceSize,
+						bool _compact, bool _materialParams) const;
+
+				/**
+				* \brief deletes the quad
+				*/
+				void dispose();
+
+		private:
+				std::vector<Batch> m_batches;
+				std::unordered_map<const Impostor*, size_t> m_batchLookup; ///< the batch of every impostor
+				unsigned int m_numInstances{ 0 }; ///< instances in all batches
+
+				std::weak_ptr<GLSLProgram> m_shader; ///< shader for the billboards
+				float m_distance{ 0.0f }; ///< the view depth beyond which instances become billboards
+				VAO m_VAO{ 0 }; ///< the quad of the billboards
+				uint m_VBOs[2] = { 0 }; ///< vertices and indices of the quad
+		};
+}
+
+#endif // !IMPOSTOR_BATCHES_H
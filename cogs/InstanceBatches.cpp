@@ -0,0 +1,737 @@
+#include "InstanceBatches.h"
+
+#include "CommandBucket.h"
+#include "GLSLProgram.h"
+#include "Camera.h"
+#include "Mesh.h"
+#include "MeshRenderer.h"
+#include "SceneTree.h"
+#include "OcclusionCuller.h"
+#include "ImpostorBatches.h"
+#include "RenderBackend.h"
+
+#include <GL\glew.h>
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+namespace cogs
+{
+		namespace
+		{
+				/**
+				* \brief the texture unit of the material params, past the ones of the material textures
+				*/
+				const uint MATERIAL_PARAMS_SLOT = 8;
+
+				/**
+				* \brief writes the world matrices of a batch into the instance buffer, compact ones as the first three rows
+				* \param _params - the material params blocks of the instances, instances past its end get block 0
+				* \param _withParams - whether every matrix is followed by the index of its params block
+				* \return the number of bytes written
+				*/
+				size_t writeInstances(const std::vector<glm::mat4>& _worldmats, const std::vector<uint>& _params, bool _compact, bool _withParams,
+						unsigned char* _data)
+				{
+						if (!_compact && !_withParams)
+						{
+								size_t size = sizeof(glm::mat4) * _worldmats.size();
+								if (size > 0)
+								{
+										std::memcpy(_data, _worldmats.data(), size);
+								}
+								return size;
+						}
+
+						float* out = reinterpret_cast<float*>(_data);
+						for (size_t i = 0; i < _worldmats.size(); i++)
+						{
+								const glm::mat4& worldmat = _worldmats[i];
+								if (_compact)
+								{
+										//the bottom row of an affine matrix is always (0, 0, 0, 1) and isn't stored
+										for (int row = 0; row < 3; row++)
+										{
+												*out++ = worldmat[0][row];
+												*out++ = worldmat[1][row];
+												*out++ = worldmat[2][row];
+												*out++ = worldmat[3][row];
+										}
+								}
+								else
+								{
+										std::memcpy(out, &worldmat, sizeof(glm::mat4));
+										out += 16;
+								}
+
+								if (_withParams)
+								{
+										const uint params = i < _params.size() ? _params[i] : 0;
+										std::memcpy(out++, &params, sizeof(uint));
+								}
+						}
+						return reinterpret_cast<unsigned char*>(out) - _data;
+				}
+
+				/**
+				* \brief the matrix an instance is drawn with, normalized positions are scaled back to model space as part of it
+				*/
+				glm::mat4 getDrawMatrix(const Mesh& _mesh, const glm::mat4& _toWorldMat)
+				{
+						return _mesh.hasDequantization() ? _toWorldMat * _mesh.getDequantization() : _toWorldMat;
+				}
+		}
+
+		InstanceBatches::InstanceBatches()
+		{
+				if (RenderBackend::isNull())
+				{
+						m_instanceBuffer = RenderBackend::generateNullHandle();
+						m_indirectBuffer = RenderBackend::generateNullHandle();
+						m_materialParamsBuffer = RenderBackend::generateNullHandle();
+						m_materialParamsTexture = RenderBackend::generateNullHandle();
+						return;
+				}
+
+				//the material params are read through a texture buffer, the first block always leaves the materials as they are
+				const MaterialParams defaultParams;
+				glGenBuffers(1, &m_materialParamsBuffer);
+				glBindBuffer(GL_TEXTURE_BUFFER, m_materialParamsBuffer);
+				glBufferData(GL_TEXTURE_BUFFER, sizeof(MaterialParams), &defaultParams, GL_STREAM_DRAW);
+				glGenTextures(1, &m_materialParamsTexture);
+				glBindTexture(GL_TEXTURE_BUFFER, m_materialParamsTexture);
+				glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, m_materialParamsBuffer);
+				glBindTexture(GL_TEXTURE_BUFFER, 0);
+				glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+				//the shared instance buffer and the indirect buffer, their storage is respecified every frame
+				glGenBuffers(1, &m_instanceBuffer);
+				glGenBuffers(1, &m_indirectBuffer);
+		}
+
+		InstanceBatches::~InstanceBatches()
+		{
+				dispose();
+		}
+
+		void InstanceBatches::clear(bool _withBounds)
+		{
+				m_entitiesMap.clear();
+				m_batchOrder.clear();
+				m_materialParams.resize(1);
+				m_withBounds = _withBounds;
+		}
+
+		uint InstanceBatches::addMaterialParams(const MeshRenderer& _meshRenderer)
+		{
+				if (!_meshRenderer.hasMaterialParams())
+				{
+						return 0;
+				}
+
+				m_materialParams.push_back(_meshRenderer.getMaterialParams());
+				return static_cast<uint>(m_materialParams.size() - 1);
+		}
+
+		void InstanceBatches::add(const Camera& _camera, std::weak_ptr<Mesh> _mesh, unsigned int _lod, const glm::mat4& _toWorldMat, float _maxScale,
+				float _centerDepth, Containment _containment, unsigned int _planeMask, unsigned int _lastPlane, uint _params)
+		{
+				std::shared_ptr<Mesh> mesh = _mesh.lock();
+				const float radius = mesh->getSphereBounds().m_radius * _maxScale;
+
+				//the world box of the instance is only needed to test it against the occluders
+				const AABB bounds = m_withBounds ? SceneTree::calcWorldBounds(mesh->getBoxBounds(), _toWorldMat) : AABB();
+
+				BatchKey key;
+				key.mesh = mesh.get();
+				key.lod = _lod;
+
+				const glm::mat4 worldmat = getDrawMatrix(*mesh, _toWorldMat);
+
+				//the meshlets of a dense mesh are culled in its model space, only the visible index ranges of the instance get drawn
+				const std::vector<Meshlet>& meshlets = mesh->getMeshlets();
+				if (m_meshletCulling && key.lod == 0 && meshlets.size() > 1)
+				{
+						const glm::mat4 modelView = _camera.getViewMatrix() * _toWorldMat;
+						const glm::vec3 cameraPosition = glm::vec3(glm::inverse(modelView)[3]);
+						const bool perspective = _camera.getProjectionType() == ProjectionType::PERSPECTIVE;
+
+						unsigned int numVisible = cullMeshlets(mesh->getMeshletCullBlocks(), meshlets.size(),
+								_camera.getProjectionMatrix() * modelView, cameraPosition, perspective, m_meshletVisibility);
+
+						if (numVisible == 0)
+						{
+								return;
+						}
+
+						if (numVisible < meshlets.size())
+						{
+								key.subMesh = BatchKey::MESHLETS;
+								addMeshletRanges(addInstance(key, _mesh, worldmat, _centerDepth - radius, bounds, _params), meshlets);
+								return;
+						}
+				}
+
+				//the parts of a composite mesh are culled one by one, the visible parts of a partly visible instance are batched on their own
+				const std::vector<SubMesh>& subMeshes = mesh->getSubMeshes(key.lod);
+				if (m_subMeshCulling && subMeshes.size() > 1 && _containment == Containment::INTERSECTS)
+				{
+						const Frustum& frustum = _camera.getFrustum();
+
+						m_visibleSubMeshes.clear();
+						for (size_t i = 0; i < subMeshes.size(); i++)
+						{
+								const MeshBoundingSphere& subMeshBounds = subMeshes[i].m_boundingSphere;
+								glm::vec3 subMeshPoint = glm::vec3(_toWorldMat * glm::vec4(subMeshBounds.m_center, 1.0f));
+								float subMeshRadius = subMeshBounds.m_radius * _maxScale;
+
+								unsigned int subMeshMask = _planeMask;
+								unsigned int subMeshPlane = _lastPlane;
+								if (frustum.sphereInFrustum(subMeshPoint, subMeshRadius, subMeshMask, subMeshPlane) != Containment::OUTSIDE)
+								{
+										float subMeshDepth = -(_camera.getViewMatrix() * glm::vec4(subMeshPoint, 1.0f)).z - subMeshRadius;
+										m_visibleSubMeshes.push_back(std::make_pair(static_cast<unsigned int>(i), subMeshDepth));
+								}
+						}
+
+						if (m_visibleSubMeshes.size() < subMeshes.size())
+						{
+								for (const auto& visible : m_visibleSubMeshes)
+								{
+										//the parts are tested on their own against the occluders, with the box around their sphere
+										AABB subMeshBounds;
+										if (m_withBounds)
+										{
+												const MeshBoundingSphere& subMeshSphere = subMeshes[visible.first].m_boundingSphere;
+												const glm::vec3 subMeshPoint = glm::vec3(_toWorldMat * glm::vec4(subMeshSphere.m_center, 1.0f));
+												const glm::vec3 subMeshExtent(subMeshSphere.m_radius * _maxScale);
+												subMeshBounds = AABB{ subMeshPoint - subMeshExtent, subMeshPoint + subMeshExtent };
+										}
+
+										key.subMesh = visible.first;
+										addInstance(key, _mesh, worldmat, visible.second, subMeshBounds, _params);
+								}
+								return;
+						}
+				}
+
+				//view space depth of the closest point of the bounding sphere, for front to back sorting
+				addInstance(key, _mesh, worldmat, _centerDepth - radius, bounds, _params);
+		}
+
+		void InstanceBatches::addToViews(std::weak_ptr<Mesh> _mesh, unsigned int _lod, const glm::mat4& _toWorldMat, float _depth, uint _params, uint _viewMask)
+		{
+				BatchKey key;
+				key.mesh = _mesh.lock().get();
+				key.lod = _lod;
+
+				addInstance(key, _mesh, getDrawMatrix(*key.mesh, _toWorldMat), _depth, AABB(), _params).viewMasks.push_back(_viewMask);
+		}
+
+		InstanceBatches::InstanceData& InstanceBatches::addInstance(const BatchKey& _key, std::weak_ptr<Mesh> _mesh, const glm::mat4& _worldmat, float _depth,
+				const AABB& _bounds, uint _params)
+		{
+				auto iter = m_entitiesMap.find(_key);
+
+				//check if it's not in the map
+				if (iter == m_entitiesMap.end())
+				{
+						InstanceData instance;
+						instance.mesh = _mesh;
+						instance.lod = _key.lod;
+						iter = m_entitiesMap.insert(std::make_pair(_key, instance)).first;
+				}
+
+				iter->second.worldmats.push_back(_worldmat);
+				iter->second.depths.push_back(_depth);
+				iter->second.params.push_back(_params);
+				if (m_withBounds)
+				{
+						iter->second.bounds.push_back(_bounds);
+				}
+				return iter->second;
+		}
+
+		void InstanceBatches::addMeshletRanges(InstanceData& _instances, const std::vector<Meshlet>& _meshlets)
+		{
+				const uint firstRange = static_cast<uint>(_instances.ranges.size());
+
+				//visible neighbours of a submesh are contiguous in the index buffer and merge into one draw
+				for (size_t i = 0; i < _meshlets.size(); i++)
+				{
+						if (!m_meshletVisibility[i])
+						{
+								continue;
+						}
+
+						const Meshlet& meshlet = _meshlets[i];
+						if (_instances.ranges.size() > firstRange
+								&& _instances.ranges.back().subMesh == meshlet.m_subMesh
+								&& _instances.ranges.back().firstIndex + _instances.ranges.back().numIndices == meshlet.m_baseIndex)
+						{
+								_instances.ranges.back().numIndices += meshlet.m_numIndices;
+								continue;
+						}
+
+						IndexRange range;
+						range.firstIndex = meshlet.m_baseIndex;
+						range.numIndices = meshlet.m_numIndices;
+						range.subMesh = meshlet.m_subMesh;
+						_instances.ranges.push_back(range);
+				}
+
+				_instances.rangeSpans.push_back(std::make_pair(firstRange, static_cast<uint>(_instances.ranges.size()) - firstRange));
+		}
+
+		void InstanceBatches::removeOccluded(OcclusionCuller& _culler)
+		{
+				//compact the visible instances of every batch, batches left empty are dropped
+				for (auto it = m_entitiesMap.begin(); it != m_entitiesMap.end();)
+				{
+						InstanceData& instances = it->second;
+						const bool meshlets = !instances.rangeSpans.empty();
+
+						//the batches of a frame begun without occlusion culling have no bounds
+						if (instances.bounds.size() != instances.worldmats.size())
+						{
+								++it;
+								continue;
+						}
+
+						size_t numVisible{ 0 };
+						for (size_t i = 0; i < instances.worldmats.size(); i++)
+						{
+								if (_culler.isOccluded(instances.bounds[i].m_min, instances.bounds[i].m_max))
+								{
+										continue;
+								}
+
+								instances.worldmats[numVisible] = instances.worldmats[i];
+								instances.depths[numVisible] = instances.depths[i];
+								instances.params[numVisible] = instances.params[i];
+								instances.bounds[numVisible] = instances.bounds[i];
+								if (meshlets)
+								{
+										//the ranges of the hidden instances stay in place, nothing points to them anymore
+										instances.rangeSpans[numVisible] = instances.rangeSpans[i];
+								}
+								numVisible++;
+						}
+
+						instances.worldmats.resize(numVisible);
+						instances.depths.resize(numVisible);
+						instances.params.resize(numVisible);
+						instances.bounds.resize(numVisible);
+						if (meshlets)
+						{
+								instances.rangeSpans.resize(numVisible);
+						}
+
+						it = numVisible == 0 ? m_entitiesMap.erase(it) : std::next(it);
+				}
+		}
+
+		void InstanceBatches::sort(float _near, float _far)
+		{
+				const float depthRange = _far - _near;
+
+				for (auto& it : m_entitiesMap)
+				{
+						InstanceData& instances = it.second;
+						const size_t numInstances = instances.worldmats.size();
+
+						//coarse sort: the depth is quantized to 16 bits in the high half of the key, the instance index in the low half
+						m_sortKeys.resize(numInstances);
+						for (size_t i = 0; i < numInstances; i++)
+						{
+								float normalizedDepth = glm::clamp((instances.depths[i] - _near) / depthRange, 0.0f, 1.0f);
+								unsigned long long depthKey = static_cast<unsigned long long>(normalizedDepth * 65535.0f);
+								m_sortKeys[i] = (depthKey << 32) | static_cast<unsigned long long>(i);
+						}
+
+						if (instances.viewMasks.empty())
+						{
+								std::sort(m_sortKeys.begin(), m_sortKeys.end());
+						}
+						else
+						{
+								//instances of the same views first, so every view draws a few runs of the batch
+								const std::vector<uint>& viewMasks = instances.viewMasks;
+								std::sort(m_sortKeys.begin(), m_sortKeys.end(), [&viewMasks](unsigned long long _a, unsigned long long _b)
+								{
+										const uint maskA = viewMasks[_a & 0xFFFFFFFFull];
+										const uint maskB = viewMasks[_b & 0xFFFFFFFFull];
+										return maskA != maskB ? maskA < maskB : _a < _b;
+								});
+						}
+
+						m_sortedWorldmats.resize(numInstances);
+						for (size_t i = 0; i < numInstances; i++)
+						{
+								m_sortedWorldmats[i] = instances.worldmats[m_sortKeys[i] & 0xFFFFFFFFull];
+						}
+						instances.worldmats.swap(m_sortedWorldmats);
+
+						m_sortedParams.resize(numInstances);
+						for (size_t i = 0; i < numInstances; i++)
+						{
+								m_sortedParams[i] = instances.params[m_sortKeys[i] & 0xFFFFFFFFull];
+						}
+						instances.params.swap(m_sortedParams);
+
+						//the visible ranges of meshlet batches follow their instances
+						if (!instances.rangeSpans.empty())
+						{
+								m_sortedRangeSpans.resize(numInstances);
+								for (size_t i = 0; i < numInstances; i++)
+								{
+										m_sortedRangeSpans[i] = instances.rangeSpans[m_sortKeys[i] & 0xFFFFFFFFull];
+								}
+								instances.rangeSpans.swap(m_sortedRangeSpans);
+						}
+
+						instances.nearestDepth = numInstances > 0 ? instances.depths[m_sortKeys[0] & 0xFFFFFFFFull] : 0.0f;
+
+						if (!instances.viewMasks.empty())
+						{
+								instances.nearestDepth = *std::min_element(instances.depths.begin(), instances.depths.end());
+
+								m_sortedViewMasks.resize(numInstances);
+								instances.viewGroups.clear();
+								for (size_t i = 0; i < numInstances; i++)
+								{
+										const uint viewMask = instances.viewMasks[m_sortKeys[i] & 0xFFFFFFFFull];
+										m_sortedViewMasks[i] = viewMask;
+
+										if (instances.viewGroups.empty() || instances.viewGroups.back().viewMask != viewMask)
+										{
+												ViewGroup group;
+												group.viewMask = viewMask;
+												group.firstInstance = static_cast<uint>(i);
+												instances.viewGroups.push_back(group);
+										}
+										instances.viewGroups.back().numInstances++;
+								}
+								instances.viewMasks.swap(m_sortedViewMasks);
+						}
+
+						m_batchOrder.push_back(it.first);
+				}
+
+				//draw the batches with the closest instances first
+				std::sort(m_batchOrder.begin(), m_batchOrder.end(), [this](const BatchKey& _a, const BatchKey& _b)
+				{
+						return m_entitiesMap[_a].nearestDepth < m_entitiesMap[_b].nearestDepth;
+				});
+		}
+
+		void InstanceBatches::buildDraws(unsigned int _view)
+		{
+				m_indirectDraws.clear();
+				m_drawGroups.clear();
+				m_unsortedDraws.clear();
+				m_groupLookup.clear();
+
+				//assign every submesh of every batch to its vao/material group, groups are created front to back.
+				//all pooled meshes share a vao, so the submeshes of different meshes with the same material end up in one group
+				uint baseInstance{ 0 };
+				for (const BatchKey& key : m_batchOrder)
+				{
+						const InstanceData& instances = m_entitiesMap[key];
+						const Mesh* mesh = key.mesh;
+						const VAO vao = mesh->getVAO();
+						const uint meshBaseVertex = mesh->getBaseVertex();
+						const uint meshBaseIndex = mesh->getBaseIndex();
+
+						const std::vector<SubMesh>& subMeshes = instances.mesh.lock()->getSubMeshes(key.lod);
+						const std::vector<std::weak_ptr<Material>>& materials = instances.mesh.lock()->getMaterials();
+
+						if (key.subMesh == BatchKey::MESHLETS)
+						{
+								//every instance draws its own visible ranges
+								for (size_t j = 0; j < instances.rangeSpans.size(); j++)
+								{
+										const std::pair<uint, uint>& span = instances.rangeSpans[j];
+										for (uint r = span.first; r < span.first + span.second; r++)
+										{
+												const IndexRange& range = instances.ranges[r];
+												const SubMesh& subMesh = subMeshes[range.subMesh];
+												assert(subMesh.m_materialIndex < materials.size());
+
+												DrawElementsIndirectCommand draw;
+												draw.count = range.numIndices;
+												draw.instanceCount = 1;
+												draw.firstIndex = meshBaseIndex + range.firstIndex;
+												draw.baseVertex = static_cast<int>(meshBaseVertex + subMesh.m_baseVertex);
+												draw.baseInstance = baseInstance + static_cast<uint>(j);
+												addDraw(vao, materials.at(subMesh.m_materialIndex), draw);
+										}
+								}
+						}
+						else if (_view != ALL_VIEWS)
+						{
+								//only the runs of instances visible in the view
+								for (const ViewGroup& group : instances.viewGroups)
+								{
+										if ((group.viewMask & (1u << _view)) == 0)
+										{
+												continue;
+										}
+
+										for (const SubMesh& subMesh : subMeshes)
+										{
+												assert(subMesh.m_materialIndex < materials.size());
+
+												DrawElementsIndirectCommand draw;
+												draw.count = subMesh.m_numIndices;
+												draw.instanceCount = group.numInstances;
+												draw.firstIndex = meshBaseIndex + subMesh.m_baseIndex;
+												draw.baseVertex = static_cast<int>(meshBaseVertex + subMesh.m_baseVertex);
+												draw.baseInstance = baseInstance + group.firstInstance;
+												addDraw(vao, materials.at(subMesh.m_materialIndex), draw);
+										}
+								}
+						}
+						else
+						{
+								for (size_t i = 0; i < subMeshes.size(); i++)
+								{
+										//the batch of a partly culled instance only draws one of the submeshes
+										if (key.subMesh != BatchKey::ALL_SUBMESHES && key.subMesh != i)
+										{
+												continue;
+										}
+
+										const SubMesh& subMesh = subMeshes[i];
+										assert(subMesh.m_materialIndex < materials.size());
+
+										DrawElementsIndirectCommand draw;
+										draw.count = subMesh.m_numIndices;
+										draw.instanceCount = static_cast<uint>(instances.worldmats.size());
+										draw.firstIndex = meshBaseIndex + subMesh.m_baseIndex;
+										draw.baseVertex = static_cast<int>(meshBaseVertex + subMesh.m_baseVertex);
+										draw.baseInstance = baseInstance;
+										addDraw(vao, materials.at(subMesh.m_materialIndex), draw);
+								}
+						}
+
+						baseInstance += static_cast<uint>(instances.worldmats.size());
+				}
+				m_numInstances = baseInstance;
+
+				//lay the draws of each group out contiguously
+				uint firstDraw{ 0 };
+				for (DrawGroup& group : m_drawGroups)
+				{
+						group.firstDraw = firstDraw;
+						firstDraw += group.numDraws;
+						group.numDraws = 0;
+				}
+
+				m_indirectDraws.resize(m_unsortedDraws.size());
+				for (const auto& draw : m_unsortedDraws)
+				{
+						DrawGroup& group = m_drawGroups[draw.first];
+						m_indirectDraws[group.firstDraw + group.numDraws++] = draw.second;
+				}
+		}
+
+		void InstanceBatches::addDraw(VAO _vao, std::weak_ptr<Material> _material, const DrawElementsIndirectCommand& _draw)
+		{
+				auto groupKey = std::make_pair(_vao, _material.lock().get());
+				auto iter = m_groupLookup.find(groupKey);
+				if (iter == m_groupLookup.end())
+				{
+						DrawGroup group;
+						group.vao = _vao;
+						group.material = _material;
+						iter = m_groupLookup.insert(std::make_pair(groupKey, static_cast<uint>(m_drawGroups.size()))).first;
+						m_drawGroups.push_back(group);
+				}
+				m_drawGroups[iter->second].numDraws++;
+
+				m_unsortedDraws.push_back(std::make_pair(iter->second, _draw));
+		}
+
+		void InstanceBatches::recordInstanceUpload(CommandBucket& _bucket, const ImpostorBatches& _impostors)
+		{
+				//the billboards' instances go behind the ones of the meshes
+				//gather the instances of all batches into the shared instance buffer, in the order of the base instances
+				//the params indices are only interleaved with the matrices in frames with overrides
+				m_instanceParams = m_materialParams.size() > 1;
+
+				uint instanceDataSize = getInstanceSize() * (m_numInstances + _impostors.getNumInstances());
+				unsigned char* instanceData = static_cast<unsigned char*>(_bucket.allocateAuxMemory(instanceDataSize));
+
+				size_t offset{ 0 };
+				for (const BatchKey& key : m_batchOrder)
+				{
+						const InstanceData& instances = m_entitiesMap[key];
+						offset += writeInstances(instances.worldmats, instances.params, m_compactInstances, m_instanceParams, instanceData + offset);
+				}
+
+				for (const ImpostorBatches::Batch& batch : _impostors.getBatches())
+				{
+						offset += writeInstances(batch.worldmats, std::vector<uint>(), m_compactInstances, m_instanceParams, instanceData + offset);
+				}
+
+				//the first block of the texture buffer stays the default one between frames
+				if (m_instanceParams)
+				{
+						commands::UploadBuffer* paramsUpload = _bucket.add<commands::UploadBuffer>();
+						paramsUpload->target = GL_TEXTURE_BUFFER;
+						paramsUpload->buffer = m_materialParamsBuffer;
+						paramsUpload->offset = 0;
+						paramsUpload->size = static_cast<uint>(sizeof(MaterialParams) * m_materialParams.size());
+						paramsUpload->usage = GL_STREAM_DRAW;
+						paramsUpload->reallocate = true;
+						paramsUpload->data = _bucket.copyAuxMemory(m_materialParams.data(), paramsUpload->size);
+				}
+
+				commands::UploadBuffer* instanceUpload = _bucket.add<commands::UploadBuffer>();
+				instanceUpload->target = GL_ARRAY_BUFFER;
+				instanceUpload->buffer = m_instanceBuffer;
+				instanceUpload->offset = 0;
+				instanceUpload->size = instanceDataSize;
+				instanceUpload->usage = GL_STREAM_DRAW;
+				instanceUpload->reallocate = true;
+				instanceUpload->data = instanceData;
+		}
+
+		const DrawElementsIndirectCommand* InstanceBatches::recordDrawUpload(CommandBucket& _bucket, bool _indirect)
+		{
+				//without the indirect path the draws are recorded one by one and don't need to outlive this call
+				if (!_indirect)
+				{
+						return m_indirectDraws.data();
+				}
+
+				uint drawsSize = static_cast<uint>(sizeof(DrawElementsIndirectCommand) * m_indirectDraws.size());
+
+				commands::UploadBuffer* drawsUpload = _bucket.add<commands::UploadBuffer>();
+				drawsUpload->target = GL_DRAW_INDIRECT_BUFFER;
+				drawsUpload->buffer = m_indirectBuffer;
+				drawsUpload->offset = 0;
+				drawsUpload->size = drawsSize;
+				drawsUpload->usage = GL_STREAM_DRAW;
+				drawsUpload->reallocate = true;
+				drawsUpload->data = _bucket.copyAuxMemory(m_indirectDraws.data(), drawsSize);
+
+				//the bucket's copy of the draws outlives this frame's m_indirectDraws
+				return static_cast<const DrawElementsIndirectCommand*>(drawsUpload->data);
+		}
+
+		void InstanceBatches::recordMaterialParams(CommandBucket& _bucket, GLSLProgram& _shader) const
+		{
+				_shader.recordValue(_bucket, "materialParams", static_cast<int>(MATERIAL_PARAMS_SLOT));
+				commands::BindTexture* bindParams = _bucket.add<commands::BindTexture>();
+				bindParams->slot = MATERIAL_PARAMS_SLOT;
+				bindParams->target = GL_TEXTURE_BUFFER;
+				bindParams->texture = m_materialParamsTexture;
+		}
+
+		void InstanceBatches::recordDraws(CommandBucket& _bucket, GLSLProgram* _shader, const DrawElementsIndirectCommand* _draws, bool _indirect) const
+		{
+				VAO boundVAO{ 0 };
+				const Material* boundMaterial{ nullptr };
+				uint boundBaseInstance{ 0 };
+
+				for (size_t i = 0; i < m_drawGroups.size(); i++)
+				{
+						const DrawGroup& group = m_drawGroups[i];
+						uint numDraws = group.numDraws;
+
+						if (_shader == nullptr)
+						{
+								//without materials the following groups of the same vao are merged, they are contiguous in the buffer
+								while (i + 1 < m_drawGroups.size() && m_drawGroups[i + 1].vao == group.vao)
+								{
+										numDraws += m_drawGroups[++i].numDraws;
+								}
+						}
+
+						if (group.vao != boundVAO)
+						{
+								_bucket.add<commands::BindVertexArray>()->vao = group.vao;
+
+								//read the instances from the shared buffer, indexed with the base instance of every draw
+								commands::BindInstanceMat4* instanceAttribute = _bucket.add<commands::BindInstanceMat4>();
+								instanceAttribute->location = Mesh::BufferObject::WORLDMAT;
+								instanceAttribute->buffer = m_instanceBuffer;
+								instanceAttribute->offset = 0;
+								instanceAttribute->compact = m_compactInstances;
+								instanceAttribute->materialParams = m_instanceParams;
+
+								boundVAO = group.vao;
+								boundBaseInstance = 0;
+						}
+
+						if (_shader != nullptr && !group.material.expired() && group.material.lock().get() != boundMaterial)
+						{
+								_shader->recordMaterial(_bucket, group.material);
+								boundMaterial = group.material.lock().get();
+						}
+
+						if (_indirect)
+						{
+								commands::MultiDrawElementsIndirect* draw = _bucket.add<commands::MultiDrawElementsIndirect>();
+								draw->mode = GL_TRIANGLES;
+								draw->buffer = m_indirectBuffer;
+								draw->offset = static_cast<uint>(sizeof(DrawElementsIndirectCommand) * group.firstDraw);
+								draw->drawCount = numDraws;
+								draw->draws = _draws + group.firstDraw;
+								continue;
+						}
+
+						//no base instance support, offset the instance attribute to the first instance of every batch instead
+						for (uint j = group.firstDraw; j < group.firstDraw + numDraws; j++)
+						{
+								const DrawElementsIndirectCommand& indirectDraw = _draws[j];
+
+								if (indirectDraw.baseInstance != boundBaseInstance)
+								{
+										commands::BindInstanceMat4* instanceAttribute = _bucket.add<commands::BindInstanceMat4>();
+										instanceAttribute->location = Mesh::BufferObject::WORLDMAT;
+										instanceAttribute->buffer = m_instanceBuffer;
+										instanceAttribute->offset = getInstanceSize() * indirectDraw.baseInstance;
+										instanceAttribute->compact = m_compactInstances;
+										instanceAttribute->materialParams = m_instanceParams;
+										boundBaseInstance = indirectDraw.baseInstance;
+								}
+
+								commands::DrawElementsInstanced* draw = _bucket.add<commands::DrawElementsInstanced>();
+								draw->mode = GL_TRIANGLES;
+								draw->indexCount = indirectDraw.count;
+								draw->indexOffset = static_cast<uint>(sizeof(unsigned int) * indirectDraw.firstIndex);
+								draw->instanceCount = indirectDraw.instanceCount;
+								draw->baseVertex = indirectDraw.baseVertex;
+						}
+				}
+
+				_bucket.add<commands::BindVertexArray>()->vao = 0;
+		}
+
+		void InstanceBatches::dispose()
+		{
+				if (!RenderBackend::isNull())
+				{
+						if (m_instanceBuffer != 0)
+						{
+								glDeleteBuffers(1, &m_instanceBuffer);
+						}
+						if (m_indirectBuffer != 0)
+						{
+								glDeleteBuffers(1, &m_indirectBuffer);
+						}
+						if (m_materialParamsTexture != 0)
+						{
+								glDeleteTextures(1, &m_materialParamsTexture);
+								glDeleteBuffers(1, &m_materialParamsBuffer);
+						}
+				}
+				m_instanceBuffer = 0;
+				m_indirectBuffer = 0;
+				m_materialParamsTexture = 0;
+				m_materialParamsBuffer = 0;
+		}
+}
@@ -0,0 +1,258 @@
+#ifndef INSTANCE_BATCHES_H
+#define INSTANCE_BATCHES_H
+
+#include "RenderCommands.h"
+#include "Material.h"
+#include "Meshlets.h"
+#include "AABBTree.h"
+#include "Frustum.h"
+
+#include <glm\mat4x4.hpp>
+#include <memory>
+#include <vector>
+#include <map>
+#include <unordered_map>
+
+namespace cogs
+{
+		class Mesh;
+		class MeshRenderer;
+		class GLSLProgram;
+		class CommandBucket;
+		class Camera;
+		class OcclusionCuller;
+		class ImpostorBatches;
+
+		using VAO = uint;
+
+		/**
+		* \brief The visible instances of a frame, batched per mesh and level of detail and sorted front to back.
+		* All batches share one instance buffer and one indirect buffer rebuilt every frame, the draws of a vao and material are recorded together
+		*/
+		class InstanceBatches
+		{
+		public:
+				static const unsigned int ALL_VIEWS = ~0u;
+
+				InstanceBatches();
+				~InstanceBatches();
+
+				/**
+				* \brief upload the instances as the first three rows of their affine world matrices, 48 instead of 64 bytes each
+				*/
+				void setCompactInstances(bool _enabled) { m_compactInstances = _enabled; }
+				bool usesCompactInstances() const noexcept { return m_compactInstances; }
+
+				/**
+				* \brief test the submeshes of partly visible instances against the frustum one by one
+				*/
+				void setSubMeshCulling(bool _enabled) { m_subMeshCulling = _enabled; }
+				bool usesSubMeshCulling() const noexcept { return m_subMeshCulling; }
+
+				/**
+				* \brief cull the meshlets of visible full detail instances against the frustum and by their facing
+				*/
+				void setMeshletCulling(bool _enabled) { m_meshletCulling = _enabled; }
+				bool usesMeshletCulling() const noexcept { return m_meshletCulling; }
+
+				/**
+				* \brief empties the batches for the passes of a new camera or a new frame of several views
+				* \param _withBounds - whether the world bounds of the instances are kept to test them against the occluders
+				*/
+				void clear(bool _withBounds);
+
+				/**
+				* \brief adds the params block of a mesh renderer with material overrides to the frame
+				* \return the index of the block, 0 if it has none
+				*/
+				uint addMaterialParams(const MeshRenderer& _meshRenderer);
+
+				/**
+				* \brief adds a visible instance, a partly visible one only with its visible meshlets or submeshes
+				* \param _maxScale - the largest scale of the world transform
+				* \param _centerDepth - the view space depth of the center of the bounding sphere
+				* \param _containment - the result of the frustum test of the instance
+				* \param _planeMask - the frustum planes the instance crosses
+				* \param _lastPlane - the plane the instance was last culled by
+				* \param _params - the params block of the instance
+				*/
+				void add(const Camera& _camera, std::weak_ptr<Mesh> _mesh, unsigned int _lod, const glm::mat4& _toWorldMat, float _maxScale,
+						float _centerDepth, Containment _containment, unsigned int _planeMask, unsigned int _lastPlane, uint _params);
+
+				/**
+				* \brief adds an instance of a frame of several views with all its submeshes
+				* \param _depth - the view space depth of the closest point of the bounding sphere in the closest view
+				* \param _viewMask - bit i set if the instance is visible in view i
+				*/
+				void addToViews(std::weak_ptr<Mesh> _mesh, unsigned int _lod, const glm::mat4& _toWorldMat, float _depth, uint _params, uint _viewMask);
+
+				/**
+				* \brief removes the instances hidden behind the rasterized occluders, batches left empty are dropped
+				*/
+				void removeOccluded(OcclusionCuller& _culler);
+
+				/**
+				* \brief sorts the instances of every batch front to back, in frames of several views by their views first, and the batches by their closest instance
+				* \param _near, _far - the depth range the depths are quantized over
+				*/
+				void sort(float _near, float _far);
+
+				/**
+				* \brief builds the draws of all instances, or only of the ones visible in a view of a frame of several views
+				*/
+				void buildDraws(unsigned int _view);
+
+				/**
+				* \brief uploads the instances of all batches followed by the ones of the billboards, and the material params of the frame
+				*/
+				void recordInstanceUpload(CommandBucket& _bucket, const ImpostorBatches& _impostors);
+
+				/**
+				* \brief uploads the draws built last if they're drawn indirect
+				* \return the draws to pass to recordDraws()
+				*/
+				const DrawElementsIndirectCommand* recordDrawUpload(CommandBucket& _bucket, bool _indirect);
+
+				/**
+				* \brief binds the texture buffer of the material params for the shader
+				*/
+				void recordMaterialParams(CommandBucket& _bucket, GLSLProgram& _shader) const;
+
+				/**
+				* \brief records the draws, the shader sets the materials, without one they are left out (depth pre-pass)
+				* \param _indirect - whether the draws are issued as multi draw indirect calls
+				*/
+				void recordDraws(CommandBucket& _bucket, GLSLProgram* _shader, const DrawElementsIndirectCommand* _draws, bool _indirect) const;
+
+				/**
+				* \brief the buffer the instances of all batches are uploaded to, and the number of them
+				*/
+				uint getInstanceBuffer() const noexcept { return m_instanceBuffer; }
+				uint getNumInstances() const noexcept { return m_numInstances; }
+
+				/**
+				* \brief whether the uploaded instances are followed by their material params index
+				*/
+				bool hasInstanceParams() const noexcept { return m_instanceParams; }
+
+				/**
+				* \brief the bytes of an instance in the instance buffer
+				*/
+				uint getInstanceSize() const noexcept
+				{
+						return static_cast<uint>((m_compactInstances ? sizeof(float) * 12 : sizeof(float) * 16) + (m_instanceParams ? sizeof(uint) : 0));
+				}
+
+				/**
+				* \brief deletes the buffers
+				*/
+				void dispose();
+
+		private:
+				/**
+				* \brief instances are batched per mesh and level of detail,
+				* the visible parts of partly culled instances per submesh or as meshlet ranges per instance
+				*/
+				struct BatchKey
+				{
+						static const unsigned int ALL_SUBMESHES = ~0u;
+						static const unsigned int MESHLETS = ~0u - 1; ///< every instance draws its own visible meshlet ranges
+
+						const Mesh* mesh{ nullptr };
+						unsigned int lod{ 0 };
+						unsigned int subMesh{ ALL_SUBMESHES }; ///< the only submesh drawn, all of them or the meshlet ranges
+
+						bool operator==(const BatchKey& _other) const { return mesh == _other.mesh && lod == _other.lod && subMesh == _other.subMesh; }
+				};
+				struct BatchKeyHash
+				{
+						size_t operator()(const BatchKey& _key) const
+						{
+								return std::hash<const Mesh*>()(_key.mesh) ^ (static_cast<size_t>(_key.lod) * 0x9E3779B9u) ^ (static_cast<size_t>(_key.subMesh) * 0x85EBCA6Bu);
+						}
+				};
+
+				/**
+				* \brief consecutive visible meshlets of a submesh
+				*/
+				struct IndexRange
+				{
+						uint firstIndex{ 0 }; ///< in the index buffer of the mesh
+						uint numIndices{ 0 };
+						uint subMesh{ 0 };
+				};
+
+				/**
+				* \brief consecutive instances of a batch visible in the same views
+				*/
+				struct ViewGroup
+				{
+						uint viewMask{ 0 };
+						uint firstInstance{ 0 };
+						uint numInstances{ 0 };
+				};
+
+				struct InstanceData
+				{
+						std::weak_ptr<Mesh> mesh;
+						unsigned int lod{ 0 };
+						std::vector<glm::mat4> worldmats;
+						std::vector<float> depths; ///< view space depth of every instance
+						std::vector<uint> params; ///< the material params block of every instance, 0 for the materials as they are
+						std::vector<AABB> bounds; ///< world bounds of every instance, only kept for the occlusion culling
+						float nearestDepth{ 0.0f }; ///< depth of the closest instance after sorting
+						std::vector<IndexRange> ranges; ///< the visible ranges of all instances of a meshlet batch
+						std::vector<std::pair<uint, uint>> rangeSpans; ///< the first range and the range count of every instance of a meshlet batch
+						std::vector<uint> viewMasks; ///< bit i set if the instance is visible in view i, frames of several views only
+						std::vector<ViewGroup> viewGroups; ///< the instances sorted into runs of the same views
+				};
+
+				/**
+				* \brief consecutive draws in the indirect buffer sharing a vao and a material
+				*/
+				struct DrawGroup
+				{
+						VAO vao{ 0 };
+						std::weak_ptr<Material> material;
+						uint firstDraw{ 0 };
+						uint numDraws{ 0 };
+				};
+
+				InstanceData& addInstance(const BatchKey& _key, std::weak_ptr<Mesh> _mesh, const glm::mat4& _worldmat, float _depth,
+						const AABB& _bounds, uint _params);
+				void addMeshletRanges(InstanceData& _instances, const std::vector<Meshlet>& _meshlets);
+				void addDraw(VAO _vao, std::weak_ptr<Material> _material, const DrawElementsIndirectCommand& _draw);
+
+				std::unordered_map<BatchKey, InstanceData, BatchKeyHash> m_entitiesMap;
+				std::vector<BatchKey> m_batchOrder; ///< the batches sorted front to back
+				std::vector<unsigned long long> m_sortKeys; ///< scratch buffer for sorting instances
+				std::vector<glm::mat4> m_sortedWorldmats; ///< scratch buffer for sorting instances
+				std::vector<uint> m_sortedParams; ///< scratch buffer for sorting instances
+				std::vector<std::pair<uint, uint>> m_sortedRangeSpans; ///< scratch buffer for sorting instances of meshlet batches
+				std::vector<uint> m_sortedViewMasks; ///< scratch buffer for sorting instances by their views
+				bool m_withBounds{ false }; ///< whether the world bounds of the instances are kept
+
+				std::vector<DrawElementsIndirectCommand> m_indirectDraws; ///< all draws of the frame, sorted by group
+				std::vector<DrawGroup> m_drawGroups; ///< the groups in order of their closest batch
+				std::vector<std::pair<uint, DrawElementsIndirectCommand>> m_unsortedDraws; ///< scratch buffer of draws with their group
+				std::map<std::pair<VAO, const Material*>, uint> m_groupLookup; ///< scratch map from vao and material to group index
+				uint m_numInstances{ 0 }; ///< instances in all batches
+
+				bool m_subMeshCulling{ true }; ///< whether the submeshes of visible instances get culled one by one
+				std::vector<std::pair<unsigned int, float>> m_visibleSubMeshes; ///< scratch buffer of the visible submeshes of an instance with their depths
+
+				bool m_meshletCulling{ true }; ///< whether the meshlets of visible instances get culled
+				std::vector<unsigned char> m_meshletVisibility; ///< scratch buffer of the visibility of the meshlets of an instance
+
+				bool m_compactInstances{ false }; ///< whether the instances are uploaded as 3x4 matrices
+				bool m_instanceParams{ false }; ///< whether the uploaded instances are followed by their material params index
+
+				std::vector<MaterialParams> m_materialParams = std::vector<MaterialParams>(1); ///< the params blocks of the frame, the first one leaves the materials as they are
+				uint m_materialParamsBuffer{ 0 }; ///< the blocks of the texture buffer
+				uint m_materialParamsTexture{ 0 }; ///< the texture buffer the shader reads the blocks from
+				uint m_instanceBuffer{ 0 }; ///< instance data of all batches
+				uint m_indirectBuffer{ 0 }; ///< the GL_DRAW_INDIRECT_BUFFER
+		};
+}
+
+#endif // !INSTANCE_BATCHES_H
@@ -0,0 +1,78 @@
+#include "LODSelector.h"
+
+#include "Camera.h"
+#include "Mesh.h"
+
+#include <glm\common.hpp>
+#include <glm\trigonometric.hpp>
+
+namespace cogs
+{
+		unsigned int LODSelector::select(const Entity* _entity, const Mesh* _mesh, float _centerDepth, float _radius, const Camera& _camera)
+		{
+				const unsigned int numLODs = _mesh->getNumLODs();
+				if (numLODs == 1 || m_pixelError <= 0.0f)
+				{
+						return 0;
+				}
+
+				const float screenHeight = static_cast<float>(_camera.getHeight());
+
+				//projected diameter of the bounding sphere as a fraction of the screen height
+				float screenSize{ 0.0f };
+				if (_camera.getProjectionType() == ProjectionType::PERSPECTIVE)
+				{
+						if (_centerDepth <= _radius)
+						{
+								//the camera is inside or right at the sphere
+								return 0;
+						}
+						screenSize = _radius / (_centerDepth * glm::tan(glm::radians(static_cast<float>(_camera.getFoV())) * 0.5f));
+				}
+				else
+				{
+						screenSize = 2.0f * _radius / (screenHeight * _camera.getSize());
+				}
+
+				//the lod errors are relative to the radius, so they shrink on screen with the sphere
+				const float pixelsPerError = screenSize * 0.5f * screenHeight;
+
+				auto coarsestLOD = [this, _mesh, numLODs](float _pixelsPerError)
+				{
+						unsigned int lod{ 0 };
+						while (lod + 1 < numLODs && _mesh->getLODError(lod + 1) * _pixelsPerError <= m_pixelError)
+						{
+								lod++;
+						}
+						return lod;
+				};
+
+				auto state = m_states.insert(std::make_pair(_entity, LODState()));
+				if (state.second)
+				{
+						state.first->second.lod = coarsestLOD(pixelsPerError);
+				}
+
+				//only switch once the size has moved past a threshold by the hysteresis
+				unsigned int finest = coarsestLOD(pixelsPerError * (1.0f + m_hysteresis));
+				unsigned int coarsest = coarsestLOD(pixelsPerError * (1.0f - m_hysteresis));
+
+				state.first->second.lod = glm::clamp(state.first->second.lod, finest, coarsest);
+				state.first->second.lastFrame = m_frame;
+
+				return state.first->second.lod;
+		}
+
+		void LODSelector::nextFrame()
+		{
+				if ((++m_frame & 255) != 0)
+				{
+						return;
+				}
+
+				for (auto it = m_states.begin(); it != m_states.end();)
+				{
+						it = m_frame - it->second.lastFrame > 255 ? m_states.erase(it) : std::next(it);
+				}
+		}
+}
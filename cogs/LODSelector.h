@@ -0,0 +1,58 @@
+#ifndef LOD_SELECTOR_H
+#define LOD_SELECTOR_H
+
+#include <unordered_map>
+
+namespace cogs
+{
+		class Entity;
+		class Mesh;
+		class Camera;
+
+		/**
+		* \brief Picks the level of detail of the instances by the screen size of their bounding spheres.
+		* The level drawn last is kept per entity, it only switches once the size moved past a threshold by the hysteresis
+		*/
+		class LODSelector
+		{
+		public:
+				/**
+				* \brief the largest simplification error in pixels an instance may show, 0 always picks the full detail
+				*/
+				void setPixelError(float _pixels) { m_pixelError = _pixels; }
+				float getPixelError() const noexcept { return m_pixelError; }
+
+				/**
+				* \brief how much the projected size has to change past a threshold before the level switches, as a fraction of the size
+				*/
+				void setHysteresis(float _fraction) { m_hysteresis = _fraction; }
+				float getHysteresis() const noexcept { return m_hysteresis; }
+
+				/**
+				* \brief the coarsest level of the mesh of an entity within the pixel error
+				* \param _centerDepth - the view space depth of the center of the bounding sphere
+				*/
+				unsigned int select(const Entity* _entity, const Mesh* _mesh, float _centerDepth, float _radius, const Camera& _camera);
+
+				/**
+				* \brief starts the next frame, every now and then the states of entities which haven't been drawn for a while are forgotten
+				*/
+				void nextFrame();
+
+		private:
+				/**
+				* \brief the level an entity was drawn with
+				*/
+				struct LODState
+				{
+						unsigned int lod{ 0 };
+						unsigned int lastFrame{ 0 };
+				};
+				std::unordered_map<const Entity*, LODState> m_states;
+				unsigned int m_frame{ 0 };
+				float m_pixelError{ 1.0f }; ///< the largest error in pixels a lod may show
+				float m_hysteresis{ 0.1f }; ///< the relative size band around the thresholds
+		};
+}
+
+#endif // !LOD_SELECTOR_H
@@ -0,0 +1,106 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace cogs
+{
+		MappedFile::~MappedFile()
+		{
+				close();
+		}
+
+		bool MappedFile::open(const std::string& _filePath)
+		{
+				close();
+
+#ifdef _WIN32
+				HANDLE file = CreateFileA(_filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+				if (file == INVALID_HANDLE_VALUE)
+				{
+						return false;
+				}
+
+				LARGE_INTEGER size;
+				if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+				{
+						CloseHandle(file);
+						return false;
+				}
+
+				HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+				if (mapping == nullptr)
+				{
+						CloseHandle(file);
+						return false;
+				}
+
+				const void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+				if (data == nullptr)
+				{
+						CloseHandle(mapping);
+						CloseHandle(file);
+						return false;
+				}
+
+				m_file = file;
+				m_mapping = mapping;
+				m_data = static_cast<const unsigned char*>(data);
+				m_size = static_cast<size_t>(size.QuadPart);
+#else
+				int file = ::open(_filePath.c_str(), O_RDONLY);
+				if (file < 0)
+				{
+						return false;
+				}
+
+				struct stat info;
+				if (fstat(file, &info) != 0 || info.st_size == 0)
+				{
+						::close(file);
+						return false;
+				}
+
+				void* data = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+				//the mapping keeps the file alive on its own
+				::close(file);
+				if (data == MAP_FAILED)
+				{
+						return false;
+				}
+
+				m_data = static_cast<const unsigned char*>(data);
+				m_size = static_cast<size_t>(info.st_size);
+#endif
+				return true;
+		}
+
+		void MappedFile::close()
+		{
+				if (m_data == nullptr)
+				{
+						return;
+				}
+
+#ifdef _WIN32
+				UnmapViewOfFile(m_data);
+				CloseHandle(m_mapping);
+				CloseHandle(m_file);
+				m_mapping = nullptr;
+				m_file = nullptr;
+#else
+				munmap(const_cast<unsigned char*>(m_data), m_size);
+#endif
+
+				m_data = nullptr;
+				m_size = 0;
+		}
+}
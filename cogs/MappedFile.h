@@ -0,0 +1,46 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <string>
+
+namespace cogs
+{
+		/**
+		* \brief Read-only memory mapping of a whole file, the pages are only read from disk when touched
+		*/
+		class MappedFile
+		{
+		public:
+				MappedFile() {}
+				~MappedFile();
+
+				MappedFile(const MappedFile&) = delete;
+				MappedFile& operator=(const MappedFile&) = delete;
+
+				/**
+				* \brief maps the file, closing the previous one
+				* \return false if the file can't be opened or is empty
+				*/
+				bool open(const std::string& _filePath);
+
+				/**
+				* \brief unmaps the file, the data pointer becomes invalid
+				*/
+				void close();
+
+				inline bool isOpen()														const noexcept { return m_data != nullptr; }
+				inline const unsigned char* getData() const noexcept { return m_data; }
+				inline size_t getSize()													const noexcept { return m_size; }
+
+		private:
+				const unsigned char* m_data{ nullptr }; ///< the mapped view of the file
+				size_t m_size{ 0 }; ///< the size of the file in bytes
+
+#ifdef _WIN32
+				void* m_file{ nullptr }; ///< the file handle
+				void* m_mapping{ nullptr }; ///< the file mapping handle
+#endif
+		};
+}
+
+#endif // !MAPPED_FILE_H
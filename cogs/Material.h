@@ -3,11 +3,23 @@
 
 #include <memory>
 #include <string>
+#include <glm\vec4.hpp>
 
 namespace cogs
 {
 		class GLTexture2D;
 
+		/**
+		* \brief values varying the materials of a mesh per instance (see MeshRenderer::setMaterialParams).
+		* They don't split the batch of the mesh, every instance reads its own block in the shader
+		*/
+		struct MaterialParams
+		{
+				glm::vec4 tint{ 1.0f }; ///< multiplies the diffuse color
+				glm::vec4 emissive{ 0.0f }; ///< added to the lit color, w is unused
+				glm::vec4 uvTransform{ 1.0f, 1.0f, 0.0f, 0.0f }; ///< scale of the uvs in xy, offset in zw
+		};
+
 		/**
 		* \brief The material class to represent the material which
 		* contains different textures to bind before rendering
@@ -1,13 +1,166 @@
 #include "Mesh.h"
 
 #include "Utils.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "MeshCache.h"
 #include "Material.h"
+#include "Impostor.h"
+#include "RenderBackend.h"
+#include "Parallel.h"
+#include "Simd.h"
 
 #include <glm\glm.hpp>
 #include <GL\glew.h>
 
+#include <cmath>
+#include <algorithm>
+
 namespace cogs
 {
+		namespace
+		{
+				//below these sizes the passes stay on the calling thread, starting threads costs more than the work
+				const size_t BOUNDS_BATCH = 1 << 16;
+				const size_t VERTEX_BATCH = 1 << 14;
+				const size_t TRIANGLE_BATCH = 1 << 14;
+
+				//the size of the meshlets, small enough to cull finely, large enough to keep the draws few
+				const unsigned int MESHLET_MAX_VERTICES = 64;
+				const unsigned int MESHLET_MAX_TRIANGLES = 124;
+
+				MeshBoundingBox calcBatchBounds(const glm::vec3* _positions, size_t _begin, size_t _end)
+				{
+						MeshBoundingBox bounds;
+						bounds.m_min = _positions[_begin];
+						bounds.m_max = _positions[_begin];
+						size_t i = _begin;
+
+#ifdef COGS_SSE
+						//4 positions are 3 registers, with the components rotating through the lanes:
+						//xyzx yzxy zxyz, so every lane of a register always sees the same component
+						const float* data = &_positions[_begin].x;
+						__m128 minA = _mm_set_ps(bounds.m_min.x, bounds.m_min.z, bounds.m_min.y, bounds.m_min.x);
+						__m128 minB = _mm_set_ps(bounds.m_min.y, bounds.m_min.x, bounds.m_min.z, bounds.m_min.y);
+						__m128 minC = _mm_set_ps(bounds.m_min.z, bounds.m_min.y, bounds.m_min.x, bounds.m_min.z);
+						__m128 maxA = minA, maxB = minB, maxC = minC;
+
+						for (; i + 4 <= _end; i += 4, data += 12)
+						{
+								__m128 a = _mm_loadu_ps(data);
+								__m128 b = _mm_loadu_ps(data + 4);
+								__m128 c = _mm_loadu_ps(data + 8);
+								minA = _mm_min_ps(minA, a);
+								minB = _mm_min_ps(minB, b);
+								minC = _mm_min_ps(minC, c);
+								maxA = _mm_max_ps(maxA, a);
+								maxB = _mm_max_ps(maxB, b);
+								maxC = _mm_max_ps(maxC, c);
+						}
+
+						float lanes[6][4];
+						_mm_storeu_ps(lanes[0], minA);
+						_mm_storeu_ps(lanes[1], minB);
+						_mm_storeu_ps(lanes[2], minC);
+						_mm_storeu_ps(lanes[3], maxA);
+						_mm_storeu_ps(lanes[4], maxB);
+						_mm_storeu_ps(lanes[5], maxC);
+
+						bounds.m_min = glm::min(glm::min(glm::vec3(lanes[0][0], lanes[0][1], lanes[0][2]), glm::vec3(lanes[0][3], lanes[1][0], lanes[1][1])),
+								glm::min(glm::vec3(lanes[1][2], lanes[1][3], lanes[2][0]), glm::vec3(lanes[2][1], lanes[2][2], lanes[2][3])));
+						bounds.m_max = glm::max(glm::max(glm::vec3(lanes[3][0], lanes[3][1], lanes[3][2]), glm::vec3(lanes[3][3], lanes[4][0], lanes[4][1])),
+								glm::max(glm::vec3(lanes[4][2], lanes[4][3], lanes[5][0]), glm::vec3(lanes[5][1], lanes[5][2], lanes[5][3])));
+#endif
+
+						for (; i < _end; i++)
+						{
+								bounds.m_min = glm::min(bounds.m_min, _positions[i]);
+								bounds.m_max = glm::max(bounds.m_max, _positions[i]);
+						}
+
+						return bounds;
+				}
+
+				/**
+				* Adds a vector computed per triangle to its three vertices. The triangles are split over the workers and every worker
+				* sums into its own copy of the vertices (the first one straight into the result), the copies get added up afterwards,
+				* so no two threads ever write to the same vertex
+				*/
+				template<typename TriangleFunction>
+				void accumulateTriangles(const std::vector<SubMesh>& _subMeshes,
+						const std::vector<unsigned int>& _indices,
+						size_t _numVertices,
+						std::vector<glm::vec3>& _result,
+						TriangleFunction _function)
+				{
+						_result.assign(_numVertices, glm::vec3(0.0f));
+
+						//the indices of a submesh are relative to its base vertex
+						std::vector<SubMesh> ranges = _subMeshes;
+						if (ranges.empty())
+						{
+								ranges.emplace_back();
+								ranges.back().m_numIndices = static_cast<unsigned int>(_indices.size());
+						}
+
+						const size_t numTriangles = _indices.size() / 3;
+						const unsigned int numBatches = getNumBatches(numTriangles, TRIANGLE_BATCH);
+						std::vector<std::vector<glm::vec3>> partials(numBatches > 1 ? numBatches - 1 : 0);
+
+						parallelFor(numTriangles, TRIANGLE_BATCH, [&](size_t _begin, size_t _end, unsigned int _batch)
+						{
+								std::vector<glm::vec3>& target = _batch == 0 ? _result : partials[_batch - 1];
+								if (_batch > 0)
+								{
+										target.assign(_numVertices, glm::vec3(0.0f));
+								}
+								glm::vec3* sums = target.data();
+								const unsigned int* indices = _indices.data();
+
+								for (const SubMesh& range : ranges)
+								{
+										const size_t first = std::max<size_t>(_begin * 3, range.m_baseIndex);
+										const size_t last = std::min<size_t>(_end * 3, static_cast<size_t>(range.m_baseIndex) + range.m_numIndices);
+
+										for (size_t i = first; i < last; i += 3)
+										{
+												const unsigned int a = range.m_baseVertex + indices[i];
+												const unsigned int b = range.m_baseVertex + indices[i + 1];
+												const unsigned int c = range.m_baseVertex + indices[i + 2];
+
+												const glm::vec3 value = _function(a, b, c);
+												sums[a] += value;
+												sums[b] += value;
+												sums[c] += value;
+										}
+								}
+						});
+
+						if (partials.empty())
+						{
+								return;
+						}
+
+						glm::vec3* sums = _result.data();
+						parallelFor(_numVertices, VERTEX_BATCH, [&](size_t _begin, size_t _end, unsigned int)
+						{
+								for (const std::vector<glm::vec3>& partial : partials)
+								{
+										const glm::vec3* values = partial.data();
+										for (size_t i = _begin; i < _end; i++)
+										{
+												sums[i] += values[i];
+										}
+								}
+						});
+				}
+		}
+
+		bool Mesh::s_optimizeOnLoad = false;
+		unsigned int Mesh::s_numGeneratedLODs = 0;
+		bool Mesh::s_buildMeshlets = false;
+		bool Mesh::s_buildOccluders = false;
+
 		Mesh::Mesh(const std::string & _filePath)
 		{
 				load(_filePath);
@@ -20,29 +173,23 @@ namespace cogs
 
 		void Mesh::render() const
 		{
-				glBindVertexArray(m_VAO);
+				if (RenderBackend::isNull())
+				{
+						return;
+				}
 
-				glDrawElements(GL_TRIANGLES, m_numIndices, GL_UNSIGNED_INT, nullptr);
+				glBindVertexArray(getVAO());
+
+				glDrawElementsBaseVertex(GL_TRIANGLES, m_numIndices, GL_UNSIGNED_INT,
+						(const void*)(sizeof(unsigned int) * getBaseIndex()), getBaseVertex());
 
 				glBindVertexArray(0);
 		}
 
 		void Mesh::dispose()
 		{
-				if (m_VAO != 0)
-				{
-						glDeleteVertexArrays(1, &m_VAO);
-						m_VAO = 0;
-				}
-
-				if (m_VBOs[0] != 0)
-				{
-						glDeleteBuffers(NUM_BUFFERS, m_VBOs);
-						for (size_t i = 0; i < 5; i++)
-						{
-								m_VBOs[i] = 0;
-						}
-				}
+				MeshPool::free(m_poolHandle);
+				m_poolHandle = MeshPool::INVALID_HANDLE;
 		}
 
 		bool Mesh::isValid(const std::vector<glm::vec3>& _positions,
@@ -57,6 +204,18 @@ namespace cogs
 
 		void Mesh::load(const std::string & _filePath)
 		{
+				//the cache skips the import and all the processing below
+				const std::string cachePath = MeshCache::getCachePath(_filePath);
+				unsigned long long sourceHash{ 0 };
+				if (MeshCache::isEnabled())
+				{
+						sourceHash = MeshCache::hashFile(_filePath);
+						if (MeshCache::load(*this, cachePath, sourceHash))
+						{
+								return;
+						}
+				}
+
 				std::vector<glm::vec3> positions;
 				std::vector<glm::vec2> uvs;
 				std::vector<glm::vec3> normals;
@@ -65,86 +224,123 @@ namespace cogs
 
 				loadMesh(_filePath, m_subMeshes, positions, uvs, normals, tangents, indices, m_materials);
 
-				createBuffers(positions, uvs, normals, tangents, indices);
+				if (s_optimizeOnLoad)
+				{
+						MeshOptimizationReport report = optimizeMesh(m_subMeshes, positions, uvs, normals, tangents, indices);
+						printf("INFO: %s optimized, ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n", _filePath.c_str(),
+								report.before.acmr, report.after.acmr, report.before.atvr, report.after.atvr);
+				}
+
+				std::vector<unsigned char> vertices;
+				createBuffers(positions, uvs, normals, tangents, indices, vertices);
+
+				if (MeshCache::isEnabled() && MeshCache::save(*this, cachePath, sourceHash, vertices, static_cast<unsigned int>(positions.size()), indices))
+				{
+						printf("INFO: %s cached to %s\n", _filePath.c_str(), cachePath.c_str());
+				}
+
+				if (!m_lods.empty())
+				{
+						printf("INFO: %s has %u levels of detail, coarsest error %f\n", _filePath.c_str(), getNumLODs(), m_lods.back().m_error);
+				}
+
+				if (MeshPool::getLayout() != VertexLayout::standard())
+				{
+						printf("INFO: %s encoded with %u bytes per vertex, max errors: position %f, uv %f, normal %.3f deg, tangent %.3f deg\n",
+								_filePath.c_str(), MeshPool::getLayout().getStride(), m_quantizationError.position, m_quantizationError.texcoord,
+								m_quantizationError.normal, m_quantizationError.tangent);
+				}
 		}
 
 		void Mesh::calcBounds(const std::vector<glm::vec3>& _positions)
 		{
-				float maxX{ 0.0f }, maxY{ 0.0f }, maxZ{ 0.0f };
-				float minX{ 0.0f }, minY{ 0.0f }, minZ{ 0.0f };
+				m_boundingBox.m_min = glm::vec3(0.0f);
+				m_boundingBox.m_max = glm::vec3(0.0f);
 
-				for (size_t i = 0; i < _positions.size(); i++)
+				if (!_positions.empty())
 				{
-						if (_positions.at(i).x > maxX)
+						std::vector<MeshBoundingBox> partials(getNumBatches(_positions.size(), BOUNDS_BATCH));
+						parallelFor(_positions.size(), BOUNDS_BATCH, [&](size_t _begin, size_t _end, unsigned int _batch)
 						{
-								maxX = _positions.at(i).x;
-						}
-						if (_positions.at(i).x < minX)
-						{
-								minX = _positions.at(i).x;
-						}
+								partials[_batch] = calcBatchBounds(_positions.data(), _begin, _end);
+						});
 
-						if (_positions.at(i).y > maxY)
-						{
-								maxY = _positions.at(i).y;
-						}
-						if (_positions.at(i).y < minY)
+						m_boundingBox = partials.front();
+						for (const MeshBoundingBox& partial : partials)
 						{
-								minY = _positions.at(i).y;
-						}
-
-						if (_positions.at(i).z > maxZ)
-						{
-								maxZ = _positions.at(i).z;
-						}
-						if (_positions.at(i).z < minZ)
-						{
-								minZ = _positions.at(i).z;
+								m_boundingBox.m_min = glm::min(m_boundingBox.m_min, partial.m_min);
+								m_boundingBox.m_max = glm::max(m_boundingBox.m_max, partial.m_max);
 						}
 				}
 
-				m_boundingBox.m_min = glm::vec3(minX, minY, minZ);
-				m_boundingBox.m_max = glm::vec3(maxX, maxY, maxZ);
+				const glm::vec3 halfExtents = (m_boundingBox.m_max - m_boundingBox.m_min) * 0.5f;
+				m_boundingSphere.m_center = m_boundingBox.m_min + halfExtents;
+				m_boundingSphere.m_radius = fmaxf(halfExtents.x, fmaxf(halfExtents.y, halfExtents.z));
+		}
 
-				m_boundingSphere.m_center = glm::vec3(
-						minX + (maxX - minX) * 0.5f,
-						minY + (maxY - minY) * 0.5f,
-						minZ + (maxZ - minZ) * 0.5f);
-				m_boundingSphere.m_radius = fmaxf((maxX - minX) * 0.5f, fmaxf((maxY - minY) * 0.5f, (maxZ - minZ) * 0.5f));
+		void Mesh::calcSubMeshBounds(const std::vector<glm::vec3>& _positions,
+				const std::vector<unsigned int>& _indices)
+		{
+				//only a part of a large mesh is often on screen, the renderer culls the submeshes of visible instances one by one
+				parallelFor(m_subMeshes.size(), 1, [&](size_t _begin, size_t _end, unsigned int)
+				{
+						for (size_t i = _begin; i < _end; i++)
+						{
+								SubMesh& subMesh = m_subMeshes[i];
+								if (subMesh.m_numIndices == 0)
+								{
+										continue;
+								}
+
+								const unsigned int* indices = _indices.data() + subMesh.m_baseIndex;
+								const glm::vec3* positions = _positions.data() + subMesh.m_baseVertex;
+
+								glm::vec3 min = positions[indices[0]];
+								glm::vec3 max = min;
+								for (unsigned int j = 1; j < subMesh.m_numIndices; j++)
+								{
+										min = glm::min(min, positions[indices[j]]);
+										max = glm::max(max, positions[indices[j]]);
+								}
+
+								//centered on the box, but reaching every vertex
+								const glm::vec3 center = (min + max) * 0.5f;
+								float radius2{ 0.0f };
+								for (unsigned int j = 0; j < subMesh.m_numIndices; j++)
+								{
+										const glm::vec3 offset = positions[indices[j]] - center;
+										radius2 = glm::max(radius2, glm::dot(offset, offset));
+								}
+
+								subMesh.m_boundingSphere.m_center = center;
+								subMesh.m_boundingSphere.m_radius = std::sqrt(radius2);
+						}
+				});
 		}
 
 		void Mesh::calcNormals(const std::vector<glm::vec3>& _positions,
 				std::vector<glm::vec3>& _normals,
 				std::vector<unsigned int>& _indices)
 		{
-				_normals.clear();
-				_normals.reserve(_positions.size());
-
-				for (unsigned int i = 0; i < _positions.size(); i++)
-				{
-						_normals.push_back(glm::vec3(0, 0, 0));
-				}
+				const glm::vec3* positions = _positions.data();
 
-				for (unsigned int i = 0; i < _indices.size(); i += 3)
+				accumulateTriangles(m_subMeshes, _indices, _positions.size(), _normals,
+						[positions](unsigned int _a, unsigned int _b, unsigned int _c)
 				{
-						int A = _indices.at(i);
-						int B = _indices.at(i + 1);
-						int C = _indices.at(i + 2);
-
-						glm::vec3 v1 = _positions.at(B) - _positions.at(A);
-						glm::vec3 v2 = _positions.at(C) - _positions.at(A);
-
-						glm::vec3 normal = glm::normalize(glm::cross(v1, v2));
-
-						_normals.at(A) += normal;
-						_normals.at(B) += normal;
-						_normals.at(C) += normal;
-				}
+						glm::vec3 normal = glm::cross(positions[_b] - positions[_a], positions[_c] - positions[_a]);
+						float length2 = glm::dot(normal, normal);
+						return length2 > 0.0f ? normal / std::sqrt(length2) : glm::vec3(0.0f);
+				});
 
-				for (unsigned int i = 0; i < _normals.size(); i++)
+				glm::vec3* normals = _normals.data();
+				parallelFor(_normals.size(), VERTEX_BATCH, [normals](size_t _begin, size_t _end, unsigned int)
 				{
-						_normals.at(i) = glm::normalize(_normals.at(i));
-				}
+						for (size_t i = _begin; i < _end; i++)
+						{
+								float length2 = glm::dot(normals[i], normals[i]);
+								normals[i] = length2 > 0.0f ? normals[i] / std::sqrt(length2) : glm::vec3(0.0f, 1.0f, 0.0f);
+						}
+				});
 		}
 
 		void Mesh::calcTangents(const std::vector<glm::vec3>& _positions,
@@ -153,46 +349,42 @@ namespace cogs
 				std::vector<glm::vec3>& _tangents,
 				std::vector<unsigned int>& _indices)
 		{
-				_tangents.clear();
-				_tangents.reserve(_positions.size());
+				const glm::vec3* positions = _positions.data();
+				const glm::vec2* uvs = _uvs.data();
 
-				for (unsigned int i = 0; i < _positions.size(); i++)
+				accumulateTriangles(m_subMeshes, _indices, _positions.size(), _tangents,
+						[positions, uvs](unsigned int _a, unsigned int _b, unsigned int _c)
 				{
-						_tangents.push_back(glm::vec3(0, 0, 0));
-				}
+						glm::vec3 edge1 = positions[_b] - positions[_a];
+						glm::vec3 edge2 = positions[_c] - positions[_a];
+						glm::vec2 deltaUV1 = uvs[_b] - uvs[_a];
+						glm::vec2 deltaUV2 = uvs[_c] - uvs[_a];
 
-				for (unsigned int i = 0; i < _indices.size(); i += 3)
-				{
-						int A = _indices.at(i);
-						int B = _indices.at(i + 1);
-						int C = _indices.at(i + 2);
-
-						glm::vec3 edge1 = _positions.at(B) - _positions.at(A);
-						glm::vec3 edge2 = _positions.at(C) - _positions.at(A);
-
-						float deltaU1 = _uvs.at(B).x - _uvs.at(A).x;
-						float deltaU2 = _uvs.at(C).x - _uvs.at(A).x;
-						float deltaV1 = _uvs.at(B).y - _uvs.at(A).y;
-						float deltaV2 = _uvs.at(C).y - _uvs.at(A).y;
-
-						float dividend = (deltaU1 * deltaV2 - deltaU2 * deltaV1);
+						float dividend = (deltaUV1.x * deltaUV2.y - deltaUV2.x * deltaUV1.y);
 						float f = dividend == 0.0f ? 0.0f : 1.0f / dividend;
 
-						glm::vec3 tangent(0, 0, 0);
-
-						tangent.x = (f * (deltaV2 * edge1.x - deltaV1 * edge2.x));
-						tangent.y = (f * (deltaV2 * edge1.y - deltaV1 * edge2.y));
-						tangent.z = (f * (deltaV2 * edge1.z - deltaV1 * edge2.z));
+						return f * (deltaUV2.y * edge1 - deltaUV1.y * edge2);
+				});
 
-						_tangents.at(A) += tangent;
-						_tangents.at(B) += tangent;
-						_tangents.at(C) += tangent;
-				}
-
-				for (unsigned int i = 0; i < _tangents.size(); i++)
+				glm::vec3* tangents = _tangents.data();
+				const glm::vec3* normals = _normals.data();
+				parallelFor(_tangents.size(), VERTEX_BATCH, [tangents, normals](size_t _begin, size_t _end, unsigned int)
 				{
-						_tangents.at(i) = glm::normalize(_tangents.at(i));
-				}
+						for (size_t i = _begin; i < _end; i++)
+						{
+								float length2 = glm::dot(tangents[i], tangents[i]);
+								if (length2 > 0.0f)
+								{
+										tangents[i] /= std::sqrt(length2);
+								}
+								else
+								{
+										//no usable texture coordinates, any direction perpendicular to the normal does
+										const glm::vec3 axis = glm::abs(normals[i].x) < 0.9f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+										tangents[i] = glm::normalize(glm::cross(normals[i], axis));
+								}
+						}
+				});
 		}
 
 		void Mesh::finalize(const std::vector<glm::vec3>& _positions,
@@ -202,6 +394,7 @@ namespace cogs
 				std::vector<unsigned int>& _indices)
 		{
 				calcBounds(_positions);
+				calcSubMeshBounds(_positions, _indices);
 
 				if (isValid(_positions, _uvs, _normals, _tangents))
 				{
@@ -234,73 +427,155 @@ namespace cogs
 				}
 		}
 
-		void Mesh::createBuffers(const std::vector<glm::vec3>& _positions,
-				std::vector<glm::vec2>& _uvs,
-				std::vector<glm::vec3>& _normals,
-				std::vector<glm::vec3>& _tangents,
+		void Mesh::generateLODs(const std::vector<glm::vec3>& _positions,
 				std::vector<unsigned int>& _indices)
 		{
-				finalize(_positions, _uvs, _normals, _tangents, _indices);
+				m_lods.clear();
 
-				m_numIndices = _indices.size();
+				const float radius = m_boundingSphere.m_radius > 0.0f ? m_boundingSphere.m_radius : 1.0f;
+				//collapses moving the surface further than this are never worth it
+				const float maxError = radius * 0.05f;
 
-				glGenVertexArrays(1, &m_VAO);
-				glBindVertexArray(m_VAO);
+				std::vector<unsigned int> simplified;
+				size_t previousIndexCount = m_numIndices;
+				float error{ 0.0f };
 
-				glGenBuffers(BufferObject::NUM_BUFFERS, m_VBOs);
+				for (unsigned int level = 1; level <= s_numGeneratedLODs; level++)
+				{
+						const std::vector<SubMesh>& source = level == 1 ? m_subMeshes : m_lods.back().m_subMeshes;
 
-				// Upload position data
-				glBindBuffer(GL_ARRAY_BUFFER, m_VBOs[BufferObject::POSITION]);
-				glBufferData(GL_ARRAY_BUFFER, _positions.size() * sizeof(_positions.at(0)), _positions.data(), GL_STATIC_DRAW);
+						MeshLOD lod;
+						lod.m_subMeshes = source;
+						size_t indexCount{ 0 };
 
-				glEnableVertexAttribArray(BufferObject::POSITION);
-				glVertexAttribPointer(BufferObject::POSITION, 3, GL_FLOAT, GL_FALSE, 0, nullptr);
+						for (size_t i = 0; i < source.size(); i++)
+						{
+								const SubMesh& subMesh = m_subMeshes.at(i);
+
+								//the vertices of a submesh end where the next one's begin
+								size_t vertexEnd = _positions.size();
+								for (const SubMesh& other : m_subMeshes)
+								{
+										if (other.m_baseVertex > subMesh.m_baseVertex && other.m_baseVertex < vertexEnd)
+										{
+												vertexEnd = other.m_baseVertex;
+										}
+								}
+
+								//simplify the previous level further, the target is relative to the full detail mesh
+								size_t targetIndexCount = (subMesh.m_numIndices >> level) / 3 * 3;
+								error = glm::max(error, simplifyMesh(_indices.data() + source.at(i).m_baseIndex, source.at(i).m_numIndices,
+										_positions.data() + subMesh.m_baseVertex, vertexEnd - subMesh.m_baseVertex,
+										targetIndexCount, maxError, simplified));
+
+								if (s_optimizeOnLoad)
+								{
+										optimizeVertexCache(simplified.data(), simplified.size(), vertexEnd - subMesh.m_baseVertex);
+								}
+
+								lod.m_subMeshes.at(i).m_baseIndex = static_cast<unsigned int>(_indices.size());
+								lod.m_subMeshes.at(i).m_numIndices = static_cast<unsigned int>(simplified.size());
+								_indices.insert(_indices.end(), simplified.begin(), simplified.end());
+								indexCount += simplified.size();
+						}
 
-				// Upload UV data
-				glBindBuffer(GL_ARRAY_BUFFER, m_VBOs[BufferObject::TEXCOORD]);
-				glBufferData(GL_ARRAY_BUFFER, _uvs.size() * sizeof(_uvs.at(0)), _uvs.data(), GL_STATIC_DRAW);
+						//stop once a level saves too little to pay for itself
+						if (indexCount > previousIndexCount * 4 / 5)
+						{
+								_indices.resize(_indices.size() - indexCount);
+								break;
+						}
 
-				glEnableVertexAttribArray(BufferObject::TEXCOORD);
-				glVertexAttribPointer(BufferObject::TEXCOORD, 2, GL_FLOAT, GL_FALSE, 0, nullptr);
+						lod.m_error = error / radius;
+						m_lods.push_back(lod);
+						previousIndexCount = indexCount;
+				}
+		}
 
-				// Upload normals data
-				glBindBuffer(GL_ARRAY_BUFFER, m_VBOs[BufferObject::NORMAL]);
-				glBufferData(GL_ARRAY_BUFFER, _normals.size() * sizeof(_normals.at(0)), _normals.data(), GL_STATIC_DRAW);
+		void Mesh::generateMeshlets(const std::vector<glm::vec3>& _positions,
+				std::vector<unsigned int>& _indices)
+		{
+				m_meshlets.clear();
 
-				glEnableVertexAttribArray(BufferObject::NORMAL);
-				glVertexAttribPointer(BufferObject::NORMAL, 3, GL_FLOAT, GL_FALSE, 0, nullptr);
+				for (size_t i = 0; i < m_subMeshes.size(); i++)
+				{
+						const SubMesh& subMesh = m_subMeshes[i];
+						const size_t firstMeshlet = m_meshlets.size();
 
-				// Upload tangents data
-				glBindBuffer(GL_ARRAY_BUFFER, m_VBOs[BufferObject::TANGENT]);
-				glBufferData(GL_ARRAY_BUFFER, _tangents.size() * sizeof(_tangents.at(0)), _tangents.data(), GL_STATIC_DRAW);
+						//the indices of a submesh are relative to its base vertex
+						buildMeshlets(_indices.data() + subMesh.m_baseIndex, subMesh.m_numIndices,
+								_positions.data() + subMesh.m_baseVertex, _positions.size() - subMesh.m_baseVertex,
+								MESHLET_MAX_VERTICES, MESHLET_MAX_TRIANGLES, m_meshlets);
 
-				glEnableVertexAttribArray(BufferObject::TANGENT);
-				glVertexAttribPointer(BufferObject::TANGENT, 3, GL_FLOAT, GL_FALSE, 0, nullptr);
+						for (size_t j = firstMeshlet; j < m_meshlets.size(); j++)
+						{
+								m_meshlets[j].m_baseIndex += subMesh.m_baseIndex;
+								m_meshlets[j].m_subMesh = static_cast<unsigned int>(i);
+						}
+				}
 
-				// Upload index data for indexed rendering
-				glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_VBOs[BufferObject::INDEX]);
-				glBufferData(GL_ELEMENT_ARRAY_BUFFER, _indices.size() * sizeof(_indices.at(0)), _indices.data(), GL_STATIC_DRAW);
+				buildMeshletCullBlocks(m_meshlets, m_meshletCullBlocks);
+		}
 
-				// bind the buffer for world matrices
-				glBindBuffer(GL_ARRAY_BUFFER, m_VBOs[BufferObject::WORLDMAT]);
-				// cannot upload mat4's all at once, so upload them as 4 vec4's
-				for (size_t i = 0; i < 4; i++)
+		void Mesh::generateOccluder(const std::vector<glm::vec3>& _positions,
+				const std::vector<unsigned int>& _indices)
+		{
+				m_occluderPositions.clear();
+				m_occluderIndices.clear();
+
+				//only the vertices the coarsest level still uses are kept
+				const std::vector<SubMesh>& subMeshes = getSubMeshes(getNumLODs() - 1);
+				std::vector<unsigned int> remap(_positions.size(), ~0u);
+
+				for (const SubMesh& subMesh : subMeshes)
 				{
-						//enable the channel of the current matrix row (4,5,6,7)
-						glEnableVertexAttribArray(BufferObject::WORLDMAT + i);
-						//tell opengl how to read it
-						glVertexAttribPointer(BufferObject::WORLDMAT + i, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4),
-								(const void*)(sizeof(float) * i * 4));
-
-						/** This function is what makes it per-instance data rather than per vertex
-						* The first parameter is the attribute channel as above (4,5,6,7)
-						* The second parameter tells the rate at which the attribute advanced during the rendering
-						* 1 means that this data is updated after 1 instance has been rendered
-						* by default it's 0 which makes it per-vertex and if it's over 1 than more than 1 instances will use this data
-						*/
-						glVertexAttribDivisor(BufferObject::WORLDMAT + i, 1);
+						for (unsigned int i = 0; i < subMesh.m_numIndices; i++)
+						{
+								unsigned int vertex = subMesh.m_baseVertex + _indices[subMesh.m_baseIndex + i];
+								if (remap[vertex] == ~0u)
+								{
+										remap[vertex] = static_cast<unsigned int>(m_occluderPositions.size());
+										m_occluderPositions.push_back(_positions[vertex]);
+								}
+								m_occluderIndices.push_back(remap[vertex]);
+						}
 				}
+		}
 
-				glBindVertexArray(0);
+		void Mesh::createBuffers(const std::vector<glm::vec3>& _positions,
+				std::vector<glm::vec2>& _uvs,
+				std::vector<glm::vec3>& _normals,
+				std::vector<glm::vec3>& _tangents,
+				std::vector<unsigned int>& _indices,
+				std::vector<unsigned char>& _encodedVertices)
+		{
+				finalize(_positions, _uvs, _normals, _tangents, _indices);
+
+				//reorders the full detail triangles, so it has to happen before the lods are built from them
+				if (s_buildMeshlets)
+				{
+						generateMeshlets(_positions, _indices);
+				}
+
+				m_numIndices = _indices.size();
+
+				//the lod index ranges are appended behind the full detail ones
+				if (s_numGeneratedLODs > 0)
+				{
+						generateLODs(_positions, _indices);
+				}
+
+				if (s_buildOccluders)
+				{
+						generateOccluder(_positions, _indices);
+				}
+
+				//interleave and compress the vertices with the layout of the pool
+				encodeVertices(MeshPool::getLayout(), _positions, _uvs, _normals, _tangents,
+						m_boundingBox.m_min, m_boundingBox.m_max, _encodedVertices, m_dequantization, m_quantizationError);
+				m_hasDequantization = MeshPool::getLayout().position == PositionFormat::UNORM16_4;
+
+				//the geometry goes into the shared buffers of the pool, the vao is shared by all meshes
+				m_poolHandle = MeshPool::allocate(_encodedVertices.data(), static_cast<uint>(_positions.size()), _indices);
 		}
 }
\ No newline at end of file
@@ -1,16 +1,27 @@
 #ifndef MESH_H
 #define MESH_H
 
+#include "MeshPool.h"
+#include "Meshlets.h"
+
 #include <vector>
 #include <string>
 #include	<memory>
 #include <glm\vec3.hpp>
 #include <glm\vec2.hpp>
+#include <glm\mat4x4.hpp>
 
 namespace cogs
 {
 		class Material;
+		class Impostor;
 
+		/* Structure to represent the bounding sphere around the mesh (for culling) */
+		struct MeshBoundingSphere
+		{
+				glm::vec3 m_center;
+				float m_radius;
+		};
 		//Structure of submeshes the mesh is composed of
 		struct SubMesh
 		{
@@ -18,12 +29,13 @@ namespace cogs
 				unsigned int m_baseIndex{ 0 };
 				unsigned int m_numIndices{ 0 };
 				unsigned int m_materialIndex{ 9999 };
+				MeshBoundingSphere m_boundingSphere{ glm::vec3(0.0f), 0.0f }; ///< around the vertices of the full detail submesh, in model space
 		};
-		/* Structure to represent the bounding sphere around the mesh (for culling) */
-		struct MeshBoundingSphere
+		/* A simplified level of detail, its index ranges use the vertices of the full detail mesh */
+		struct MeshLOD
 		{
-				glm::vec3 m_center;
-				float m_radius;
+				std::vector<SubMesh> m_subMeshes;
+				float m_error{ 0.0f }; ///< deviation from the full detail surface, relative to the bounding sphere radius
 		};
 		/* Structure to represent the bounding box around the mesh (for culling) */
 		struct MeshBoundingBox
@@ -38,6 +50,11 @@ namespace cogs
 		class Mesh
 		{
 				friend class Renderer3D;
+				friend class MeshCache;
+				friend class GPUScene;
+				friend class StaticBatches;
+				friend class ImpostorBatches;
+				friend class InstanceBatches;
 
 		public:
 				Mesh() {}
@@ -51,7 +68,7 @@ namespace cogs
 				void render() const;
 
 				/**
-				* \brief dispose of the vao and vbo's
+				* \brief release the geometry from the mesh pool
 				*/
 				void dispose();
 
@@ -73,10 +90,85 @@ namespace cogs
 				inline const std::vector<SubMesh>& getSubMeshes()					const noexcept { return m_subMeshes; }
 				inline const std::vector<std::weak_ptr<Material>>& getMaterials()	const noexcept { return m_materials; }
 
+				/**
+				* \brief the levels of detail, 0 is the full detail mesh
+				*/
+				inline unsigned int getNumLODs()																	const noexcept { return static_cast<unsigned int>(m_lods.size()) + 1; }
+				inline const std::vector<SubMesh>& getSubMeshes(unsigned int _lod) const { return _lod == 0 ? m_subMeshes : m_lods.at(_lod - 1).m_subMeshes; }
+				inline float getLODError(unsigned int _lod)											const { return _lod == 0 ? 0.0f : m_lods.at(_lod - 1).m_error; }
+
+				/**
+				* \brief the billboard drawn instead of the mesh for distant instances (see Impostor::bake and Renderer3D::setImpostorDistance)
+				*/
+				void setImpostor(std::shared_ptr<Impostor> _impostor) { m_impostor = _impostor; }
+				inline std::weak_ptr<Impostor> getImpostor()												const noexcept { return m_impostor; }
+
+				/**
+				* \brief where the geometry lives in the mesh pool, the offsets change when the pool gets compacted
+				*/
+				inline unsigned int getVAO()					const noexcept { return MeshPool::getVAO(); }
+				inline unsigned int getBaseVertex() const { return MeshPool::getBaseVertex(m_poolHandle); }
+				inline unsigned int getBaseIndex()		const { return MeshPool::getBaseIndex(m_poolHandle); }
+
+				/**
+				* \brief matrix turning the stored vertex positions back into model space,
+				* identity unless the pool layout normalizes positions to the mesh bounds
+				*/
+				inline const glm::mat4& getDequantization()					const noexcept { return m_dequantization; }
+				inline bool hasDequantization()													const noexcept { return m_hasDequantization; }
+
+				/**
+				* \brief the largest errors introduced by encoding the vertices with the pool layout
+				*/
+				inline const QuantizationError& getQuantizationError() const noexcept { return m_quantizationError; }
+
+				/**
+				* \brief whether meshes get their triangles and vertices reordered for the vertex cache and overdraw when loaded (off by default).
+				* Prints the cache miss ratios before and after
+				*/
+				static void setOptimizeOnLoad(bool _optimize) noexcept { s_optimizeOnLoad = _optimize; }
+				static bool getOptimizeOnLoad() noexcept { return s_optimizeOnLoad; }
+
+				/**
+				* \brief how many simplified levels of detail get generated for meshes when loaded (0 by default).
+				* Every level halves the triangle count, generation stops early once a level barely simplifies
+				*/
+				static void setGeneratedLODs(unsigned int _numLevels) noexcept { s_numGeneratedLODs = _numLevels; }
+				static unsigned int getGeneratedLODs() noexcept { return s_numGeneratedLODs; }
+
+				/**
+				* \brief whether the full detail triangles of meshes get clustered into meshlets when loaded (off by default),
+				* so the renderer can cull the parts of dense meshes which are off screen or face away
+				*/
+				static void setBuildMeshlets(bool _build) noexcept { s_buildMeshlets = _build; }
+				static bool getBuildMeshlets() noexcept { return s_buildMeshlets; }
+
+				/**
+				* \brief the meshlets of the full detail mesh, ordered by submesh, and their culling data in blocks of 4
+				*/
+				inline const std::vector<Meshlet>& getMeshlets()									const noexcept { return m_meshlets; }
+				inline const std::vector<MeshletCullBlock>& getMeshletCullBlocks() const noexcept { return m_meshletCullBlocks; }
+
+				/**
+				* \brief whether meshes keep a copy of their coarsest level of detail in memory when loaded (off by default),
+				* so they can be rasterized as occluders by the OcclusionCuller
+				*/
+				static void setBuildOccluders(bool _build) noexcept { s_buildOccluders = _build; }
+				static bool getBuildOccluders() noexcept { return s_buildOccluders; }
+
+				/**
+				* \brief the occluder triangles in model space, empty unless built
+				*/
+				inline const std::vector<glm::vec3>& getOccluderPositions()			const noexcept { return m_occluderPositions; }
+				inline const std::vector<unsigned int>& getOccluderIndices()		const noexcept { return m_occluderIndices; }
+
 		private:
 				/* internal utility functions */
 				void calcBounds(const std::vector<glm::vec3>& _positions);
 
+				void calcSubMeshBounds(const std::vector<glm::vec3>& _positions,
+						const std::vector<unsigned int>& _indices);
+
 				void calcNormals(const std::vector<glm::vec3>& _positions,
 						std::vector<glm::vec3>& _normals,
 						std::vector<unsigned int>& _indices);
@@ -93,24 +185,30 @@ namespace cogs
 						std::vector<glm::vec3>& _tangents,
 						std::vector<unsigned int>& _indices);
 
+				void generateLODs(const std::vector<glm::vec3>& _positions,
+						std::vector<unsigned int>& _indices);
+
+				void generateMeshlets(const std::vector<glm::vec3>& _positions,
+						std::vector<unsigned int>& _indices);
+
+				void generateOccluder(const std::vector<glm::vec3>& _positions,
+						const std::vector<unsigned int>& _indices);
+
 				void createBuffers(const std::vector<glm::vec3>& _positions,
 						std::vector<glm::vec2>& _uvs,
 						std::vector<glm::vec3>& _normals,
 						std::vector<glm::vec3>& _tangents,
-						std::vector<unsigned int>& _indices);
+						std::vector<unsigned int>& _indices,
+						std::vector<unsigned char>& _encodedVertices);
 
-				//enum for all the buffer objects
+				//enum for the vertex attribute locations
 				enum BufferObject
 				{
 						POSITION,
 						TEXCOORD,
 						NORMAL,
 						TANGENT,
-						WORLDMAT,
-
-						INDEX,
-
-						NUM_BUFFERS
+						WORLDMAT
 				};
 
 		private:
@@ -118,11 +216,25 @@ namespace cogs
 				MeshBoundingSphere m_boundingSphere;
 
 				unsigned int m_numIndices{ 0 };
-				unsigned int m_VAO{ 0 }; ///< the vao of this mesh
-				unsigned int m_VBOs[BufferObject::NUM_BUFFERS] = { 0 }; ///< the vbo's of this mesh
+				MeshPool::Handle m_poolHandle{ MeshPool::INVALID_HANDLE }; ///< the allocation of the geometry in the mesh pool
+
+				glm::mat4 m_dequantization{ 1.0f }; ///< from stored positions to model space
+				bool m_hasDequantization{ false }; ///< whether m_dequantization isn't the identity
+				QuantizationError m_quantizationError; ///< the errors of the vertex encoding
 
 				std::vector<SubMesh> m_subMeshes;
 				std::vector<std::weak_ptr<Material>> m_materials;
+				std::vector<MeshLOD> m_lods; ///< the simplified levels, from fine to coarse
+				std::shared_ptr<Impostor> m_impostor; ///< the baked billboard, if any
+				std::vector<Meshlet> m_meshlets; ///< clusters of the full detail triangles
+				std::vector<MeshletCullBlock> m_meshletCullBlocks; ///< the culling data of m_meshlets
+				std::vector<glm::vec3> m_occluderPositions; ///< the vertices used by the coarsest level, for the software occlusion culling
+				std::vector<unsigned int> m_occluderIndices; ///< the triangles of the coarsest level, indexing m_occluderPositions
+
+				static bool s_optimizeOnLoad;
+				static unsigned int s_numGeneratedLODs;
+				static bool s_buildMeshlets;
+				static bool s_buildOccluders;
 		};
 }
 #endif // !MESH_H
@@ -0,0 +1,403 @@
+#include "MeshCache.h"
+
+#include "Mesh.h"
+#include "Material.h"
+#include "GLTexture2D.h"
+#include "ResourceManager.h"
+#include "MappedFile.h"
+
+#include <fstream>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <type_traits>
+
+namespace cogs
+{
+		bool MeshCache::s_enabled = true;
+
+		namespace
+		{
+				const char MAGIC[4] = { 'C', 'M', 'S', 'H' };
+				const uint64_t BLOCK_ALIGNMENT = 16;
+
+				//texture slots of the material records, in this order
+				const char* const TEXTURE_NAMES[4] = { "texture_diffuse", "texture_specular", "texture_reflection", "texture_normal" };
+
+				struct Header
+				{
+						char magic[4];
+						uint32_t version;
+						uint64_t sourceHash;
+
+						//settings the content depends on
+						uint32_t layout[4];
+						uint32_t optimized;
+						uint32_t generatedLODs;
+						uint32_t buildMeshlets;
+						uint32_t buildOccluders;
+
+						uint32_t numVertices;
+						uint32_t vertexStride;
+						uint32_t numIndices; ///< of all levels
+						uint32_t numFullDetailIndices;
+						uint32_t numSubMeshes;
+						uint32_t numLODs; ///< simplified levels
+						uint32_t numMaterials;
+						uint32_t numMeshlets;
+						uint32_t numOccluderVertices;
+						uint32_t numOccluderIndices;
+						uint32_t hasDequantization;
+
+						MeshBoundingBox boundingBox;
+						MeshBoundingSphere boundingSphere;
+						glm::mat4 dequantization;
+						QuantizationError quantizationError;
+
+						//byte offsets of the blocks from the start of the file
+						uint64_t vertexOffset;
+						uint64_t indexOffset;
+						uint64_t subMeshOffset; ///< numSubMeshes * (numLODs + 1) submeshes, level by level
+						uint64_t lodErrorOffset; ///< numLODs floats
+						uint64_t meshletOffset; ///< numMeshlets meshlets
+						uint64_t occluderOffset; ///< numOccluderVertices positions, then numOccluderIndices indices
+						uint64_t materialOffset; ///< name and the 4 texture paths per material, as length prefixed strings
+				};
+				static_assert(std::is_trivially_copyable<Header>::value, "the header is written as is");
+				static_assert(std::is_trivially_copyable<SubMesh>::value, "submeshes are written as is");
+				static_assert(std::is_trivially_copyable<Meshlet>::value, "meshlets are written as is");
+
+				void fillSettings(Header& _header)
+				{
+						const VertexLayout& layout = MeshPool::getLayout();
+						_header.layout[0] = static_cast<uint32_t>(layout.position);
+						_header.layout[1] = static_cast<uint32_t>(layout.texcoord);
+						_header.layout[2] = static_cast<uint32_t>(layout.normal);
+						_header.layout[3] = static_cast<uint32_t>(layout.tangent);
+						_header.optimized = Mesh::getOptimizeOnLoad() ? 1 : 0;
+						_header.generatedLODs = Mesh::getGeneratedLODs();
+						_header.buildMeshlets = Mesh::getBuildMeshlets() ? 1 : 0;
+						_header.buildOccluders = Mesh::getBuildOccluders() ? 1 : 0;
+						_header.vertexStride = layout.getStride();
+				}
+
+				uint64_t align(uint64_t _offset)
+				{
+						return (_offset + BLOCK_ALIGNMENT - 1) & ~(BLOCK_ALIGNMENT - 1);
+				}
+
+				void writeString(std::ofstream& _file, const std::string& _string)
+				{
+						uint32_t length = static_cast<uint32_t>(_string.size());
+						_file.write(reinterpret_cast<const char*>(&length), sizeof(length));
+						_file.write(_string.data(), length);
+				}
+
+				bool readString(const unsigned char*& _cursor, const unsigned char* _end, std::string& _string)
+				{
+						uint32_t length;
+						if (_end - _cursor < static_cast<ptrdiff_t>(sizeof(length)))
+						{
+								return false;
+						}
+						std::memcpy(&length, _cursor, sizeof(length));
+						_cursor += sizeof(length);
+
+						if (static_cast<uint64_t>(_end - _cursor) < length)
+						{
+								return false;
+						}
+						_string.assign(reinterpret_cast<const char*>(_cursor), length);
+						_cursor += length;
+						return true;
+				}
+
+				void writePadding(std::ofstream& _file)
+				{
+						const char zeros[BLOCK_ALIGNMENT] = { 0 };
+						uint64_t position = static_cast<uint64_t>(_file.tellp());
+						_file.write(zeros, static_cast<std::streamsize>(align(position) - position));
+				}
+		}
+
+		unsigned long long MeshCache::hashFile(const std::string& _filePath)
+		{
+				MappedFile file;
+				if (!file.open(_filePath))
+				{
+						return 0;
+				}
+
+				uint64_t hash = 14695981039346656037ull;
+				const unsigned char* data = file.getData();
+				for (size_t i = 0; i < file.getSize(); i++)
+				{
+						hash ^= data[i];
+						hash *= 1099511628211ull;
+				}
+
+				//0 means no source
+				return hash != 0 ? hash : 1;
+		}
+
+		bool MeshCache::load(Mesh& _mesh, const std::string& _cachePath, unsigned long long _sourceHash)
+		{
+				MappedFile file;
+				if (!file.open(_cachePath) || file.getSize() < sizeof(Header))
+				{
+						return false;
+				}
+
+				const unsigned char* data = file.getData();
+				const uint64_t size = file.getSize();
+
+				Header header;
+				std::memcpy(&header, data, sizeof(Header));
+
+				if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION)
+				{
+						return false;
+				}
+
+				if (_sourceHash != 0 && header.sourceHash != _sourceHash)
+				{
+						printf("INFO: %s is stale, the source changed\n", _cachePath.c_str());
+						return false;
+				}
+
+				Header settings = header;
+				fillSettings(settings);
+				if (std::memcmp(settings.layout, header.layout, sizeof(header.layout)) != 0 || settings.vertexStride != header.vertexStride
+						|| settings.optimized != header.optimized || settings.generatedLODs != header.generatedLODs
+						|| settings.buildMeshlets != header.buildMeshlets || settings.buildOccluders != header.buildOccluders)
+				{
+						return false;
+				}
+
+				//every block has to lie inside the file
+				const uint64_t numSubMeshRecords = static_cast<uint64_t>(header.numSubMeshes) * (header.numLODs + 1);
+				if (header.vertexOffset + static_cast<uint64_t>(header.numVertices) * header.vertexStride > size
+						|| header.indexOffset + static_cast<uint64_t>(header.numIndices) * sizeof(unsigned int) > size
+						|| header.subMeshOffset + numSubMeshRecords * sizeof(SubMesh) > size
+						|| header.lodErrorOffset + static_cast<uint64_t>(header.numLODs) * sizeof(float) > size
+						|| header.meshletOffset + static_cast<uint64_t>(header.numMeshlets) * sizeof(Meshlet) > size
+						|| header.occluderOffset + static_cast<uint64_t>(header.numOccluderVertices) * sizeof(glm::vec3)
+								+ static_cast<uint64_t>(header.numOccluderIndices) * sizeof(unsigned int) > size
+						|| header.materialOffset > size
+						|| header.indexOffset % sizeof(unsigned int) != 0)
+				{
+						return false;
+				}
+
+				std::vector<SubMesh> subMeshes(static_cast<size_t>(numSubMeshRecords));
+				if (!subMeshes.empty())
+				{
+						std::memcpy(subMeshes.data(), data + header.subMeshOffset, subMeshes.size() * sizeof(SubMesh));
+				}
+
+				std::vector<float> lodErrors(header.numLODs);
+				if (!lodErrors.empty())
+				{
+						std::memcpy(lodErrors.data(), data + header.lodErrorOffset, lodErrors.size() * sizeof(float));
+				}
+
+				std::vector<Meshlet> meshlets(header.numMeshlets);
+				if (!meshlets.empty())
+				{
+						std::memcpy(meshlets.data(), data + header.meshletOffset, meshlets.size() * sizeof(Meshlet));
+				}
+
+				std::vector<glm::vec3> occluderPositions(header.numOccluderVertices);
+				std::vector<unsigned int> occluderIndices(header.numOccluderIndices);
+				if (!occluderPositions.empty())
+				{
+						std::memcpy(occluderPositions.data(), data + header.occluderOffset, occluderPositions.size() * sizeof(glm::vec3));
+				}
+				if (!occluderIndices.empty())
+				{
+						std::memcpy(occluderIndices.data(), data + header.occluderOffset + occluderPositions.size() * sizeof(glm::vec3),
+								occluderIndices.size() * sizeof(unsigned int));
+				}
+
+				std::vector<std::weak_ptr<Material>> materials(header.numMaterials);
+				const unsigned char* cursor = data + header.materialOffset;
+				const unsigned char* end = data + size;
+				for (uint32_t i = 0; i < header.numMaterials; i++)
+				{
+						std::string name;
+						std::string texturePaths[4];
+						if (!readString(cursor, end, name))
+						{
+								return false;
+						}
+						for (size_t j = 0; j < 4; j++)
+						{
+								if (!readString(cursor, end, texturePaths[j]))
+								{
+										return false;
+								}
+						}
+
+						std::weak_ptr<Material> material = ResourceManager::getMaterial(name);
+
+						//like the import, a material shared with another mesh keeps its textures
+						if (material.lock()->getDiffuseMap().expired())
+						{
+								if (!texturePaths[0].empty())
+								{
+										material.lock()->setDiffuseMap(ResourceManager::getGLTexture2D(texturePaths[0], TEXTURE_NAMES[0]));
+								}
+								if (!texturePaths[1].empty())
+								{
+										material.lock()->setSpecularMap(ResourceManager::getGLTexture2D(texturePaths[1], TEXTURE_NAMES[1]));
+								}
+								if (!texturePaths[2].empty())
+								{
+										material.lock()->setReflectionMap(ResourceManager::getGLTexture2D(texturePaths[2], TEXTURE_NAMES[2]));
+								}
+								if (!texturePaths[3].empty())
+								{
+										material.lock()->setNormalMap(ResourceManager::getGLTexture2D(texturePaths[3], TEXTURE_NAMES[3]));
+								}
+						}
+						materials.at(i) = material;
+				}
+
+				//straight from the mapping into the pool's buffers
+				_mesh.m_poolHandle = MeshPool::allocate(data + header.vertexOffset, header.numVertices,
+						reinterpret_cast<const unsigned int*>(data + header.indexOffset), header.numIndices);
+
+				_mesh.m_boundingBox = header.boundingBox;
+				_mesh.m_boundingSphere = header.boundingSphere;
+				_mesh.m_dequantization = header.dequantization;
+				_mesh.m_hasDequantization = header.hasDequantization != 0;
+				_mesh.m_quantizationError = header.quantizationError;
+				_mesh.m_numIndices = header.numFullDetailIndices;
+				_mesh.m_materials = materials;
+
+				_mesh.m_subMeshes.assign(subMeshes.begin(), subMeshes.begin() + header.numSubMeshes);
+				_mesh.m_lods.resize(header.numLODs);
+				for (uint32_t i = 0; i < header.numLODs; i++)
+				{
+						auto first = subMeshes.begin() + static_cast<size_t>(header.numSubMeshes) * (i + 1);
+						_mesh.m_lods[i].m_subMeshes.assign(first, first + header.numSubMeshes);
+						_mesh.m_lods[i].m_error = lodErrors[i];
+				}
+
+				_mesh.m_meshlets.swap(meshlets);
+				buildMeshletCullBlocks(_mesh.m_meshlets, _mesh.m_meshletCullBlocks);
+
+				_mesh.m_occluderPositions.swap(occluderPositions);
+				_mesh.m_occluderIndices.swap(occluderIndices);
+
+				return true;
+		}
+
+		bool MeshCache::save(const Mesh& _mesh,
+				const std::string& _cachePath,
+				unsigned long long _sourceHash,
+				const std::vector<unsigned char>& _vertices,
+				unsigned int _numVertices,
+				const std::vector<unsigned int>& _indices)
+		{
+				Header header{};
+				std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+				header.version = VERSION;
+				header.sourceHash = _sourceHash;
+				fillSettings(header);
+
+				header.numVertices = _numVertices;
+				header.numIndices = static_cast<uint32_t>(_indices.size());
+				header.numFullDetailIndices = _mesh.m_numIndices;
+				header.numSubMeshes = static_cast<uint32_t>(_mesh.m_subMeshes.size());
+				header.numLODs = static_cast<uint32_t>(_mesh.m_lods.size());
+				header.numMaterials = static_cast<uint32_t>(_mesh.m_materials.size());
+				header.numMeshlets = static_cast<uint32_t>(_mesh.m_meshlets.size());
+				header.numOccluderVertices = static_cast<uint32_t>(_mesh.m_occluderPositions.size());
+				header.numOccluderIndices = static_cast<uint32_t>(_mesh.m_occluderIndices.size());
+				header.hasDequantization = _mesh.m_hasDequantization ? 1 : 0;
+				header.boundingBox = _mesh.m_boundingBox;
+				header.boundingSphere = _mesh.m_boundingSphere;
+				header.dequantization = _mesh.m_dequantization;
+				header.quantizationError = _mesh.m_quantizationError;
+
+				//written to a temporary file first, a crash mustn't leave a half written cache behind
+				const std::string tempPath = _cachePath + ".tmp";
+				std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+				if (!file.is_open())
+				{
+						printf("WARNING: couldn't write the mesh cache %s\n", _cachePath.c_str());
+						return false;
+				}
+
+				file.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+
+				writePadding(file);
+				header.vertexOffset = static_cast<uint64_t>(file.tellp());
+				file.write(reinterpret_cast<const char*>(_vertices.data()), static_cast<std::streamsize>(_vertices.size()));
+
+				writePadding(file);
+				header.indexOffset = static_cast<uint64_t>(file.tellp());
+				file.write(reinterpret_cast<const char*>(_indices.data()), static_cast<std::streamsize>(_indices.size() * sizeof(unsigned int)));
+
+				writePadding(file);
+				header.subMeshOffset = static_cast<uint64_t>(file.tellp());
+				file.write(reinterpret_cast<const char*>(_mesh.m_subMeshes.data()), static_cast<std::streamsize>(_mesh.m_subMeshes.size() * sizeof(SubMesh)));
+				for (const MeshLOD& lod : _mesh.m_lods)
+				{
+						file.write(reinterpret_cast<const char*>(lod.m_subMeshes.data()), static_cast<std::streamsize>(lod.m_subMeshes.size() * sizeof(SubMesh)));
+				}
+
+				header.lodErrorOffset = static_cast<uint64_t>(file.tellp());
+				for (const MeshLOD& lod : _mesh.m_lods)
+				{
+						file.write(reinterpret_cast<const char*>(&lod.m_error), sizeof(float));
+				}
+
+				header.meshletOffset = static_cast<uint64_t>(file.tellp());
+				file.write(reinterpret_cast<const char*>(_mesh.m_meshlets.data()), static_cast<std::streamsize>(_mesh.m_meshlets.size() * sizeof(Meshlet)));
+
+				header.occluderOffset = static_cast<uint64_t>(file.tellp());
+				file.write(reinterpret_cast<const char*>(_mesh.m_occluderPositions.data()), static_cast<std::streamsize>(_mesh.m_occluderPositions.size() * sizeof(glm::vec3)));
+				file.write(reinterpret_cast<const char*>(_mesh.m_occluderIndices.data()), static_cast<std::streamsize>(_mesh.m_occluderIndices.size() * sizeof(unsigned int)));
+
+				header.materialOffset = static_cast<uint64_t>(file.tellp());
+				for (const std::weak_ptr<Material>& material : _mesh.m_materials)
+				{
+						std::shared_ptr<Material> locked = material.lock();
+						writeString(file, locked ? locked->getName() : "");
+
+						std::weak_ptr<GLTexture2D> textures[4];
+						if (locked)
+						{
+								textures[0] = locked->getDiffuseMap();
+								textures[1] = locked->getSpecularMap();
+								textures[2] = locked->getReflectionMap();
+								textures[3] = locked->getNormalMap();
+						}
+						for (size_t i = 0; i < 4; i++)
+						{
+								writeString(file, textures[i].expired() ? "" : textures[i].lock()->getFilePath());
+						}
+				}
+
+				file.seekp(0);
+				file.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+				file.close();
+
+				if (file.fail())
+				{
+						printf("WARNING: couldn't write the mesh cache %s\n", _cachePath.c_str());
+						std::remove(tempPath.c_str());
+						return false;
+				}
+
+				std::remove(_cachePath.c_str());
+				if (std::rename(tempPath.c_str(), _cachePath.c_str()) != 0)
+				{
+						std::remove(tempPath.c_str());
+						return false;
+				}
+				return true;
+		}
+}
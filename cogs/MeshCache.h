@@ -0,0 +1,64 @@
+#ifndef MESH_CACHE_H
+#define MESH_CACHE_H
+
+#include <vector>
+#include <string>
+
+namespace cogs
+{
+		class Mesh;
+
+		/**
+		* \brief Binary cache of imported meshes (.cmesh), written next to the source file on the first import.
+		* It holds the vertices already encoded with the pool layout and the indices of all levels of detail, ready for upload,
+		* the submesh table, the bounds and the material references. Loading maps the file and uploads straight from the mapping.
+		* A cache is stale when the content hash of the source file, the format version, the pool layout
+		* or the load settings (optimization, lod count, meshlets, occluders) don't match, it is rebuilt then
+		*/
+		class MeshCache
+		{
+		public:
+				static const unsigned int VERSION = 4; ///< bump when the layout of the file changes
+
+				/**
+				* \brief whether Mesh::load uses and writes caches (enabled by default)
+				*/
+				static void setEnabled(bool _enabled) noexcept { s_enabled = _enabled; }
+				static bool isEnabled() noexcept { return s_enabled; }
+
+				/**
+				* \brief the path of the cache of a source file
+				*/
+				static std::string getCachePath(const std::string& _sourcePath) { return _sourcePath + ".cmesh"; }
+
+				/**
+				* \brief 64 bit FNV-1a hash of the content of a file, 0 if it can't be read
+				*/
+				static unsigned long long hashFile(const std::string& _filePath);
+
+				/**
+				* \brief loads a mesh from its cache into the mesh pool
+				* \param[in] _sourceHash - the hash of the source file, 0 skips the check (shipped without sources)
+				* \return false if the cache is missing, broken or stale
+				*/
+				static bool load(Mesh& _mesh, const std::string& _cachePath, unsigned long long _sourceHash);
+
+				/**
+				* \brief writes the cache of a loaded mesh
+				* \param[in] _vertices - the vertices encoded with the pool layout
+				* \param[in] _indices - the indices of all levels of detail
+				* \return false if the file couldn't be written
+				*/
+				static bool save(const Mesh& _mesh,
+						const std::string& _cachePath,
+						unsigned long long _sourceHash,
+						const std::vector<unsigned char>& _vertices,
+						unsigned int _numVertices,
+						const std::vector<unsigned int>& _indices);
+
+		private:
+				static bool s_enabled;
+		};
+}
+
+#endif // !MESH_CACHE_H
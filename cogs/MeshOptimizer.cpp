@@ -0,0 +1,450 @@
+#include "MeshOptimizer.h"
+
+#include <glm\glm.hpp>
+#include <algorithm>
+#include <cmath>
+
+namespace cogs
+{
+		namespace
+		{
+				const int FORSYTH_CACHE_SIZE = 32; ///< size of the cache modelled by the scoring function
+				const float FORSYTH_LAST_TRIANGLE_SCORE = 0.75f;
+				const float FORSYTH_CACHE_DECAY_POWER = 1.5f;
+				const float FORSYTH_VALENCE_BOOST_SCALE = 2.0f;
+				const float FORSYTH_VALENCE_BOOST_POWER = 0.5f;
+
+				float forsythVertexScore(int _cachePosition, unsigned int _remainingTriangles)
+				{
+						if (_remainingTriangles == 0)
+						{
+								//no triangles left to use this vertex
+								return -1.0f;
+						}
+
+						float score{ 0.0f };
+						if (_cachePosition >= 0)
+						{
+								if (_cachePosition < 3)
+								{
+										//the vertices of the last triangle get a fixed score so the next one doesn't just reuse the same edge
+										score = FORSYTH_LAST_TRIANGLE_SCORE;
+								}
+								else
+								{
+										float scaler = 1.0f / (FORSYTH_CACHE_SIZE - 3);
+										score = std::pow(1.0f - (_cachePosition - 3) * scaler, FORSYTH_CACHE_DECAY_POWER);
+								}
+						}
+
+						//boost vertices with few triangles left, so lone triangles don't get stranded
+						score += FORSYTH_VALENCE_BOOST_SCALE * std::pow(static_cast<float>(_remainingTriangles), -FORSYTH_VALENCE_BOOST_POWER);
+
+						return score;
+				}
+
+				bool indicesInRange(const unsigned int* _indices, size_t _numIndices, size_t _numVertices)
+				{
+						for (size_t i = 0; i < _numIndices; i++)
+						{
+								if (_indices[i] >= _numVertices)
+								{
+										return false;
+								}
+						}
+						return true;
+				}
+		}
+
+		VertexCacheStats analyzeVertexCache(const unsigned int* _indices, size_t _numIndices, size_t _numVertices, unsigned int _cacheSize)
+		{
+				VertexCacheStats stats;
+				if (_numIndices < 3)
+				{
+						return stats;
+				}
+
+				//timestamps of when each vertex entered the fifo
+				std::vector<unsigned int> cacheTimestamps(_numVertices, 0);
+				std::vector<bool> referenced(_numVertices, false);
+				unsigned int timestamp{ _cacheSize + 1 };
+				size_t misses{ 0 };
+				size_t uniqueVertices{ 0 };
+
+				for (size_t i = 0; i < _numIndices; i++)
+				{
+						unsigned int index = _indices[i];
+
+						if (timestamp - cacheTimestamps[index] > _cacheSize)
+						{
+								cacheTimestamps[index] = timestamp++;
+								misses++;
+						}
+
+						if (!referenced[index])
+						{
+								referenced[index] = true;
+								uniqueVertices++;
+						}
+				}
+
+				stats.acmr = static_cast<float>(misses) / static_cast<float>(_numIndices / 3);
+				stats.atvr = uniqueVertices > 0 ? static_cast<float>(misses) / static_cast<float>(uniqueVertices) : 0.0f;
+				return stats;
+		}
+
+		void optimizeVertexCache(unsigned int* _indices, size_t _numIndices, size_t _numVertices)
+		{
+				const size_t numTriangles = _numIndices / 3;
+				if (numTriangles < 2 || !indicesInRange(_indices, _numIndices, _numVertices))
+				{
+						return;
+				}
+
+				//triangles using each vertex, as offsets into one adjacency array
+				std::vector<unsigned int> remaining(_numVertices, 0);
+				for (size_t i = 0; i < numTriangles * 3; i++)
+				{
+						remaining[_indices[i]]++;
+				}
+
+				std::vector<unsigned int> offsets(_numVertices, 0);
+				for (size_t i = 1; i < _numVertices; i++)
+				{
+						offsets[i] = offsets[i - 1] + remaining[i - 1];
+				}
+
+				std::vector<unsigned int> adjacency(numTriangles * 3);
+				std::vector<unsigned int> filled(_numVertices, 0);
+				for (size_t t = 0; t < numTriangles; t++)
+				{
+						for (size_t k = 0; k < 3; k++)
+						{
+								unsigned int vertex = _indices[t * 3 + k];
+								adjacency[offsets[vertex] + filled[vertex]++] = static_cast<unsigned int>(t);
+						}
+				}
+
+				std::vector<int> cachePositions(_numVertices, -1);
+				std::vector<float> vertexScores(_numVertices);
+				for (size_t i = 0; i < _numVertices; i++)
+				{
+						vertexScores[i] = forsythVertexScore(-1, remaining[i]);
+				}
+
+				std::vector<float> triangleScores(numTriangles);
+				std::vector<bool> emitted(numTriangles, false);
+				for (size_t t = 0; t < numTriangles; t++)
+				{
+						triangleScores[t] = vertexScores[_indices[t * 3]] + vertexScores[_indices[t * 3 + 1]] + vertexScores[_indices[t * 3 + 2]];
+				}
+
+				std::vector<unsigned int> output(numTriangles * 3);
+				std::vector<unsigned int> cache;
+				std::vector<unsigned int> newCache;
+				cache.reserve(FORSYTH_CACHE_SIZE + 3);
+				newCache.reserve(FORSYTH_CACHE_SIZE + 3);
+
+				size_t cursor{ 0 };
+				long long bestTriangle{ -1 };
+
+				for (size_t out = 0; out < numTriangles; out++)
+				{
+						if (bestTriangle < 0)
+						{
+								//nothing in the cache to continue from, take the next unused triangle
+								while (emitted[cursor])
+								{
+										cursor++;
+								}
+								bestTriangle = static_cast<long long>(cursor);
+						}
+
+						const size_t triangle = static_cast<size_t>(bestTriangle);
+						const unsigned int* vertices = _indices + triangle * 3;
+
+						output[out * 3] = vertices[0];
+						output[out * 3 + 1] = vertices[1];
+						output[out * 3 + 2] = vertices[2];
+						emitted[triangle] = true;
+
+						//remove the triangle from the active triangles of its vertices
+						for (size_t k = 0; k < 3; k++)
+						{
+								unsigned int vertex = vertices[k];
+								unsigned int* begin = adjacency.data() + offsets[vertex];
+								unsigned int* end = begin + remaining[vertex];
+								unsigned int* found = std::find(begin, end, static_cast<unsigned int>(triangle));
+								if (found != end)
+								{
+										*found = *(end - 1);
+										remaining[vertex]--;
+								}
+						}
+
+						//the triangle's vertices move to the front of the lru cache
+						newCache.clear();
+						newCache.push_back(vertices[0]);
+						newCache.push_back(vertices[1]);
+						newCache.push_back(vertices[2]);
+						for (unsigned int vertex : cache)
+						{
+								if (vertex != vertices[0] && vertex != vertices[1] && vertex != vertices[2])
+								{
+										newCache.push_back(vertex);
+								}
+						}
+
+						//update the scores of everything in the cache, including what just fell out of it
+						for (size_t i = 0; i < newCache.size(); i++)
+						{
+								unsigned int vertex = newCache[i];
+								cachePositions[vertex] = i < FORSYTH_CACHE_SIZE ? static_cast<int>(i) : -1;
+								vertexScores[vertex] = forsythVertexScore(cachePositions[vertex], remaining[vertex]);
+						}
+
+						//the best next triangle is one of the triangles of the cached vertices
+						bestTriangle = -1;
+						float bestScore{ -1.0f };
+						for (unsigned int vertex : newCache)
+						{
+								const unsigned int* begin = adjacency.data() + offsets[vertex];
+								for (unsigned int i = 0; i < remaining[vertex]; i++)
+								{
+										unsigned int t = begin[i];
+										float score = vertexScores[_indices[t * 3]] + vertexScores[_indices[t * 3 + 1]] + vertexScores[_indices[t * 3 + 2]];
+										triangleScores[t] = score;
+
+										if (score > bestScore)
+										{
+												bestScore = score;
+												bestTriangle = t;
+										}
+								}
+						}
+
+						if (newCache.size() > FORSYTH_CACHE_SIZE)
+						{
+								newCache.resize(FORSYTH_CACHE_SIZE);
+						}
+						cache.swap(newCache);
+				}
+
+				std::copy(output.begin(), output.end(), _indices);
+		}
+
+		void optimizeOverdraw(unsigned int* _indices, size_t _numIndices, const glm::vec3* _positions, size_t _numVertices, float _threshold)
+		{
+				const size_t numTriangles = _numIndices / 3;
+				if (numTriangles < 2 || !indicesInRange(_indices, _numIndices, _numVertices))
+				{
+						return;
+				}
+
+				const unsigned int cacheSize{ 16 };
+
+				//split into clusters where all three vertices of a triangle miss the cache, reordering there costs nothing
+				std::vector<size_t> clusterStarts;
+				std::vector<unsigned int> cacheTimestamps(_numVertices, 0);
+				unsigned int timestamp{ cacheSize + 1 };
+
+				for (size_t t = 0; t < numTriangles; t++)
+				{
+						int misses{ 0 };
+						for (size_t k = 0; k < 3; k++)
+						{
+								unsigned int index = _indices[t * 3 + k];
+								if (timestamp - cacheTimestamps[index] > cacheSize)
+								{
+										cacheTimestamps[index] = timestamp++;
+										misses++;
+								}
+						}
+
+						if (t == 0 || misses == 3)
+						{
+								clusterStarts.push_back(t);
+						}
+				}
+
+				if (clusterStarts.size() < 2)
+				{
+						return;
+				}
+
+				//area weighted centroid and normal of every cluster and of the whole mesh
+				struct Cluster
+				{
+						size_t start;
+						size_t count;
+						float sortKey;
+				};
+				std::vector<Cluster> clusters(clusterStarts.size());
+				std::vector<glm::vec3> centroids(clusters.size());
+				std::vector<glm::vec3> normals(clusters.size());
+
+				glm::vec3 meshCentroid(0.0f);
+				float meshArea{ 0.0f };
+
+				for (size_t c = 0; c < clusters.size(); c++)
+				{
+						clusters[c].start = clusterStarts[c];
+						clusters[c].count = (c + 1 < clusterStarts.size() ? clusterStarts[c + 1] : numTriangles) - clusterStarts[c];
+
+						glm::vec3 centroid(0.0f);
+						glm::vec3 normal(0.0f);
+						float area{ 0.0f };
+
+						for (size_t t = clusters[c].start; t < clusters[c].start + clusters[c].count; t++)
+						{
+								const glm::vec3& a = _positions[_indices[t * 3]];
+								const glm::vec3& b = _positions[_indices[t * 3 + 1]];
+								const glm::vec3& d = _positions[_indices[t * 3 + 2]];
+
+								glm::vec3 faceNormal = glm::cross(b - a, d - a);
+								float faceArea = glm::length(faceNormal);
+
+								centroid += (a + b + d) * (faceArea / 3.0f);
+								normal += faceNormal;
+								area += faceArea;
+						}
+
+						meshCentroid += centroid;
+						meshArea += area;
+
+						centroids[c] = area > 0.0f ? centroid / area : centroid;
+						normals[c] = normal;
+				}
+
+				if (meshArea > 0.0f)
+				{
+						meshCentroid /= meshArea;
+				}
+
+				//clusters facing away from the center are likely to occlude the others, draw them first
+				for (size_t c = 0; c < clusters.size(); c++)
+				{
+						float normalLength = glm::length(normals[c]);
+						clusters[c].sortKey = normalLength > 0.0f ? glm::dot(centroids[c] - meshCentroid, normals[c] / normalLength) : 0.0f;
+				}
+
+				std::stable_sort(clusters.begin(), clusters.end(), [](const Cluster& _a, const Cluster& _b) { return _a.sortKey > _b.sortKey; });
+
+				std::vector<unsigned int> output;
+				output.reserve(numTriangles * 3);
+				for (const Cluster& cluster : clusters)
+				{
+						output.insert(output.end(), _indices + cluster.start * 3, _indices + (cluster.start + cluster.count) * 3);
+				}
+
+				//only keep the new order if it doesn't cost too much vertex cache efficiency
+				float inputACMR = analyzeVertexCache(_indices, numTriangles * 3, _numVertices, cacheSize).acmr;
+				float outputACMR = analyzeVertexCache(output.data(), output.size(), _numVertices, cacheSize).acmr;
+
+				if (outputACMR <= inputACMR * _threshold)
+				{
+						std::copy(output.begin(), output.end(), _indices);
+				}
+		}
+
+		MeshOptimizationReport optimizeMesh(const std::vector<SubMesh>& _subMeshes,
+				std::vector<glm::vec3>& _positions,
+				std::vector<glm::vec2>& _uvs,
+				std::vector<glm::vec3>& _normals,
+				std::vector<glm::vec3>& _tangents,
+				std::vector<unsigned int>& _indices)
+		{
+				MeshOptimizationReport report;
+
+				size_t totalTriangles{ 0 };
+				size_t totalVertices{ 0 };
+				float missesBefore{ 0.0f }, missesAfter{ 0.0f };
+
+				for (size_t i = 0; i < _subMeshes.size(); i++)
+				{
+						const SubMesh& subMesh = _subMeshes[i];
+
+						//the vertices of a submesh end where the next submesh's begin
+						size_t vertexEnd = _positions.size();
+						for (const SubMesh& other : _subMeshes)
+						{
+								if (other.m_baseVertex > subMesh.m_baseVertex && other.m_baseVertex < vertexEnd)
+								{
+										vertexEnd = other.m_baseVertex;
+								}
+						}
+						const size_t numVertices = vertexEnd - subMesh.m_baseVertex;
+
+						unsigned int* indices = _indices.data() + subMesh.m_baseIndex;
+						const size_t numIndices = subMesh.m_numIndices;
+						const size_t numTriangles = numIndices / 3;
+
+						if (numTriangles == 0 || !indicesInRange(indices, numIndices, numVertices))
+						{
+								continue;
+						}
+
+						VertexCacheStats before = analyzeVertexCache(indices, numIndices, numVertices);
+
+						optimizeVertexCache(indices, numIndices, numVertices);
+						optimizeOverdraw(indices, numIndices, _positions.data() + subMesh.m_baseVertex, numVertices);
+
+						//renumber the vertices in order of first use, unused ones go to the end
+						std::vector<unsigned int> remap(numVertices, ~0u);
+						unsigned int next{ 0 };
+						for (size_t j = 0; j < numIndices; j++)
+						{
+								if (remap[indices[j]] == ~0u)
+								{
+										remap[indices[j]] = next++;
+								}
+								indices[j] = remap[indices[j]];
+						}
+						for (size_t j = 0; j < numVertices; j++)
+						{
+								if (remap[j] == ~0u)
+								{
+										remap[j] = next++;
+								}
+						}
+
+						auto permute = [&](auto& _attribute)
+						{
+								if (_attribute.size() != _positions.size())
+								{
+										return;
+								}
+								auto begin = _attribute.begin() + subMesh.m_baseVertex;
+								std::vector<typename std::decay<decltype(_attribute)>::type::value_type> reordered(numVertices);
+								for (size_t j = 0; j < numVertices; j++)
+								{
+										reordered[remap[j]] = begin[j];
+								}
+								std::copy(reordered.begin(), reordered.end(), begin);
+						};
+						permute(_uvs);
+						permute(_normals);
+						permute(_tangents);
+						permute(_positions);
+
+						VertexCacheStats after = analyzeVertexCache(indices, numIndices, numVertices);
+
+						missesBefore += before.acmr * numTriangles;
+						missesAfter += after.acmr * numTriangles;
+						totalTriangles += numTriangles;
+						totalVertices += numVertices;
+				}
+
+				if (totalTriangles > 0)
+				{
+						report.before.acmr = missesBefore / totalTriangles;
+						report.after.acmr = missesAfter / totalTriangles;
+				}
+				if (totalVertices > 0)
+				{
+						report.before.atvr = missesBefore / totalVertices;
+						report.after.atvr = missesAfter / totalVertices;
+				}
+				return report;
+		}
+}
@@ -0,0 +1,60 @@
+#ifndef MESH_OPTIMIZER_H
+#define MESH_OPTIMIZER_H
+
+#include "Mesh.h"
+
+namespace cogs
+{
+		/**
+		* \brief Efficiency of an index buffer on a simulated FIFO post-transform vertex cache
+		*/
+		struct VertexCacheStats
+		{
+				float acmr{ 0.0f };	///< average cache miss ratio, transformed vertices per triangle (0.5 - 3, lower is better)
+				float atvr{ 0.0f };	///< average transformed vertex ratio, transformed vertices per unique vertex (1 is optimal)
+		};
+
+		/**
+		* \brief Cache efficiency of a mesh before and after optimizing it
+		*/
+		struct MeshOptimizationReport
+		{
+				VertexCacheStats before;
+				VertexCacheStats after;
+		};
+
+		/**
+		* \brief Simulates a FIFO vertex cache over a triangle list
+		* \param _indices - the triangle list
+		* \param _numIndices - the number of indices
+		* \param _numVertices - the number of vertices the indices refer to
+		* \param _cacheSize - the size of the simulated cache
+		*/
+		extern VertexCacheStats analyzeVertexCache(const unsigned int* _indices, size_t _numIndices, size_t _numVertices, unsigned int _cacheSize = 16);
+
+		/**
+		* \brief Reorders the triangles for the post-transform vertex cache (Tom Forsyth's linear-speed algorithm)
+		*/
+		extern void optimizeVertexCache(unsigned int* _indices, size_t _numIndices, size_t _numVertices);
+
+		/**
+		* \brief Reorders clusters of cache-optimized triangles so the outward facing ones are drawn first, to reduce overdraw.
+		* Clusters are split where the cache gets flushed anyway, the new order is only kept if the
+		* cache miss ratio stays below _threshold times the one of the input
+		*/
+		extern void optimizeOverdraw(unsigned int* _indices, size_t _numIndices, const glm::vec3* _positions, size_t _numVertices, float _threshold = 1.05f);
+
+		/**
+		* \brief Optimizes all submeshes of a loaded mesh: triangles for the vertex cache, then for overdraw,
+		* then the vertices in order of first use for fetch locality. Indices stay relative to the submesh base vertex
+		* \return the cache efficiency before and after, summed over all submeshes
+		*/
+		extern MeshOptimizationReport optimizeMesh(const std::vector<SubMesh>& _subMeshes,
+				std::vector<glm::vec3>& _positions,
+				std::vector<glm::vec2>& _uvs,
+				std::vector<glm::vec3>& _normals,
+				std::vector<glm::vec3>& _tangents,
+				std::vector<unsigned int>& _indices);
+}
+
+#endif // !MESH_OPTIMIZER_H
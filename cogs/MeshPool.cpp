@@ -0,0 +1,415 @@
+#include "MeshPool.h"
+#include "RenderBackend.h"
+#include "Window.h"
+
+#include <GL\glew.h>
+#include <glm\mat4x4.hpp>
+#include <algorithm>
+#include <stdexcept>
+#include <cassert>
+
+namespace cogs
+{
+		void RangeAllocator::reset(uint _capacity, uint _used)
+		{
+				m_capacity = _capacity;
+				m_used = _used;
+				m_freeRanges.clear();
+
+				if (_capacity > _used)
+				{
+						m_freeRanges.push_back(Range{ _used, _capacity - _used });
+				}
+		}
+
+		bool RangeAllocator::allocate(uint _size, uint& _offset)
+		{
+				for (size_t i = 0; i < m_freeRanges.size(); i++)
+				{
+						Range& range = m_freeRanges[i];
+						if (range.size >= _size)
+						{
+								_offset = range.offset;
+								range.offset += _size;
+								range.size -= _size;
+
+								if (range.size == 0)
+								{
+										m_freeRanges.erase(m_freeRanges.begin() + i);
+								}
+								m_used += _size;
+								return true;
+						}
+				}
+				return false;
+		}
+
+		void RangeAllocator::free(uint _offset, uint _size)
+		{
+				if (_size == 0)
+				{
+						return;
+				}
+
+				auto iter = std::lower_bound(m_freeRanges.begin(), m_freeRanges.end(), _offset,
+						[](const Range& _range, uint _offset) { return _range.offset < _offset; });
+
+				iter = m_freeRanges.insert(iter, Range{ _offset, _size });
+
+				//merge with the next free range
+				auto next = iter + 1;
+				if (next != m_freeRanges.end() && iter->offset + iter->size == next->offset)
+				{
+						iter->size += next->size;
+						iter = m_freeRanges.erase(next) - 1;
+				}
+
+				//merge with the previous free range
+				if (iter != m_freeRanges.begin())
+				{
+						auto prev = iter - 1;
+						if (prev->offset + prev->size == iter->offset)
+						{
+								prev->size += iter->size;
+								m_freeRanges.erase(iter);
+						}
+				}
+
+				m_used -= _size;
+		}
+
+		namespace
+		{
+				//attribute locations matching Mesh::BufferObject and the 3D shaders
+				const uint WORLDMAT_LOCATION = 4;
+		}
+
+		uint MeshPool::s_VAO = 0;
+		uint MeshPool::s_buffers[NUM_BUFFERS] = { 0 };
+		uint MeshPool::s_identityInstance = 0;
+		VertexLayout MeshPool::s_layout;
+		RangeAllocator MeshPool::s_vertices;
+		RangeAllocator MeshPool::s_indices;
+		std::vector<MeshPool::Allocation> MeshPool::s_allocations;
+		std::vector<MeshPool::Handle> MeshPool::s_freeHandles;
+		uint MeshPool::s_initialVertices = 1 << 18;
+		uint MeshPool::s_initialIndices = 1 << 20;
+		uint MeshPool::s_numCompactions = 0;
+
+		void MeshPool::reserve(uint _numVertices, uint _numIndices)
+		{
+				s_initialVertices = _numVertices;
+				s_initialIndices = _numIndices;
+		}
+
+		void MeshPool::setLayout(const VertexLayout& _layout)
+		{
+				if (_layout == s_layout)
+				{
+						return;
+				}
+
+				if (s_vertices.getUsed() > 0)
+				{
+						throw std::runtime_error("The vertex layout cannot change while the mesh pool holds meshes");
+				}
+
+				//the buffers get recreated with the new stride on the next allocation
+				dispose();
+				s_layout = _layout;
+		}
+
+		MeshPool::Handle MeshPool::allocate(const void* _vertices, uint _numVertices, const unsigned int* _indices, uint _numIndices)
+		{
+				//the upload (and a compaction) runs right away, load meshes before the render thread takes the context
+				assert(RenderBackend::isNull() || Window::isContextCurrent());
+
+				if (s_allocations.empty())
+				{
+						init();
+				}
+
+				Allocation allocation;
+				allocation.numVertices = _numVertices;
+				allocation.numIndices = _numIndices;
+				allocation.alive = true;
+
+				if (!s_vertices.allocate(allocation.numVertices, allocation.vertexOffset))
+				{
+						//compact if there's enough space in total, otherwise grow as well
+						uint capacity = s_vertices.getCapacity();
+						if (s_vertices.getFree() < allocation.numVertices)
+						{
+								capacity = std::max(capacity * 2, s_vertices.getUsed() + allocation.numVertices);
+						}
+						repackVertices(capacity);
+						s_vertices.allocate(allocation.numVertices, allocation.vertexOffset);
+				}
+
+				if (!s_indices.allocate(allocation.numIndices, allocation.indexOffset))
+				{
+						uint capacity = s_indices.getCapacity();
+						if (s_indices.getFree() < allocation.numIndices)
+						{
+								capacity = std::max(capacity * 2, s_indices.getUsed() + allocation.numIndices);
+						}
+						repackIndices(capacity);
+						s_indices.allocate(allocation.numIndices, allocation.indexOffset);
+				}
+
+				Handle handle;
+				if (!s_freeHandles.empty())
+				{
+						handle = s_freeHandles.back();
+						s_freeHandles.pop_back();
+						s_allocations[handle] = allocation;
+				}
+				else
+				{
+						handle = static_cast<Handle>(s_allocations.size());
+						s_allocations.push_back(allocation);
+				}
+
+				if (RenderBackend::isNull())
+				{
+						return handle;
+				}
+
+				//upload through the copy target so the element array binding of whatever vao is bound stays untouched
+				const uint vertexStride = s_layout.getStride();
+				if (allocation.numVertices > 0)
+				{
+						glBindBuffer(GL_COPY_WRITE_BUFFER, s_buffers[VERTEX]);
+						glBufferSubData(GL_COPY_WRITE_BUFFER, allocation.vertexOffset * vertexStride, allocation.numVertices * vertexStride, _vertices);
+				}
+				if (allocation.numIndices > 0)
+				{
+						glBindBuffer(GL_COPY_WRITE_BUFFER, s_buffers[INDEX]);
+						glBufferSubData(GL_COPY_WRITE_BUFFER, allocation.indexOffset * sizeof(unsigned int), allocation.numIndices * sizeof(unsigned int), _indices);
+				}
+				glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+				return handle;
+		}
+
+		void MeshPool::free(Handle _handle)
+		{
+				//the pool may have been disposed already
+				if (_handle == INVALID_HANDLE || _handle >= s_allocations.size() || !s_allocations[_handle].alive)
+				{
+						return;
+				}
+
+				Allocation& allocation = s_allocations[_handle];
+				s_vertices.free(allocation.vertexOffset, allocation.numVertices);
+				s_indices.free(allocation.indexOffset, allocation.numIndices);
+				allocation.alive = false;
+
+				s_freeHandles.push_back(_handle);
+		}
+
+		void MeshPool::compact()
+		{
+				assert(RenderBackend::isNull() || Window::isContextCurrent());
+
+				if (s_allocations.empty())
+				{
+						return;
+				}
+
+				if (s_vertices.getNumFreeRanges() > 1)
+				{
+						repackVertices(s_vertices.getCapacity());
+				}
+				if (s_indices.getNumFreeRanges() > 1)
+				{
+						repackIndices(s_indices.getCapacity());
+				}
+		}
+
+		void MeshPool::dispose()
+		{
+				if (!RenderBackend::isNull() && s_VAO != 0)
+				{
+						glDeleteVertexArrays(1, &s_VAO);
+						glDeleteBuffers(NUM_BUFFERS, s_buffers);
+						glDeleteBuffers(1, &s_identityInstance);
+				}
+
+				s_VAO = 0;
+				for (int i = 0; i < NUM_BUFFERS; i++)
+				{
+						s_buffers[i] = 0;
+				}
+				s_identityInstance = 0;
+
+				s_vertices.reset(0);
+				s_indices.reset(0);
+				s_allocations.clear();
+				s_freeHandles.clear();
+		}
+
+		void MeshPool::init()
+		{
+				//slot 0 is the invalid handle
+				s_allocations.push_back(Allocation());
+
+				s_vertices.reset(s_initialVertices);
+				s_indices.reset(s_initialIndices);
+
+				if (RenderBackend::isNull())
+				{
+						s_VAO = RenderBackend::generateNullHandle();
+						RenderBackend::generateNullHandles(NUM_BUFFERS, s_buffers);
+						s_identityInstance = RenderBackend::generateNullHandle();
+						return;
+				}
+
+				glGenVertexArrays(1, &s_VAO);
+				glGenBuffers(NUM_BUFFERS, s_buffers);
+
+				glBindBuffer(GL_COPY_WRITE_BUFFER, s_buffers[VERTEX]);
+				glBufferData(GL_COPY_WRITE_BUFFER, s_vertices.getCapacity() * s_layout.getStride(), nullptr, GL_STATIC_DRAW);
+				glBindBuffer(GL_COPY_WRITE_BUFFER, s_buffers[INDEX]);
+				glBufferData(GL_COPY_WRITE_BUFFER, s_indices.getCapacity() * sizeof(unsigned int), nullptr, GL_STATIC_DRAW);
+
+				//meshes drawn without the 3D renderer still need something in the instance attribute
+				glm::mat4 identity(1.0f);
+				glGenBuffers(1, &s_identityInstance);
+				glBindBuffer(GL_COPY_WRITE_BUFFER, s_identityInstance);
+				glBufferData(GL_COPY_WRITE_BUFFER, sizeof(identity), &identity[0][0], GL_STATIC_DRAW);
+				glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+				setupVAO();
+		}
+
+		void MeshPool::repackVertices(uint _capacity)
+		{
+				s_numCompactions++;
+
+				//live allocations in the order they are laid out, so ranges only ever move towards the start
+				std::vector<Allocation*> live;
+				for (Allocation& allocation : s_allocations)
+				{
+						if (allocation.alive && allocation.numVertices > 0)
+						{
+								live.push_back(&allocation);
+						}
+				}
+				std::sort(live.begin(), live.end(), [](const Allocation* _a, const Allocation* _b) { return _a->vertexOffset < _b->vertexOffset; });
+
+				if (!RenderBackend::isNull())
+				{
+						const uint stride = s_layout.getStride();
+
+						uint newBuffer{ 0 };
+						glGenBuffers(1, &newBuffer);
+						glBindBuffer(GL_COPY_WRITE_BUFFER, newBuffer);
+						glBufferData(GL_COPY_WRITE_BUFFER, _capacity * stride, nullptr, GL_STATIC_DRAW);
+						glBindBuffer(GL_COPY_READ_BUFFER, s_buffers[VERTEX]);
+
+						uint offset{ 0 };
+						for (const Allocation* allocation : live)
+						{
+								glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+										allocation->vertexOffset * stride, offset * stride, allocation->numVertices * stride);
+								offset += allocation->numVertices;
+						}
+
+						glDeleteBuffers(1, &s_buffers[VERTEX]);
+						s_buffers[VERTEX] = newBuffer;
+
+						glBindBuffer(GL_COPY_READ_BUFFER, 0);
+						glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+				}
+
+				uint offset{ 0 };
+				for (Allocation* allocation : live)
+				{
+						allocation->vertexOffset = offset;
+						offset += allocation->numVertices;
+				}
+				s_vertices.reset(_capacity, offset);
+
+				if (!RenderBackend::isNull())
+				{
+						setupVAO();
+				}
+		}
+
+		void MeshPool::repackIndices(uint _capacity)
+		{
+				s_numCompactions++;
+
+				std::vector<Allocation*> live;
+				for (Allocation& allocation : s_allocations)
+				{
+						if (allocation.alive && allocation.numIndices > 0)
+						{
+								live.push_back(&allocation);
+						}
+				}
+				std::sort(live.begin(), live.end(), [](const Allocation* _a, const Allocation* _b) { return _a->indexOffset < _b->indexOffset; });
+
+				if (!RenderBackend::isNull())
+				{
+						uint newBuffer{ 0 };
+						glGenBuffers(1, &newBuffer);
+						glBindBuffer(GL_COPY_WRITE_BUFFER, newBuffer);
+						glBufferData(GL_COPY_WRITE_BUFFER, _capacity * sizeof(unsigned int), nullptr, GL_STATIC_DRAW);
+						glBindBuffer(GL_COPY_READ_BUFFER, s_buffers[INDEX]);
+
+						uint offset{ 0 };
+						for (const Allocation* allocation : live)
+						{
+								glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+										allocation->indexOffset * sizeof(unsigned int), offset * sizeof(unsigned int), allocation->numIndices * sizeof(unsigned int));
+								offset += allocation->numIndices;
+						}
+
+						glDeleteBuffers(1, &s_buffers[INDEX]);
+						s_buffers[INDEX] = newBuffer;
+
+						glBindBuffer(GL_COPY_READ_BUFFER, 0);
+						glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+				}
+
+				//the indices are relative to the base vertex, so they don't need to change
+				uint offset{ 0 };
+				for (Allocation* allocation : live)
+				{
+						allocation->indexOffset = offset;
+						offset += allocation->numIndices;
+				}
+				s_indices.reset(_capacity, offset);
+
+				if (!RenderBackend::isNull())
+				{
+						setupVAO();
+				}
+		}
+
+		void MeshPool::setupVAO()
+		{
+				glBindVertexArray(s_VAO);
+
+				//position, texcoord, normal and tangent interleaved in one buffer
+				glBindBuffer(GL_ARRAY_BUFFER, s_buffers[VERTEX]);
+				s_layout.setupAttributes();
+
+				glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, s_buffers[INDEX]);
+
+				//per-instance world matrix, the renderers point it at their instance buffers before drawing
+				glBindBuffer(GL_ARRAY_BUFFER, s_identityInstance);
+				for (uint i = 0; i < 4; i++)
+				{
+						glEnableVertexAttribArray(WORLDMAT_LOCATION + i);
+						glVertexAttribPointer(WORLDMAT_LOCATION + i, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4),
+								(const void*)(sizeof(float) * i * 4));
+						glVertexAttribDivisor(WORLDMAT_LOCATION + i, 1);
+				}
+
+				glBindVertexArray(0);
+				glBindBuffer(GL_ARRAY_BUFFER, 0);
+		}
+}
@@ -0,0 +1,162 @@
+#ifndef MESH_POOL_H
+#define MESH_POOL_H
+
+#include "VertexLayout.h"
+
+#include <vector>
+
+namespace cogs
+{
+		using uint = unsigned int;
+
+		/**
+		* \brief Offset based allocator of ranges in a linear address space (vertices, indices).
+		* Free ranges are kept sorted by offset and merged with their neighbours when released
+		*/
+		class RangeAllocator
+		{
+		public:
+				struct Range
+				{
+						uint offset{ 0 };
+						uint size{ 0 };
+				};
+
+				/**
+				* \brief Resets the allocator to a single free range of _capacity elements after the first _used ones
+				*/
+				void reset(uint _capacity, uint _used = 0);
+
+				/**
+				* \brief First-fit allocation
+				* \return true if a free range was big enough, the offset is written to _offset
+				*/
+				bool allocate(uint _size, uint& _offset);
+
+				/**
+				* \brief Releases a range, merging it with the adjacent free ranges
+				*/
+				void free(uint _offset, uint _size);
+
+				/**
+				* \brief getters
+				*/
+				uint getCapacity() const noexcept { return m_capacity; }
+				uint getUsed() const noexcept { return m_used; }
+				uint getFree() const noexcept { return m_capacity - m_used; }
+				size_t getNumFreeRanges() const noexcept { return m_freeRanges.size(); }
+
+		private:
+				std::vector<Range> m_freeRanges; ///< the free ranges sorted by offset
+				uint m_capacity{ 0 }; ///< total number of elements
+				uint m_used{ 0 }; ///< number of allocated elements
+		};
+
+		/**
+		* \brief Global pool of mesh geometry.
+		* The interleaved vertices and the indices of every mesh live in large shared buffers, sub-allocated by offset,
+		* so all meshes are drawn from one vao with a base vertex and a first index.
+		* When a range doesn't fit anywhere the pool is compacted, moving the live ranges together on the GPU,
+		* and grown if that isn't enough. Ranges are referred to by handles since compaction moves them.
+		* Allocating and compacting upload and copy on the GPU right away, so meshes are created at load time on the thread owning the GL context,
+		* before a RenderThread is started or from a commands::Callback while it runs (debug builds assert it). Freeing only touches the allocators
+		*/
+		class MeshPool
+		{
+		public:
+				using Handle = uint;
+				static const Handle INVALID_HANDLE = 0;
+
+				/**
+				* \brief Sets the initial capacity, must be called before the first allocation to have an effect
+				*/
+				static void reserve(uint _numVertices, uint _numIndices);
+
+				/**
+				* \brief Sets the layout of the vertices, throws if the pool already holds meshes
+				*/
+				static void setLayout(const VertexLayout& _layout);
+				static const VertexLayout& getLayout() noexcept { return s_layout; }
+
+				/**
+				* \brief Allocates space for a mesh and uploads its vertex and index data, on the thread owning the GL context
+				* \param[in] _vertices - the vertices encoded with the layout of the pool
+				* \return the handle of the allocation
+				*/
+				static Handle allocate(const void* _vertices, uint _numVertices, const unsigned int* _indices, uint _numIndices);
+				static Handle allocate(const void* _vertices, uint _numVertices, const std::vector<unsigned int>& _indices)
+				{
+						return allocate(_vertices, _numVertices, _indices.data(), static_cast<uint>(_indices.size()));
+				}
+
+				/**
+				* \brief Releases the ranges of a mesh
+				*/
+				static void free(Handle _handle);
+
+				/**
+				* \brief Moves all live ranges together, leaving a single free range at the end of the buffers, on the thread owning the GL context
+				*/
+				static void compact();
+
+				/**
+				* \brief Deletes the shared buffers and the vao, all handles become invalid
+				*/
+				static void dispose();
+
+				/**
+				* \brief The offsets of an allocation, which change when the pool gets compacted
+				*/
+				static uint getBaseVertex(Handle _handle) { return s_allocations[_handle].vertexOffset; }
+				static uint getBaseIndex(Handle _handle) { return s_allocations[_handle].indexOffset; }
+
+				/**
+				* \brief The vao every pooled mesh is drawn with
+				*/
+				static uint getVAO() noexcept { return s_VAO; }
+
+				/**
+				* \brief stats
+				*/
+				static const RangeAllocator& getVertexAllocator() noexcept { return s_vertices; }
+				static const RangeAllocator& getIndexAllocator() noexcept { return s_indices; }
+				static uint getNumCompactions() noexcept { return s_numCompactions; }
+
+		private:
+				struct Allocation
+				{
+						uint vertexOffset{ 0 };
+						uint numVertices{ 0 };
+						uint indexOffset{ 0 };
+						uint numIndices{ 0 };
+						bool alive{ false };
+				};
+
+				enum Buffer
+				{
+						VERTEX,
+						INDEX,
+
+						NUM_BUFFERS
+				};
+
+				static void init();
+				static void repackVertices(uint _capacity);
+				static void repackIndices(uint _capacity);
+				static void setupVAO();
+
+				static uint s_VAO; ///< the shared vao
+				static uint s_buffers[NUM_BUFFERS]; ///< the shared vertex and index buffers
+				static uint s_identityInstance; ///< a single identity matrix for meshes drawn without instance data
+				static VertexLayout s_layout; ///< layout of the vertices
+				static RangeAllocator s_vertices; ///< allocator of the vertex buffers, in vertices
+				static RangeAllocator s_indices; ///< allocator of the index buffer, in indices
+				static std::vector<Allocation> s_allocations; ///< allocations by handle, slot 0 is the invalid handle
+				static std::vector<Handle> s_freeHandles; ///< handles of released allocations to reuse
+				static uint s_initialVertices; ///< capacity of the vertex buffers when the pool is created
+				static uint s_initialIndices; ///< capacity of the index buffer when the pool is created
+				static uint s_numCompactions; ///< number of times the pool had to be compacted
+		};
+}
+
+#endif // !MESH_POOL_H
@@ -18,6 +18,14 @@ namespace cogs
 
 		MeshRenderer::~MeshRenderer()
 		{
+				leaveSceneTree();
+				leaveStaticBatches();
+
+				//the address may be reused by another mesh renderer
+				if (!m_renderer.expired())
+				{
+						m_renderer.lock()->forgetVisibility(this);
+				}
 		}
 		void MeshRenderer::init()
 		{
@@ -27,6 +35,115 @@ namespace cogs
 		}
 		void MeshRenderer::render()
 		{
-				m_renderer.lock()->submit(m_entity);
+				std::shared_ptr<Renderer3D> renderer = m_renderer.lock();
+
+				//static entities are drawn from the batches of the renderer, the per instance overrides keep an entity out of them
+				const bool staticBatched = m_static && !m_hasMaterialParams && renderer->usesStaticBatching();
+				if (!staticBatched)
+				{
+						leaveStaticBatches();
+				}
+				else
+				{
+						if (m_staticInstance == -1)
+						{
+								leaveSceneTree();
+
+								m_staticInstance = renderer->addToStaticBatches(m_entity);
+								m_staticRenderer = m_renderer;
+								m_listenedTransform = m_entity.lock()->getComponent<Transform>();
+								m_staticListener = m_listenedTransform.lock()->addListener([this]()
+								{
+										if (!m_staticRenderer.expired())
+										{
+												m_staticRenderer.lock()->moveInStaticBatches(m_staticInstance);
+										}
+								});
+						}
+						return;
+				}
+
+				if (renderer->usesSceneTree())
+				{
+						//once in the tree, the renderer submits the entity itself while it's visible
+						if (m_sceneProxy == AABBTree::NULL_NODE)
+						{
+								m_sceneProxy = renderer->addToSceneTree(m_entity);
+								m_sceneRenderer = m_renderer;
+								m_listenedTransform = m_entity.lock()->getComponent<Transform>();
+								m_transformListener = m_listenedTransform.lock()->addListener([this]()
+								{
+										if (!m_sceneRenderer.expired())
+										{
+												m_sceneRenderer.lock()->moveInSceneTree(m_sceneProxy);
+										}
+								});
+						}
+						return;
+				}
+
+				renderer->submit(m_entity);
+		}
+
+		void MeshRenderer::setRenderer(std::weak_ptr<Renderer3D> _renderer)
+		{
+				leaveSceneTree();
+				leaveStaticBatches();
+				if (!m_renderer.expired())
+				{
+						m_renderer.lock()->forgetVisibility(this);
+				}
+				m_renderer = _renderer;
+		}
+
+		void MeshRenderer::leaveSceneTree()
+		{
+				if (m_sceneProxy == AABBTree::NULL_NODE)
+				{
+						return;
+				}
+
+				if (!m_listenedTransform.expired())
+				{
+						m_listenedTransform.lock()->removeListener(m_transformListener);
+				}
+				if (!m_sceneRenderer.expired())
+				{
+						m_sceneRenderer.lock()->removeFromSceneTree(m_sceneProxy);
+				}
+				m_sceneProxy = AABBTree::NULL_NODE;
+		}
+
+		void MeshRenderer::leaveStaticBatches()
+		{
+				if (m_staticInstance == -1)
+				{
+						return;
+				}
+
+				if (!m_listenedTransform.expired())
+				{
+						m_listenedTransform.lock()->removeListener(m_staticListener);
+				}
+				if (!m_staticRenderer.expired())
+				{
+						m_staticRenderer.lock()->removeFromStaticBatches(m_staticInstance);
+				}
+				m_staticInstance = -1;
+		}
+
+		void MeshRenderer::setMesh(std::weak_ptr<Mesh> _mesh)
+		{
+				m_mesh = _mesh;
+
+				//the bounds in the scene tree belong to the old mesh
+				if (m_sceneProxy != AABBTree::NULL_NODE && !m_sceneRenderer.expired())
+				{
+						m_sceneRenderer.lock()->moveInSceneTree(m_sceneProxy);
+				}
+				if (m_staticInstance != -1 && !m_staticRenderer.expired())
+				{
+						m_staticRenderer.lock()->moveInStaticBatches(m_staticInstance);
+				}
 		}
 }
\ No newline at end of file
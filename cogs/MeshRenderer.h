@@ -2,12 +2,14 @@
 #define MESH_RENDERER_H
 
 #include "Component.h"
+#include "Material.h"
 
 namespace cogs
 {
 		class Mesh;
 		class Material;
 		class Renderer3D;
+		class Transform;
 		/**
 		* \brief This component, given to an entity should submit it to a 3D renderer
 		*/
@@ -47,14 +49,69 @@ namespace cogs
 				/**
 				* Setters
 				*/
-				void setMesh(std::weak_ptr<Mesh> _mesh) { m_mesh = _mesh; }
+				void setMesh(std::weak_ptr<Mesh> _mesh);
 				//void setMaterial(std::weak_ptr<Material> _material) { m_material = _material; }
-				void setRenderer(std::weak_ptr<Renderer3D> _renderer) { m_renderer = _renderer; }
+				void setRenderer(std::weak_ptr<Renderer3D> _renderer);
+
+				/**
+				* \brief the frustum plane which culled the entity last, the renderer tests it first
+				*/
+				unsigned int getCullingPlane()							const noexcept { return m_cullingPlane; }
+				void setCullingPlane(unsigned int _plane) noexcept { m_cullingPlane = _plane; }
+
+				/**
+				* \brief whether the entity hides the ones behind it when the renderer has an occlusion culler,
+				* meant for large, solid meshes like walls and terrain. Off by default
+				*/
+				bool isOccluder()										const noexcept { return m_occluder; }
+				void setOccluder(bool _occluder) noexcept { m_occluder = _occluder; }
+
+				/**
+				* \brief hints that the entity doesn't move, so the renderer may keep its frustum test between frames
+				* (see Renderer3D::setVisibilityCaching) or draw it from its static batches (see Renderer3D::setStaticBatching).
+				* Off by default, a static entity which moves anyway is just retested or rebatched
+				*/
+				bool isStatic()												const noexcept { return m_static; }
+				void setStatic(bool _static) noexcept { m_static = _static; }
+
+				/**
+				* \brief overrides the tint, emission and uv transform of the mesh's materials for this entity only.
+				* The entity still shares the instanced draws of its mesh, the shader reads the values per instance
+				*/
+				void setMaterialParams(const MaterialParams& _params) noexcept { m_materialParams = _params; m_hasMaterialParams = true; }
+				void clearMaterialParams() noexcept { m_hasMaterialParams = false; }
+				const MaterialParams& getMaterialParams()	const noexcept { return m_materialParams; }
+				bool hasMaterialParams()											const noexcept { return m_hasMaterialParams; }
+
+		private:
+				/**
+				* \brief removes the entity from the scene tree it's in, if any
+				*/
+				void leaveSceneTree();
+
+				/**
+				* \brief removes the entity from the static batches it's in, if any
+				*/
+				void leaveStaticBatches();
 
 		private:
 				std::weak_ptr<Mesh> m_mesh; ///< reference to the mesh rendererd
 				//std::weak_ptr<Material> m_material; ///< reference to the material the mesh is rendered with
 				std::weak_ptr<Renderer3D> m_renderer; ///< reference to the renderer the mesh is submitted to
+				unsigned int m_cullingPlane{ 0 }; ///< frustum plane coherency between frames
+				bool m_occluder{ false }; ///< whether the mesh is rasterized for the occlusion culling
+				bool m_static{ false }; ///< whether the visibility may be cached
+				MaterialParams m_materialParams; ///< the overrides of the materials
+				bool m_hasMaterialParams{ false };
+
+				int m_sceneProxy{ -1 }; ///< the proxy in the scene tree of the renderer, -1 if not in it
+				std::weak_ptr<Renderer3D> m_sceneRenderer; ///< the renderer whose scene tree the entity is in
+				std::weak_ptr<Transform> m_listenedTransform; ///< the transform reporting the movements to the scene tree or the static batches
+				unsigned int m_transformListener{ 0 };
+
+				int m_staticInstance{ -1 }; ///< the instance in the static batches of the renderer, -1 if not in them
+				std::weak_ptr<Renderer3D> m_staticRenderer; ///< the renderer whose static batches the entity is in
+				unsigned int m_staticListener{ 0 };
 		};
 }
 #endif // !MESH_RENDERER_H
@@ -0,0 +1,343 @@
+#include "MeshSimplifier.h"
+
+#include <glm\glm.hpp>
+#include <unordered_map>
+#include <unordered_set>
+#include <algorithm>
+#include <numeric>
+#include <cstring>
+#include <cmath>
+
+namespace cogs
+{
+		namespace
+		{
+				/**
+				* \brief sum of squared distances to a set of planes, weighted by the area of the triangles they came from
+				*/
+				struct Quadric
+				{
+						double a00{ 0.0 }, a01{ 0.0 }, a02{ 0.0 }, a11{ 0.0 }, a12{ 0.0 }, a22{ 0.0 };
+						double b0{ 0.0 }, b1{ 0.0 }, b2{ 0.0 };
+						double c{ 0.0 };
+						double weight{ 0.0 };
+
+						void addPlane(const glm::dvec3& _normal, double _distance, double _weight)
+						{
+								a00 += _weight * _normal.x * _normal.x;
+								a01 += _weight * _normal.x * _normal.y;
+								a02 += _weight * _normal.x * _normal.z;
+								a11 += _weight * _normal.y * _normal.y;
+								a12 += _weight * _normal.y * _normal.z;
+								a22 += _weight * _normal.z * _normal.z;
+								b0 += _weight * _normal.x * _distance;
+								b1 += _weight * _normal.y * _distance;
+								b2 += _weight * _normal.z * _distance;
+								c += _weight * _distance * _distance;
+								weight += _weight;
+						}
+
+						Quadric& operator+=(const Quadric& _other)
+						{
+								a00 += _other.a00; a01 += _other.a01; a02 += _other.a02;
+								a11 += _other.a11; a12 += _other.a12; a22 += _other.a22;
+								b0 += _other.b0; b1 += _other.b1; b2 += _other.b2;
+								c += _other.c;
+								weight += _other.weight;
+								return *this;
+						}
+
+						/**
+						* \brief the mean squared distance of the point to the planes
+						*/
+						double error(const glm::vec3& _point) const
+						{
+								if (weight <= 0.0)
+								{
+										return 0.0;
+								}
+
+								double x = _point.x, y = _point.y, z = _point.z;
+								double result = a00 * x * x + a11 * y * y + a22 * z * z
+										+ 2.0 * (a01 * x * y + a02 * x * z + a12 * y * z)
+										+ 2.0 * (b0 * x + b1 * y + b2 * z)
+										+ c;
+
+								return std::fabs(result) / weight;
+						}
+				};
+
+				struct PositionHash
+				{
+						size_t operator()(const glm::vec3& _position) const
+						{
+								unsigned int bits[3];
+								std::memcpy(bits, &_position[0], sizeof(bits));
+								return static_cast<size_t>(bits[0] * 73856093u ^ bits[1] * 19349663u ^ bits[2] * 83492791u);
+						}
+				};
+
+				unsigned long long edgeKey(unsigned int _from, unsigned int _to)
+				{
+						return (static_cast<unsigned long long>(_from) << 32) | _to;
+				}
+
+				struct Collapse
+				{
+						unsigned int from;
+						unsigned int to;
+						double cost;
+				};
+		}
+
+		float simplifyMesh(const unsigned int* _indices,
+				size_t _numIndices,
+				const glm::vec3* _positions,
+				size_t _numVertices,
+				size_t _targetIndexCount,
+				float _targetError,
+				std::vector<unsigned int>& _destination)
+		{
+				_destination.assign(_indices, _indices + (_numIndices / 3) * 3);
+
+				if (_destination.size() <= _targetIndexCount)
+				{
+						return 0.0f;
+				}
+
+				for (unsigned int index : _destination)
+				{
+						if (index >= _numVertices)
+						{
+								return 0.0f;
+						}
+				}
+
+				//vertices sharing a position are welded for finding borders and seams
+				std::vector<unsigned int> welded(_numVertices);
+				std::vector<unsigned int> weldCount(_numVertices, 0);
+				std::vector<bool> referenced(_numVertices, false);
+				{
+						for (unsigned int index : _destination)
+						{
+								referenced[index] = true;
+						}
+
+						std::unordered_map<glm::vec3, unsigned int, PositionHash> firstAtPosition;
+						for (unsigned int i = 0; i < _numVertices; i++)
+						{
+								welded[i] = firstAtPosition.insert(std::make_pair(_positions[i], i)).first->second;
+								if (referenced[i])
+								{
+										weldCount[welded[i]]++;
+								}
+						}
+				}
+
+				//vertices on open borders and attribute seams stay where they are, moving them would tear the mesh open
+				std::vector<bool> lockedGroups(_numVertices, false);
+				{
+						std::unordered_set<unsigned long long> edges;
+						edges.reserve(_destination.size());
+						for (size_t i = 0; i < _destination.size(); i += 3)
+						{
+								for (size_t k = 0; k < 3; k++)
+								{
+										edges.insert(edgeKey(welded[_destination[i + k]], welded[_destination[i + (k + 1) % 3]]));
+								}
+						}
+
+						for (size_t i = 0; i < _destination.size(); i += 3)
+						{
+								for (size_t k = 0; k < 3; k++)
+								{
+										unsigned int a = welded[_destination[i + k]];
+										unsigned int b = welded[_destination[i + (k + 1) % 3]];
+										if (edges.find(edgeKey(b, a)) == edges.end())
+										{
+												lockedGroups[a] = true;
+												lockedGroups[b] = true;
+										}
+								}
+						}
+				}
+
+				std::vector<bool> locked(_numVertices);
+				for (unsigned int i = 0; i < _numVertices; i++)
+				{
+						locked[i] = lockedGroups[welded[i]] || weldCount[welded[i]] > 1;
+				}
+
+				//plane quadrics of the triangles around every vertex
+				std::vector<Quadric> quadrics(_numVertices);
+				for (size_t i = 0; i < _destination.size(); i += 3)
+				{
+						const glm::dvec3 p0(_positions[_destination[i]]);
+						const glm::dvec3 p1(_positions[_destination[i + 1]]);
+						const glm::dvec3 p2(_positions[_destination[i + 2]]);
+
+						glm::dvec3 normal = glm::cross(p1 - p0, p2 - p0);
+						double length = glm::length(normal);
+						if (length <= 0.0)
+						{
+								continue;
+						}
+						normal /= length;
+
+						double distance = -glm::dot(normal, p0);
+						for (size_t k = 0; k < 3; k++)
+						{
+								quadrics[_destination[i + k]].addPlane(normal, distance, length * 0.5);
+						}
+				}
+
+				const double maxError = static_cast<double>(_targetError) * static_cast<double>(_targetError);
+				double resultError{ 0.0 };
+
+				std::vector<unsigned int> offsets(_numVertices + 1);
+				std::vector<unsigned int> adjacency;
+				std::vector<unsigned int> remap(_numVertices);
+				std::vector<bool> touched(_numVertices);
+				std::vector<Collapse> collapses;
+
+				//every pass collapses a set of independent edges, cheapest first
+				while (_destination.size() > _targetIndexCount)
+				{
+						const size_t numTriangles = _destination.size() / 3;
+
+						//triangles around every vertex
+						std::fill(offsets.begin(), offsets.end(), 0);
+						for (unsigned int index : _destination)
+						{
+								offsets[index + 1]++;
+						}
+						for (size_t i = 1; i <= _numVertices; i++)
+						{
+								offsets[i] += offsets[i - 1];
+						}
+						adjacency.resize(_destination.size());
+						{
+								std::vector<unsigned int> filled(offsets.begin(), offsets.end() - 1);
+								for (size_t i = 0; i < _destination.size(); i++)
+								{
+										adjacency[filled[_destination[i]]++] = static_cast<unsigned int>(i / 3);
+								}
+						}
+
+						collapses.clear();
+						for (size_t i = 0; i < _destination.size(); i += 3)
+						{
+								for (size_t k = 0; k < 3; k++)
+								{
+										unsigned int a = _destination[i + k];
+										unsigned int b = _destination[i + (k + 1) % 3];
+
+										Quadric quadric = quadrics[a];
+										quadric += quadrics[b];
+
+										if (!locked[a])
+										{
+												collapses.push_back({ a, b, quadric.error(_positions[b]) });
+										}
+										if (!locked[b])
+										{
+												collapses.push_back({ b, a, quadric.error(_positions[a]) });
+										}
+								}
+						}
+
+						std::sort(collapses.begin(), collapses.end(), [](const Collapse& _a, const Collapse& _b) { return _a.cost < _b.cost; });
+
+						std::iota(remap.begin(), remap.end(), 0);
+						std::fill(touched.begin(), touched.end(), false);
+
+						const size_t trianglesToRemove = (_destination.size() - _targetIndexCount + 2) / 3;
+						size_t removedTriangles{ 0 };
+						size_t numCollapses{ 0 };
+
+						for (const Collapse& collapse : collapses)
+						{
+								if (collapse.cost > maxError)
+								{
+										break;
+								}
+
+								if (touched[collapse.from] || touched[collapse.to])
+								{
+										continue;
+								}
+
+								//reject the collapse if one of the remaining triangles around the vertex would flip
+								bool flips{ false };
+								size_t collapsedTriangles{ 0 };
+								for (unsigned int j = offsets[collapse.from]; j < offsets[collapse.from + 1] && !flips; j++)
+								{
+										const unsigned int* triangle = _destination.data() + adjacency[j] * 3;
+										if (triangle[0] == collapse.to || triangle[1] == collapse.to || triangle[2] == collapse.to)
+										{
+												collapsedTriangles++;
+												continue;
+										}
+
+										glm::vec3 before[3], after[3];
+										for (size_t k = 0; k < 3; k++)
+										{
+												before[k] = _positions[triangle[k]];
+												after[k] = triangle[k] == collapse.from ? _positions[collapse.to] : before[k];
+										}
+
+										glm::vec3 normalBefore = glm::cross(before[1] - before[0], before[2] - before[0]);
+										glm::vec3 normalAfter = glm::cross(after[1] - after[0], after[2] - after[0]);
+										flips = glm::dot(normalBefore, normalAfter) <= 0.0f;
+								}
+
+								if (flips)
+								{
+										continue;
+								}
+
+								//the neighbourhood is frozen for the rest of the pass, the flip test above relies on it
+								for (unsigned int j = offsets[collapse.from]; j < offsets[collapse.from + 1]; j++)
+								{
+										const unsigned int* triangle = _destination.data() + adjacency[j] * 3;
+										touched[triangle[0]] = touched[triangle[1]] = touched[triangle[2]] = true;
+								}
+
+								remap[collapse.from] = collapse.to;
+								quadrics[collapse.to] += quadrics[collapse.from];
+								resultError = std::max(resultError, collapse.cost);
+
+								numCollapses++;
+								removedTriangles += collapsedTriangles;
+								if (removedTriangles >= trianglesToRemove)
+								{
+										break;
+								}
+						}
+
+						if (numCollapses == 0)
+						{
+								break;
+						}
+
+						//apply the collapses and drop the triangles that became degenerate
+						size_t write{ 0 };
+						for (size_t i = 0; i < numTriangles * 3; i += 3)
+						{
+								unsigned int a = remap[_destination[i]];
+								unsigned int b = remap[_destination[i + 1]];
+								unsigned int c = remap[_destination[i + 2]];
+
+								if (a != b && b != c && a != c)
+								{
+										_destination[write++] = a;
+										_destination[write++] = b;
+										_destination[write++] = c;
+								}
+						}
+						_destination.resize(write);
+				}
+
+				return static_cast<float>(std::sqrt(resultError));
+		}
+}
@@ -0,0 +1,31 @@
+#ifndef MESH_SIMPLIFIER_H
+#define MESH_SIMPLIFIER_H
+
+#include <vector>
+#include <glm\vec3.hpp>
+
+namespace cogs
+{
+		/**
+		* \brief Simplifies a triangle list with quadric error metric edge collapses, onto the existing vertices.
+		* The result only uses vertices of the input, so a lod can share the vertex data of the full detail mesh.
+		* Vertices on open borders and on attribute seams (several vertices at one position) are never moved
+		* \param _indices - the triangle list
+		* \param _numIndices - the number of indices
+		* \param _positions - the positions the indices refer to
+		* \param _numVertices - the number of positions
+		* \param _targetIndexCount - the index count to stop at
+		* \param _targetError - the largest allowed deviation from the surface, in model space units
+		* \param[out] _destination - the simplified triangle list
+		* \return the deviation of the result from the input surface, in model space units
+		*/
+		extern float simplifyMesh(const unsigned int* _indices,
+				size_t _numIndices,
+				const glm::vec3* _positions,
+				size_t _numVertices,
+				size_t _targetIndexCount,
+				float _targetError,
+				std::vector<unsigned int>& _destination);
+}
+
+#endif // !MESH_SIMPLIFIER_H
@@ -0,0 +1,388 @@
+#include "Meshlets.h"
+
+#include "Simd.h"
+
+#include <glm\glm.hpp>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace cogs
+{
+		namespace
+		{
+				//cones with triangles this close to perpendicular to the axis are too wide to ever face away
+				const float MIN_CONE_DOT = 0.1f;
+
+				const unsigned int NO_MESHLET = ~0u;
+
+				void calcMeshletBounds(Meshlet& _meshlet, const unsigned int* _indices, const glm::vec3* _positions)
+				{
+						glm::vec3 min = _positions[_indices[0]];
+						glm::vec3 max = min;
+						glm::vec3 normalSum(0.0f);
+
+						for (unsigned int i = 0; i < _meshlet.m_numIndices; i += 3)
+						{
+								const glm::vec3& a = _positions[_indices[i]];
+								const glm::vec3& b = _positions[_indices[i + 1]];
+								const glm::vec3& c = _positions[_indices[i + 2]];
+								min = glm::min(min, glm::min(a, glm::min(b, c)));
+								max = glm::max(max, glm::max(a, glm::max(b, c)));
+
+								glm::vec3 normal = glm::cross(b - a, c - a);
+								float length = glm::length(normal);
+								if (length > 0.0f)
+								{
+										normalSum += normal / length;
+								}
+						}
+
+						_meshlet.m_center = (min + max) * 0.5f;
+						float radius2{ 0.0f };
+						for (unsigned int i = 0; i < _meshlet.m_numIndices; i++)
+						{
+								const glm::vec3 offset = _positions[_indices[i]] - _meshlet.m_center;
+								radius2 = glm::max(radius2, glm::dot(offset, offset));
+						}
+						_meshlet.m_radius = std::sqrt(radius2);
+
+						_meshlet.m_coneAxis = glm::vec3(0.0f);
+						_meshlet.m_coneCutoff = 1.0f;
+
+						float axisLength = glm::length(normalSum);
+						if (axisLength <= 0.0f)
+						{
+								return;
+						}
+						const glm::vec3 axis = normalSum / axisLength;
+
+						//the widest angle between a triangle normal and the axis
+						float minDot{ 1.0f };
+						for (unsigned int i = 0; i < _meshlet.m_numIndices; i += 3)
+						{
+								const glm::vec3& a = _positions[_indices[i]];
+								glm::vec3 normal = glm::cross(_positions[_indices[i + 1]] - a, _positions[_indices[i + 2]] - a);
+								float length = glm::length(normal);
+								if (length > 0.0f)
+								{
+										minDot = glm::min(minDot, glm::dot(normal / length, axis));
+								}
+						}
+
+						if (minDot > MIN_CONE_DOT)
+						{
+								//all triangles face away once the view direction is within 90 degrees minus the cone angle of the axis
+								_meshlet.m_coneAxis = axis;
+								_meshlet.m_coneCutoff = std::sqrt(1.0f - minDot * minDot);
+						}
+				}
+
+				//planes of the clip space volume, in the space the matrix transforms from
+				void extractPlanes(const glm::mat4& _matrix, glm::vec4 _planes[6])
+				{
+						const glm::vec4 row0(_matrix[0][0], _matrix[1][0], _matrix[2][0], _matrix[3][0]);
+						const glm::vec4 row1(_matrix[0][1], _matrix[1][1], _matrix[2][1], _matrix[3][1]);
+						const glm::vec4 row2(_matrix[0][2], _matrix[1][2], _matrix[2][2], _matrix[3][2]);
+						const glm::vec4 row3(_matrix[0][3], _matrix[1][3], _matrix[2][3], _matrix[3][3]);
+
+						_planes[0] = row3 + row0;
+						_planes[1] = row3 - row0;
+						_planes[2] = row3 + row1;
+						_planes[3] = row3 - row1;
+						_planes[4] = row3 + row2;
+						_planes[5] = row3 - row2;
+
+						//normalized, so the distances compare to the radii
+						for (int i = 0; i < 6; i++)
+						{
+								float length = glm::length(glm::vec3(_planes[i]));
+								_planes[i] /= length > 0.0f ? length : 1.0f;
+						}
+				}
+		}
+
+		void buildMeshlets(unsigned int* _indices,
+				size_t _numIndices,
+				const glm::vec3* _positions,
+				size_t _numVertices,
+				unsigned int _maxVertices,
+				unsigned int _maxTriangles,
+				std::vector<Meshlet>& _meshlets)
+		{
+				const size_t numTriangles = _numIndices / 3;
+				if (numTriangles == 0)
+				{
+						return;
+				}
+
+				_maxVertices = std::max(_maxVertices, 3u);
+				_maxTriangles = std::max(_maxTriangles, 1u);
+
+				//the triangles around every vertex
+				std::vector<unsigned int> adjacencyOffsets(_numVertices + 1, 0);
+				for (size_t i = 0; i < numTriangles * 3; i++)
+				{
+						adjacencyOffsets[_indices[i] + 1]++;
+				}
+				for (size_t i = 0; i < _numVertices; i++)
+				{
+						adjacencyOffsets[i + 1] += adjacencyOffsets[i];
+				}
+
+				std::vector<unsigned int> adjacency(numTriangles * 3);
+				std::vector<unsigned int> adjacencyFill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+				for (size_t i = 0; i < numTriangles * 3; i++)
+				{
+						adjacency[adjacencyFill[_indices[i]]++] = static_cast<unsigned int>(i / 3);
+				}
+
+				std::vector<glm::vec3> centroids(numTriangles);
+				for (size_t i = 0; i < numTriangles; i++)
+				{
+						centroids[i] = (_positions[_indices[i * 3]] + _positions[_indices[i * 3 + 1]] + _positions[_indices[i * 3 + 2]]) / 3.0f;
+				}
+
+				std::vector<unsigned char> emitted(numTriangles, 0);
+				std::vector<unsigned int> vertexMeshlet(_numVertices, NO_MESHLET); ///< the last meshlet a vertex was added to
+				std::vector<unsigned int> candidateMeshlet(numTriangles, NO_MESHLET); ///< the last meshlet a triangle was a candidate of
+				std::vector<unsigned int> candidates;
+				std::vector<unsigned int> reordered;
+				reordered.reserve(numTriangles * 3);
+
+				const size_t firstMeshlet = _meshlets.size();
+				unsigned int meshletID{ 0 };
+				size_t seed{ 0 };
+				size_t numEmitted{ 0 };
+
+				while (numEmitted < numTriangles)
+				{
+						Meshlet meshlet;
+						meshlet.m_baseIndex = static_cast<unsigned int>(reordered.size());
+
+						unsigned int numMeshletVertices{ 0 };
+						unsigned int numMeshletTriangles{ 0 };
+						glm::vec3 centroidSum(0.0f);
+						candidates.clear();
+
+						//every meshlet starts at the first triangle left, which keeps the order of the input roughly intact
+						while (emitted[seed])
+						{
+								seed++;
+						}
+						unsigned int triangle = static_cast<unsigned int>(seed);
+
+						while (true)
+						{
+								emitted[triangle] = 1;
+								numEmitted++;
+								numMeshletTriangles++;
+								centroidSum += centroids[triangle];
+
+								for (int corner = 0; corner < 3; corner++)
+								{
+										const unsigned int vertex = _indices[triangle * 3 + corner];
+										reordered.push_back(vertex);
+
+										if (vertexMeshlet[vertex] == meshletID)
+										{
+												continue;
+										}
+										vertexMeshlet[vertex] = meshletID;
+										numMeshletVertices++;
+
+										//the triangles sharing a vertex with the meshlet are the ones it can grow by
+										for (unsigned int j = adjacencyOffsets[vertex]; j < adjacencyOffsets[vertex + 1]; j++)
+										{
+												const unsigned int neighbour = adjacency[j];
+												if (!emitted[neighbour] && candidateMeshlet[neighbour] != meshletID)
+												{
+														candidateMeshlet[neighbour] = meshletID;
+														candidates.push_back(neighbour);
+												}
+										}
+								}
+
+								if (numMeshletTriangles == _maxTriangles)
+								{
+										break;
+								}
+
+								//the candidate adding the fewest vertices, the closest one to the center on a tie
+								const glm::vec3 center = centroidSum / static_cast<float>(numMeshletTriangles);
+								unsigned int best{ NO_MESHLET };
+								unsigned int bestNewVertices{ 4 };
+								float bestDistance = std::numeric_limits<float>::max();
+
+								for (size_t i = 0; i < candidates.size();)
+								{
+										const unsigned int candidate = candidates[i];
+										if (emitted[candidate])
+										{
+												candidates[i] = candidates.back();
+												candidates.pop_back();
+												continue;
+										}
+										i++;
+
+										unsigned int newVertices{ 0 };
+										for (int corner = 0; corner < 3; corner++)
+										{
+												newVertices += vertexMeshlet[_indices[candidate * 3 + corner]] != meshletID ? 1 : 0;
+										}
+
+										if (numMeshletVertices + newVertices > _maxVertices || newVertices > bestNewVertices)
+										{
+												continue;
+										}
+
+										const glm::vec3 offset = centroids[candidate] - center;
+										const float distance = glm::dot(offset, offset);
+										if (newVertices < bestNewVertices || distance < bestDistance)
+										{
+												best = candidate;
+												bestNewVertices = newVertices;
+												bestDistance = distance;
+										}
+								}
+
+								//the connected piece is used up or the vertex limit reached
+								if (best == NO_MESHLET)
+								{
+										break;
+								}
+								triangle = best;
+						}
+
+						meshlet.m_numIndices = numMeshletTriangles * 3;
+						_meshlets.push_back(meshlet);
+						meshletID++;
+				}
+
+				std::copy(reordered.begin(), reordered.end(), _indices);
+
+				for (size_t i = firstMeshlet; i < _meshlets.size(); i++)
+				{
+						calcMeshletBounds(_meshlets[i], _indices + _meshlets[i].m_baseIndex, _positions);
+				}
+		}
+
+		void buildMeshletCullBlocks(const std::vector<Meshlet>& _meshlets, std::vector<MeshletCullBlock>& _blocks)
+		{
+				_blocks.assign((_meshlets.size() + 3) / 4, MeshletCullBlock());
+
+				for (size_t i = 0; i < _blocks.size() * 4; i++)
+				{
+						MeshletCullBlock& block = _blocks[i / 4];
+						const size_t lane = i % 4;
+
+						if (i >= _meshlets.size())
+						{
+								block.centerX[lane] = block.centerY[lane] = block.centerZ[lane] = 0.0f;
+								block.radius[lane] = 0.0f;
+								block.axisX[lane] = block.axisY[lane] = block.axisZ[lane] = 0.0f;
+								block.cutoff[lane] = 1.0f;
+								continue;
+						}
+
+						const Meshlet& meshlet = _meshlets[i];
+						block.centerX[lane] = meshlet.m_center.x;
+						block.centerY[lane] = meshlet.m_center.y;
+						block.centerZ[lane] = meshlet.m_center.z;
+						block.radius[lane] = meshlet.m_radius;
+						block.axisX[lane] = meshlet.m_coneAxis.x;
+						block.axisY[lane] = meshlet.m_coneAxis.y;
+						block.axisZ[lane] = meshlet.m_coneAxis.z;
+						block.cutoff[lane] = meshlet.m_coneCutoff;
+				}
+		}
+
+		unsigned int cullMeshlets(const std::vector<MeshletCullBlock>& _blocks,
+				size_t _numMeshlets,
+				const glm::mat4& _modelViewProjection,
+				const glm::vec3& _cameraPosition,
+				bool _coneCulling,
+				std::vector<unsigned char>& _visibility)
+		{
+				glm::vec4 planes[6];
+				extractPlanes(_modelViewProjection, planes);
+
+				_visibility.resize(_numMeshlets);
+				const size_t numBlocks = std::min(_blocks.size(), (_numMeshlets + 3) / 4);
+
+				//called for every instance drawing meshlets each frame, so it stays on the calling thread
+				unsigned int numVisible{ 0 };
+				for (size_t b = 0; b < numBlocks; b++)
+				{
+						const MeshletCullBlock& block = _blocks[b];
+						int mask{ 0 };
+
+#ifdef COGS_SSE
+						const __m128 centerX = _mm_loadu_ps(block.centerX);
+						const __m128 centerY = _mm_loadu_ps(block.centerY);
+						const __m128 centerZ = _mm_loadu_ps(block.centerZ);
+						const __m128 radius = _mm_loadu_ps(block.radius);
+						const __m128 negativeRadius = _mm_sub_ps(_mm_setzero_ps(), radius);
+
+						//in front of every plane, or at least within the radius
+						__m128 visible = _mm_cmpgt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(centerX, _mm_set1_ps(planes[0].x)),
+								_mm_mul_ps(centerY, _mm_set1_ps(planes[0].y))),
+								_mm_add_ps(_mm_mul_ps(centerZ, _mm_set1_ps(planes[0].z)), _mm_set1_ps(planes[0].w))), negativeRadius);
+						for (int p = 1; p < 6; p++)
+						{
+								__m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(centerX, _mm_set1_ps(planes[p].x)),
+										_mm_mul_ps(centerY, _mm_set1_ps(planes[p].y))),
+										_mm_add_ps(_mm_mul_ps(centerZ, _mm_set1_ps(planes[p].z)), _mm_set1_ps(planes[p].w)));
+								visible = _mm_and_ps(visible, _mm_cmpgt_ps(distance, negativeRadius));
+						}
+
+						if (_coneCulling)
+						{
+								const __m128 viewX = _mm_sub_ps(centerX, _mm_set1_ps(_cameraPosition.x));
+								const __m128 viewY = _mm_sub_ps(centerY, _mm_set1_ps(_cameraPosition.y));
+								const __m128 viewZ = _mm_sub_ps(centerZ, _mm_set1_ps(_cameraPosition.z));
+
+								const __m128 axisDot = _mm_add_ps(_mm_add_ps(_mm_mul_ps(viewX, _mm_loadu_ps(block.axisX)),
+										_mm_mul_ps(viewY, _mm_loadu_ps(block.axisY))), _mm_mul_ps(viewZ, _mm_loadu_ps(block.axisZ)));
+								const __m128 distance = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(viewX, viewX),
+										_mm_mul_ps(viewY, viewY)), _mm_mul_ps(viewZ, viewZ)));
+
+								const __m128 backFacing = _mm_cmpge_ps(axisDot, _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(block.cutoff), distance), radius));
+								visible = _mm_andnot_ps(backFacing, visible);
+						}
+
+						mask = _mm_movemask_ps(visible);
+#else
+						for (int lane = 0; lane < 4; lane++)
+						{
+								const glm::vec3 center(block.centerX[lane], block.centerY[lane], block.centerZ[lane]);
+								bool visible = true;
+								for (int p = 0; p < 6 && visible; p++)
+								{
+										visible = glm::dot(glm::vec3(planes[p]), center) + planes[p].w > -block.radius[lane];
+								}
+
+								if (visible && _coneCulling)
+								{
+										const glm::vec3 view = center - _cameraPosition;
+										const glm::vec3 axis(block.axisX[lane], block.axisY[lane], block.axisZ[lane]);
+										visible = glm::dot(view, axis) < block.cutoff[lane] * glm::length(view) + block.radius[lane];
+								}
+
+								mask |= visible ? (1 << lane) : 0;
+						}
+#endif
+
+						const size_t first = b * 4;
+						const size_t last = std::min(first + 4, _numMeshlets);
+						for (size_t i = first; i < last; i++)
+						{
+								const unsigned char visible = static_cast<unsigned char>((mask >> (i - first)) & 1);
+								_visibility[i] = visible;
+								numVisible += visible;
+						}
+				}
+
+				return numVisible;
+		}
+}
@@ -0,0 +1,84 @@
+#ifndef MESHLETS_H
+#define MESHLETS_H
+
+#include <vector>
+#include <glm\vec3.hpp>
+#include <glm\mat4x4.hpp>
+
+namespace cogs
+{
+		/**
+		* \brief A small cluster of neighbouring triangles, a contiguous range of the index buffer,
+		* with the bounds to cull it against the view frustum and its normal cone to cull it when it faces away
+		*/
+		struct Meshlet
+		{
+				unsigned int m_baseIndex{ 0 }; ///< first index in the full detail index buffer of the mesh
+				unsigned int m_numIndices{ 0 };
+				unsigned int m_subMesh{ 0 }; ///< the submesh the triangles belong to
+				glm::vec3 m_center{ 0.0f }; ///< bounding sphere in model space
+				float m_radius{ 0.0f };
+				glm::vec3 m_coneAxis{ 0.0f }; ///< average direction of the triangle normals
+				float m_coneCutoff{ 1.0f }; ///< sine of the cone's half angle, 1 if the normals spread too much to ever cull
+		};
+
+		/**
+		* \brief The culling data of 4 meshlets, component by component so they can be tested together with SSE
+		*/
+		struct MeshletCullBlock
+		{
+				float centerX[4];
+				float centerY[4];
+				float centerZ[4];
+				float radius[4];
+				float axisX[4];
+				float axisY[4];
+				float axisZ[4];
+				float cutoff[4];
+		};
+
+		/**
+		* \brief Splits a triangle list into meshlets by growing every cluster over the triangles sharing its vertices,
+		* and rewrites the indices in meshlet order, so every meshlet is a contiguous range
+		* \param _indices - the triangle list, reordered in place
+		* \param _numIndices - the number of indices
+		* \param _positions - the positions the indices refer to
+		* \param _numVertices - the number of positions
+		* \param _maxVertices - the most distinct vertices per meshlet
+		* \param _maxTriangles - the most triangles per meshlet
+		* \param[out] _meshlets - the meshlets are appended, their base index is relative to _indices
+		*/
+		extern void buildMeshlets(unsigned int* _indices,
+				size_t _numIndices,
+				const glm::vec3* _positions,
+				size_t _numVertices,
+				unsigned int _maxVertices,
+				unsigned int _maxTriangles,
+				std::vector<Meshlet>& _meshlets);
+
+		/**
+		* \brief packs the culling data of the meshlets into blocks of 4, the lanes behind the last meshlet are never visible
+		*/
+		extern void buildMeshletCullBlocks(const std::vector<Meshlet>& _meshlets, std::vector<MeshletCullBlock>& _blocks);
+
+		/**
+		* \brief Tests the meshlets of an instance against the view frustum and their normal cones.
+		* Runs in model space, the frustum planes are taken from the model-view-projection matrix,
+		* 4 meshlets at a time with SSE on the calling thread
+		* \param _blocks - the culling data of the meshlets
+		* \param _numMeshlets - the number of meshlets
+		* \param _modelViewProjection - the projection * view * world matrix of the instance
+		* \param _cameraPosition - the position of the camera in model space
+		* \param _coneCulling - whether to cull meshlets facing away, only valid for perspective projections
+		* \param[out] _visibility - 1 for every visible meshlet, 0 otherwise
+		* \return the number of visible meshlets
+		*/
+		extern unsigned int cullMeshlets(const std::vector<MeshletCullBlock>& _blocks,
+				size_t _numMeshlets,
+				const glm::mat4& _modelViewProjection,
+				const glm::vec3& _cameraPosition,
+				bool _coneCulling,
+				std::vector<unsigned char>& _visibility);
+}
+
+#endif // !MESHLETS_H
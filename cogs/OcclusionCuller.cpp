@@ -0,0 +1,389 @@
+#include "OcclusionCuller.h"
+#include "BulletDebugRenderer.h"
+#include "Parallel.h"
+#include "Simd.h"
+#include "Timing.h"
+
+#include <glm\glm.hpp>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace cogs
+{
+		namespace
+		{
+				//pixels per tile side, a multiple of the 4 pixels rasterized at once
+				const unsigned int TILE_SIZE = 32;
+
+				//tiles rasterized per batch of the worker pool at least, the bins of a frame are handed to the pool in one job
+				const size_t TILE_BATCH = 4;
+
+				unsigned int roundUpToTiles(unsigned int _pixels)
+				{
+						return glm::max((_pixels + TILE_SIZE - 1) / TILE_SIZE, 1u) * TILE_SIZE;
+				}
+		}
+
+		OcclusionCuller::OcclusionCuller(unsigned int _width, unsigned int _height)
+		{
+				setResolution(_width, _height);
+		}
+
+		OcclusionCuller::~OcclusionCuller()
+		{
+		}
+
+		void OcclusionCuller::setResolution(unsigned int _width, unsigned int _height)
+		{
+				m_width = roundUpToTiles(_width);
+				m_height = roundUpToTiles(_height);
+				m_tilesX = m_width / TILE_SIZE;
+				m_tilesY = m_height / TILE_SIZE;
+				m_tileBins.assign(m_tilesX * m_tilesY, std::vector<unsigned int>());
+
+				//every level halves the previous one, down to a single texel
+				m_levelSizes.clear();
+				m_levels.clear();
+				glm::uvec2 size(m_width, m_height);
+				while (true)
+				{
+						m_levelSizes.push_back(size);
+						m_levels.push_back(std::vector<float>(size.x * size.y, 1.0f));
+						if (size.x == 1 && size.y == 1)
+						{
+								break;
+						}
+						size = glm::uvec2((size.x + 1) / 2, (size.y + 1) / 2);
+				}
+		}
+
+		void OcclusionCuller::begin(const glm::mat4& _viewProjection)
+		{
+				m_viewProjection = _viewProjection;
+				m_occluders.clear();
+				m_stats = OcclusionStats();
+				m_visibleBoxes.clear();
+				m_occludedBoxes.clear();
+		}
+
+		void OcclusionCuller::addOccluder(const std::vector<glm::vec3>& _positions, const std::vector<unsigned int>& _indices, const glm::mat4& _world)
+		{
+				if (_indices.empty())
+				{
+						return;
+				}
+
+				Occluder occluder;
+				occluder.positions = &_positions;
+				occluder.indices = &_indices;
+				occluder.worldViewProjection = m_viewProjection * _world;
+				m_occluders.push_back(occluder);
+		}
+
+		void OcclusionCuller::rasterize()
+		{
+				HRTimer timer;
+				timer.start();
+
+				std::fill(m_levels.front().begin(), m_levels.front().end(), 1.0f);
+
+				setupTriangles();
+
+				parallelFor(m_tileBins.size(), TILE_BATCH, [this](size_t _begin, size_t _end, unsigned int)
+				{
+						for (size_t tile = _begin; tile < _end; tile++)
+						{
+								rasterizeTile(static_cast<unsigned int>(tile));
+						}
+				});
+
+				buildPyramid();
+
+				timer.stop();
+				m_stats.numOccluders = static_cast<unsigned int>(m_occluders.size());
+				m_stats.numTriangles = static_cast<unsigned int>(m_triangles.size());
+				m_stats.rasterizeTime = timer.milli();
+		}
+
+		void OcclusionCuller::setupTriangles()
+		{
+				m_triangles.clear();
+				for (std::vector<unsigned int>& bin : m_tileBins)
+				{
+						bin.clear();
+				}
+
+				const glm::vec2 screenSize(static_cast<float>(m_width), static_cast<float>(m_height));
+
+				for (const Occluder& occluder : m_occluders)
+				{
+						const std::vector<glm::vec3>& positions = *occluder.positions;
+						const std::vector<unsigned int>& indices = *occluder.indices;
+
+						m_clipPositions.resize(positions.size());
+						for (size_t i = 0; i < positions.size(); i++)
+						{
+								m_clipPositions[i] = occluder.worldViewProjection * glm::vec4(positions[i], 1.0f);
+						}
+
+						for (size_t i = 0; i + 2 < indices.size(); i += 3)
+						{
+								const glm::vec4* clip[3] = { &m_clipPositions[indices[i]], &m_clipPositions[indices[i + 1]], &m_clipPositions[indices[i + 2]] };
+
+								//triangles crossing the near plane are dropped instead of clipped, which only makes the culling more conservative
+								if (clip[0]->z < -clip[0]->w || clip[1]->z < -clip[1]->w || clip[2]->z < -clip[2]->w)
+								{
+										continue;
+								}
+
+								glm::vec2 screen[3];
+								float depth[3];
+								for (int j = 0; j < 3; j++)
+								{
+										const float inverseW = 1.0f / clip[j]->w;
+										screen[j] = (glm::vec2(*clip[j]) * inverseW * 0.5f + 0.5f) * screenSize;
+										depth[j] = clip[j]->z * inverseW * 0.5f + 0.5f;
+								}
+
+								//back facing and degenerate triangles
+								const float area = (screen[1].x - screen[0].x) * (screen[2].y - screen[0].y) - (screen[1].y - screen[0].y) * (screen[2].x - screen[0].x);
+								if (area <= 0.0f)
+								{
+										continue;
+								}
+
+								//the pixels whose centers the bounds contain
+								const glm::vec2 min = glm::min(screen[0], glm::min(screen[1], screen[2]));
+								const glm::vec2 max = glm::max(screen[0], glm::max(screen[1], screen[2]));
+
+								ScreenTriangle triangle;
+								triangle.minX = glm::max(static_cast<int>(std::ceil(min.x - 0.5f)), 0);
+								triangle.minY = glm::max(static_cast<int>(std::ceil(min.y - 0.5f)), 0);
+								triangle.maxX = glm::min(static_cast<int>(std::floor(max.x - 0.5f)), static_cast<int>(m_width) - 1);
+								triangle.maxY = glm::min(static_cast<int>(std::floor(max.y - 0.5f)), static_cast<int>(m_height) - 1);
+								if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY)
+								{
+										continue;
+								}
+
+								//the edge functions and the depth plane are evaluated at the pixel centers
+								for (int j = 0; j < 3; j++)
+								{
+										const glm::vec2& from = screen[j];
+										const glm::vec2& to = screen[(j + 1) % 3];
+										triangle.edgeA[j] = from.y - to.y;
+										triangle.edgeB[j] = to.x - from.x;
+										triangle.edgeC[j] = -(triangle.edgeA[j] * from.x + triangle.edgeB[j] * from.y)
+												+ 0.5f * (triangle.edgeA[j] + triangle.edgeB[j]);
+								}
+
+								triangle.depthDx = ((depth[1] - depth[0]) * (screen[2].y - screen[0].y) - (depth[2] - depth[0]) * (screen[1].y - screen[0].y)) / area;
+								triangle.depthDy = ((depth[2] - depth[0]) * (screen[1].x - screen[0].x) - (depth[1] - depth[0]) * (screen[2].x - screen[0].x)) / area;
+								triangle.depth0 = depth[0] - triangle.depthDx * screen[0].x - triangle.depthDy * screen[0].y
+										+ 0.5f * (triangle.depthDx + triangle.depthDy);
+
+								const unsigned int index = static_cast<unsigned int>(m_triangles.size());
+								m_triangles.push_back(triangle);
+
+								for (int y = triangle.minY / TILE_SIZE; y <= triangle.maxY / static_cast<int>(TILE_SIZE); y++)
+								{
+										for (int x = triangle.minX / TILE_SIZE; x <= triangle.maxX / static_cast<int>(TILE_SIZE); x++)
+										{
+												m_tileBins[y * m_tilesX + x].push_back(index);
+										}
+								}
+						}
+				}
+		}
+
+		void OcclusionCuller::rasterizeTile(unsigned int _tile)
+		{
+				const int tileX = static_cast<int>((_tile % m_tilesX) * TILE_SIZE);
+				const int tileY = static_cast<int>((_tile / m_tilesX) * TILE_SIZE);
+				float* depthBuffer = m_levels.front().data();
+
+				for (unsigned int index : m_tileBins[_tile])
+				{
+						const ScreenTriangle& triangle = m_triangles[index];
+
+						//whole groups of 4 pixels, the edge functions reject the ones outside
+						const int minX = glm::max(triangle.minX, tileX) & ~3;
+						const int maxX = glm::min(triangle.maxX, tileX + static_cast<int>(TILE_SIZE) - 1);
+						const int minY = glm::max(triangle.minY, tileY);
+						const int maxY = glm::min(triangle.maxY, tileY + static_cast<int>(TILE_SIZE) - 1);
+
+#ifdef COGS_SSE
+						const __m128 offsets = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+						const __m128 zero = _mm_setzero_ps();
+						const __m128 a0 = _mm_set1_ps(triangle.edgeA[0]);
+						const __m128 a1 = _mm_set1_ps(triangle.edgeA[1]);
+						const __m128 a2 = _mm_set1_ps(triangle.edgeA[2]);
+						const __m128 depthDx = _mm_set1_ps(triangle.depthDx);
+
+						for (int y = minY; y <= maxY; y++)
+						{
+								const float fy = static_cast<float>(y);
+								const __m128 rowEdge0 = _mm_set1_ps(triangle.edgeB[0] * fy + triangle.edgeC[0]);
+								const __m128 rowEdge1 = _mm_set1_ps(triangle.edgeB[1] * fy + triangle.edgeC[1]);
+								const __m128 rowEdge2 = _mm_set1_ps(triangle.edgeB[2] * fy + triangle.edgeC[2]);
+								const __m128 rowDepth = _mm_set1_ps(triangle.depth0 + triangle.depthDy * fy);
+								float* row = depthBuffer + y * m_width;
+
+								for (int x = minX; x <= maxX; x += 4)
+								{
+										const __m128 px = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), offsets);
+										const __m128 inside = _mm_and_ps(_mm_and_ps(
+												_mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(a0, px), rowEdge0), zero),
+												_mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(a1, px), rowEdge1), zero)),
+												_mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(a2, px), rowEdge2), zero));
+										if (_mm_movemask_ps(inside) == 0)
+										{
+												continue;
+										}
+
+										const __m128 depth = _mm_add_ps(_mm_mul_ps(depthDx, px), rowDepth);
+										const __m128 stored = _mm_loadu_ps(row + x);
+										const __m128 nearest = _mm_min_ps(stored, depth);
+										_mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearest), _mm_andnot_ps(inside, stored)));
+								}
+						}
+#else
+						for (int y = minY; y <= maxY; y++)
+						{
+								const float fy = static_cast<float>(y);
+								float* row = depthBuffer + y * m_width;
+
+								for (int x = minX; x <= maxX; x++)
+								{
+										const float fx = static_cast<float>(x);
+										if (triangle.edgeA[0] * fx + triangle.edgeB[0] * fy + triangle.edgeC[0] >= 0.0f
+												&& triangle.edgeA[1] * fx + triangle.edgeB[1] * fy + triangle.edgeC[1] >= 0.0f
+												&& triangle.edgeA[2] * fx + triangle.edgeB[2] * fy + triangle.edgeC[2] >= 0.0f)
+										{
+												row[x] = glm::min(row[x], triangle.depth0 + triangle.depthDx * fx + triangle.depthDy * fy);
+										}
+								}
+						}
+#endif
+				}
+		}
+
+		void OcclusionCuller::buildPyramid()
+		{
+				for (size_t level = 1; level < m_levels.size(); level++)
+				{
+						const glm::uvec2 source = m_levelSizes[level - 1];
+						const glm::uvec2 size = m_levelSizes[level];
+						const std::vector<float>& finer = m_levels[level - 1];
+						std::vector<float>& coarser = m_levels[level];
+
+						//the farthest of the 2x2 texels below, the last row and column of odd sizes have no neighbour
+						for (unsigned int y = 0; y < size.y; y++)
+						{
+								const unsigned int y0 = y * 2;
+								const unsigned int y1 = glm::min(y0 + 1, source.y - 1);
+								for (unsigned int x = 0; x < size.x; x++)
+								{
+										const unsigned int x0 = x * 2;
+										const unsigned int x1 = glm::min(x0 + 1, source.x - 1);
+										coarser[y * size.x + x] = glm::max(glm::max(finer[y0 * source.x + x0], finer[y0 * source.x + x1]),
+												glm::max(finer[y1 * source.x + x0], finer[y1 * source.x + x1]));
+								}
+						}
+				}
+		}
+
+		bool OcclusionCuller::isOccluded(const glm::vec3& _min, const glm::vec3& _max)
+		{
+				HRTimer timer;
+				timer.start();
+				m_stats.numTested++;
+
+				auto result = [&](bool _occluded)
+				{
+						if (m_debugView)
+						{
+								(_occluded ? m_occludedBoxes : m_visibleBoxes).push_back(std::make_pair(_min, _max));
+						}
+						m_stats.numOccluded += _occluded ? 1 : 0;
+						timer.stop();
+						m_stats.testTime += timer.milli();
+						return _occluded;
+				};
+
+				//the screen rectangle and the nearest depth of the corners
+				glm::vec2 minScreen(std::numeric_limits<float>::max());
+				glm::vec2 maxScreen(-std::numeric_limits<float>::max());
+				float nearestDepth{ 1.0f };
+				for (int i = 0; i < 8; i++)
+				{
+						const glm::vec3 corner((i & 1) ? _max.x : _min.x, (i & 2) ? _max.y : _min.y, (i & 4) ? _max.z : _min.z);
+						const glm::vec4 clip = m_viewProjection * glm::vec4(corner, 1.0f);
+
+						//a box reaching in front of the near plane can't be hidden
+						if (clip.z < -clip.w)
+						{
+								return result(false);
+						}
+
+						const float inverseW = 1.0f / clip.w;
+						const glm::vec2 screen = (glm::vec2(clip) * inverseW * 0.5f + 0.5f) * glm::vec2(static_cast<float>(m_width), static_cast<float>(m_height));
+						minScreen = glm::min(minScreen, screen);
+						maxScreen = glm::max(maxScreen, screen);
+						nearestDepth = glm::min(nearestDepth, clip.z * inverseW * 0.5f + 0.5f);
+				}
+
+				//off screen boxes are left to the frustum culling
+				if (maxScreen.x < 0.0f || maxScreen.y < 0.0f || minScreen.x >= m_width || minScreen.y >= m_height)
+				{
+						return result(false);
+				}
+
+				//every pixel the rectangle touches
+				int x0 = glm::max(static_cast<int>(std::floor(minScreen.x)), 0);
+				int y0 = glm::max(static_cast<int>(std::floor(minScreen.y)), 0);
+				int x1 = glm::min(static_cast<int>(std::floor(maxScreen.x)), static_cast<int>(m_width) - 1);
+				int y1 = glm::min(static_cast<int>(std::floor(maxScreen.y)), static_cast<int>(m_height) - 1);
+
+				//the finest level where the rectangle covers at most 2x2 texels
+				size_t level{ 0 };
+				while (level + 1 < m_levels.size() && ((x1 >> level) - (x0 >> level) > 1 || (y1 >> level) - (y0 >> level) > 1))
+				{
+						level++;
+				}
+				x0 >>= level;
+				y0 >>= level;
+				x1 >>= level;
+				y1 >>= level;
+
+				const std::vector<float>& depths = m_levels[level];
+				const unsigned int width = m_levelSizes[level].x;
+				float farthestDepth{ 0.0f };
+				for (int y = y0; y <= y1; y++)
+				{
+						for (int x = x0; x <= x1; x++)
+						{
+								farthestDepth = glm::max(farthestDepth, depths[y * width + x]);
+						}
+				}
+
+				return result(nearestDepth > farthestDepth);
+		}
+
+		void OcclusionCuller::render(BulletDebugRenderer* _renderer) const
+		{
+				for (const auto& box : m_visibleBoxes)
+				{
+						_renderer->drawBox(btVector3(box.first.x, box.first.y, box.first.z),
+								btVector3(box.second.x, box.second.y, box.second.z),
+								btVector3(0.0f, 1.0f, 0.0f));
+				}
+				for (const auto& box : m_occludedBoxes)
+				{
+						_renderer->drawBox(btVector3(box.first.x, box.first.y, box.first.z),
+								btVector3(box.second.x, box.second.y, box.second.z),
+								btVector3(1.0f, 0.0f, 0.0f));
+				}
+		}
+}
@@ -0,0 +1,136 @@
+#ifndef OCCLUSION_CULLER_H
+#define OCCLUSION_CULLER_H
+
+#include <glm\vec2.hpp>
+#include <glm\vec3.hpp>
+#include <glm\mat4x4.hpp>
+#include <vector>
+
+namespace cogs
+{
+		class BulletDebugRenderer;
+
+		/**
+		* \brief what the occlusion culling did in the last frame
+		*/
+		struct OcclusionStats
+		{
+				unsigned int numOccluders{ 0 };
+				unsigned int numTriangles{ 0 }; ///< occluder triangles rasterized, after clipping and back face culling
+				unsigned int numTested{ 0 }; ///< occludee boxes tested
+				unsigned int numOccluded{ 0 }; ///< occludee boxes found hidden
+				float rasterizeTime{ 0.0f }; ///< milliseconds spent transforming, rasterizing and building the pyramid
+				float testTime{ 0.0f }; ///< milliseconds spent testing the occludees
+		};
+
+		/**
+		* \brief Software occlusion culling. The triangles of a few large occluders are rasterized into a small depth buffer on the cpu,
+		* the screen is split into tiles rasterized in parallel, 4 pixels at a time with SSE.
+		* A pyramid of the farthest depth over ever larger areas is built from it, the screen rectangle of an occludee box
+		* is then tested against the 2x2 texels of the level covering it: the box is hidden if it's behind all of them
+		*/
+		class OcclusionCuller
+		{
+		public:
+				/**
+				* \param _width, _height - the resolution of the depth buffer, rounded up to whole tiles
+				*/
+				OcclusionCuller(unsigned int _width = 256, unsigned int _height = 128);
+				~OcclusionCuller();
+
+				/**
+				* \brief sets the resolution of the depth buffer, rounded up to whole tiles
+				*/
+				void setResolution(unsigned int _width, unsigned int _height);
+				inline unsigned int getWidth()		const noexcept { return m_width; }
+				inline unsigned int getHeight()	const noexcept { return m_height; }
+
+				/**
+				* \brief starts a frame, drops the occluders and the stats of the last one
+				* \param _viewProjection - the camera's projection * view matrix, the occluders and occludees are given in world space
+				*/
+				void begin(const glm::mat4& _viewProjection);
+
+				/**
+				* \brief adds the triangles of an occluder, front faces are counter clockwise.
+				* The vertices aren't copied, they have to stay alive until rasterize() is done
+				*/
+				void addOccluder(const std::vector<glm::vec3>& _positions, const std::vector<unsigned int>& _indices, const glm::mat4& _world);
+
+				/**
+				* \brief rasterizes all occluders and builds the depth pyramid, call once after adding them and before the tests
+				*/
+				void rasterize();
+
+				/**
+				* \brief tests a world space box against the occluders
+				* \return true if the box is hidden behind them
+				*/
+				bool isOccluded(const glm::vec3& _min, const glm::vec3& _max);
+
+				inline const OcclusionStats& getStats()						const noexcept { return m_stats; }
+
+				/**
+				* \brief the rasterized depths of the occluders, 0 near to 1 far, row by row from the bottom of the screen
+				*/
+				inline const std::vector<float>& getDepthBuffer() const noexcept { return m_levels.front(); }
+
+				/**
+				* \brief keep the boxes tested during the frame, so render() can draw them (off by default)
+				*/
+				void setDebugView(bool _enabled) { m_debugView = _enabled; }
+				bool getDebugView() const noexcept { return m_debugView; }
+
+				/**
+				* \brief draws the occludee boxes of the last frame, hidden ones in red, visible ones in green
+				*/
+				void render(BulletDebugRenderer* _renderer) const;
+
+		private:
+				struct Occluder
+				{
+						const std::vector<glm::vec3>* positions;
+						const std::vector<unsigned int>* indices;
+						glm::mat4 worldViewProjection;
+				};
+
+				/**
+				* \brief an occluder triangle in pixels with the depth as a plane over the screen
+				*/
+				struct ScreenTriangle
+				{
+						float edgeA[3]; ///< edge i is inside where edgeA * x + edgeB * y + edgeC >= 0
+						float edgeB[3];
+						float edgeC[3];
+						float depth0; ///< the depth at pixel (0, 0)
+						float depthDx; ///< the depth change per pixel to the right
+						float depthDy; ///< the depth change per pixel up
+						int minX, minY, maxX, maxY; ///< the covered pixels, inclusive
+				};
+
+				void setupTriangles();
+				void rasterizeTile(unsigned int _tile);
+				void buildPyramid();
+
+				unsigned int m_width{ 0 };
+				unsigned int m_height{ 0 };
+				unsigned int m_tilesX{ 0 };
+				unsigned int m_tilesY{ 0 };
+
+				glm::mat4 m_viewProjection{ 1.0f };
+				std::vector<Occluder> m_occluders;
+				std::vector<ScreenTriangle> m_triangles;
+				std::vector<std::vector<unsigned int>> m_tileBins; ///< the triangles overlapping every tile
+				std::vector<glm::vec4> m_clipPositions; ///< scratch buffer for the transformed vertices of an occluder
+
+				std::vector<std::vector<float>> m_levels; ///< the depth buffer, then the pyramid of the farthest depths
+				std::vector<glm::uvec2> m_levelSizes;
+
+				OcclusionStats m_stats;
+				bool m_debugView{ false };
+				std::vector<std::pair<glm::vec3, glm::vec3>> m_visibleBoxes; ///< the tested boxes for the debug view
+				std::vector<std::pair<glm::vec3, glm::vec3>> m_occludedBoxes;
+		};
+}
+
+#endif // !OCCLUSION_CULLER_H
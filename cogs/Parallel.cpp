@@ -0,0 +1,183 @@
+#include "Parallel.h"
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <vector>
+#include <algorithm>
+
+namespace cogs
+{
+		namespace
+		{
+				/**
+				* \brief a parallelFor call waiting for its batches, lives on the stack of the calling thread
+				*/
+				struct Job
+				{
+						const std::function<void(size_t, size_t, unsigned int)>* function{ nullptr };
+						size_t count{ 0 };
+						unsigned int numBatches{ 0 };
+						unsigned int nextBatch{ 0 }; ///< the first batch nobody claimed yet
+						unsigned int remaining{ 0 }; ///< the batches not finished yet
+				};
+
+				/**
+				* \brief The threads the batches run on, started on the first parallelFor and kept until the program exits.
+				* The calling thread works on its own job too, so a call from inside a batch can't starve
+				*/
+				class WorkerPool
+				{
+				public:
+						WorkerPool()
+						{
+								const unsigned int numThreads = getNumWorkers() - 1;
+								m_threads.reserve(numThreads);
+								for (unsigned int i = 0; i < numThreads; i++)
+								{
+										m_threads.emplace_back([this]() { work(); });
+								}
+						}
+
+						~WorkerPool()
+						{
+								{
+										std::lock_guard<std::mutex> lock(m_mutex);
+										m_stop = true;
+								}
+								m_wake.notify_all();
+								for (std::thread& thread : m_threads)
+								{
+										thread.join();
+								}
+						}
+
+						void run(Job& _job)
+						{
+								std::unique_lock<std::mutex> lock(m_mutex);
+								m_jobs.push_back(&_job);
+								lock.unlock();
+								m_wake.notify_all();
+
+								lock.lock();
+								unsigned int batch;
+								while (claim(_job, batch))
+								{
+										lock.unlock();
+										runBatch(_job, batch);
+										lock.lock();
+										_job.remaining--;
+								}
+
+								//the batches claimed by the workers
+								m_done.wait(lock, [&_job]() { return _job.remaining == 0; });
+						}
+
+				private:
+						/**
+						* \brief takes the next batch of a job, a job leaves the queue once all its batches are taken. Called with the mutex locked
+						*/
+						bool claim(Job& _job, unsigned int& _batch)
+						{
+								if (_job.nextBatch == _job.numBatches)
+								{
+										return false;
+								}
+
+								_batch = _job.nextBatch++;
+								if (_job.nextBatch == _job.numBatches)
+								{
+										m_jobs.erase(std::find(m_jobs.begin(), m_jobs.end(), &_job));
+								}
+								return true;
+						}
+
+						static void runBatch(const Job& _job, unsigned int _batch)
+						{
+								const size_t begin = _job.count * _batch / _job.numBatches;
+								const size_t end = _job.count * (_batch + 1) / _job.numBatches;
+								(*_job.function)(begin, end, _batch);
+						}
+
+						void work()
+						{
+								std::unique_lock<std::mutex> lock(m_mutex);
+								while (true)
+								{
+										m_wake.wait(lock, [this]() { return m_stop || !m_jobs.empty(); });
+										if (m_stop)
+										{
+												return;
+										}
+
+										Job& job = *m_jobs.front();
+										unsigned int batch;
+										claim(job, batch);
+
+										lock.unlock();
+										runBatch(job, batch);
+										lock.lock();
+
+										//the job may be gone right after its last batch is reported
+										if (--job.remaining == 0)
+										{
+												m_done.notify_all();
+										}
+								}
+						}
+
+						std::vector<std::thread> m_threads;
+						std::deque<Job*> m_jobs; ///< the jobs with batches left to claim
+						std::mutex m_mutex;
+						std::condition_variable m_wake; ///< signals new jobs to the workers
+						std::condition_variable m_done; ///< signals finished batches to the callers
+						bool m_stop{ false };
+				};
+
+				WorkerPool& getPool()
+				{
+						static WorkerPool pool;
+						return pool;
+				}
+		}
+
+		unsigned int getNumWorkers()
+		{
+				static const unsigned int numWorkers = std::max(std::thread::hardware_concurrency(), 1u);
+				return numWorkers;
+		}
+
+		unsigned int getNumBatches(size_t _count, size_t _minBatch)
+		{
+				if (_count == 0)
+				{
+						return 0;
+				}
+
+				size_t numBatches = _count / std::max<size_t>(_minBatch, 1);
+				return static_cast<unsigned int>(std::min<size_t>(std::max<size_t>(numBatches, 1), getNumWorkers()));
+		}
+
+		void parallelFor(size_t _count, size_t _minBatch, const std::function<void(size_t, size_t, unsigned int)>& _function)
+		{
+				const unsigned int numBatches = getNumBatches(_count, _minBatch);
+				if (numBatches == 0)
+				{
+						return;
+				}
+
+				if (numBatches == 1)
+				{
+						_function(0, _count, 0);
+						return;
+				}
+
+				Job job;
+				job.function = &_function;
+				job.count = _count;
+				job.numBatches = numBatches;
+				job.remaining = numBatches;
+				getPool().run(job);
+		}
+}
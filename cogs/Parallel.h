@@ -0,0 +1,30 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <functional>
+#include <cstddef>
+
+namespace cogs
+{
+		/**
+		* \brief the number of threads parallelFor spreads work over, the hardware concurrency
+		*/
+		extern unsigned int getNumWorkers();
+
+		/**
+		* \brief how many batches parallelFor splits _count items into, callers size their per batch partial results with it
+		*/
+		extern unsigned int getNumBatches(size_t _count, size_t _minBatch);
+
+		/**
+		* \brief Splits [0, _count) into contiguous batches of at least _minBatch items and runs them on a pool of worker threads,
+		* the calling thread works on the batches as well and returns once all are done. The pool is started on the first call
+		* and reused until the program exits, so per frame passes don't pay for thread creation, only for waking the workers.
+		* Small inputs stay on the calling thread, size _minBatch so a batch outweighs that wake up (tens of microseconds).
+		* Safe to call from several threads and from inside a batch
+		* \param[in] _function - called with (begin, end, batch index), the batch index is below getNumBatches(_count, _minBatch)
+		*/
+		extern void parallelFor(size_t _count, size_t _minBatch, const std::function<void(size_t, size_t, unsigned int)>& _function);
+}
+
+#endif // !PARALLEL_H
@@ -21,6 +21,14 @@ namespace cogs
 		}
 		void ParticleRenderer::init()
 		{
+				if (RenderBackend::isNull())
+				{
+						//no GL objects with the null backend, just unique handles to batch by
+						m_VAO = RenderBackend::generateNullHandle();
+						RenderBackend::generateNullHandles(BufferObjects::NUM_BUFFERS, m_VBOs);
+						return;
+				}
+
 				//generate the vertex array buffer
 				glGenVertexArrays(1, &m_VAO);
 
@@ -107,29 +115,42 @@ namespace cogs
 						m_particlesMap.insert(std::make_pair(texture.lock()->getTextureID(), instance));
 				}
 
-				for (int i = 0; i < particleSystem.lock()->getNumActiveParticles(); ++i)
+				//test all particles against the view frustum at once
+				const size_t numParticles = static_cast<size_t>(particleSystem.lock()->getNumActiveParticles());
+				m_cullX.resize(numParticles);
+				m_cullY.resize(numParticles);
+				m_cullZ.resize(numParticles);
+				m_cullRadius.resize(numParticles);
+				for (size_t i = 0; i < numParticles; ++i)
 				{
-						//submit the mesh if it's in the view frustum
-						if (currentCam.lock()->sphereInFrustum(particles[i].m_position, particles[i].m_radius))
-						{
-								float lifeFactor = abs(particles[i].m_life - 1.0f);
-								int stageCount = texture.lock()->getDims().x * texture.lock()->getDims().y;
-								float atlasProgression = lifeFactor * stageCount;
-								float index1{ 0.0f }, index2{ 0.0f }, blend{ 0.0f };
-								blend = modff(atlasProgression, &index1);
-								index2 = index1 < stageCount - 1 ? index1 + 1 : index1;
-
-								glm::vec2 texOffset1 = texture.lock()->getTexOffsets((int)(index1));
-								glm::vec2 texOffset2 = texture.lock()->getTexOffsets((int)(index1));
-
-								InstanceAttributes newInstance;
-								newInstance.worldPosAndSize = glm::vec4(particles[i].m_position, particles[i].m_radius * 2.0f);
-								newInstance.color = particles[i].m_color;
-								newInstance.texOffsets = glm::vec4(texOffset1, texOffset2);
-								newInstance.blendFactor = blend;
-
-								m_particlesMap[texture.lock()->getTextureID()].instanceAttribs.push_back(newInstance);
-						}
+						m_cullX[i] = particles[i].m_position.x;
+						m_cullY[i] = particles[i].m_position.y;
+						m_cullZ[i] = particles[i].m_position.z;
+						m_cullRadius[i] = particles[i].m_radius;
+				}
+
+				currentCam.lock()->getFrustum().spheresInFrustum(m_cullX.data(), m_cullY.data(), m_cullZ.data(), m_cullRadius.data(),
+						numParticles, m_visibleParticles);
+
+				for (unsigned int i : m_visibleParticles)
+				{
+						float lifeFactor = abs(particles[i].m_life - 1.0f);
+						int stageCount = texture.lock()->getDims().x * texture.lock()->getDims().y;
+						float atlasProgression = lifeFactor * stageCount;
+						float index1{ 0.0f }, index2{ 0.0f }, blend{ 0.0f };
+						blend = modff(atlasProgression, &index1);
+						index2 = index1 < stageCount - 1 ? index1 + 1 : index1;
+
+						glm::vec2 texOffset1 = texture.lock()->getTexOffsets((int)(index1));
+						glm::vec2 texOffset2 = texture.lock()->getTexOffsets((int)(index2));
+
+						InstanceAttributes newInstance;
+						newInstance.worldPosAndSize = glm::vec4(particles[i].m_position, particles[i].m_radius * 2.0f);
+						newInstance.color = particles[i].m_color;
+						newInstance.texOffsets = glm::vec4(texOffset1, texOffset2);
+						newInstance.blendFactor = blend;
+
+						m_particlesMap[texture.lock()->getTextureID()].instanceAttribs.push_back(newInstance);
 				}
 		}
 		void ParticleRenderer::end()
@@ -141,57 +162,90 @@ namespace cogs
 		{
 				std::weak_ptr<Camera> currentCam = Camera::getCurrent();
 
-				m_shader.lock()->use();
-				m_shader.lock()->uploadValue("projection", currentCam.lock()->getProjectionMatrix());
-				m_shader.lock()->uploadValue("view", currentCam.lock()->getViewMatrix());
-				m_shader.lock()->uploadValue("cameraRight_worldSpace",
+				CommandBucket& bucket = getCommandBucket();
+
+				m_shader.lock()->recordUse(bucket);
+				m_shader.lock()->recordValue(bucket, "projection", currentCam.lock()->getProjectionMatrix());
+				m_shader.lock()->recordValue(bucket, "view", currentCam.lock()->getViewMatrix());
+				m_shader.lock()->recordValue(bucket, "cameraRight_worldSpace",
 						currentCam.lock()->getEntity().lock()->getComponent<Transform>().lock()->worldRightAxis());
-				m_shader.lock()->uploadValue("cameraUp_worldSpace",
+				m_shader.lock()->recordValue(bucket, "cameraUp_worldSpace",
 						currentCam.lock()->getEntity().lock()->getComponent<Transform>().lock()->worldUpAxis());
 				/* Bind the VAO. This sets up the opengl state we need, including the
 				vertex attribute pointers and it binds the VBO */
-				glBindVertexArray(m_VAO);
+				bucket.add<commands::BindVertexArray>()->vao = m_VAO;
 
-				glDepthMask(GL_FALSE);
+				bucket.add<commands::SetDepthMask>()->enabled = false;
 
 				for (auto& it : m_particlesMap)
 				{
-						InstanceData instances = it.second;
+						const InstanceData& instances = it.second;
 						GLuint texID = it.first;
 
 						if (instances.isTexAdditive)
 						{
-								glBlendFunc(GL_SRC_ALPHA, GL_ONE);
+								commands::SetBlendFunc* blend = bucket.add<commands::SetBlendFunc>();
+								blend->source = GL_SRC_ALPHA;
+								blend->destination = GL_ONE;
 						}
 
-						m_shader.lock()->uploadValue("texNumOfRows", instances.texNumOfRows);
+						m_shader.lock()->recordValue(bucket, "texNumOfRows", instances.texNumOfRows);
 
-						//bind the per-instance buffers
-						glBindBuffer(GL_ARRAY_BUFFER, m_VBOs[BufferObjects::INSTANCED_ATTRIBS]);
-						//upload the data
-						glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(InstanceAttributes) * instances.instanceAttribs.size(), instances.instanceAttribs.data());
+						uint dataSize = static_cast<uint>(sizeof(InstanceAttributes) * instances.instanceAttribs.size());
 
-						glBindTexture(GL_TEXTURE_2D, texID);
+						//upload the per-instance data
+						commands::UploadBuffer* upload = bucket.add<commands::UploadBuffer>();
+						upload->target = GL_ARRAY_BUFFER;
+						upload->buffer = m_VBOs[BufferObjects::INSTANCED_ATTRIBS];
+						upload->offset = 0;
+						upload->size = dataSize;
+						upload->usage = GL_STREAM_DRAW;
+						upload->reallocate = false;
+						upload->data = bucket.copyAuxMemory(instances.instanceAttribs.data(), dataSize);
 
-						glDrawElementsInstanced(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0, instances.instanceAttribs.size());
+						commands::BindTexture* bind = bucket.add<commands::BindTexture>();
+						bind->slot = 0;
+						bind->target = GL_TEXTURE_2D;
+						bind->texture = texID;
+
+						commands::DrawElementsInstanced* draw = bucket.add<commands::DrawElementsInstanced>();
+						draw->mode = GL_TRIANGLES;
+						draw->indexCount = 6;
+						draw->indexOffset = 0;
+						draw->instanceCount = static_cast<uint>(instances.instanceAttribs.size());
+						draw->baseVertex = 0;
 
 						if (instances.isTexAdditive)
 						{
-								glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+								commands::SetBlendFunc* blend = bucket.add<commands::SetBlendFunc>();
+								blend->source = GL_SRC_ALPHA;
+								blend->destination = GL_ONE_MINUS_SRC_ALPHA;
 						}
 				}
 
-				glDepthMask(GL_TRUE);
+				bucket.add<commands::SetDepthMask>()->enabled = true;
 
 				//unbind the vao
-				glBindVertexArray(0);
+				bucket.add<commands::BindVertexArray>()->vao = 0;
+
+				m_shader.lock()->recordUnUse(bucket);
 
-				m_shader.lock()->unUse();
+				submitCommands();
 		}
 		void ParticleRenderer::dispose()
 		{
 				//Dispose of all the buffest if they have't been disposed already
 
+				if (RenderBackend::isNull())
+				{
+						m_VAO = 0;
+						for (size_t i = 0; i < BufferObjects::NUM_BUFFERS; i++)
+						{
+								m_VBOs[i] = 0;
+						}
+						return;
+				}
+
 				if (m_VAO != 0)
 				{
 						glDeleteVertexArrays(1, &m_VAO);
@@ -70,6 +70,13 @@ namespace cogs
 				//key = texture id (all sprites of the same texture to be instanced rendered)
 				//value = instance data = per instance data
 				std::unordered_map<unsigned int, InstanceData> m_particlesMap;
+
+				//scratch buffers of the particles of a system, component by component for the batched frustum test
+				std::vector<float> m_cullX;
+				std::vector<float> m_cullY;
+				std::vector<float> m_cullZ;
+				std::vector<float> m_cullRadius;
+				std::vector<unsigned int> m_visibleParticles; ///< indices of the particles in the frustum
 		};
 }
 #endif //!PARTICLE_RENDERER_H
\ No newline at end of file
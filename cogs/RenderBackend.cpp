@@ -0,0 +1,124 @@
+#include "RenderBackend.h"
+
+#include "CommandBucket.h"
+
+#include <GL\glew.h>
+
+namespace cogs
+{
+		RenderBackendType RenderBackend::s_type = RenderBackendType::OPENGL;
+		RenderStats RenderBackend::s_stats;
+		RenderCaps RenderBackend::s_caps;
+		uint RenderBackend::s_lastNullHandle = 0;
+
+		void RenderBackend::setType(RenderBackendType _type)
+		{
+				s_type = _type;
+
+				if (s_type == RenderBackendType::NULL_BACKEND)
+				{
+						detectCaps();
+				}
+		}
+
+		void RenderBackend::detectCaps()
+		{
+				if (s_type == RenderBackendType::NULL_BACKEND)
+				{
+						s_caps.baseInstance = true;
+						s_caps.multiDrawIndirect = true;
+						s_caps.computeShaders = true;
+						return;
+				}
+
+				s_caps.baseInstance = GLEW_VERSION_4_2 || GLEW_ARB_base_instance;
+				//the multi draws index the instance data with the base instance, so both are needed
+				s_caps.multiDrawIndirect = s_caps.baseInstance && (GLEW_VERSION_4_3 || GLEW_ARB_multi_draw_indirect);
+				s_caps.computeShaders = GLEW_VERSION_4_3 || (GLEW_ARB_compute_shader && GLEW_ARB_shader_storage_buffer_object);
+		}
+
+		void RenderBackend::execute(const CommandBucket& _bucket)
+		{
+				accumulateStats(_bucket);
+
+				if (s_type == RenderBackendType::OPENGL)
+				{
+						_bucket.submit();
+				}
+		}
+
+		void RenderBackend::accumulateStats(const CommandBucket& _bucket)
+		{
+				for (const CommandBucket::Packet& packet : _bucket.getPackets())
+				{
+						s_stats.commands++;
+
+						switch (packet.type)
+						{
+						case CommandType::DRAW_ELEMENTS_INSTANCED:
+						{
+								const commands::DrawElementsInstanced* draw = static_cast<const commands::DrawElementsInstanced*>(packet.command);
+								s_stats.drawCalls++;
+								s_stats.instances += draw->instanceCount;
+								s_stats.triangles += (draw->indexCount / 3) * draw->instanceCount;
+								break;
+						}
+						case CommandType::MULTI_DRAW_ELEMENTS_INDIRECT:
+						{
+								const commands::MultiDrawElementsIndirect* draw = static_cast<const commands::MultiDrawElementsIndirect*>(packet.command);
+								s_stats.drawCalls++;
+								s_stats.indirectDraws += draw->drawCount;
+								for (uint i = 0; i < draw->drawCount; i++)
+								{
+										s_stats.instances += draw->draws[i].instanceCount;
+										s_stats.triangles += (draw->draws[i].count / 3) * draw->draws[i].instanceCount;
+								}
+								break;
+						}
+						case CommandType::UPLOAD_BUFFER:
+						{
+								const commands::UploadBuffer* upload = static_cast<const commands::UploadBuffer*>(packet.command);
+								s_stats.bufferUploads++;
+								s_stats.bytesUploaded += upload->size;
+								break;
+						}
+						case CommandType::SET_UNIFORM_MAT4:
+						case CommandType::SET_UNIFORM_VEC4:
+						case CommandType::SET_UNIFORM_VEC3:
+						case CommandType::SET_UNIFORM_VEC2:
+						case CommandType::SET_UNIFORM_FLOAT:
+						case CommandType::SET_UNIFORM_INT:
+						{
+								s_stats.uniformUploads++;
+								break;
+						}
+						case CommandType::USE_PROGRAM:
+						case CommandType::BIND_TEXTURE:
+						case CommandType::BIND_VERTEX_ARRAY:
+						case CommandType::BIND_BUFFER_BASE:
+						case CommandType::BIND_INSTANCE_MAT4:
+						case CommandType::BIND_FRAMEBUFFER:
+						case CommandType::SET_BLEND_FUNC:
+						case CommandType::SET_DEPTH_MASK:
+						case CommandType::SET_DEPTH_FUNC:
+						case CommandType::SET_COLOR_MASK:
+						{
+								s_stats.stateChanges++;
+								break;
+						}
+						case CommandType::CLEAR:
+						{
+								s_stats.clears++;
+								break;
+						}
+						case CommandType::DISPATCH_COMPUTE:
+						{
+								s_stats.dispatches++;
+								break;
+						}
+						default:
+								break;
+						}
+				}
+		}
+}
@@ -0,0 +1,108 @@
+#ifndef RENDER_BACKEND_H
+#define RENDER_BACKEND_H
+
+#include <cstddef>
+
+namespace cogs
+{
+		class CommandBucket;
+
+		using uint = unsigned int;
+
+		/**
+		* \brief The backends command buckets can be executed with
+		*/
+		enum class RenderBackendType
+		{
+				OPENGL,					///< commands are executed with OpenGL (requires a window and a GL context)
+				NULL_BACKEND	///< no GL calls are made, commands are only counted (for CPU benchmarks on display-less machines)
+		};
+
+		/**
+		* \brief Counters of everything that was (or would have been) sent to the GPU
+		*/
+		struct RenderStats
+		{
+				size_t commands{ 0 };						///< total number of executed commands
+				size_t drawCalls{ 0 };						///< number of draw calls
+				size_t indirectDraws{ 0 };				///< number of draws packed into multi-draw-indirect calls
+				size_t instances{ 0 };						///< number of instances drawn
+				size_t triangles{ 0 };						///< number of triangles drawn
+				size_t bytesUploaded{ 0 };		///< bytes uploaded to buffer objects
+				size_t bufferUploads{ 0 };		///< number of buffer uploads
+				size_t stateChanges{ 0 };			///< program/vao/texture/framebuffer binds and blend/depth state changes
+				size_t uniformUploads{ 0 };	///< number of uniform values set
+				size_t clears{ 0 };										///< number of framebuffer clears
+				size_t dispatches{ 0 };							///< number of compute dispatches
+
+				void reset() { *this = RenderStats(); }
+		};
+
+		/**
+		* \brief Optional GL features the renderers can take faster paths with
+		*/
+		struct RenderCaps
+		{
+				bool baseInstance{ false };						///< glDraw*BaseInstance (GL 4.2 or ARB_base_instance)
+				bool multiDrawIndirect{ false };		///< glMultiDrawElementsIndirect (GL 4.3 or ARB_multi_draw_indirect)
+				bool computeShaders{ false };				///< compute shaders and shader storage buffers (GL 4.3 or ARB_compute_shader + ARB_shader_storage_buffer_object)
+		};
+
+		/**
+		* \brief Static class which selects the backend and executes command buckets with it.
+		* The backend must be selected before any GL resource (shader, mesh, texture, renderer) is created,
+		* with the null backend those objects get fake handles and never touch GL
+		*/
+		class RenderBackend
+		{
+		public:
+				/**
+				* \brief Select the backend, call before creating any resources
+				*/
+				static void setType(RenderBackendType _type);
+				static RenderBackendType getType() noexcept { return s_type; }
+				static bool isNull() noexcept { return s_type == RenderBackendType::NULL_BACKEND; }
+
+				/**
+				* \brief Queries the optional features of the current GL context, called by the window after GL is initialized.
+				* The null backend reports every feature as supported so the CPU side of every path can be measured
+				*/
+				static void detectCaps();
+				static const RenderCaps& getCaps() noexcept { return s_caps; }
+
+				/**
+				* \brief Executes the commands of the bucket with the selected backend and accumulates them in the stats
+				*/
+				static void execute(const CommandBucket& _bucket);
+
+				/**
+				* \brief Generates a unique fake handle for GL objects created with the null backend,
+				* so that everything keyed by GL handles (e.g. batching by vao/texture) behaves like on the GL backend
+				*/
+				static uint generateNullHandle() noexcept { return ++s_lastNullHandle; }
+				static void generateNullHandles(uint _count, uint* _handles) noexcept
+				{
+						for (uint i = 0; i < _count; i++)
+						{
+								_handles[i] = generateNullHandle();
+						}
+				}
+
+				/**
+				* \brief Stats of all buckets executed since the last reset
+				*/
+				static const RenderStats& getStats() noexcept { return s_stats; }
+				static void resetStats() { s_stats.reset(); }
+
+		private:
+				static void accumulateStats(const CommandBucket& _bucket);
+
+		private:
+				static RenderBackendType s_type; ///< the selected backend
+				static RenderStats s_stats; ///< the accumulated stats
+				static RenderCaps s_caps; ///< the features of the current context
+				static uint s_lastNullHandle; ///< the last fake handle generated
+		};
+}
+
+#endif // !RENDER_BACKEND_H
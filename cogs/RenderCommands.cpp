@@ -0,0 +1,282 @@
+#include "RenderCommands.h"
+#include "RenderBackend.h"
+
+#include <GL\glew.h>
+
+namespace cogs
+{
+		namespace backend
+		{
+				void useProgram(const void* _data)
+				{
+						const commands::UseProgram* cmd = static_cast<const commands::UseProgram*>(_data);
+						glUseProgram(cmd->program);
+				}
+
+				void setUniformMat4(const void* _data)
+				{
+						const commands::SetUniformMat4* cmd = static_cast<const commands::SetUniformMat4*>(_data);
+						glUniformMatrix4fv(cmd->location, 1, GL_FALSE, cmd->value);
+				}
+
+				void setUniformVec4(const void* _data)
+				{
+						const commands::SetUniformVec4* cmd = static_cast<const commands::SetUniformVec4*>(_data);
+						glUniform4fv(cmd->location, 1, cmd->value);
+				}
+
+				void setUniformVec3(const void* _data)
+				{
+						const commands::SetUniformVec3* cmd = static_cast<const commands::SetUniformVec3*>(_data);
+						glUniform3fv(cmd->location, 1, cmd->value);
+				}
+
+				void setUniformVec2(const void* _data)
+				{
+						const commands::SetUniformVec2* cmd = static_cast<const commands::SetUniformVec2*>(_data);
+						glUniform2fv(cmd->location, 1, cmd->value);
+				}
+
+				void setUniformFloat(const void* _data)
+				{
+						const commands::SetUniformFloat* cmd = static_cast<const commands::SetUniformFloat*>(_data);
+						glUniform1f(cmd->location, cmd->value);
+				}
+
+				void setUniformInt(const void* _data)
+				{
+						const commands::SetUniformInt* cmd = static_cast<const commands::SetUniformInt*>(_data);
+						glUniform1i(cmd->location, cmd->value);
+				}
+
+				void bindTexture(const void* _data)
+				{
+						const commands::BindTexture* cmd = static_cast<const commands::BindTexture*>(_data);
+						glActiveTexture(GL_TEXTURE0 + cmd->slot);
+						glBindTexture(cmd->target, cmd->texture);
+						if (cmd->slot != 0)
+						{
+								glActiveTexture(GL_TEXTURE0);
+						}
+				}
+
+				void bindVertexArray(const void* _data)
+				{
+						const commands::BindVertexArray* cmd = static_cast<const commands::BindVertexArray*>(_data);
+						glBindVertexArray(cmd->vao);
+				}
+
+				void bindBufferBase(const void* _data)
+				{
+						const commands::BindBufferBase* cmd = static_cast<const commands::BindBufferBase*>(_data);
+						glBindBufferBase(cmd->target, cmd->index, cmd->buffer);
+				}
+
+				void bindFramebuffer(const void* _data)
+				{
+						const commands::BindFramebuffer* cmd = static_cast<const commands::BindFramebuffer*>(_data);
+						glBindFramebuffer(GL_FRAMEBUFFER, cmd->fbo);
+						glViewport(0, 0, cmd->width, cmd->height);
+				}
+
+				void uploadBuffer(const void* _data)
+				{
+						const commands::UploadBuffer* cmd = static_cast<const commands::UploadBuffer*>(_data);
+						glBindBuffer(cmd->target, cmd->buffer);
+						if (cmd->reallocate)
+						{
+								glBufferData(cmd->target, cmd->size, cmd->data, cmd->usage);
+						}
+						else
+						{
+								glBufferSubData(cmd->target, cmd->offset, cmd->size, cmd->data);
+						}
+				}
+
+				void drawElementsInstanced(const void* _data)
+				{
+						const commands::DrawElementsInstanced* cmd = static_cast<const commands::DrawElementsInstanced*>(_data);
+						glDrawElementsInstancedBaseVertex(cmd->mode, cmd->indexCount, GL_UNSIGNED_INT,
+								(const void*)(size_t)cmd->indexOffset, cmd->instanceCount, cmd->baseVertex);
+				}
+
+				void multiDrawElementsIndirect(const void* _data)
+				{
+						const commands::MultiDrawElementsIndirect* cmd = static_cast<const commands::MultiDrawElementsIndirect*>(_data);
+
+						if (RenderBackend::getCaps().multiDrawIndirect)
+						{
+								glBindBuffer(GL_DRAW_INDIRECT_BUFFER, cmd->buffer);
+								glMultiDrawElementsIndirect(cmd->mode, GL_UNSIGNED_INT, (const void*)(size_t)cmd->offset, cmd->drawCount, 0);
+								return;
+						}
+
+						for (uint i = 0; i < cmd->drawCount; i++)
+						{
+								const DrawElementsIndirectCommand& draw = cmd->draws[i];
+								glDrawElementsInstancedBaseVertexBaseInstance(cmd->mode, draw.count, GL_UNSIGNED_INT,
+										(const void*)(sizeof(unsigned int) * draw.firstIndex), draw.instanceCount, draw.baseVertex, draw.baseInstance);
+						}
+				}
+
+				void bindInstanceMat4(const void* _data)
+				{
+						const commands::BindInstanceMat4* cmd = static_cast<const commands::BindInstanceMat4*>(_data);
+						glBindBuffer(GL_ARRAY_BUFFER, cmd->buffer);
+
+						const uint matrixSize = sizeof(float) * (cmd->compact ? 12 : 16);
+						const uint stride = matrixSize + (cmd->materialParams ? sizeof(uint) : 0);
+
+						for (uint i = 0; i < (cmd->compact ? 3u : 4u); i++)
+						{
+								glVertexAttribPointer(cmd->location + i, 4, GL_FLOAT, GL_FALSE, stride,
+										(const void*)(cmd->offset + sizeof(float) * i * 4));
+						}
+
+						//the last column of compact instances comes from the constant attribute value instead
+						if (cmd->compact)
+						{
+								glDisableVertexAttribArray(cmd->location + 3);
+								glVertexAttrib4f(cmd->location + 3, 0.0f, 0.0f, 0.0f, 0.0f);
+						}
+						else
+						{
+								glEnableVertexAttribArray(cmd->location + 3);
+						}
+
+						if (cmd->materialParams)
+						{
+								glEnableVertexAttribArray(cmd->location + 4);
+								glVertexAttribIPointer(cmd->location + 4, 1, GL_UNSIGNED_INT, stride, (const void*)(size_t)(cmd->offset + matrixSize));
+								glVertexAttribDivisor(cmd->location + 4, 1);
+						}
+						else
+						{
+								glDisableVertexAttribArray(cmd->location + 4);
+								glVertexAttribI4ui(cmd->location + 4, 0, 0, 0, 0);
+						}
+				}
+
+				void setBlendFunc(const void* _data)
+				{
+						const commands::SetBlendFunc* cmd = static_cast<const commands::SetBlendFunc*>(_data);
+						glBlendFunc(cmd->source, cmd->destination);
+				}
+
+				void setDepthMask(const void* _data)
+				{
+						const commands::SetDepthMask* cmd = static_cast<const commands::SetDepthMask*>(_data);
+						glDepthMask(cmd->enabled ? GL_TRUE : GL_FALSE);
+				}
+
+				void setDepthFunc(const void* _data)
+				{
+						const commands::SetDepthFunc* cmd = static_cast<const commands::SetDepthFunc*>(_data);
+						glDepthFunc(cmd->func);
+				}
+
+				void setColorMask(const void* _data)
+				{
+						const commands::SetColorMask* cmd = static_cast<const commands::SetColorMask*>(_data);
+						GLboolean enabled = cmd->enabled ? GL_TRUE : GL_FALSE;
+						glColorMask(enabled, enabled, enabled, enabled);
+				}
+
+				void clear(const void* _data)
+				{
+						const commands::Clear* cmd = static_cast<const commands::Clear*>(_data);
+						glClearColor(cmd->color[0], cmd->color[1], cmd->color[2], cmd->color[3]);
+						glClear(cmd->mask);
+				}
+
+				void dispatchCompute(const void* _data)
+				{
+						const commands::DispatchCompute* cmd = static_cast<const commands::DispatchCompute*>(_data);
+						glDispatchCompute(cmd->numGroupsX, cmd->numGroupsY, cmd->numGroupsZ);
+				}
+
+				void setMemoryBarrier(const void* _data)
+				{
+						const commands::SetMemoryBarrier* cmd = static_cast<const commands::SetMemoryBarrier*>(_data);
+						glMemoryBarrier(cmd->barriers);
+				}
+
+				void callback(const void* _data)
+				{
+						const commands::Callback* cmd = static_cast<const commands::Callback*>(_data);
+						cmd->function(cmd->userData);
+				}
+		}
+
+		namespace commands
+		{
+				const CommandType UseProgram::TYPE = CommandType::USE_PROGRAM;
+				const BackendDispatchFunction UseProgram::DISPATCH_FUNCTION = &backend::useProgram;
+
+				const CommandType SetUniformMat4::TYPE = CommandType::SET_UNIFORM_MAT4;
+				const BackendDispatchFunction SetUniformMat4::DISPATCH_FUNCTION = &backend::setUniformMat4;
+
+				const CommandType SetUniformVec4::TYPE = CommandType::SET_UNIFORM_VEC4;
+				const BackendDispatchFunction SetUniformVec4::DISPATCH_FUNCTION = &backend::setUniformVec4;
+
+				const CommandType SetUniformVec3::TYPE = CommandType::SET_UNIFORM_VEC3;
+				const BackendDispatchFunction SetUniformVec3::DISPATCH_FUNCTION = &backend::setUniformVec3;
+
+				const CommandType SetUniformVec2::TYPE = CommandType::SET_UNIFORM_VEC2;
+				const BackendDispatchFunction SetUniformVec2::DISPATCH_FUNCTION = &backend::setUniformVec2;
+
+				const CommandType SetUniformFloat::TYPE = CommandType::SET_UNIFORM_FLOAT;
+				const BackendDispatchFunction SetUniformFloat::DISPATCH_FUNCTION = &backend::setUniformFloat;
+
+				const CommandType SetUniformInt::TYPE = CommandType::SET_UNIFORM_INT;
+				const BackendDispatchFunction SetUniformInt::DISPATCH_FUNCTION = &backend::setUniformInt;
+
+				const CommandType BindTexture::TYPE = CommandType::BIND_TEXTURE;
+				const BackendDispatchFunction BindTexture::DISPATCH_FUNCTION = &backend::bindTexture;
+
+				const CommandType BindVertexArray::TYPE = CommandType::BIND_VERTEX_ARRAY;
+				const BackendDispatchFunction BindVertexArray::DISPATCH_FUNCTION = &backend::bindVertexArray;
+
+				const CommandType BindBufferBase::TYPE = CommandType::BIND_BUFFER_BASE;
+				const BackendDispatchFunction BindBufferBase::DISPATCH_FUNCTION = &backend::bindBufferBase;
+
+				const CommandType BindFramebuffer::TYPE = CommandType::BIND_FRAMEBUFFER;
+				const BackendDispatchFunction BindFramebuffer::DISPATCH_FUNCTION = &backend::bindFramebuffer;
+
+				const CommandType UploadBuffer::TYPE = CommandType::UPLOAD_BUFFER;
+				const BackendDispatchFunction UploadBuffer::DISPATCH_FUNCTION = &backend::uploadBuffer;
+
+				const CommandType DrawElementsInstanced::TYPE = CommandType::DRAW_ELEMENTS_INSTANCED;
+				const BackendDispatchFunction DrawElementsInstanced::DISPATCH_FUNCTION = &backend::drawElementsInstanced;
+
+				const CommandType MultiDrawElementsIndirect::TYPE = CommandType::MULTI_DRAW_ELEMENTS_INDIRECT;
+				const BackendDispatchFunction MultiDrawElementsIndirect::DISPATCH_FUNCTION = &backend::multiDrawElementsIndirect;
+
+				const CommandType BindInstanceMat4::TYPE = CommandType::BIND_INSTANCE_MAT4;
+				const BackendDispatchFunction BindInstanceMat4::DISPATCH_FUNCTION = &backend::bindInstanceMat4;
+
+				const CommandType SetBlendFunc::TYPE = CommandType::SET_BLEND_FUNC;
+				const BackendDispatchFunction SetBlendFunc::DISPATCH_FUNCTION = &backend::setBlendFunc;
+
+				const CommandType SetDepthMask::TYPE = CommandType::SET_DEPTH_MASK;
+				const BackendDispatchFunction SetDepthMask::DISPATCH_FUNCTION = &backend::setDepthMask;
+
+				const CommandType SetDepthFunc::TYPE = CommandType::SET_DEPTH_FUNC;
+				const BackendDispatchFunction SetDepthFunc::DISPATCH_FUNCTION = &backend::setDepthFunc;
+
+				const CommandType SetColorMask::TYPE = CommandType::SET_COLOR_MASK;
+				const BackendDispatchFunction SetColorMask::DISPATCH_FUNCTION = &backend::setColorMask;
+
+				const CommandType Clear::TYPE = CommandType::CLEAR;
+				const BackendDispatchFunction Clear::DISPATCH_FUNCTION = &backend::clear;
+
+				const CommandType DispatchCompute::TYPE = CommandType::DISPATCH_COMPUTE;
+				const BackendDispatchFunction DispatchCompute::DISPATCH_FUNCTION = &backend::dispatchCompute;
+
+				const CommandType SetMemoryBarrier::TYPE = CommandType::MEMORY_BARRIER;
+				const BackendDispatchFunction SetMemoryBarrier::DISPATCH_FUNCTION = &backend::setMemoryBarrier;
+
+				const CommandType Callback::TYPE = CommandType::USER_CALLBACK;
+				const BackendDispatchFunction Callback::DISPATCH_FUNCTION = &backend::callback;
+		}
+}
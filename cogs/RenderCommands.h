@@ -0,0 +1,326 @@
+#ifndef RENDER_COMMANDS_H
+#define RENDER_COMMANDS_H
+
+namespace cogs
+{
+		using uint = unsigned int;
+
+		/**
+		* \brief Function which executes a single recorded command on the backend
+		*/
+		using BackendDispatchFunction = void(*)(const void*);
+
+		/**
+		* \brief Identifies the type of a recorded command (used for stats and non-GL backends)
+		*/
+		enum class CommandType : unsigned char
+		{
+				USE_PROGRAM,
+				SET_UNIFORM_MAT4,
+				SET_UNIFORM_VEC4,
+				SET_UNIFORM_VEC3,
+				SET_UNIFORM_VEC2,
+				SET_UNIFORM_FLOAT,
+				SET_UNIFORM_INT,
+				BIND_TEXTURE,
+				BIND_VERTEX_ARRAY,
+				BIND_BUFFER_BASE,
+				BIND_FRAMEBUFFER,
+				UPLOAD_BUFFER,
+				DRAW_ELEMENTS_INSTANCED,
+				MULTI_DRAW_ELEMENTS_INDIRECT,
+				BIND_INSTANCE_MAT4,
+				SET_BLEND_FUNC,
+				SET_DEPTH_MASK,
+				SET_DEPTH_FUNC,
+				SET_COLOR_MASK,
+				CLEAR,
+				DISPATCH_COMPUTE,
+				MEMORY_BARRIER,
+				USER_CALLBACK,
+
+				NUM_COMMANDS
+		};
+
+		/**
+		* \brief A single draw in a GL_DRAW_INDIRECT_BUFFER, laid out as GL expects it
+		*/
+		struct DrawElementsIndirectCommand
+		{
+				uint count;									///< number of indices
+				uint instanceCount;			///< number of instances
+				uint firstIndex;						///< offset into the index buffer in indices
+				int baseVertex;								///< added to every index
+				uint baseInstance;				///< offset of the first instance into the instanced attributes
+		};
+
+		/**
+		* \brief Plain-old-data render commands which get recorded in a CommandBucket
+		* and executed later (possibly on a different thread) by the backend.
+		* Commands never own memory, any data they point to lives in the bucket's aux memory
+		*/
+		namespace commands
+		{
+				/** \brief glUseProgram */
+				struct UseProgram
+				{
+						static const CommandType TYPE;
+						static const BackendDispatchFunction DISPATCH_FUNCTION;
+
+						uint program;
+				};
+
+				/** \brief glUniformMatrix4fv */
+				struct SetUniformMat4
+				{
+						static const CommandType TYPE;
+						static const BackendDispatchFunction DISPATCH_FUNCTION;
+
+						int location;
+						float value[16];
+				};
+
+				/** \brief glUniform4fv */
+				struct SetUniformVec4
+				{
+						static const CommandType TYPE;
+						static const BackendDispatchFunction DISPATCH_FUNCTION;
+
+						int location;
+						float value[4];
+				};
+
+				/** \brief glUniform3fv */
+				struct SetUniformVec3
+				{
+						static const CommandType TYPE;
+						static const BackendDispatchFunction DISPATCH_FUNCTION;
+
+						int location;
+						float value[3];
+				};
+
+				/** \brief glUniform2fv */
+				struct SetUniformVec2
+				{
+						static const CommandType TYPE;
+						static const BackendDispatchFunction DISPATCH_FUNCTION;
+
+						int location;
+						float value[2];
+				};
+
+				/** \brief glUniform1f */
+				struct SetUniformFloat
+				{
+						static const CommandType TYPE;
+						static const BackendDispatchFunction DISPATCH_FUNCTION;
+
+						int location;
+						float value;
+				};
+
+				/** \brief glUniform1i */
+				struct SetUniformInt
+				{
+						static const CommandType TYPE;
+						static const BackendDispatchFunction DISPATCH_FUNCTION;
+
+						int location;
+						int value;
+				};
+
+				/** \brief glActiveTexture + glBindTexture (texture unit 0 is left active afterwards) */
+				struct BindTexture
+				{
+						static const CommandType TYPE;
+						static const BackendDispatchFunction DISPATCH_FUNCTION;
+
+						uint slot;
+						uint target;
+						uint texture;
+				};
+
+				/** \brief glBindVertexArray */
+				struct BindVertexArray
+				{
+						static const CommandType TYPE;
+						static const BackendDispatchFunction DISPATCH_FUNCTION;
+
+						uint vao;
+				};
+
+				/** \brief glBindBufferBase (uniform blocks, storage buffers) */
+				struct BindBufferBase
+				{
+						static const CommandType TYPE;
+						static const BackendDispatchFunction DISPATCH_FUNCTION;
+
+						uint target;
+						uint index;
+						uint buffer;
+				};
+
+				/** \brief glBindFramebuffer + glViewport */
+				struct BindFramebuffer
+				{
+						static const CommandType TYPE;
+						static const BackendDispatchFunction DISPATCH_FUNCTION;
+
+						uint fbo;
+						int width;
+						int height;
+				};
+
+				/**
+				* \brief Uploads data to a buffer object.
+				* If reallocate is set the whole buffer storage is respecified with glBufferData,
+				* otherwise glBufferSubData is used at the given offset
+				*/
+				struct UploadBuffer
+				{
+						static const CommandType TYPE;
+						static const BackendDispatchFunction DISPATCH_FUNCTION;
+
+						uint target;
+						uint buffer;
+						uint offset;
+						uint size;
+						uint usage;
+						bool reallocate;
+						const void* data;
+				};
+
+				/** \brief glDrawElementsInstancedBaseVertex with unsigned int indices */
+				struct DrawElementsInstanced
+				{
+						static const CommandType TYPE;
+						static const BackendDispatchFunction DISPATCH_FUNCTION;
+
+						uint mode;
+						uint indexCount;
+						uint indexOffset; ///< offset into the bound index buffer in bytes
+						uint instanceCount;
+						int baseVertex;
+				};
+
+				/**
+				* \brief glMultiDrawElementsIndirect with unsigned int indices from the given indirect buffer.
+				* draws points to a CPU copy of the draws in the buffer (in the bucket's aux memory), used for the stats
+				* and to issue them one by one with glDrawElementsInstancedBaseVertexBaseInstance if multi draw isn't supported
+				*/
+				struct MultiDrawElementsIndirect
+				{
+						static const CommandType TYPE;
+						static const BackendDispatchFunction DISPATCH_FUNCTION;
+
+						uint mode;
+						uint buffer;
+						uint offset; ///< offset of the first draw into the indirect buffer in bytes
+						uint drawCount;
+						const DrawElementsIndirectCommand* draws;
+				};
+
+				/**
+				* \brief Points the mat4 instance attribute at location..location+3 of the bound vao to a buffer,
+				* so many vaos and batches can read their instances from one shared buffer.
+				* Compact instances are the first three rows of affine matrices (48 bytes), the fourth column is then read as (0, 0, 0, 0)
+				* so the shader can tell them apart from full matrices (see decodeWorldMat in Test/Shaders/Basic3DShader.vert).
+				* With material params every matrix is followed by the uint index of its params block, read at location + 4, otherwise that reads 0
+				*/
+				struct BindInstanceMat4
+				{
+						static const CommandType TYPE;
+						static const BackendDispatchFunction DISPATCH_FUNCTION;
+
+						uint location;
+						uint buffer;
+						uint offset; ///< offset of the first instance into the buffer in bytes
+						bool compact;
+						bool materialParams;
+				};
+
+				/** \brief glBlendFunc */
+				struct SetBlendFunc
+				{
+						static const CommandType TYPE;
+						static const BackendDispatchFunction DISPATCH_FUNCTION;
+
+						uint source;
+						uint destination;
+				};
+
+				/** \brief glDepthMask */
+				struct SetDepthMask
+				{
+						static const CommandType TYPE;
+						static const BackendDispatchFunction DISPATCH_FUNCTION;
+
+						bool enabled;
+				};
+
+				/** \brief glDepthFunc */
+				struct SetDepthFunc
+				{
+						static const CommandType TYPE;
+						static const BackendDispatchFunction DISPATCH_FUNCTION;
+
+						uint func;
+				};
+
+				/** \brief glColorMask, enabling or disabling all channels at once */
+				struct SetColorMask
+				{
+						static const CommandType TYPE;
+						static const BackendDispatchFunction DISPATCH_FUNCTION;
+
+						bool enabled;
+				};
+
+				/** \brief glClearColor + glClear */
+				struct Clear
+				{
+						static const CommandType TYPE;
+						static const BackendDispatchFunction DISPATCH_FUNCTION;
+
+						uint mask;
+						float color[4];
+				};
+
+				/** \brief glDispatchCompute with the program in use */
+				struct DispatchCompute
+				{
+						static const CommandType TYPE;
+						static const BackendDispatchFunction DISPATCH_FUNCTION;
+
+						uint numGroupsX;
+						uint numGroupsY;
+						uint numGroupsZ;
+				};
+
+				/** \brief glMemoryBarrier, makes the writes of earlier dispatches visible to the uses given by the barrier bits */
+				struct SetMemoryBarrier
+				{
+						static const CommandType TYPE;
+						static const BackendDispatchFunction DISPATCH_FUNCTION;
+
+						uint barriers;
+				};
+
+				/**
+				* \brief Calls back into user code on the backend thread,
+				* for systems that haven't been converted to commands yet (skybox, debug draw, gui).
+				* The user data must stay alive until the bucket has been executed
+				*/
+				struct Callback
+				{
+						static const CommandType TYPE;
+						static const BackendDispatchFunction DISPATCH_FUNCTION;
+
+						void(*function)(void*);
+						void* userData;
+				};
+		}
+}
+
+#endif // !RENDER_COMMANDS_H
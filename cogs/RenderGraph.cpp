@@ -0,0 +1,366 @@
+#include "RenderGraph.h"
+
+#include "Framebuffer.h"
+#include "RenderBackend.h"
+
+#include <stdexcept>
+#include <algorithm>
+#include <cassert>
+
+namespace cogs
+{
+		RenderResource RenderGraph::PassBuilder::create(const std::string& _name, const RenderTargetDesc& _desc)
+		{
+				Resource resource;
+				resource.name = _name;
+				resource.desc = _desc;
+
+				m_graph.m_resources.push_back(resource);
+
+				RenderResource handle = static_cast<RenderResource>(m_graph.m_resources.size() - 1);
+				m_graph.m_passes[m_pass].writes.push_back(handle);
+				return handle;
+		}
+
+		RenderResource RenderGraph::PassBuilder::read(RenderResource _resource)
+		{
+				assert(_resource >= 0 && _resource < (int)m_graph.m_resources.size());
+				m_graph.m_passes[m_pass].reads.push_back(_resource);
+				return _resource;
+		}
+
+		RenderResource RenderGraph::PassBuilder::write(RenderResource _resource)
+		{
+				assert(_resource >= 0 && _resource < (int)m_graph.m_resources.size());
+				m_graph.m_passes[m_pass].writes.push_back(_resource);
+				return _resource;
+		}
+
+		RenderResource RenderGraph::importFramebuffer(const std::string& _name, std::weak_ptr<Framebuffer> _framebuffer)
+		{
+				Resource resource;
+				resource.name = _name;
+				resource.imported = true;
+				resource.framebuffer = _framebuffer;
+
+				m_resources.push_back(resource);
+				return static_cast<RenderResource>(m_resources.size() - 1);
+		}
+
+		void RenderGraph::addPass(const std::string& _name, const SetupFunction& _setup, const ExecuteFunction& _execute)
+		{
+				Pass pass;
+				pass.name = _name;
+				pass.execute = _execute;
+				m_passes.push_back(pass);
+
+				PassBuilder builder(*this, static_cast<int>(m_passes.size() - 1));
+				_setup(builder);
+		}
+
+		void RenderGraph::compile()
+		{
+				cullPasses();
+				sortPasses();
+				allocateTransients();
+		}
+
+		void RenderGraph::execute()
+		{
+				for (int passIndex : m_executionOrder)
+				{
+						const Pass& pass = m_passes[passIndex];
+
+						if (!pass.writes.empty())
+						{
+								recordSetActive(m_resources[pass.writes.front()].framebuffer);
+						}
+
+						if (pass.execute)
+						{
+								pass.execute(*this);
+						}
+				}
+
+				//leave the window's framebuffer bound for whatever comes after the graph
+				recordSetActive(std::weak_ptr<Framebuffer>());
+		}
+
+		void RenderGraph::recordSetActive(std::weak_ptr<Framebuffer> _framebuffer)
+		{
+				//the bucket is fetched for every switch, the render thread swaps it on every kick()
+				CommandBucket& bucket = m_renderThread != nullptr ? m_renderThread->getSubmissionBucket() : m_immediateBucket;
+				Framebuffer::recordSetActive(bucket, _framebuffer);
+
+				//without a render thread the target has to be bound before the pass draws
+				if (m_renderThread == nullptr)
+				{
+						RenderBackend::execute(m_immediateBucket);
+						m_immediateBucket.clear();
+				}
+		}
+
+		void RenderGraph::reset()
+		{
+				m_resources.clear();
+				m_passes.clear();
+				m_executionOrder.clear();
+		}
+
+		std::weak_ptr<Framebuffer> RenderGraph::getFramebuffer(RenderResource _resource) const
+		{
+				if (_resource < 0 || _resource >= (int)m_resources.size())
+				{
+						return std::weak_ptr<Framebuffer>();
+				}
+				return m_resources[_resource].framebuffer;
+		}
+
+		void RenderGraph::cullPasses()
+		{
+				//a resource is needed if it's imported or an alive pass reads it,
+				//a pass is alive if it has side effects or writes a needed resource
+				std::vector<bool> needed(m_resources.size(), false);
+				for (size_t i = 0; i < m_resources.size(); i++)
+				{
+						needed[i] = m_resources[i].imported;
+				}
+
+				for (Pass& pass : m_passes)
+				{
+						pass.culled = true;
+				}
+
+				//iterate until nothing changes, so the declaration order of the passes doesn't matter
+				bool changed{ true };
+				while (changed)
+				{
+						changed = false;
+						for (Pass& pass : m_passes)
+						{
+								if (!pass.culled)
+								{
+										continue;
+								}
+
+								bool alive = pass.sideEffect;
+								for (RenderResource write : pass.writes)
+								{
+										alive = alive || needed[write];
+								}
+
+								if (alive)
+								{
+										pass.culled = false;
+										changed = true;
+
+										//everything it reads is needed, and so is everything it writes (earlier writers to it must stay)
+										for (RenderResource read : pass.reads)
+										{
+												needed[read] = true;
+										}
+										for (RenderResource write : pass.writes)
+										{
+												needed[write] = true;
+										}
+								}
+						}
+				}
+
+				m_numCulledPasses = 0;
+				for (const Pass& pass : m_passes)
+				{
+						if (pass.culled)
+						{
+								m_numCulledPasses++;
+						}
+				}
+		}
+
+		void RenderGraph::sortPasses()
+		{
+				const size_t numPasses = m_passes.size();
+
+				std::vector<std::vector<int>> dependents(numPasses);
+				std::vector<int> numDependencies(numPasses, 0);
+
+				auto addEdge = [&](int _from, int _to)
+				{
+						if (_from != _to)
+						{
+								dependents[_from].push_back(_to);
+								numDependencies[_to]++;
+						}
+				};
+
+				//in declaration order, a reader sees the contents of the last writer declared before it,
+				//so it runs after that writer and before the next one (ping-pong targets, reused targets)
+				for (size_t r = 0; r < m_resources.size(); r++)
+				{
+						int lastWriter{ -1 };
+						std::vector<int> readersSinceWrite;
+
+						for (size_t p = 0; p < numPasses; p++)
+						{
+								if (m_passes[p].culled)
+								{
+										continue;
+								}
+
+								const std::vector<RenderResource>& reads = m_passes[p].reads;
+								const std::vector<RenderResource>& writes = m_passes[p].writes;
+								const bool isRead = std::find(reads.begin(), reads.end(), (RenderResource)r) != reads.end();
+								const bool isWritten = std::find(writes.begin(), writes.end(), (RenderResource)r) != writes.end();
+
+								if (isRead)
+								{
+										if (lastWriter != -1)
+										{
+												addEdge(lastWriter, (int)p);
+										}
+										readersSinceWrite.push_back((int)p);
+								}
+
+								if (isWritten)
+								{
+										if (lastWriter != -1)
+										{
+												addEdge(lastWriter, (int)p);
+										}
+										//the readers of the previous contents must be done before they're overwritten
+										for (int reader : readersSinceWrite)
+										{
+												addEdge(reader, (int)p);
+										}
+										readersSinceWrite.clear();
+										lastWriter = (int)p;
+								}
+						}
+				}
+
+				//topological sort, picking the earliest declared pass among the ready ones to keep the order stable
+				m_executionOrder.clear();
+				std::vector<bool> scheduled(numPasses, false);
+				size_t numAlive = numPasses - m_numCulledPasses;
+
+				while (m_executionOrder.size() < numAlive)
+				{
+						int next{ -1 };
+						for (size_t p = 0; p < numPasses; p++)
+						{
+								if (!m_passes[p].culled && !scheduled[p] && numDependencies[p] == 0)
+								{
+										next = (int)p;
+										break;
+								}
+						}
+
+						if (next == -1)
+						{
+								throw std::runtime_error("Render graph has a dependency cycle!");
+						}
+
+						scheduled[next] = true;
+						m_executionOrder.push_back(next);
+						for (int dependent : dependents[next])
+						{
+								numDependencies[dependent]--;
+						}
+				}
+		}
+
+		void RenderGraph::allocateTransients()
+		{
+				//release framebuffers which haven't been needed for a while
+				for (size_t i = 0; i < m_pool.size();)
+				{
+						if (m_pool[i].unusedFrames > s_maxUnusedFrames)
+						{
+								m_pool.erase(m_pool.begin() + i);
+						}
+						else
+						{
+								m_pool[i].inUse = false;
+								i++;
+						}
+				}
+
+				//lifetimes of the resources in execution order
+				for (int order = 0; order < (int)m_executionOrder.size(); order++)
+				{
+						const Pass& pass = m_passes[m_executionOrder[order]];
+
+						auto use = [&](RenderResource _resource)
+						{
+								Resource& resource = m_resources[_resource];
+								if (resource.firstUse == -1)
+								{
+										resource.firstUse = order;
+								}
+								resource.lastUse = order;
+						};
+
+						for (RenderResource read : pass.reads)
+						{
+								use(read);
+						}
+						for (RenderResource write : pass.writes)
+						{
+								use(write);
+						}
+				}
+
+				std::vector<bool> usedThisFrame(m_pool.size(), false);
+				m_numTransients = 0;
+
+				//assign framebuffers to transients when their lifetime starts, and give them back when it ends
+				for (int order = 0; order < (int)m_executionOrder.size(); order++)
+				{
+						for (Resource& resource : m_resources)
+						{
+								if (!resource.imported && resource.firstUse == order)
+								{
+										resource.poolIndex = acquireFramebuffer(resource.desc);
+										resource.framebuffer = m_pool[resource.poolIndex].framebuffer;
+
+										usedThisFrame.resize(m_pool.size(), false);
+										usedThisFrame[resource.poolIndex] = true;
+										m_numTransients++;
+								}
+						}
+
+						for (Resource& resource : m_resources)
+						{
+								if (!resource.imported && resource.lastUse == order)
+								{
+										m_pool[resource.poolIndex].inUse = false;
+								}
+						}
+				}
+
+				for (size_t i = 0; i < m_pool.size(); i++)
+				{
+						m_pool[i].unusedFrames = usedThisFrame[i] ? 0 : m_pool[i].unusedFrames + 1;
+				}
+		}
+
+		int RenderGraph::acquireFramebuffer(const RenderTargetDesc& _desc)
+		{
+				for (size_t i = 0; i < m_pool.size(); i++)
+				{
+						if (!m_pool[i].inUse && m_pool[i].desc.width == _desc.width && m_pool[i].desc.height == _desc.height)
+						{
+								m_pool[i].inUse = true;
+								return static_cast<int>(i);
+						}
+				}
+
+				PooledFramebuffer pooled;
+				pooled.framebuffer = Framebuffer::create(_desc.width, _desc.height);
+				pooled.desc = _desc;
+				pooled.inUse = true;
+				m_pool.push_back(pooled);
+
+				return static_cast<int>(m_pool.size() - 1);
+		}
+}
@@ -0,0 +1,188 @@
+#ifndef RENDER_GRAPH_H
+#define RENDER_GRAPH_H
+
+#include "CommandBucket.h"
+#include "RenderThread.h"
+
+#include <memory>
+#include <vector>
+#include <string>
+#include <functional>
+
+namespace cogs
+{
+		class Framebuffer;
+
+		using uint = unsigned int;
+
+		/**
+		* \brief Handle of a render target declared in the render graph
+		*/
+		using RenderResource = int;
+
+		static const RenderResource INVALID_RENDER_RESOURCE = -1;
+
+		/**
+		* \brief Description of a transient render target (color texture + depth buffer, as created by Framebuffer::create)
+		*/
+		struct RenderTargetDesc
+		{
+				uint width{ 0 };
+				uint height{ 0 };
+		};
+
+		/**
+		* \brief A frame's render passes and the render targets they read and write.
+		* The graph is rebuilt every frame: passes are declared with addPass(), then compile() culls the passes
+		* whose results are never used, orders them by their dependencies and assigns framebuffers to the transient targets.
+		* Transient targets whose lifetimes don't overlap share the same framebuffer, and framebuffers are pooled across frames.
+		* Imported targets (a camera's render target or the window) are owned outside of the graph and are never culled
+		*/
+		class RenderGraph
+		{
+		public:
+				/**
+				* \brief Used in the setup function of a pass to declare what it reads and writes
+				*/
+				class PassBuilder
+				{
+				public:
+						/**
+						* \brief Declares a new transient render target written by this pass
+						*/
+						RenderResource create(const std::string& _name, const RenderTargetDesc& _desc);
+
+						/**
+						* \brief Declares that this pass samples the render target, it sees what the last pass declared before it wrote there
+						*/
+						RenderResource read(RenderResource _resource);
+
+						/**
+						* \brief Declares that this pass renders into the render target,
+						* the first target written is the one bound when the pass executes
+						*/
+						RenderResource write(RenderResource _resource);
+
+						/**
+						* \brief Keeps the pass even if nothing reads its results (e.g. gui, debug output, readbacks)
+						*/
+						void setSideEffect() { m_graph.m_passes[m_pass].sideEffect = true; }
+
+				private:
+						friend class RenderGraph;
+						PassBuilder(RenderGraph& _graph, int _pass) : m_graph(_graph), m_pass(_pass) {}
+
+						RenderGraph& m_graph;
+						int m_pass;
+				};
+
+				using SetupFunction = std::function<void(PassBuilder&)>;
+				using ExecuteFunction = std::function<void(const RenderGraph&)>;
+
+				RenderGraph() {}
+				~RenderGraph() {}
+
+				/**
+				* \brief Imports a render target owned outside of the graph
+				* \param[in] _framebuffer - the framebuffer, an empty pointer means the window's (default) framebuffer
+				*/
+				RenderResource importFramebuffer(const std::string& _name, std::weak_ptr<Framebuffer> _framebuffer);
+
+				/**
+				* \brief Adds a pass, _setup is called right away to declare the pass's reads/writes,
+				* _execute is called from execute() with the pass's render target bound
+				*/
+				void addPass(const std::string& _name, const SetupFunction& _setup, const ExecuteFunction& _execute);
+
+				/**
+				* \brief Culls, orders the passes and assigns framebuffers to the transient targets
+				*/
+				void compile();
+
+				/**
+				* \brief Executes the compiled passes in order, the switch to the render target of a pass is recorded as a command before it
+				*/
+				void execute();
+
+				/**
+				* \brief Set the render thread whose submission bucket execute() records the render target switches into, in order with the
+				* commands the passes record. If it's nullptr (default) they are recorded into the graph's own bucket and executed right away
+				*/
+				void setRenderThread(RenderThread* _renderThread) { m_renderThread = _renderThread; }
+
+				/**
+				* \brief Removes all passes and resources for the next frame, keeping the pooled framebuffers
+				*/
+				void reset();
+
+				/**
+				* \brief Gets the framebuffer assigned to a resource during execution (empty for the window's framebuffer)
+				*/
+				std::weak_ptr<Framebuffer> getFramebuffer(RenderResource _resource) const;
+
+				/**
+				* \brief stats of the last compiled frame
+				*/
+				size_t getNumPasses()								const noexcept { return m_passes.size(); }
+				size_t getNumCulledPasses()			const noexcept { return m_numCulledPasses; }
+				size_t getNumTransients()					const noexcept { return m_numTransients; }
+				size_t getNumPooledFramebuffers() const noexcept { return m_pool.size(); }
+
+		private:
+				struct Resource
+				{
+						std::string name;
+						RenderTargetDesc desc;
+						bool imported{ false };
+						std::weak_ptr<Framebuffer> framebuffer; ///< imported framebuffer or the one assigned from the pool
+						int poolIndex{ -1 }; ///< pool entry assigned to a transient
+						int firstUse{ -1 }; ///< index in the execution order of the first pass using it
+						int lastUse{ -1 }; ///< index in the execution order of the last pass using it
+				};
+
+				struct Pass
+				{
+						std::string name;
+						ExecuteFunction execute;
+						std::vector<RenderResource> reads;
+						std::vector<RenderResource> writes;
+						bool sideEffect{ false };
+						bool culled{ false };
+				};
+
+				struct PooledFramebuffer
+				{
+						std::shared_ptr<Framebuffer> framebuffer;
+						RenderTargetDesc desc;
+						bool inUse{ false }; ///< assigned to a transient whose lifetime hasn't ended yet
+						int unusedFrames{ 0 }; ///< number of frames it wasn't used in
+				};
+
+				/**
+				* \brief records the bind of a render target, executed right away without a render thread
+				*/
+				void recordSetActive(std::weak_ptr<Framebuffer> _framebuffer);
+
+				void cullPasses();
+				void sortPasses();
+				void allocateTransients();
+
+				int acquireFramebuffer(const RenderTargetDesc& _desc);
+
+		private:
+				std::vector<Resource> m_resources;
+				std::vector<Pass> m_passes;
+				std::vector<int> m_executionOrder; ///< indices of the alive passes in execution order
+				std::vector<PooledFramebuffer> m_pool; ///< framebuffers kept across frames for transients
+
+				RenderThread* m_renderThread{ nullptr }; ///< the render thread executing the target switches, if any
+				CommandBucket m_immediateBucket; ///< bucket used when no render thread is set
+
+				size_t m_numCulledPasses{ 0 };
+				size_t m_numTransients{ 0 };
+
+				static const int s_maxUnusedFrames = 60; ///< pooled framebuffers unused for this many frames are released
+		};
+}
+
+#endif // !RENDER_GRAPH_H
@@ -0,0 +1,112 @@
+#include "RenderThread.h"
+
+#include "Window.h"
+#include "RenderBackend.h"
+
+namespace cogs
+{
+		RenderThread::RenderThread()
+		{
+		}
+
+		RenderThread::~RenderThread()
+		{
+				stop();
+		}
+
+		void RenderThread::start(Window* _window)
+		{
+				if (m_running)
+				{
+						return;
+				}
+
+				m_window = _window;
+				m_stopRequested = false;
+				m_frameReady = false;
+				m_running = true;
+
+				//the context can only be current on one thread at a time
+				m_window->releaseContext();
+
+				m_thread = std::thread(&RenderThread::run, this);
+		}
+
+		void RenderThread::stop()
+		{
+				if (!m_running)
+				{
+						return;
+				}
+
+				{
+						std::unique_lock<std::mutex> lock(m_mutex);
+						m_stopRequested = true;
+				}
+				m_condition.notify_all();
+
+				m_thread.join();
+				m_running = false;
+
+				//give the context back to the calling thread
+				m_window->makeCurrent();
+		}
+
+		void RenderThread::kick()
+		{
+				if (!m_running)
+				{
+						//nobody to hand the bucket to, execute it here
+						RenderBackend::execute(m_buckets[m_submissionIndex]);
+						m_buckets[m_submissionIndex].clear();
+						return;
+				}
+
+				std::unique_lock<std::mutex> lock(m_mutex);
+				//wait for the previous frame, its bucket becomes the next submission bucket
+				m_condition.wait(lock, [this] { return !m_frameReady; });
+
+				m_submissionIndex = 1 - m_submissionIndex;
+				m_frameReady = true;
+
+				lock.unlock();
+				m_condition.notify_all();
+		}
+
+		void RenderThread::waitForFrame()
+		{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				m_condition.wait(lock, [this] { return !m_frameReady; });
+		}
+
+		void RenderThread::run()
+		{
+				m_window->makeCurrent();
+
+				while (true)
+				{
+						std::unique_lock<std::mutex> lock(m_mutex);
+						m_condition.wait(lock, [this] { return m_frameReady || m_stopRequested; });
+
+						if (!m_frameReady && m_stopRequested)
+						{
+								break;
+						}
+						lock.unlock();
+
+						//the bucket that isn't being recorded into is the one that was kicked
+						CommandBucket& bucket = m_buckets[1 - m_submissionIndex];
+						RenderBackend::execute(bucket);
+						bucket.clear();
+
+						m_window->swapBuffer();
+
+						lock.lock();
+						m_frameReady = false;
+						lock.unlock();
+						m_condition.notify_all();
+				}
+
+				m_window->releaseContext();
+		}
+}
@@ -0,0 +1,77 @@
+#ifndef RENDER_THREAD_H
+#define RENDER_THREAD_H
+
+#include "CommandBucket.h"
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+namespace cogs
+{
+		class Window;
+
+		/**
+		* \brief Executes recorded command buckets on a dedicated thread which owns the GL context.
+		* The game thread records frame N+1 into the submission bucket while the render thread executes frame N.
+		* While the thread is running, the game thread must not issue GL calls directly,
+		* systems that still need them can record a commands::Callback instead
+		*/
+		class RenderThread
+		{
+		public:
+				RenderThread();
+				~RenderThread();
+
+				RenderThread(const RenderThread&) = delete;
+				RenderThread& operator=(const RenderThread&) = delete;
+
+				/**
+				* \brief Releases the window's GL context from the calling thread and starts the render thread with it
+				* \param[in] _window - the window to render and swap buffers to
+				*/
+				void start(Window* _window);
+
+				/**
+				* \brief Finishes the frame in flight, stops the thread and makes the GL context current on the calling thread again
+				*/
+				void stop();
+
+				/**
+				* \brief Hands the submission bucket over to the render thread and starts executing it.
+				* Waits for the previous frame to finish first, so there is at most one frame in flight
+				*/
+				void kick();
+
+				/**
+				* \brief Blocks until the render thread has finished executing the last kicked frame
+				*/
+				void waitForFrame();
+
+				/**
+				* \brief The bucket the game thread should record the next frame into.
+				* kick() swaps the buckets, so fetch it again every frame instead of keeping the reference
+				*/
+				CommandBucket& getSubmissionBucket() noexcept { return m_buckets[m_submissionIndex]; }
+
+				bool isRunning() const noexcept { return m_running; }
+
+		private:
+				void run();
+
+		private:
+				Window* m_window{ nullptr }; ///< the window which owns the GL context
+
+				CommandBucket m_buckets[2]; ///< double buffered buckets
+				int m_submissionIndex{ 0 }; ///< index of the bucket the game thread records into
+
+				std::thread m_thread; ///< the render thread
+				std::mutex m_mutex; ///< guards the flags below
+				std::condition_variable m_condition; ///< signals frame kick-off/completion
+				bool m_frameReady{ false }; ///< the game thread kicked a frame which isn't executed yet
+				bool m_stopRequested{ false }; ///< the thread should exit
+				bool m_running{ false }; ///< the thread is running
+		};
+}
+
+#endif // !RENDER_THREAD_H
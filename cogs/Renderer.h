@@ -1,6 +1,10 @@
 #ifndef RENDERER_H
 #define RENDERER_H
 
+#include "CommandBucket.h"
+#include "RenderBackend.h"
+#include "RenderThread.h"
+
 #include <memory>
 
 namespace cogs
@@ -36,9 +40,33 @@ namespace cogs
 				virtual void dispose() = 0;
 				//Set the shader to render with
 				void setShader(std::weak_ptr<GLSLProgram> _shader) { m_shader = _shader; }
+				/**
+				* \brief Set the render thread whose submission bucket flush() records its commands into, the thread executes them after its next kick().
+				* The bucket is fetched again on every flush(), since every kick() swaps it for the one the render thread just finished.
+				* Buckets or pointers into them must never be kept past a kick().
+				* If it's nullptr (default) the renderer records into its own bucket and executes it immediately at the end of flush()
+				*/
+				void setRenderThread(RenderThread* _renderThread) { m_renderThread = _renderThread; }
+
+		protected:
+				//Get the bucket to record commands into, only valid until the end of the current flush
+				CommandBucket& getCommandBucket() { return m_renderThread != nullptr ? m_renderThread->getSubmissionBucket() : m_immediateBucket; }
+				//Executes the recorded commands if the renderer is in immediate mode (called at the end of flush)
+				void submitCommands()
+				{
+						if (m_renderThread == nullptr)
+						{
+								RenderBackend::execute(m_immediateBucket);
+								m_immediateBucket.clear();
+						}
+				}
 
 		protected:
 				std::weak_ptr<GLSLProgram> m_shader; ///< shader to render with
+
+		private:
+				RenderThread* m_renderThread{ nullptr }; ///< the render thread executing the recorded commands, if any
+				CommandBucket m_immediateBucket; ///< bucket used when no external one is set
 		};
 }
 
@@ -25,6 +25,14 @@ namespace cogs
 		}
 		void Renderer2D::init()
 		{
+				if (RenderBackend::isNull())
+				{
+						//no GL objects with the null backend, just unique handles to batch by
+						m_VAO = RenderBackend::generateNullHandle();
+						RenderBackend::generateNullHandles(BufferObjects::NUM_BUFFERS, m_VBOs);
+						return;
+				}
+
 				//generate the vertex array buffer
 				glGenVertexArrays(1, &m_VAO);
 
@@ -99,6 +107,16 @@ namespace cogs
 				//The transform values of the sprite
 				std::weak_ptr<Transform> transform = _entity.lock()->getComponent<Transform>();
 
+				//the quad of the sprite is centered on its transform, neighbouring sprites are mostly culled by the same plane
+				const glm::vec3 halfSize = glm::vec3(sprite.lock()->getSize() * 0.5f, 0.0f);
+				std::weak_ptr<Camera> currentCam = Camera::getCurrent();
+				unsigned int planeMask = Frustum::ALL_PLANES;
+				if (!currentCam.expired() &&
+						currentCam.lock()->getFrustum().boxInFrustum(-halfSize, halfSize, transform.lock()->worldTransform(), planeMask, m_cullingPlane) == Containment::OUTSIDE)
+				{
+						return;
+				}
+
 				auto iter = m_spritesMap.find(texture.lock()->getTextureID());
 
 				//check if it's not in the map
@@ -119,35 +137,51 @@ namespace cogs
 		{
 				std::weak_ptr<Camera> currentCam = Camera::getCurrent();
 
-				m_shader.lock()->use();
-				m_shader.lock()->uploadValue("projection", currentCam.lock()->getProjectionMatrix());
-				m_shader.lock()->uploadValue("view", currentCam.lock()->getViewMatrix());
+				CommandBucket& bucket = getCommandBucket();
+
+				m_shader.lock()->recordUse(bucket);
+				m_shader.lock()->recordValue(bucket, "projection", currentCam.lock()->getProjectionMatrix());
+				m_shader.lock()->recordValue(bucket, "view", currentCam.lock()->getViewMatrix());
 				/* Bind the VAO. This sets up the opengl state we need, including the
 				vertex attribute pointers and it binds the VBO */
-				glBindVertexArray(m_VAO);
-
-				//glDepthMask(GL_FALSE);
+				bucket.add<commands::BindVertexArray>()->vao = m_VAO;
 
 				for (auto& it : m_spritesMap)
 				{
-						std::vector<InstancedAttributes> instances = it.second;
+						const std::vector<InstancedAttributes>& instances = it.second;
 						GLuint texID = it.first;
-						//bind the per-instance buffers
-						glBindBuffer(GL_ARRAY_BUFFER, m_VBOs[BufferObjects::INSTANCED_ATTRIBS]);
-						//upload the data
-						glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(InstancedAttributes) * instances.size(), instances.data());
-
-						glBindTexture(GL_TEXTURE_2D, texID);
 
-						glDrawElementsInstanced(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0, instances.size());
+						uint dataSize = static_cast<uint>(sizeof(InstancedAttributes) * instances.size());
+
+						//upload the per-instance data
+						commands::UploadBuffer* upload = bucket.add<commands::UploadBuffer>();
+						upload->target = GL_ARRAY_BUFFER;
+						upload->buffer = m_VBOs[BufferObjects::INSTANCED_ATTRIBS];
+						upload->offset = 0;
+						upload->size = dataSize;
+						upload->usage = GL_STREAM_DRAW;
+						upload->reallocate = false;
+						upload->data = bucket.copyAuxMemory(instances.data(), dataSize);
+
+						commands::BindTexture* bind = bucket.add<commands::BindTexture>();
+						bind->slot = 0;
+						bind->target = GL_TEXTURE_2D;
+						bind->texture = texID;
+
+						commands::DrawElementsInstanced* draw = bucket.add<commands::DrawElementsInstanced>();
+						draw->mode = GL_TRIANGLES;
+						draw->indexCount = 6;
+						draw->indexOffset = 0;
+						draw->instanceCount = static_cast<uint>(instances.size());
+						draw->baseVertex = 0;
 				}
 
-				//glDepthMask(GL_TRUE);
-
 				//unbind the vao
-				glBindVertexArray(0);
+				bucket.add<commands::BindVertexArray>()->vao = 0;
+
+				m_shader.lock()->recordUnUse(bucket);
 
-				m_shader.lock()->unUse();
+				submitCommands();
 		}
 
 		void Renderer2D::begin()
@@ -164,6 +198,16 @@ namespace cogs
 		{
 				//Dispose of all the buffest if they have't been disposed already
 
+				if (RenderBackend::isNull())
+				{
+						m_VAO = 0;
+						for (size_t i = 0; i < BufferObjects::NUM_BUFFERS; i++)
+						{
+								m_VBOs[i] = 0;
+						}
+						return;
+				}
+
 				if (m_VAO != 0)
 				{
 						glDeleteVertexArrays(1, &m_VAO);
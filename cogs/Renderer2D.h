@@ -75,6 +75,7 @@ namespace cogs
 
 				VAO m_VAO{ 0 }; ///< the vao to be used
 				VBO m_VBOs[BufferObjects::NUM_BUFFERS] = { 0 }; ///< the vbos
+				unsigned int m_cullingPlane{ 0 }; ///< the frustum plane which culled the last sprite
 
 				struct InstancedAttributes
 				{
@@ -6,8 +6,10 @@
 #include "Light.h"
 #include "Mesh.h"
 #include "Entity.h"
+#include "OcclusionCuller.h"
 
 #include <GL\glew.h>
+#include <algorithm>
 
 namespace cogs
 {
@@ -19,16 +21,33 @@ namespace cogs
 		}
 		Renderer3D::~Renderer3D()
 		{
+				dispose();
 		}
 		void Renderer3D::init()
 		{
 
 		}
 		void Renderer3D::submit(std::weak_ptr<Entity> _entity)
+		{
+				if (m_multiView)
+				{
+						//the views share one gathering of the scene, the submissions of their later passes are the same entities again
+						if (!m_viewsCulled)
+						{
+								m_viewCuller.gather(_entity.lock().get());
+						}
+						return;
+				}
+
+				submitCulled(_entity, Frustum::ALL_PLANES);
+		}
+
+		void Renderer3D::submitCulled(std::weak_ptr<Entity> _entity, unsigned int _planeMask)
 		{
 				std::weak_ptr<Camera> currentCam = Camera::getCurrent();
 
-				std::weak_ptr<Mesh> mesh = _entity.lock()->getComponent<MeshRenderer>().lock()->getMesh();
+				std::shared_ptr<MeshRenderer> meshRenderer = _entity.lock()->getComponent<MeshRenderer>().lock();
+				std::weak_ptr<Mesh> mesh = meshRenderer->getMesh();
 
 				std::weak_ptr<Transform> transform = _entity.lock()->getComponent<Transform>();
 
@@ -44,39 +63,158 @@ namespace cogs
 				const glm::vec3& scale = transform.lock()->worldScale();
 
 				//scale the radius
-				float radius = sphereBounds.m_radius * glm::max(scale.x, glm::max(scale.y, scale.z));
-				//submit the mesh if it's in the view frustum
+				const float maxScale = glm::max(scale.x, glm::max(scale.y, scale.z));
+				float radius = sphereBounds.m_radius * maxScale;
+
+				//the sphere rejects most entities, the oriented box decides for the ones it crosses the border with, as it fits long and flat meshes closer.
+				//the planes the entity crosses are the only ones its parts test
+				const Frustum& frustum = currentCam.lock()->getFrustum();
+				unsigned int planeMask = _planeMask;
+				unsigned int lastPlane = meshRenderer->getCullingPlane();
 
-				if (currentCam.lock()->sphereInFrustum(point, radius))
+				//static entities skip the planes their cached test found them inside of, or are rejected right away
+				if (m_visibilityCache.isActive() && planeMask != 0 && meshRenderer->isStatic()
+						&& !m_visibilityCache.test(meshRenderer.get(), point, radius, frustum, planeMask))
 				{
-						auto iter = m_entitiesMap.find(mesh.lock()->m_VAO);
+						return;
+				}
 
-						//check if it's not in the map
-						if (iter == m_entitiesMap.end())
+				Containment containment = Containment::INSIDE;
+				if (planeMask != 0)
+				{
+						containment = frustum.sphereInFrustum(point, radius, planeMask, lastPlane);
+				}
+				if (containment == Containment::INTERSECTS)
+				{
+						const MeshBoundingBox& boxBounds = mesh.lock()->getBoxBounds();
+						containment = frustum.boxInFrustum(boxBounds.m_min, boxBounds.m_max, toWorldMat, planeMask, lastPlane);
+				}
+				meshRenderer->setCullingPlane(lastPlane);
+
+				//submit the mesh if it's in the view frustum
+				if (containment != Containment::OUTSIDE)
+				{
+						//visible occluders get rasterized in end(), they may hide each other's instances but never their own triangles
+						if (m_occlusionCuller && meshRenderer->isOccluder() && !mesh.lock()->getOccluderIndices().empty())
 						{
-								InstanceData instance;
-								instance.mesh = mesh;
-								m_entitiesMap.insert(std::make_pair(mesh.lock()->m_VAO, instance));
+								m_occluders.push_back(std::make_pair(mesh.lock().get(), toWorldMat));
 						}
-						m_entitiesMap[mesh.lock()->m_VAO].worldmats.push_back(toWorldMat);
-				}
 
+						//view space depth of the center of the bounding sphere
+						float centerDepth = -(currentCam.lock()->getViewMatrix() * glm::vec4(point, 1.0f)).z;
+
+						//far enough away to be drawn as a billboard
+						if (m_impostorBatches.add(*mesh.lock(), toWorldMat, centerDepth - radius))
+						{
+								return;
+						}
+
+						//the parts of the entity share its params block
+						const uint params = m_instanceBatches.addMaterialParams(*meshRenderer);
+						const unsigned int lod = m_lodSelector.select(_entity.lock().get(), mesh.lock().get(), centerDepth, radius, *currentCam.lock());
+
+						m_instanceBatches.add(*currentCam.lock(), mesh, lod, toWorldMat, maxScale, centerDepth, containment, planeMask, lastPlane, params);
+				}
 		}
+
 		void Renderer3D::flush()
 		{
 				//get the current cam that will be used for space-transforms
 				std::weak_ptr<Camera> currentCam = Camera::getCurrent();
 
+				//the bucket the commands get recorded into
+				CommandBucket& bucket = getCommandBucket();
+
+				//in a frame of several views only the current camera's is drawn
+				unsigned int view = InstanceBatches::ALL_VIEWS;
+				if (m_multiView)
+				{
+						const int viewIndex = m_viewCuller.findView(currentCam.lock().get());
+						if (viewIndex < 0)
+						{
+								return;
+						}
+						view = static_cast<unsigned int>(viewIndex);
+				}
+
+				//the pre-pass is only possible if there's a shader for it
+				const bool depthPrePass = currentCam.lock()->hasDepthPrePass() && !m_depthShader.expired();
+
+				const bool indirect = usesMultiDrawIndirect();
+
+				//upload the per-instance data and the draws once, both passes draw from the same buffers
+				m_instanceBatches.buildDraws(view);
+
+				//the views of a frame share the instances, the first one drawn uploads them
+				if (!m_multiView || !m_viewInstancesUploaded)
+				{
+						m_instanceBatches.recordInstanceUpload(bucket, m_impostorBatches);
+						m_viewInstancesUploaded = m_multiView;
+				}
+				const DrawElementsIndirectCommand* draws = m_instanceBatches.recordDrawUpload(bucket, indirect);
+
+				//the entities of the scene tree are culled against the current camera on the gpu, both passes draw its results
+				const bool gpuCulling = usesGPUCulling();
+				if (gpuCulling)
+				{
+						refreshActiveStates();
+						m_gpuScene.recordCulling(bucket, *m_gpuCullingShader.lock(), currentCam.lock()->getFrustum());
+				}
+
+				//the static batches only test their chunks against the current camera, they're uploaded when they change
+				const bool staticBatches = m_staticBatches.getNumInstances() > 0;
+				if (staticBatches)
+				{
+						m_staticBatches.refitEntities();
+						refreshActiveStates();
+						m_staticBatches.cull(bucket, currentCam.lock()->getFrustum());
+				}
+
+				if (depthPrePass)
+				{
+						m_depthPrePassTimer.begin(bucket);
+
+						//lay down the depth of the opaque geometry without touching the color buffer
+						m_depthShader.lock()->recordUse(bucket);
+						m_depthShader.lock()->recordValue(bucket, "projection", currentCam.lock()->getProjectionMatrix());
+						m_depthShader.lock()->recordValue(bucket, "view", currentCam.lock()->getViewMatrix());
+
+						bucket.add<commands::SetColorMask>()->enabled = false;
+
+						m_instanceBatches.recordDraws(bucket, nullptr, draws, indirect);
+						if (gpuCulling)
+						{
+								m_gpuScene.recordDraws(bucket, nullptr);
+						}
+						if (staticBatches)
+						{
+								m_staticBatches.recordDraws(bucket, nullptr, indirect);
+						}
+
+						bucket.add<commands::SetColorMask>()->enabled = true;
+
+						m_depthShader.lock()->recordUnUse(bucket);
+
+						m_depthPrePassTimer.end(bucket);
+
+						//the main pass now only shades the visible fragments, the depth buffer is already complete
+						bucket.add<commands::SetDepthFunc>()->func = GL_EQUAL;
+						bucket.add<commands::SetDepthMask>()->enabled = false;
+				}
+
+				m_mainPassTimer.begin(bucket);
+
 				//begind using the shader this renderer uses
-				m_shader.lock()->use();
+				m_shader.lock()->recordUse(bucket);
 
 				//upload the projection and view matrices as they are the same for every entity in this render queue
-				m_shader.lock()->uploadValue("projection", currentCam.lock()->getProjectionMatrix());
-				m_shader.lock()->uploadValue("view", currentCam.lock()->getViewMatrix());
+				m_shader.lock()->recordValue(bucket, "projection", currentCam.lock()->getProjectionMatrix());
+				m_shader.lock()->recordValue(bucket, "view", currentCam.lock()->getViewMatrix());
 
-				//upload the lights as they are also the same for the whole scene
-				std::vector<std::weak_ptr<Light>> lights = Light::getAllLights();
+				//the per-instance overrides of the materials
+				m_instanceBatches.recordMaterialParams(bucket, *m_shader.lock());
 
+				//upload the lights as they are also the same for the whole scene
 				int pointLightIndex{ 0 };
 				int spotLightIndex{ 0 };
 				int dirLightIndex{ 0 };
@@ -89,17 +227,17 @@ namespace cogs
 								{
 								case LightType::POINT:
 								{
-										m_shader.lock()->uploadValue("pointLights[" + std::to_string(pointLightIndex++) + "]", light);
+										m_shader.lock()->recordValue(bucket, "pointLights[" + std::to_string(pointLightIndex++) + "]", light);
 										break;
 								}
 								case LightType::SPOT:
 								{
-										m_shader.lock()->uploadValue("spotLights[" + std::to_string(spotLightIndex++) + "]", light);
+										m_shader.lock()->recordValue(bucket, "spotLights[" + std::to_string(spotLightIndex++) + "]", light);
 										break;
 								}
 								case LightType::DIRECTIONAL:
 								{
-										m_shader.lock()->uploadValue("dirLights[" + std::to_string(dirLightIndex++) + "]", light);
+										m_shader.lock()->recordValue(bucket, "dirLights[" + std::to_string(dirLightIndex++) + "]", light);
 										break;
 								}
 								default:
@@ -109,53 +247,304 @@ namespace cogs
 						}
 				}
 
-				for (auto& it : m_entitiesMap)
+				m_instanceBatches.recordDraws(bucket, m_shader.lock().get(), draws, indirect);
+				if (gpuCulling)
+				{
+						m_gpuScene.recordDraws(bucket, m_shader.lock().get());
+				}
+				if (staticBatches)
 				{
-						InstanceData instances = it.second;
+						m_staticBatches.recordDraws(bucket, m_shader.lock().get(), indirect);
+				}
 
-						const std::vector<SubMesh>& subMeshes = instances.mesh.lock()->getSubMeshes();
-						const std::vector<std::weak_ptr<Material>>& materials = instances.mesh.lock()->getMaterials();
+				//finally unbind the current shader program
+				m_shader.lock()->recordUnUse(bucket);
 
-						//bind the per-instance buffers
-						glBindBuffer(GL_ARRAY_BUFFER, instances.mesh.lock()->m_VBOs[instances.mesh.lock()->BufferObject::WORLDMAT]);
-						//upload the data
-						glBufferData(GL_ARRAY_BUFFER, sizeof(glm::mat4) * instances.worldmats.size(), instances.worldmats.data(), GL_DYNAMIC_DRAW);
+				m_mainPassTimer.end(bucket);
 
-						glBindVertexArray(it.first);
+				//restore the default depth state
+				if (depthPrePass)
+				{
+						bucket.add<commands::SetDepthFunc>()->func = GL_LESS;
+						bucket.add<commands::SetDepthMask>()->enabled = true;
+				}
 
-						for (unsigned int i = 0; i < subMeshes.size(); i++)
-						{
-								const unsigned int materialIndex = subMeshes[i].m_materialIndex;
-								assert(materialIndex < materials.size());
+				//the billboards aren't in the pre-pass, they're drawn with the default depth test
+				if (!m_impostorBatches.empty())
+				{
+						m_impostorBatches.recordDraws(bucket, *currentCam.lock(), m_instanceBatches.getInstanceBuffer(), m_instanceBatches.getNumInstances(),
+								m_instanceBatches.getInstanceSize(), m_instanceBatches.usesCompactInstances(), m_instanceBatches.hasInstanceParams());
+				}
 
-								if (!materials.at(materialIndex).expired())
-								{
-										m_shader.lock()->uploadMaterial(materials.at(materialIndex));
-								}
+				//execute the commands right away if no external bucket is set
+				submitCommands();
+		}
+
+		void Renderer3D::dispose()
+		{
+				m_instanceBatches.dispose();
+				m_impostorBatches.dispose();
+				m_gpuScene.dispose();
+				m_staticBatches.dispose();
+		}
+
+		bool Renderer3D::usesMultiDrawIndirect() const noexcept
+		{
+				return m_multiDrawIndirect && RenderBackend::getCaps().baseInstance;
+		}
+
+		bool Renderer3D::usesGPUCulling() const noexcept
+		{
+				return m_gpuCulling && !m_gpuCullingShader.expired() && RenderBackend::getCaps().computeShaders &&
+						RenderBackend::getCaps().multiDrawIndirect && usesMultiDrawIndirect();
+		}
+
+		void Renderer3D::begin()
+		{
+				//the passes of a frame of several views share the batches of beginViews()
+				if (m_multiView)
+				{
+						return;
+				}
+
+				std::shared_ptr<Camera> camera = Camera::getCurrent().lock();
+
+				clearBatches();
+				countFrame(camera.get());
+
+				//the static entities are tested against the results of this camera
+				m_visibilityCache.begin(m_visibilityCaching ? camera.get() : nullptr);
+		}
+
+		void Renderer3D::clearBatches()
+		{
+				//the instances keep their bounds to be tested against the occluders
+				m_instanceBatches.clear(m_occlusionCuller != nullptr);
+				m_impostorBatches.clear();
+				m_occluders.clear();
+		}
+
+		void Renderer3D::countFrame(const Camera* _camera)
+		{
+				//the passes of the cameras of a frame are one frame, a camera drawn again starts the next one
+				if (std::find(m_frameCameras.begin(), m_frameCameras.end(), _camera) == m_frameCameras.end())
+				{
+						m_frameCameras.push_back(_camera);
+						return;
+				}
+				m_frameCameras.clear();
+				m_frameCameras.push_back(_camera);
 
-								glDrawElementsInstancedBaseVertex(GL_TRIANGLES, subMeshes.at(i).m_numIndices, GL_UNSIGNED_INT,
-										(void*)(sizeof(unsigned int) * subMeshes.at(i).m_baseIndex), instances.worldmats.size(),
-										subMeshes.at(i).m_baseVertex);
+				m_lodSelector.nextFrame();
+				m_visibilityCache.nextFrame();
+		}
+
+		void Renderer3D::forgetVisibility(const MeshRenderer* _meshRenderer)
+		{
+				m_visibilityCache.forget(_meshRenderer);
+		}
+
+		void Renderer3D::beginViews(const std::vector<std::weak_ptr<Camera>>& _cameras)
+		{
+				clearBatches();
+
+				//the visibility caches belong to single cameras
+				m_visibilityCache.begin(nullptr);
+
+				m_multiView = true;
+				m_viewsCulled = false;
+				m_viewInstancesUploaded = false;
+				m_viewCuller.begin(_cameras);
+				for (std::weak_ptr<Camera> view : m_viewCuller.getViews())
+				{
+						countFrame(view.lock().get());
+				}
+		}
+
+		void Renderer3D::endViews()
+		{
+				m_multiView = false;
+				m_viewCuller.clear();
+		}
+
+		void Renderer3D::cullViews()
+		{
+				//the entities in the scene tree are the ones in any of the views, unless the gpu culls them
+				if (usesSceneTree() && m_sceneTree.getNumProxies() > 0)
+				{
+						refitSceneTree();
+				}
+				if (m_useSceneTree && !usesGPUCulling() && m_sceneTree.getNumProxies() > 0)
+				{
+						m_viewCuller.gather(m_sceneTree);
+				}
+
+				m_viewCuller.cull(m_lodSelector, m_instanceBatches, m_impostorBatches);
+
+				sortBatches();
+		}
+
+		int Renderer3D::addToSceneTree(std::weak_ptr<Entity> _entity)
+		{
+				const int proxy = m_sceneTree.add(_entity.lock().get());
+				if (usesGPUCulling())
+				{
+						m_gpuScene.syncEntity(proxy, _entity.lock().get());
+				}
+				return proxy;
+		}
+
+		void Renderer3D::moveInSceneTree(int _proxy)
+		{
+				m_sceneTree.move(_proxy);
+		}
+
+		void Renderer3D::removeFromSceneTree(int _proxy)
+		{
+				m_sceneTree.remove(_proxy);
+
+				m_gpuScene.removeEntity(_proxy);
+		}
+
+		std::weak_ptr<Entity> Renderer3D::raycast(const glm::vec3& _origin, const glm::vec3& _direction, float _maxDistance, float& _distance)
+		{
+				refitSceneTree();
+				return m_sceneTree.raycast(_origin, _direction, _maxDistance, _distance);
+		}
+
+		void Renderer3D::overlapBox(const glm::vec3& _min, const glm::vec3& _max, std::vector<std::weak_ptr<Entity>>& _entities)
+		{
+				refitSceneTree();
+				m_sceneTree.overlapBox(_min, _max, _entities);
+		}
+
+		void Renderer3D::overlapSphere(const glm::vec3& _center, float _radius, std::vector<std::weak_ptr<Entity>>& _entities)
+		{
+				refitSceneTree();
+				m_sceneTree.overlapSphere(_center, _radius, _entities);
+		}
+
+		const AABBTree& Renderer3D::getSceneTree()
+		{
+				refitSceneTree();
+				return m_sceneTree.getTree();
+		}
+
+		void Renderer3D::refitSceneTree()
+		{
+				const std::vector<int>& movedProxies = m_sceneTree.refit();
+
+				//the gpu instances follow their entities
+				if (usesGPUCulling() || m_gpuScene.hasEntities())
+				{
+						for (int proxy : movedProxies)
+						{
+								m_gpuScene.syncEntity(proxy, m_sceneTree.getEntity(proxy));
 						}
+				}
+		}
 
-						glBindVertexArray(0);
+		void Renderer3D::refreshActiveStates()
+		{
+				if (Entity::getNumActiveChanges() == m_activeChanges)
+				{
+						return;
 				}
+				m_activeChanges = Entity::getNumActiveChanges();
 
-				//finally unbind the current shader program
-				m_shader.lock()->unUse();
+				m_gpuScene.refreshActiveStates();
+				m_staticBatches.refreshActiveStates();
 		}
 
-		void Renderer3D::dispose()
+		int Renderer3D::addToStaticBatches(std::weak_ptr<Entity> _entity)
 		{
+				return m_staticBatches.addEntity(_entity.lock().get());
 		}
 
-		void Renderer3D::begin()
+		void Renderer3D::moveInStaticBatches(int _instance)
+		{
+				m_staticBatches.moveEntity(_instance);
+		}
+
+		void Renderer3D::removeFromStaticBatches(int _instance)
 		{
-				m_entitiesMap.clear();
+				m_staticBatches.removeEntity(_instance);
 		}
 
 		void Renderer3D::end()
 		{
-				//TODO: possibly sorting and batching/preparing for instanced rendering ?
+				//the first end() of a frame of several views culls and batches for all of them
+				if (m_multiView)
+				{
+						if (!m_viewsCulled)
+						{
+								cullViews();
+								m_viewsCulled = true;
+						}
+						return;
+				}
+
+				std::weak_ptr<Camera> currentCam = Camera::getCurrent();
+
+				//the entities in the scene tree weren't submitted, the visible ones are found with a single query
+				if (usesSceneTree() && m_sceneTree.getNumProxies() > 0)
+				{
+						refitSceneTree();
+				}
+				if (m_useSceneTree && !usesGPUCulling() && m_sceneTree.getNumProxies() > 0)
+				{
+						m_sceneTree.queryFrustum(currentCam.lock()->getFrustum(), [this](int _proxy, unsigned int _planeMask)
+						{
+								Entity* entity = m_sceneTree.getEntity(_proxy);
+								if (entity->isActiveInHierarchy())
+								{
+										submitCulled(entity->shared_from_this(), _planeMask);
+								}
+						});
+				}
+
+				//drop the instances hidden behind the occluders before anything gets sorted
+				if (m_occlusionCuller)
+				{
+						cullOccluded();
+				}
+
+				sortBatches();
+		}
+
+		void Renderer3D::sortBatches()
+		{
+				//the depths of several views are quantized over the range of all of them
+				float nearPlane;
+				float farPlane;
+				if (m_multiView)
+				{
+						m_viewCuller.getDepthRange(nearPlane, farPlane);
+				}
+				else
+				{
+						nearPlane = Camera::getCurrent().lock()->getNear();
+						farPlane = Camera::getCurrent().lock()->getFar();
+				}
+				m_instanceBatches.sort(nearPlane, farPlane);
+		}
+
+		void Renderer3D::cullOccluded()
+		{
+				std::weak_ptr<Camera> currentCam = Camera::getCurrent();
+
+				m_occlusionCuller->begin(currentCam.lock()->getProjectionMatrix() * currentCam.lock()->getViewMatrix());
+				if (m_occluders.empty())
+				{
+						return;
+				}
+
+				for (const auto& occluder : m_occluders)
+				{
+						m_occlusionCuller->addOccluder(occluder.first->getOccluderPositions(), occluder.first->getOccluderIndices(), occluder.second);
+				}
+				m_occlusionCuller->rasterize();
+
+				m_instanceBatches.removeOccluded(*m_occlusionCuller);
 		}
-}
\ No newline at end of file
+}
@@ -2,14 +2,26 @@
 #define RENDERER3D_H
 
 #include "Renderer.h"
+#include "GPUTimer.h"
+#include "InstanceBatches.h"
+#include "SceneTree.h"
+#include "GPUScene.h"
+#include "StaticBatches.h"
+#include "LODSelector.h"
+#include "ImpostorBatches.h"
+#include "VisibilityCache.h"
+#include "ViewCuller.h"
 
-#include <unordered_map>
 #include <vector>
 #include <glm\mat4x4.hpp>
 
 namespace cogs
 {
 		class Mesh;
+		class Material;
+		class OcclusionCuller;
+		class MeshRenderer;
+		class Camera;
 		/**
 		* \brief derived class from Base Renderer to handle rendering 3D meshes
 		*/
@@ -39,27 +51,283 @@ namespace cogs
 				void submit(std::weak_ptr<Entity> _entity) override;
 
 				/**
-				* End submission and sort the sprites and put them in batches
+				* End submission and sort the instances of every batch and the batches themselves front to back
 				*/
 				void end() override;
 
 				/**
-				* \brief flush the renderer
+				* \brief flush the renderer, in a frame of several views only the view of the current camera is drawn
 				*/
 				void flush() override;
 
+				/**
+				* \brief starts a frame drawn from several cameras (split screen, render to texture monitors), at most 32.
+				* Until endViews() the scene is gathered once for all of them: begin() calls are ignored, only the entities submitted
+				* before the first end() count, that end() culls them against every view in one pass and packs the instances of all views
+				* into one buffer. Every flush() then draws the view of the current camera out of it.
+				* The lod of an instance and whether it's drawn as an impostor are picked by its closest view, submesh, meshlet and occlusion culling aren't used
+				*/
+				void beginViews(const std::vector<std::weak_ptr<Camera>>& _cameras);
+				void endViews();
+				bool isDrawingViews() const noexcept { return m_multiView; }
+
 				/**
 				* \brief disposes
 				*/
 				void dispose() override;
 
+				/**
+				* \brief set the position-only shader used for the depth pre-pass of cameras which enable it,
+				* it has to transform the vertices exactly like the main shader for the GL_EQUAL test to pass
+				*/
+				void setDepthPrePassShader(std::weak_ptr<GLSLProgram> _shader) { m_depthShader = _shader; }
+
+				/**
+				* \brief latest GPU times of the depth pre-pass and the main pass in milliseconds
+				*/
+				float getDepthPrePassTime() const noexcept { return m_depthPrePassTimer.getMilliseconds(); }
+				float getMainPassTime() const noexcept { return m_mainPassTimer.getMilliseconds(); }
+
+				/**
+				* \brief enable or disable issuing the draws as multi-draw-indirect calls, one per vao and material.
+				* Enabled by default, only used if the context supports base instance
+				*/
+				void setMultiDrawIndirect(bool _enabled) { m_multiDrawIndirect = _enabled; }
+				bool usesMultiDrawIndirect() const noexcept;
+
+				/**
+				* \brief upload the instances as the first three rows of their affine world matrices, 48 instead of 64 bytes each (off by default).
+				* The shaders drawing them have to decode both formats like decodeWorldMat of Test/Shaders/Basic3DShader.vert.
+				* The instances culled on the gpu always use full matrices
+				*/
+				void setCompactInstances(bool _enabled) { m_instanceBatches.setCompactInstances(_enabled); }
+				bool usesCompactInstances() const noexcept { return m_instanceBatches.usesCompactInstances(); }
+
+				/**
+				* \brief the largest simplification error in pixels an instance may show, the coarsest level
+				* of its mesh within it gets drawn. 0 always draws the full detail mesh, 1 by default
+				*/
+				void setLODPixelError(float _pixels) { m_lodSelector.setPixelError(_pixels); }
+				float getLODPixelError() const noexcept { return m_lodSelector.getPixelError(); }
+
+				/**
+				* \brief how much the projected size of an instance has to change past a lod threshold before it switches,
+				* as a fraction of the size, so instances near a threshold don't flicker between levels. 0.1 by default
+				*/
+				void setLODHysteresis(float _fraction) { m_lodSelector.setHysteresis(_fraction); }
+				float getLODHysteresis() const noexcept { return m_lodSelector.getHysteresis(); }
+
+				/**
+				* \brief set the shader drawing the impostor billboards (see Test/Shaders/Impostor.vert/.frag)
+				*/
+				void setImpostorShader(std::weak_ptr<GLSLProgram> _shader) { m_impostorBatches.setShader(_shader); }
+
+				/**
+				* \brief instances further away than this are drawn as one textured quad if their mesh has an impostor.
+				* 0 disables impostors (the default)
+				*/
+				void setImpostorDistance(float _distance) { m_impostorBatches.setDistance(_distance); }
+				float getImpostorDistance() const noexcept { return m_impostorBatches.getDistance(); }
+
+				/**
+				* \brief test the submeshes of visible instances against the frustum one by one, only the visible parts
+				* of a partly visible instance get drawn. Only meshes with several submeshes are affected, enabled by default
+				*/
+				void setSubMeshCulling(bool _enabled) { m_instanceBatches.setSubMeshCulling(_enabled); }
+				bool usesSubMeshCulling() const noexcept { return m_instanceBatches.usesSubMeshCulling(); }
+
+				/**
+				* \brief cull the meshlets of visible full detail instances against the frustum and by their facing,
+				* partly visible instances only draw their visible index ranges. Only meshes loaded with meshlets
+				* (see Mesh::setBuildMeshlets) are affected, enabled by default
+				*/
+				void setMeshletCulling(bool _enabled) { m_instanceBatches.setMeshletCulling(_enabled); }
+				bool usesMeshletCulling() const noexcept { return m_instanceBatches.usesMeshletCulling(); }
+
+				/**
+				* \brief cull the entities through a tree of their world bounds instead of one by one as they are submitted (off by default).
+				* Mesh renderers join the tree on their first submit and leave it when destroyed, from then on end() submits the visible ones
+				* found by a frustum query, so the cost follows the number of visible entities rather than the size of the scene.
+				* The active flags of an entity and of its parents are respected
+				*/
+				void setSceneTree(bool _enabled) { m_useSceneTree = _enabled; }
+				bool usesSceneTree() const noexcept { return m_useSceneTree || usesGPUCulling(); }
+
+				/**
+				* \brief add an entity with a mesh renderer to the scene tree, its bounds get refreshed with moveInSceneTree whenever its transform changes
+				* \return the proxy of the entity in the tree
+				*/
+				int addToSceneTree(std::weak_ptr<Entity> _entity);
+				void moveInSceneTree(int _proxy);
+				void removeFromSceneTree(int _proxy);
+
+				/**
+				* \brief the entity of the scene tree with the closest bounds hit by the ray, for picking
+				* \param[out] _distance - where the ray enters the bounds, in units of _direction
+				*/
+				std::weak_ptr<Entity> raycast(const glm::vec3& _origin, const glm::vec3& _direction, float _maxDistance, float& _distance);
+
+				/**
+				* \brief the entities of the scene tree whose bounds overlap a box or a sphere
+				* \param[out] _entities - the entities are appended
+				*/
+				void overlapBox(const glm::vec3& _min, const glm::vec3& _max, std::vector<std::weak_ptr<Entity>>& _entities);
+				void overlapSphere(const glm::vec3& _center, float _radius, std::vector<std::weak_ptr<Entity>>& _entities);
+
+				/**
+				* \brief the scene tree with the bounds of the entities which moved refreshed, e.g. to draw it
+				*/
+				const AABBTree& getSceneTree();
+
+				/**
+				* \brief test the visible instances against the depths of the occluders in software before they're drawn (none by default).
+				* The occluders are the visible entities whose mesh renderer is set as one and whose mesh has occluder triangles (see Mesh::setBuildOccluders)
+				*/
+				void setOcclusionCuller(std::shared_ptr<OcclusionCuller> _culler) { m_occlusionCuller = _culler; }
+				std::shared_ptr<OcclusionCuller> getOcclusionCuller() const noexcept { return m_occlusionCuller; }
+
+				/**
+				* \brief cull the entities of the scene tree on the gpu instead of with frustum queries (off by default), implies the scene tree.
+				* Their matrices and bounds are uploaded when they join the tree and again only when they move, every frame a compute shader
+				* culls them against the camera and writes the instances and the indirect draws, so the cpu cost doesn't grow with the scene.
+				* Needs compute shaders, multi draw indirect and the culling shader, turn it on before the entities are first drawn.
+				* The entities are drawn at full detail without impostors, submesh, meshlet or occlusion culling.
+				* An inactive entity, or one with an inactive parent, is masked in the instance buffer once the change is seen
+				*/
+				void setGPUCulling(bool _enabled) { m_gpuCulling = _enabled; }
+				bool usesGPUCulling() const noexcept;
+
+				/**
+				* \brief set the compute shader culling the entities on the gpu (see Test/Shaders/GPUCulling.comp)
+				*/
+				void setGPUCullingShader(std::weak_ptr<GLSLProgram> _shader) { m_gpuCullingShader = _shader; }
+
+				/**
+				* \brief keep the frustum test results of static mesh renderers (see MeshRenderer::setStatic) between frames, per camera (off by default).
+				* They are tested against a frustum widened by the thresholds, so the results hold while the camera stays close to where they were made.
+				* Once it moves or turns past the thresholds the results get refreshed a slice per frame, dynamic entities are tested every frame
+				*/
+				void setVisibilityCaching(bool _enabled) { m_visibilityCaching = _enabled; }
+				bool usesVisibilityCaching() const noexcept { return m_visibilityCaching; }
+
+				/**
+				* \brief how far in world units and how much in radians the camera may move and turn before the cached results get refreshed.
+				* Larger thresholds refresh less often but keep more entities near the borders of the view. 0.5 and 0.02 by default
+				*/
+				void setVisibilityCacheThresholds(float _distance, float _angle) { m_visibilityCache.setThresholds(_distance, _angle); }
+
+				/**
+				* \brief over how many frames the cached results are refreshed once the camera passed the thresholds, 8 by default
+				*/
+				void setVisibilityRefreshFrames(unsigned int _frames) { m_visibilityCache.setRefreshFrames(_frames); }
+				unsigned int getVisibilityRefreshFrames() const noexcept { return m_visibilityCache.getRefreshFrames(); }
+
+				/**
+				* \brief drops the cached results of a mesh renderer, called when it's destroyed
+				*/
+				void forgetVisibility(const MeshRenderer* _meshRenderer);
+
+				/**
+				* \brief draw static mesh renderers (see MeshRenderer::setStatic) from persistent batches instead of submitting them (off by default).
+				* They join the batches on their first submit, the instances are grouped into chunks of a grid and uploaded once,
+				* every frame only the bounds of the chunks are tested against the camera. Moving one rebuilds the batches, so un-static entities before moving them.
+				* The entities are drawn at full detail without impostors, submesh, meshlet or occlusion culling.
+				* Deactivating an entity or a parent rebuilds the batches without it, mesh renderers with material params stay out of the batches
+				*/
+				void setStaticBatching(bool _enabled) { m_staticBatching = _enabled; }
+				bool usesStaticBatching() const noexcept { return m_staticBatching; }
+
+				/**
+				* \brief the edge length of the chunks of the static batches in world units, 32 by default.
+				* Larger chunks mean fewer draws but more instances drawn outside the view
+				*/
+				void setStaticChunkSize(float _size) { m_staticBatches.setChunkSize(_size); }
+				float getStaticChunkSize() const noexcept { return m_staticBatches.getChunkSize(); }
+
+				/**
+				* \brief add an entity with a mesh renderer to the static batches, it gets refreshed with moveInStaticBatches whenever its transform changes
+				* \return the instance of the entity in the batches
+				*/
+				int addToStaticBatches(std::weak_ptr<Entity> _entity);
+				void moveInStaticBatches(int _instance);
+				void removeFromStaticBatches(int _instance);
+
+		private:
+				/**
+				* \brief submits an entity, only testing the frustum planes of the mask, 0 if it's known to be inside
+				*/
+				void submitCulled(std::weak_ptr<Entity> _entity, unsigned int _planeMask);
+
+				/**
+				* \brief refreshes the bounds of the entities which moved in the scene tree and their gpu instances
+				*/
+				void refitSceneTree();
+
+				/**
+				* \brief masks the gpu and static instances of the entities which are inactive or have an inactive parent,
+				* only checks them again after the active flag of any entity changed
+				*/
+				void refreshActiveStates();
+
+				/**
+				* \brief rasterizes the occluders of the frame and removes the hidden instances from the batches
+				*/
+				void cullOccluded();
+
+				/**
+				* \brief culls the gathered entities against all views and batches the visible ones, once per frame of several views
+				*/
+				void cullViews();
+
+				/**
+				* \brief sorts the batches front to back over the depth range of the current camera or of all views
+				*/
+				void sortBatches();
+
+				/**
+				* \brief empties the batches for the passes of a new camera or a new frame of several views
+				*/
+				void clearBatches();
+
+				/**
+				* \brief counts a frame once a camera begins again, so the ages of the lods and the cached visibilities don't depend on the number of cameras
+				*/
+				void countFrame(const Camera* _camera);
+
 		private:
-				struct InstanceData
-				{
-						std::weak_ptr<Mesh> mesh;
-						std::vector<glm::mat4> worldmats;
-				};
-				std::unordered_map<VAO, InstanceData> m_entitiesMap;
+				InstanceBatches m_instanceBatches; ///< the visible instances of the frame
+				bool m_multiDrawIndirect{ true }; ///< whether the indirect path is wanted
+
+				LODSelector m_lodSelector; ///< picks the lods of the instances
+				std::vector<const Camera*> m_frameCameras; ///< the cameras begun in the current frame
+
+				ImpostorBatches m_impostorBatches; ///< the distant instances drawn as billboards, stored behind the mesh instances
+
+				SceneTree m_sceneTree; ///< the world bounds of the entities
+				bool m_useSceneTree{ false }; ///< whether the visible entities are found with the scene tree
+
+				GPUScene m_gpuScene; ///< the entities of the scene tree culled on the gpu
+				std::weak_ptr<GLSLProgram> m_gpuCullingShader;
+				bool m_gpuCulling{ false }; ///< whether the entities of the scene tree are culled on the gpu
+				unsigned int m_activeChanges{ 0 }; ///< Entity::getNumActiveChanges() when the active states were last checked
+
+				StaticBatches m_staticBatches; ///< the static entities drawn from persistent buffers
+				bool m_staticBatching{ false }; ///< whether static entities join the static batches
+
+				std::shared_ptr<OcclusionCuller> m_occlusionCuller; ///< tests the instances against the occluders, if set
+				std::vector<std::pair<const Mesh*, glm::mat4>> m_occluders; ///< the meshes and world matrices of the visible occluders of the frame
+
+				VisibilityCache m_visibilityCache; ///< the frustum tests of the static entities kept between frames
+				bool m_visibilityCaching{ false };
+
+				ViewCuller m_viewCuller; ///< culls the entities of a frame of several views against all of them
+				bool m_multiView{ false }; ///< whether the frame is drawn from several views
+				bool m_viewsCulled{ false }; ///< whether end() was called in the frame of several views
+				bool m_viewInstancesUploaded{ false }; ///< whether a flush of the frame of several views uploaded the instances
+
+				std::weak_ptr<GLSLProgram> m_depthShader; ///< shader for the depth pre-pass
+				GPUTimer m_depthPrePassTimer; ///< gpu time of the depth pre-pass
+				GPUTimer m_mainPassTimer; ///< gpu time of the main pass
 		};
 }
 
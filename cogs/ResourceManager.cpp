@@ -58,6 +58,29 @@ namespace cogs
 				}
 		}
 
+		std::weak_ptr<GLSLProgram> ResourceManager::getComputeProgram(const std::string & _name, const std::string & _csFilePath)
+		{
+				auto iter = s_shaderMap.find(_name);
+
+				//check if it's not in the map
+				if (iter == s_shaderMap.end())
+				{
+						//if the resource does not exist, create it
+						std::shared_ptr<GLSLProgram> newShader = std::make_shared<GLSLProgram>();
+						newShader->compileComputeShader(_name, _csFilePath);
+
+						//insert it into the resource map
+						s_shaderMap.insert(std::make_pair(_name, std::move(newShader)));
+
+						return s_shaderMap.at(_name);
+				}
+				else
+				{
+						//return the found resource
+						return iter->second;
+				}
+		}
+
 		std::weak_ptr<GLTexture2D> ResourceManager::getGLTexture2D(const std::string & _filePath)
 		{
 				auto iter = s_glTex2DMap.find(_filePath);
@@ -267,6 +290,12 @@ namespace cogs
 				clearMaterials();
 				clearModels();
 				clearSprites();
+
+				//release the shared geometry buffers once no mesh lives in them anymore
+				if (MeshPool::getVertexAllocator().getUsed() == 0 && MeshPool::getIndexAllocator().getUsed() == 0)
+				{
+						MeshPool::dispose();
+				}
 		}
 
 		void ResourceManager::clearGLSLPrograms()
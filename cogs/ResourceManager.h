@@ -31,6 +31,8 @@ namespace cogs
 						const std::string& _vsFilePath,
 						const std::string& _fsFilePath,
 						const std::string& _gsFilePath = "");
+				static std::weak_ptr<GLSLProgram> getComputeProgram(const std::string& _name,
+						const std::string& _csFilePath);
 
 				/* GLTexture2D getters */
 				static std::weak_ptr<GLTexture2D> getGLTexture2D(const std::string& _filePath);
@@ -0,0 +1,98 @@
+#include "SceneTree.h"
+
+#include "Entity.h"
+#include "Mesh.h"
+#include "MeshRenderer.h"
+
+#include <glm\common.hpp>
+#include <algorithm>
+
+namespace cogs
+{
+		int SceneTree::add(const Entity* _entity)
+		{
+				return m_tree.insert(calcWorldBounds(_entity), const_cast<Entity*>(_entity));
+		}
+
+		void SceneTree::move(int _proxy)
+		{
+				//an entity may move several times a frame, the tree is only refit once before it's used
+				m_movedProxies.push_back(_proxy);
+		}
+
+		void SceneTree::remove(int _proxy)
+		{
+				m_movedProxies.erase(std::remove(m_movedProxies.begin(), m_movedProxies.end(), _proxy), m_movedProxies.end());
+				m_tree.remove(_proxy);
+		}
+
+		const std::vector<int>& SceneTree::refit()
+		{
+				m_refitProxies.clear();
+				if (m_movedProxies.empty())
+				{
+						return m_refitProxies;
+				}
+
+				std::sort(m_movedProxies.begin(), m_movedProxies.end());
+				m_movedProxies.erase(std::unique(m_movedProxies.begin(), m_movedProxies.end()), m_movedProxies.end());
+
+				for (int proxy : m_movedProxies)
+				{
+						m_tree.move(proxy, calcWorldBounds(getEntity(proxy)));
+				}
+				m_refitProxies.swap(m_movedProxies);
+				return m_refitProxies;
+		}
+
+		std::weak_ptr<Entity> SceneTree::raycast(const glm::vec3& _origin, const glm::vec3& _direction, float _maxDistance, float& _distance) const
+		{
+				int proxy = m_tree.raycast(_origin, _direction, _maxDistance, _distance);
+				if (proxy == AABBTree::NULL_NODE)
+				{
+						return std::weak_ptr<Entity>();
+				}
+				return getEntity(proxy)->shared_from_this();
+		}
+
+		void SceneTree::overlapBox(const glm::vec3& _min, const glm::vec3& _max, std::vector<std::weak_ptr<Entity>>& _entities) const
+		{
+				m_tree.queryBox(AABB{ _min, _max }, [this, &_entities](int _proxy)
+				{
+						_entities.push_back(getEntity(_proxy)->shared_from_this());
+				});
+		}
+
+		void SceneTree::overlapSphere(const glm::vec3& _center, float _radius, std::vector<std::weak_ptr<Entity>>& _entities) const
+		{
+				m_tree.querySphere(_center, _radius, [this, &_entities](int _proxy)
+				{
+						_entities.push_back(getEntity(_proxy)->shared_from_this());
+				});
+		}
+
+		AABB SceneTree::calcWorldBounds(const Entity* _entity)
+		{
+				const glm::mat4 toWorldMat = _entity->getComponent<Transform>().lock()->worldTransform();
+
+				std::shared_ptr<Mesh> mesh = _entity->getComponent<MeshRenderer>().lock()->getMesh().lock();
+				if (!mesh)
+				{
+						return AABB{ glm::vec3(toWorldMat[3]), glm::vec3(toWorldMat[3]) };
+				}
+
+				return calcWorldBounds(mesh->getBoxBounds(), toWorldMat);
+		}
+
+		AABB SceneTree::calcWorldBounds(const MeshBoundingBox& _bounds, const glm::mat4& _toWorldMat)
+		{
+				//the extent of the oriented box along every world axis
+				const glm::vec3 center = glm::vec3(_toWorldMat * glm::vec4((_bounds.m_min + _bounds.m_max) * 0.5f, 1.0f));
+				const glm::vec3 halfSize = (_bounds.m_max - _bounds.m_min) * 0.5f;
+				const glm::vec3 extent = glm::abs(glm::vec3(_toWorldMat[0])) * halfSize.x +
+						glm::abs(glm::vec3(_toWorldMat[1])) * halfSize.y +
+						glm::abs(glm::vec3(_toWorldMat[2])) * halfSize.z;
+
+				return AABB{ center - extent, center + extent };
+		}
+}
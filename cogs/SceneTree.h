@@ -0,0 +1,75 @@
+#ifndef SCENE_TREE_H
+#define SCENE_TREE_H
+
+#include "AABBTree.h"
+
+#include <glm\mat4x4.hpp>
+#include <memory>
+#include <vector>
+
+namespace cogs
+{
+		class Entity;
+		struct MeshBoundingBox;
+
+		/**
+		* \brief The world bounds of the entities with mesh renderers in a dynamic AABB tree, for culling and spatial queries.
+		* Moved entities are only refit once before the tree is used again
+		*/
+		class SceneTree
+		{
+		public:
+				/**
+				* \brief adds an entity with a mesh renderer
+				* \return the proxy of the entity in the tree
+				*/
+				int add(const Entity* _entity);
+
+				/**
+				* \brief marks an entity as moved, its bounds get refreshed by the next refit()
+				*/
+				void move(int _proxy);
+				void remove(int _proxy);
+
+				/**
+				* \brief refreshes the bounds of the entities which moved
+				* \return the proxies which were refit, valid until the next call
+				*/
+				const std::vector<int>& refit();
+
+				Entity* getEntity(int _proxy) const { return static_cast<Entity*>(m_tree.getUserData(_proxy)); }
+				size_t getNumProxies() const noexcept { return m_tree.getNumProxies(); }
+				const AABBTree& getTree() const noexcept { return m_tree; }
+
+				/**
+				* \brief calls the callback with the proxy of every entity whose bounds intersect the frustum and the planes they cross
+				*/
+				void queryFrustum(const Frustum& _frustum, const std::function<void(int, unsigned int)>& _callback) const { m_tree.queryFrustum(_frustum, _callback); }
+
+				/**
+				* \brief the entity with the closest bounds hit by the ray
+				* \param[out] _distance - where the ray enters the bounds, in units of _direction
+				*/
+				std::weak_ptr<Entity> raycast(const glm::vec3& _origin, const glm::vec3& _direction, float _maxDistance, float& _distance) const;
+
+				/**
+				* \brief the entities whose bounds overlap a box or a sphere
+				* \param[out] _entities - the entities are appended
+				*/
+				void overlapBox(const glm::vec3& _min, const glm::vec3& _max, std::vector<std::weak_ptr<Entity>>& _entities) const;
+				void overlapSphere(const glm::vec3& _center, float _radius, std::vector<std::weak_ptr<Entity>>& _entities) const;
+
+				/**
+				* \brief the world space box around the mesh of an entity, or around a model space box
+				*/
+				static AABB calcWorldBounds(const Entity* _entity);
+				static AABB calcWorldBounds(const MeshBoundingBox& _bounds, const glm::mat4& _toWorldMat);
+
+		private:
+				AABBTree m_tree; ///< the world bounds of the entities, user data is the entity
+				std::vector<int> m_movedProxies; ///< the proxies to refresh before the next query
+				std::vector<int> m_refitProxies; ///< the proxies refreshed by the last refit
+		};
+}
+
+#endif // !SCENE_TREE_H
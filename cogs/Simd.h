@@ -0,0 +1,26 @@
+#ifndef SIMD_H
+#define SIMD_H
+
+/**
+* SSE is used where the target guarantees it (always on x64, /arch:SSE2 and up on x86),
+* every SSE path has a scalar fallback computing the same results
+*/
+#if defined(_M_X64) || defined(__x86_64__) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define COGS_SSE 1
+#include <xmmintrin.h>
+#endif
+
+/**
+* Wider paths are only compiled in when the build targets them (/arch:AVX, /arch:AVX512 or -mavx, -mavx512f),
+* there is no runtime dispatch
+*/
+#if defined(__AVX__)
+#define COGS_AVX 1
+#include <immintrin.h>
+#endif
+
+#if defined(__AVX512F__)
+#define COGS_AVX512 1
+#endif
+
+#endif // !SIMD_H
@@ -3,6 +3,7 @@
 #include "Camera.h"
 #include "GLSLProgram.h"
 #include "Mesh.h"
+#include "CommandBucket.h"
 
 #include <GL\glew.h>
 #include <glm\gtc\matrix_transform.hpp>
@@ -35,6 +36,12 @@ namespace cogs
 		}
 
 		void Skybox::render()
+		{
+				std::weak_ptr<Camera> currentCamera = Camera::getCurrent();
+				render(currentCamera.lock()->getViewMatrix(), currentCamera.lock()->getProjectionMatrix());
+		}
+
+		void Skybox::render(const glm::mat4& _view, const glm::mat4& _projection)
 		{
 				m_skyboxShader.lock()->use();
 
@@ -46,12 +53,10 @@ namespace cogs
 				glCullFace(GL_FRONT);
 				glDepthFunc(GL_LEQUAL);
 
-				std::weak_ptr<Camera> currentCamera = Camera::getCurrent();
-
-				const glm::mat4& view = glm::mat4(glm::mat3(currentCamera.lock()->getViewMatrix())); // Remove any translation component of the view matrix
+				const glm::mat4& view = glm::mat4(glm::mat3(_view)); // Remove any translation component of the view matrix
 
 				m_skyboxShader.lock()->uploadValue("view", view);
-				m_skyboxShader.lock()->uploadValue("projection", currentCamera.lock()->getProjectionMatrix());
+				m_skyboxShader.lock()->uploadValue("projection", _projection);
 				m_skyboxShader.lock()->uploadValue("skybox", 0, m_cubemapTex);
 
 				m_mesh.lock()->render();
@@ -61,4 +66,29 @@ namespace cogs
 
 				m_skyboxShader.lock()->unUse();
 		}
+
+		void Skybox::recordRender(CommandBucket& _bucket)
+		{
+				//the camera may move on before the render thread gets to the callback, the matrices are copied into the bucket
+				struct RenderData
+				{
+						Skybox* skybox;
+						glm::mat4 view;
+						glm::mat4 projection;
+				};
+
+				std::weak_ptr<Camera> currentCamera = Camera::getCurrent();
+				RenderData* data = static_cast<RenderData*>(_bucket.allocateAuxMemory(sizeof(RenderData)));
+				data->skybox = this;
+				data->view = currentCamera.lock()->getViewMatrix();
+				data->projection = currentCamera.lock()->getProjectionMatrix();
+
+				commands::Callback* callback = _bucket.add<commands::Callback>();
+				callback->function = [](void* _data)
+				{
+						RenderData* renderData = static_cast<RenderData*>(_data);
+						renderData->skybox->render(renderData->view, renderData->projection);
+				};
+				callback->userData = data;
+		}
 }
\ No newline at end of file
@@ -2,9 +2,11 @@
 #define SKYBOX_H
 
 #include <memory>
+#include <glm\mat4x4.hpp>
 
 namespace cogs
 {
+		class CommandBucket;
 		class GLCubemapTexture;
 		class Mesh;
 		class GLSLProgram;
@@ -27,9 +29,18 @@ namespace cogs
 				*/
 				static std::shared_ptr<Skybox> create(std::weak_ptr<GLSLProgram> _shader, std::weak_ptr<GLCubemapTexture> m_cubemapTex, bool _isBox);
 
-				/** \brief renders the skybox */
+				/** \brief renders the skybox with the matrices of the current camera */
 				void render();
 
+				/** \brief renders the skybox with the given camera matrices, the translation of the view is ignored */
+				void render(const glm::mat4& _view, const glm::mat4& _projection);
+
+				/**
+				* \brief records a callback rendering the skybox with the matrices of the current camera, for frames executed by the render thread.
+				* The skybox isn't converted to commands yet, it has to stay alive until the bucket is executed
+				*/
+				void recordRender(CommandBucket& _bucket);
+
 				/** \brief shader and texture setters */
 				void setShader(std::weak_ptr<GLSLProgram> _shader) { m_skyboxShader = _shader; }
 				void setCubemap(std::weak_ptr<GLCubemapTexture> _texture) { m_cubemapTex = _texture; }
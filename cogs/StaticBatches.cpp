@@ -0,0 +1,448 @@
+#include "StaticBatches.h"
+
+#include "CommandBucket.h"
+#include "GLSLProgram.h"
+#include "Frustum.h"
+#include "Mesh.h"
+#include "MeshRenderer.h"
+#include "Entity.h"
+#include "RenderBackend.h"
+
+#include <GL\glew.h>
+#include <glm\geometric.hpp>
+#include <glm\gtx\hash.hpp>
+#include <algorithm>
+#include <cassert>
+#include <map>
+#include <unordered_map>
+
+namespace cogs
+{
+		StaticBatches::StaticBatches()
+		{
+				if (RenderBackend::isNull())
+				{
+						m_instanceBuffer = RenderBackend::generateNullHandle();
+						m_drawBuffer = RenderBackend::generateNullHandle();
+						return;
+				}
+
+				glGenBuffers(1, &m_instanceBuffer);
+				glGenBuffers(1, &m_drawBuffer);
+		}
+
+		StaticBatches::~StaticBatches()
+		{
+				dispose();
+		}
+
+		void StaticBatches::setChunkSize(float _size)
+		{
+				if (_size > 0.0f && _size != m_chunkSize)
+				{
+						m_chunkSize = _size;
+						m_changed = true;
+				}
+		}
+
+		int StaticBatches::add(std::weak_ptr<Mesh> _mesh, const glm::mat4& _toWorldMat)
+		{
+				int instance;
+				if (!m_freeInstances.empty())
+				{
+						instance = m_freeInstances.back();
+						m_freeInstances.pop_back();
+				}
+				else
+				{
+						instance = static_cast<int>(m_instances.size());
+						m_instances.emplace_back();
+				}
+
+				setInstance(instance, _mesh, _toWorldMat);
+				m_numInstances++;
+
+				return instance;
+		}
+
+		void StaticBatches::update(int _instance, std::weak_ptr<Mesh> _mesh, const glm::mat4& _toWorldMat)
+		{
+				setInstance(_instance, _mesh, _toWorldMat);
+		}
+
+		void StaticBatches::remove(int _instance)
+		{
+				m_instances[_instance] = Instance();
+				m_freeInstances.push_back(_instance);
+				m_numInstances--;
+				m_changed = true;
+		}
+
+		void StaticBatches::setActive(int _instance, bool _active)
+		{
+				if (m_instances[_instance].active != _active)
+				{
+						m_instances[_instance].active = _active;
+						m_changed = true;
+				}
+		}
+
+		int StaticBatches::addEntity(const Entity* _entity)
+		{
+				const int instance = add(_entity->getComponent<MeshRenderer>().lock()->getMesh(), _entity->getComponent<Transform>().lock()->worldTransform());
+				m_instances[instance].entity = _entity;
+				return instance;
+		}
+
+		void StaticBatches::moveEntity(int _instance)
+		{
+				m_movedEntities.push_back(_instance);
+		}
+
+		void StaticBatches::removeEntity(int _instance)
+		{
+				m_movedEntities.erase(std::remove(m_movedEntities.begin(), m_movedEntities.end(), _instance), m_movedEntities.end());
+				remove(_instance);
+		}
+
+		void StaticBatches::refitEntities()
+		{
+				if (m_movedEntities.empty())
+				{
+						return;
+				}
+
+				std::sort(m_movedEntities.begin(), m_movedEntities.end());
+				m_movedEntities.erase(std::unique(m_movedEntities.begin(), m_movedEntities.end()), m_movedEntities.end());
+
+				for (int instance : m_movedEntities)
+				{
+						const Entity* entity = m_instances[instance].entity;
+						setInstance(instance, entity->getComponent<MeshRenderer>().lock()->getMesh(), entity->getComponent<Transform>().lock()->worldTransform());
+
+						//a moved entity may have been attached to an inactive parent
+						setActive(instance, entity->isActiveInHierarchy());
+				}
+				m_movedEntities.clear();
+		}
+
+		void StaticBatches::refreshActiveStates()
+		{
+				for (size_t i = 0; i < m_instances.size(); i++)
+				{
+						if (m_instances[i].entity != nullptr)
+						{
+								setActive(static_cast<int>(i), m_instances[i].entity->isActiveInHierarchy());
+						}
+				}
+		}
+
+		void StaticBatches::setInstance(int _instance, std::weak_ptr<Mesh> _mesh, const glm::mat4& _toWorldMat)
+		{
+				Instance& instance = m_instances[_instance];
+				instance.mesh = _mesh;
+				instance.used = true;
+				m_changed = true;
+
+				//an instance without a mesh keeps its slot but isn't drawn
+				std::shared_ptr<Mesh> mesh = _mesh.lock();
+				if (!mesh)
+				{
+						return;
+				}
+
+				//normalized positions are scaled back to model space as part of the world matrix
+				instance.worldmat = mesh->hasDequantization() ? _toWorldMat * mesh->getDequantization() : _toWorldMat;
+
+				const MeshBoundingSphere& sphereBounds = mesh->getSphereBounds();
+				const float maxScale = glm::sqrt(glm::max(glm::dot(glm::vec3(_toWorldMat[0]), glm::vec3(_toWorldMat[0])),
+						glm::max(glm::dot(glm::vec3(_toWorldMat[1]), glm::vec3(_toWorldMat[1])),
+								glm::dot(glm::vec3(_toWorldMat[2]), glm::vec3(_toWorldMat[2])))));
+				instance.center = glm::vec3(_toWorldMat * glm::vec4(sphereBounds.m_center, 1.0f));
+				instance.radius = sphereBounds.m_radius * maxScale;
+		}
+
+		void StaticBatches::rebuild(CommandBucket& _bucket)
+		{
+				m_changed = false;
+
+				m_chunks.clear();
+				m_draws.clear();
+				m_drawChunks.clear();
+				m_drawGroups.clear();
+
+				//sort the instances into the chunks of the grid by their centers, then by mesh within a chunk
+				std::unordered_map<glm::ivec3, uint> chunkLookup;
+				std::vector<std::pair<unsigned long long, int>> order;
+				order.reserve(m_numInstances);
+
+				for (size_t i = 0; i < m_instances.size(); i++)
+				{
+						const Instance& instance = m_instances[i];
+						if (!instance.used || !instance.active || instance.mesh.expired())
+						{
+								continue;
+						}
+
+						const glm::ivec3 cell = glm::ivec3(glm::floor(instance.center / m_chunkSize));
+						auto it = chunkLookup.find(cell);
+						if (it == chunkLookup.end())
+						{
+								Chunk chunk;
+								chunk.min = instance.center - instance.radius;
+								chunk.max = instance.center + instance.radius;
+								it = chunkLookup.insert(std::make_pair(cell, static_cast<uint>(m_chunks.size()))).first;
+								m_chunks.push_back(chunk);
+						}
+
+						//the instances may stick out of their cell, the bounds of the chunk grow around them
+						Chunk& chunk = m_chunks[it->second];
+						chunk.min = glm::min(chunk.min, instance.center - instance.radius);
+						chunk.max = glm::max(chunk.max, instance.center + instance.radius);
+
+						order.push_back(std::make_pair(static_cast<unsigned long long>(it->second), static_cast<int>(i)));
+				}
+
+				std::sort(order.begin(), order.end(), [this](const std::pair<unsigned long long, int>& _a, const std::pair<unsigned long long, int>& _b)
+				{
+						if (_a.first != _b.first)
+						{
+								return _a.first < _b.first;
+						}
+						return m_instances[_a.second].mesh.lock().get() < m_instances[_b.second].mesh.lock().get();
+				});
+
+				m_chunkVisible.assign(m_chunks.size(), 0);
+
+				//the instance buffer in the sorted order, every run of a mesh in a chunk is one batch
+				const size_t instanceDataSize = sizeof(glm::mat4) * order.size();
+				glm::mat4* worldmats = static_cast<glm::mat4*>(_bucket.allocateAuxMemory(instanceDataSize > 0 ? instanceDataSize : sizeof(glm::mat4)));
+
+				struct UnsortedDraw
+				{
+						uint group;
+						uint chunk;
+						DrawElementsIndirectCommand draw;
+				};
+				std::vector<UnsortedDraw> unsortedDraws;
+				std::map<std::pair<VAO, const Material*>, uint> groupLookup;
+
+				size_t first{ 0 };
+				while (first < order.size())
+				{
+						const uint chunk = static_cast<uint>(order[first].first);
+						const std::shared_ptr<Mesh> mesh = m_instances[order[first].second].mesh.lock();
+
+						size_t last = first;
+						while (last < order.size() && order[last].first == chunk && m_instances[order[last].second].mesh.lock() == mesh)
+						{
+								worldmats[last] = m_instances[order[last].second].worldmat;
+								last++;
+						}
+
+						const std::vector<std::weak_ptr<Material>>& materials = mesh->getMaterials();
+						for (const SubMesh& subMesh : mesh->getSubMeshes(0))
+						{
+								assert(subMesh.m_materialIndex < materials.size());
+								const std::weak_ptr<Material>& material = materials.at(subMesh.m_materialIndex);
+
+								auto groupKey = std::make_pair(mesh->getVAO(), material.lock().get());
+								auto iter = groupLookup.find(groupKey);
+								if (iter == groupLookup.end())
+								{
+										DrawGroup group;
+										group.vao = mesh->getVAO();
+										group.material = material;
+										iter = groupLookup.insert(std::make_pair(groupKey, static_cast<uint>(m_drawGroups.size()))).first;
+										m_drawGroups.push_back(group);
+								}
+								m_drawGroups[iter->second].numDraws++;
+
+								UnsortedDraw unsorted;
+								unsorted.group = iter->second;
+								unsorted.chunk = chunk;
+								unsorted.draw.count = subMesh.m_numIndices;
+								unsorted.draw.instanceCount = static_cast<uint>(last - first);
+								unsorted.draw.firstIndex = mesh->getBaseIndex() + subMesh.m_baseIndex;
+								unsorted.draw.baseVertex = static_cast<int>(mesh->getBaseVertex() + subMesh.m_baseVertex);
+								unsorted.draw.baseInstance = static_cast<uint>(first);
+								unsortedDraws.push_back(unsorted);
+						}
+
+						first = last;
+				}
+
+				//lay the draws of each group out contiguously, they stay in chunk order
+				uint firstDraw{ 0 };
+				for (DrawGroup& group : m_drawGroups)
+				{
+						group.firstDraw = firstDraw;
+						firstDraw += group.numDraws;
+						group.numDraws = 0;
+				}
+
+				m_draws.resize(unsortedDraws.size());
+				m_drawChunks.resize(unsortedDraws.size());
+				for (const UnsortedDraw& unsorted : unsortedDraws)
+				{
+						DrawGroup& group = m_drawGroups[unsorted.group];
+						const uint index = group.firstDraw + group.numDraws++;
+						m_draws[index] = unsorted.draw;
+						m_drawChunks[index] = unsorted.chunk;
+				}
+
+				commands::UploadBuffer* instanceUpload = _bucket.add<commands::UploadBuffer>();
+				instanceUpload->target = GL_ARRAY_BUFFER;
+				instanceUpload->buffer = m_instanceBuffer;
+				instanceUpload->offset = 0;
+				instanceUpload->size = static_cast<uint>(instanceDataSize);
+				instanceUpload->usage = GL_STATIC_DRAW;
+				instanceUpload->reallocate = true;
+				instanceUpload->data = worldmats;
+
+				commands::UploadBuffer* drawUpload = _bucket.add<commands::UploadBuffer>();
+				drawUpload->target = GL_DRAW_INDIRECT_BUFFER;
+				drawUpload->buffer = m_drawBuffer;
+				drawUpload->offset = 0;
+				drawUpload->size = static_cast<uint>(sizeof(DrawElementsIndirectCommand) * m_draws.size());
+				drawUpload->usage = GL_STATIC_DRAW;
+				drawUpload->reallocate = true;
+				drawUpload->data = _bucket.copyAuxMemory(m_draws.data(), drawUpload->size);
+		}
+
+		void StaticBatches::cull(CommandBucket& _bucket, const Frustum& _frustum)
+		{
+				//a compaction of the mesh pool moves the geometry the draws point at
+				if (MeshPool::getNumCompactions() != m_numCompactions)
+				{
+						m_numCompactions = MeshPool::getNumCompactions();
+						m_changed = true;
+				}
+
+				if (m_changed)
+				{
+						rebuild(_bucket);
+				}
+
+				m_recordedDraws = nullptr;
+				if (m_draws.empty())
+				{
+						return;
+				}
+
+				for (size_t i = 0; i < m_chunks.size(); i++)
+				{
+						m_chunkVisible[i] = _frustum.boxInFrustum(m_chunks[i].min, m_chunks[i].max) ? 1 : 0;
+				}
+
+				//the draws as the cpu knows them, for the stats and the multi draw fallback
+				m_recordedDraws = static_cast<const DrawElementsIndirectCommand*>(_bucket.copyAuxMemory(m_draws.data(),
+						sizeof(DrawElementsIndirectCommand) * m_draws.size()));
+		}
+
+		void StaticBatches::recordDraws(CommandBucket& _bucket, GLSLProgram* _shader, bool _indirect)
+		{
+				if (m_recordedDraws == nullptr)
+				{
+						return;
+				}
+
+				VAO boundVAO{ 0 };
+				const Material* boundMaterial{ nullptr };
+				uint boundBaseInstance{ 0 };
+
+				for (const DrawGroup& group : m_drawGroups)
+				{
+						const uint endDraw = group.firstDraw + group.numDraws;
+
+						uint draw = group.firstDraw;
+						while (draw < endDraw)
+						{
+								//the runs of draws in visible chunks
+								if (!m_chunkVisible[m_drawChunks[draw]])
+								{
+										draw++;
+										continue;
+								}
+								uint runEnd = draw + 1;
+								while (runEnd < endDraw && m_chunkVisible[m_drawChunks[runEnd]])
+								{
+										runEnd++;
+								}
+
+								if (group.vao != boundVAO)
+								{
+										_bucket.add<commands::BindVertexArray>()->vao = group.vao;
+
+										commands::BindInstanceMat4* instanceAttribute = _bucket.add<commands::BindInstanceMat4>();
+										instanceAttribute->location = Mesh::BufferObject::WORLDMAT;
+										instanceAttribute->buffer = m_instanceBuffer;
+										instanceAttribute->offset = 0;
+										instanceAttribute->compact = false;
+										instanceAttribute->materialParams = false;
+
+										boundVAO = group.vao;
+										boundBaseInstance = 0;
+								}
+
+								if (_shader != nullptr && !group.material.expired() && group.material.lock().get() != boundMaterial)
+								{
+										_shader->recordMaterial(_bucket, group.material);
+										boundMaterial = group.material.lock().get();
+								}
+
+								if (_indirect)
+								{
+										commands::MultiDrawElementsIndirect* multiDraw = _bucket.add<commands::MultiDrawElementsIndirect>();
+										multiDraw->mode = GL_TRIANGLES;
+										multiDraw->buffer = m_drawBuffer;
+										multiDraw->offset = static_cast<uint>(sizeof(DrawElementsIndirectCommand) * draw);
+										multiDraw->drawCount = runEnd - draw;
+										multiDraw->draws = m_recordedDraws + draw;
+										draw = runEnd;
+										continue;
+								}
+
+								//no base instance support, offset the instance attribute to the first instance of every batch instead
+								for (; draw < runEnd; draw++)
+								{
+										const DrawElementsIndirectCommand& indirectDraw = m_draws[draw];
+
+										if (indirectDraw.baseInstance != boundBaseInstance)
+										{
+												commands::BindInstanceMat4* instanceAttribute = _bucket.add<commands::BindInstanceMat4>();
+												instanceAttribute->location = Mesh::BufferObject::WORLDMAT;
+												instanceAttribute->buffer = m_instanceBuffer;
+												instanceAttribute->offset = static_cast<uint>(sizeof(glm::mat4) * indirectDraw.baseInstance);
+												instanceAttribute->compact = false;
+												instanceAttribute->materialParams = false;
+												boundBaseInstance = indirectDraw.baseInstance;
+										}
+
+										commands::DrawElementsInstanced* instancedDraw = _bucket.add<commands::DrawElementsInstanced>();
+										instancedDraw->mode = GL_TRIANGLES;
+										instancedDraw->indexCount = indirectDraw.count;
+										instancedDraw->indexOffset = static_cast<uint>(sizeof(unsigned int) * indirectDraw.firstIndex);
+										instancedDraw->instanceCount = indirectDraw.instanceCount;
+										instancedDraw->baseVertex = indirectDraw.baseVertex;
+								}
+						}
+				}
+
+				if (boundVAO != 0)
+				{
+						_bucket.add<commands::BindVertexArray>()->vao = 0;
+				}
+		}
+
+		void StaticBatches::dispose()
+		{
+				if (!RenderBackend::isNull() && m_instanceBuffer != 0)
+				{
+						glDeleteBuffers(1, &m_instanceBuffer);
+						glDeleteBuffers(1, &m_drawBuffer);
+				}
+				m_instanceBuffer = 0;
+				m_drawBuffer = 0;
+		}
+}
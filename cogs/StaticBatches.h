@@ -0,0 +1,157 @@
+#ifndef STATIC_BATCHES_H
+#define STATIC_BATCHES_H
+
+#include "RenderCommands.h"
+
+#include <glm\vec3.hpp>
+#include <glm\mat4x4.hpp>
+#include <memory>
+#include <vector>
+
+namespace cogs
+{
+		class Mesh;
+		class Material;
+		class GLSLProgram;
+		class CommandBucket;
+		class Frustum;
+		class Entity;
+
+		using VAO = uint;
+
+		/**
+		* \brief The instances of entities which don't move, kept in persistent buffers. They are grouped into the chunks of a grid,
+		* the instance and indirect draw buffers are only rebuilt when an instance is added, moved, removed or (de)activated, or the mesh pool was compacted.
+		* Every frame only the bounds of the chunks are tested against the frustum, the draws of a vao and material are laid out chunk by chunk,
+		* so the visible chunks next to each other are drawn with one multi draw. Meshes are drawn at their full detail
+		*/
+		class StaticBatches
+		{
+		public:
+				StaticBatches();
+				~StaticBatches();
+
+				/**
+				* \brief the edge length of the chunks in world units, 32 by default. A change rebuilds the batches
+				*/
+				void setChunkSize(float _size);
+				float getChunkSize() const noexcept { return m_chunkSize; }
+
+				/**
+				* \brief adds an instance of a mesh
+				* \param _toWorldMat - the transform of the entity
+				* \return the id of the instance
+				*/
+				int add(std::weak_ptr<Mesh> _mesh, const glm::mat4& _toWorldMat);
+
+				/**
+				* \brief refreshes an instance after its entity moved or changed its mesh, the batches get rebuilt
+				*/
+				void update(int _instance, std::weak_ptr<Mesh> _mesh, const glm::mat4& _toWorldMat);
+				void remove(int _instance);
+
+				/**
+				* \brief leaves an instance out of the batches while its entity is inactive, a change rebuilds the batches
+				*/
+				void setActive(int _instance, bool _active);
+
+				/**
+				* \brief adds the instance of an entity with a mesh renderer, it follows the entity once it's marked as moved
+				* \return the id of the instance
+				*/
+				int addEntity(const Entity* _entity);
+
+				/**
+				* \brief marks the instance of an entity as moved, it's refreshed by the next refitEntities()
+				*/
+				void moveEntity(int _instance);
+				void removeEntity(int _instance);
+
+				/**
+				* \brief refreshes the instances of the entities which moved or changed their mesh, an entity may move several times a frame
+				*/
+				void refitEntities();
+
+				/**
+				* \brief leaves out the instances of the entities which became inactive or have an inactive parent, and adds back the reactivated ones
+				*/
+				void refreshActiveStates();
+
+				unsigned int getNumInstances() const noexcept { return m_numInstances; }
+				unsigned int getNumChunks()				const noexcept { return static_cast<unsigned int>(m_chunks.size()); }
+
+				/**
+				* \brief uploads the batches if they changed, then tests the chunks against a frustum
+				*/
+				void cull(CommandBucket& _bucket, const Frustum& _frustum);
+
+				/**
+				* \brief records the draws of the chunks found visible by the last cull().
+				* The shader sets the materials, without one they are left out (depth pre-pass)
+				* \param _indirect - whether the draws are issued as multi draw indirect calls
+				*/
+				void recordDraws(CommandBucket& _bucket, GLSLProgram* _shader, bool _indirect);
+
+				/**
+				* \brief deletes the buffers
+				*/
+				void dispose();
+
+		private:
+				struct Instance
+				{
+						std::weak_ptr<Mesh> mesh;
+						glm::mat4 worldmat{ 1.0f }; ///< the world matrix drawn with, including the dequantization of the mesh
+						glm::vec3 center{ 0.0f }; ///< the world bounding sphere
+						float radius{ 0.0f };
+						bool used{ false }; ///< false for free slots
+						bool active{ true }; ///< false while the entity or a parent is inactive
+						const Entity* entity{ nullptr }; ///< the entity the instance follows, if added with addEntity
+				};
+
+				struct Chunk
+				{
+						glm::vec3 min{ 0.0f }; ///< the world bounds of the instances in the chunk
+						glm::vec3 max{ 0.0f };
+				};
+
+				/**
+				* \brief consecutive draws sharing a vao and a material, ordered by chunk
+				*/
+				struct DrawGroup
+				{
+						VAO vao{ 0 };
+						std::weak_ptr<Material> material;
+						uint firstDraw{ 0 };
+						uint numDraws{ 0 };
+				};
+
+				void setInstance(int _instance, std::weak_ptr<Mesh> _mesh, const glm::mat4& _toWorldMat);
+
+				/**
+				* \brief sorts the instances into chunks and meshes and rebuilds the draws
+				*/
+				void rebuild(CommandBucket& _bucket);
+
+				std::vector<Instance> m_instances;
+				std::vector<int> m_freeInstances;
+				std::vector<int> m_movedEntities; ///< the instances of entities to refresh before the next frame
+				uint m_numInstances{ 0 };
+				float m_chunkSize{ 32.0f };
+				bool m_changed{ false }; ///< whether the batches need rebuilding
+				uint m_numCompactions{ 0 }; ///< the compactions of the mesh pool when the batches were built, their offsets are stale after another
+
+				std::vector<Chunk> m_chunks;
+				std::vector<unsigned char> m_chunkVisible; ///< the result of the last cull() for every chunk
+
+				std::vector<DrawElementsIndirectCommand> m_draws; ///< grouped by vao and material, then by chunk
+				std::vector<uint> m_drawChunks; ///< the chunk of every draw
+				std::vector<DrawGroup> m_drawGroups;
+				const DrawElementsIndirectCommand* m_recordedDraws{ nullptr }; ///< the bucket's copy of the draws of this frame
+
+				uint m_instanceBuffer{ 0 }; ///< the world matrices, chunk by chunk and mesh by mesh
+				uint m_drawBuffer{ 0 }; ///< the GL_DRAW_INDIRECT_BUFFER
+		};
+}
+
+#endif // !STATIC_BATCHES_H
@@ -3,6 +3,7 @@
 
 #include <glm\gtc\matrix_transform.hpp>
 #include <glm\gtx\matrix_decompose.hpp>
+#include <algorithm>
 
 namespace cogs
 {
@@ -60,6 +61,7 @@ namespace cogs
 		void Transform::translate(const glm::vec3 & _offset)
 		{
 				m_localPosition += _offset;
+				notifyChanged();
 		}
 
 		void Transform::translate(float _x, float _y, float _z)
@@ -67,11 +69,13 @@ namespace cogs
 				m_localPosition.x += _x;
 				m_localPosition.y += _y;
 				m_localPosition.z += _z;
+				notifyChanged();
 		}
 
 		void Transform::offsetScale(const glm::vec3 & _offset)
 		{
 				m_localScale += _offset;
+				notifyChanged();
 		}
 
 		void Transform::offsetScale(float _x, float _y, float _z)
@@ -79,6 +83,7 @@ namespace cogs
 				m_localScale.x += _x;
 				m_localScale.y += _y;
 				m_localScale.z += _z;
+				notifyChanged();
 		}
 
 		glm::mat4 Transform::localTransform() const
@@ -139,6 +144,7 @@ namespace cogs
 
 				//set the orientation's euler angles representation
 				m_localOrientation = glm::eulerAngles(m_localOrientationRaw);
+				notifyChanged();
 		}
 
 		void Transform::setLocalOrientation(const glm::vec3 & _value)
@@ -150,12 +156,14 @@ namespace cogs
 		{
 				//set the new world position
 				m_localPosition = _value;
+				notifyChanged();
 		}
 
 		void Transform::setLocalScale(const glm::vec3 & _value)
 		{
 				//set the new world position
 				m_localScale = _value;
+				notifyChanged();
 		}
 
 		void Transform::setWorldOrientation(const glm::quat & _value)
@@ -177,6 +185,7 @@ namespace cogs
 
 				//set the local orientation's euler angle representation
 				m_localOrientation = glm::eulerAngles(m_localOrientationRaw);
+				notifyChanged();
 		}
 
 		void Transform::setWorldOrientation(const glm::vec3 & _value)
@@ -197,6 +206,7 @@ namespace cogs
 						//if there is no parent, world == local
 						m_localPosition = _value;
 				}
+				notifyChanged();
 		}
 
 		void Transform::setWorldScale(const glm::vec3 & _value)
@@ -212,10 +222,24 @@ namespace cogs
 						//if there is no parent, world == local
 						m_localScale = _value;
 				}
+				notifyChanged();
 		}
 
 		void Transform::setParent(std::weak_ptr<Transform> _parent)
 		{
+				//changes of the parent are passed on to its children
+				if (!m_parent.expired())
+				{
+						std::vector<std::weak_ptr<Transform>>& siblings = m_parent.lock()->m_children;
+						siblings.erase(std::remove_if(siblings.begin(), siblings.end(),
+								[this](const std::weak_ptr<Transform>& _child) { return _child.expired() || _child.lock().get() == this; }),
+								siblings.end());
+				}
+				if (!_parent.expired() && !m_entity.expired())
+				{
+						_parent.lock()->m_children.push_back(m_entity.lock()->getComponent<Transform>());
+				}
+
 				if (_parent.expired())
 				{
 						setLocalPosition(worldPosition());
@@ -237,6 +261,34 @@ namespace cogs
 				}
 		}
 
+		unsigned int Transform::addListener(const std::function<void()>& _listener)
+		{
+				m_listeners.push_back(std::make_pair(m_nextListenerID, _listener));
+				return m_nextListenerID++;
+		}
+
+		void Transform::removeListener(unsigned int _id)
+		{
+				m_listeners.erase(std::remove_if(m_listeners.begin(), m_listeners.end(),
+						[_id](const std::pair<unsigned int, std::function<void()>>& _listener) { return _listener.first == _id; }),
+						m_listeners.end());
+		}
+
+		void Transform::notifyChanged()
+		{
+				for (auto& listener : m_listeners)
+				{
+						listener.second();
+				}
+				for (auto& child : m_children)
+				{
+						if (!child.expired())
+						{
+								child.lock()->notifyChanged();
+						}
+				}
+		}
+
 		bool Transform::operator==(const Transform & _rhs) const
 		{
 				auto boolVec = glm::equal(worldPosition(), _rhs.worldPosition());
@@ -3,6 +3,8 @@
 
 #include "Component.h"
 #include <glm\gtc\quaternion.hpp>
+#include <functional>
+#include <vector>
 
 namespace cogs
 {
@@ -169,8 +171,23 @@ namespace cogs
 				//operator overload to check if 2 transforms are equal
 				bool operator== (const Transform& _rhs) const;
 
+				/**
+				* \brief registers a function called whenever the world transform changes, also when it's through a parent
+				* \return the id to remove the listener with
+				*/
+				unsigned int addListener(const std::function<void()>& _listener);
+				void removeListener(unsigned int _id);
+
 		private:
+				/**
+				* \brief calls the listeners of this transform and of all its children
+				*/
+				void notifyChanged();
+
 				std::weak_ptr<Transform> m_parent; ///< the parent transform of this transform
+				std::vector<std::weak_ptr<Transform>> m_children; ///< the transforms with this one as parent, to pass changes on
+				std::vector<std::pair<unsigned int, std::function<void()>>> m_listeners; ///< the functions called on changes, with their ids
+				unsigned int m_nextListenerID{ 0 };
 
 				glm::vec3 m_localPosition{ 0.0f, 0.0f, 0.0f }; ///< local position
 				glm::vec3 m_localScale{ 1.0f, 1.0f, 1.0f }; ///< local scale
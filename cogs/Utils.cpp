@@ -2,6 +2,7 @@
 
 #include "ResourceManager.h"
 #include "Material.h"
+#include "Parallel.h"
 
 #include <SDL\SDL_timer.h>
 #include <SOIL2\SOIL2.h>
@@ -12,8 +13,16 @@
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
 
+#include <algorithm>
+
 namespace cogs
 {
+		namespace
+		{
+				//vertices or faces converted per thread at least
+				const size_t CONVERSION_BATCH = 1 << 14;
+		}
+
 		float getTime()
 		{
 				return static_cast<float>(SDL_GetTicks());
@@ -100,6 +109,7 @@ namespace cogs
 
 				const aiScene* scene = importer.ReadFile(_filePath,
 						aiProcess_Triangulate |
+						aiProcess_JoinIdenticalVertices |
 						aiProcess_GenSmoothNormals |
 						//aiProcess_FlipUVs |
 						aiProcess_CalcTangentSpace);
@@ -130,43 +140,61 @@ namespace cogs
 						numIndices += _subMeshes.at(i).m_numIndices;
 				}
 
-				_positions.reserve(numVertices);
-				_uvs.reserve(numVertices);
-				_normals.reserve(numVertices);
-				_tangents.reserve(numVertices);
-				_indices.reserve(numIndices);
+				_positions.resize(numVertices);
+				_uvs.resize(numVertices);
+				_normals.resize(numVertices);
+				_tangents.resize(numVertices);
+				_indices.resize(numIndices);
 
 				const aiVector3D aiZeroVector(0.0f, 0.0f, 0.0f);
 
-				// Initialize the meshes in the scene one by one
-				for (unsigned int i = 0; i < _subMeshes.size(); i++)
+				//every submesh writes to its own range of the arrays, so the vertices and faces of all of them
+				//are split over the workers as one array, a single huge submesh gets spread as well
+				parallelFor(numVertices, CONVERSION_BATCH, [&](size_t _begin, size_t _end, unsigned int)
 				{
-						const aiMesh* paiMesh = scene->mMeshes[i];
-
-						//load all the per-vertex data
-						for (unsigned int currVert = 0; currVert < paiMesh->mNumVertices; ++currVert)
+						for (const SubMesh& subMesh : _subMeshes)
 						{
-								const aiVector3D pos = paiMesh->mVertices[currVert];
-								const aiVector3D normal = paiMesh->mNormals[currVert];
-								const aiVector3D uv = paiMesh->HasTextureCoords(0) ? paiMesh->mTextureCoords[0][currVert] : aiZeroVector;
-								const aiVector3D tangent = paiMesh->mTangents[currVert];
-
-								_positions.push_back(glm::vec3(pos.x, pos.y, pos.z));
-								_uvs.push_back(glm::vec2(uv.x, uv.y));
-								_normals.push_back(glm::vec3(normal.x, normal.y, normal.z));
-								_tangents.push_back(glm::vec3(tangent.x, tangent.y, tangent.z));
+								const aiMesh* paiMesh = scene->mMeshes[&subMesh - _subMeshes.data()];
+								const size_t first = std::max<size_t>(_begin, subMesh.m_baseVertex);
+								const size_t last = std::min<size_t>(_end, static_cast<size_t>(subMesh.m_baseVertex) + paiMesh->mNumVertices);
+
+								//load all the per-vertex data
+								for (size_t i = first; i < last; i++)
+								{
+										const unsigned int currVert = static_cast<unsigned int>(i - subMesh.m_baseVertex);
+										const aiVector3D& pos = paiMesh->mVertices[currVert];
+										const aiVector3D& normal = paiMesh->mNormals[currVert];
+										const aiVector3D& uv = paiMesh->HasTextureCoords(0) ? paiMesh->mTextureCoords[0][currVert] : aiZeroVector;
+										const aiVector3D& tangent = paiMesh->mTangents[currVert];
+
+										_positions[i] = glm::vec3(pos.x, pos.y, pos.z);
+										_uvs[i] = glm::vec2(uv.x, uv.y);
+										_normals[i] = glm::vec3(normal.x, normal.y, normal.z);
+										_tangents[i] = glm::vec3(tangent.x, tangent.y, tangent.z);
+								}
 						}
+				});
 
-						//load all the indices for indexed rendering
-						for (unsigned int currFace = 0; currFace < paiMesh->mNumFaces; ++currFace)
+				parallelFor(numIndices / 3, CONVERSION_BATCH, [&](size_t _begin, size_t _end, unsigned int)
+				{
+						for (const SubMesh& subMesh : _subMeshes)
 						{
-								const aiFace& face = paiMesh->mFaces[currFace];
-								assert(face.mNumIndices == 3);
-								_indices.push_back(face.mIndices[0]);
-								_indices.push_back(face.mIndices[1]);
-								_indices.push_back(face.mIndices[2]);
+								const aiMesh* paiMesh = scene->mMeshes[&subMesh - _subMeshes.data()];
+								const size_t firstFace = subMesh.m_baseIndex / 3;
+								const size_t first = std::max<size_t>(_begin, firstFace);
+								const size_t last = std::min<size_t>(_end, firstFace + paiMesh->mNumFaces);
+
+								//load all the indices for indexed rendering
+								for (size_t i = first; i < last; i++)
+								{
+										const aiFace& face = paiMesh->mFaces[i - firstFace];
+										assert(face.mNumIndices == 3);
+										_indices[i * 3] = face.mIndices[0];
+										_indices[i * 3 + 1] = face.mIndices[1];
+										_indices[i * 3 + 2] = face.mIndices[2];
+								}
 						}
-				}
+				});
 
 				for (size_t i = 0; i < scene->mNumMaterials; i++)
 				{
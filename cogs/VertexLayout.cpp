@@ -0,0 +1,248 @@
+#include "VertexLayout.h"
+
+#include <GL\glew.h>
+#include <glm\glm.hpp>
+#include <glm\gtc\packing.hpp>
+#include <glm\gtc\matrix_transform.hpp>
+#include <cstring>
+
+namespace cogs
+{
+		namespace
+		{
+				uint positionSize(PositionFormat _format)
+				{
+						return _format == PositionFormat::FLOAT3 ? 12 : 8;
+				}
+
+				uint texcoordSize(TexcoordFormat _format)
+				{
+						return _format == TexcoordFormat::FLOAT2 ? 8 : 4;
+				}
+
+				uint directionSize(DirectionFormat _format)
+				{
+						return _format == DirectionFormat::FLOAT3 ? 12 : 4;
+				}
+
+				float signNotZero(float _value)
+				{
+						return _value >= 0.0f ? 1.0f : -1.0f;
+				}
+
+				glm::vec2 octEncode(const glm::vec3& _direction)
+				{
+						glm::vec3 n = _direction / (glm::abs(_direction.x) + glm::abs(_direction.y) + glm::abs(_direction.z));
+						if (n.z < 0.0f)
+						{
+								return glm::vec2((1.0f - glm::abs(n.y)) * signNotZero(n.x), (1.0f - glm::abs(n.x)) * signNotZero(n.y));
+						}
+						return glm::vec2(n.x, n.y);
+				}
+
+				glm::vec3 octDecode(const glm::vec2& _encoded)
+				{
+						glm::vec3 n(_encoded.x, _encoded.y, 1.0f - glm::abs(_encoded.x) - glm::abs(_encoded.y));
+						if (n.z < 0.0f)
+						{
+								n = glm::vec3((1.0f - glm::abs(n.y)) * signNotZero(n.x), (1.0f - glm::abs(n.x)) * signNotZero(n.y), n.z);
+						}
+						return glm::normalize(n);
+				}
+
+				//packs signed 10 bit components into a GL_INT_2_10_10_10_REV
+				unsigned int packInt2101010(int _x, int _y, int _z, int _w)
+				{
+						return (static_cast<unsigned int>(_x) & 0x3FF)
+								| ((static_cast<unsigned int>(_y) & 0x3FF) << 10)
+								| ((static_cast<unsigned int>(_z) & 0x3FF) << 20)
+								| ((static_cast<unsigned int>(_w) & 0x3) << 30);
+				}
+
+				//encodes a direction, returns the angle between the original and the decoded one in degrees
+				float encodeDirection(DirectionFormat _format, const glm::vec3& _direction, unsigned char* _destination)
+				{
+						if (_format == DirectionFormat::FLOAT3)
+						{
+								std::memcpy(_destination, &_direction[0], sizeof(glm::vec3));
+								return 0.0f;
+						}
+
+						glm::vec3 direction = glm::length(_direction) > 0.0f ? glm::normalize(_direction) : glm::vec3(0.0f, 0.0f, 1.0f);
+						glm::vec2 encoded = octEncode(direction);
+
+						int x = static_cast<int>(glm::round(glm::clamp(encoded.x, -1.0f, 1.0f) * 511.0f));
+						int y = static_cast<int>(glm::round(glm::clamp(encoded.y, -1.0f, 1.0f) * 511.0f));
+
+						//w = 0 marks the direction as octahedral for the shader
+						unsigned int packed = packInt2101010(x, y, 0, 0);
+						std::memcpy(_destination, &packed, sizeof(packed));
+
+						glm::vec3 decoded = octDecode(glm::vec2(x / 511.0f, y / 511.0f));
+						return glm::degrees(glm::acos(glm::clamp(glm::dot(direction, decoded), -1.0f, 1.0f)));
+				}
+		}
+
+		uint VertexLayout::getStride() const
+		{
+				return positionSize(position) + texcoordSize(texcoord) + directionSize(normal) + directionSize(tangent);
+		}
+
+		uint VertexLayout::getTexcoordOffset() const
+		{
+				return positionSize(position);
+		}
+
+		uint VertexLayout::getNormalOffset() const
+		{
+				return getTexcoordOffset() + texcoordSize(texcoord);
+		}
+
+		uint VertexLayout::getTangentOffset() const
+		{
+				return getNormalOffset() + directionSize(normal);
+		}
+
+		VertexLayout VertexLayout::compact()
+		{
+				VertexLayout layout;
+				layout.position = PositionFormat::UNORM16_4;
+				layout.texcoord = TexcoordFormat::HALF2;
+				layout.normal = DirectionFormat::OCTAHEDRAL;
+				layout.tangent = DirectionFormat::OCTAHEDRAL;
+				return layout;
+		}
+
+		void VertexLayout::setupAttributes() const
+		{
+				const GLsizei stride = static_cast<GLsizei>(getStride());
+
+				switch (position)
+				{
+				case PositionFormat::FLOAT3:
+						glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, nullptr);
+						break;
+				case PositionFormat::HALF4:
+						glVertexAttribPointer(0, 4, GL_HALF_FLOAT, GL_FALSE, stride, nullptr);
+						break;
+				case PositionFormat::UNORM16_4:
+						glVertexAttribPointer(0, 4, GL_UNSIGNED_SHORT, GL_TRUE, stride, nullptr);
+						break;
+				}
+
+				if (texcoord == TexcoordFormat::FLOAT2)
+				{
+						glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, stride, (const void*)(size_t)getTexcoordOffset());
+				}
+				else
+				{
+						glVertexAttribPointer(1, 2, GL_HALF_FLOAT, GL_FALSE, stride, (const void*)(size_t)getTexcoordOffset());
+				}
+
+				const DirectionFormat directions[] = { normal, tangent };
+				const uint offsets[] = { getNormalOffset(), getTangentOffset() };
+				for (uint i = 0; i < 2; i++)
+				{
+						if (directions[i] == DirectionFormat::FLOAT3)
+						{
+								glVertexAttribPointer(2 + i, 3, GL_FLOAT, GL_FALSE, stride, (const void*)(size_t)offsets[i]);
+						}
+						else
+						{
+								glVertexAttribPointer(2 + i, 4, GL_INT_2_10_10_10_REV, GL_TRUE, stride, (const void*)(size_t)offsets[i]);
+						}
+				}
+
+				for (uint i = 0; i < 4; i++)
+				{
+						glEnableVertexAttribArray(i);
+				}
+		}
+
+		void encodeVertices(const VertexLayout& _layout,
+				const std::vector<glm::vec3>& _positions,
+				const std::vector<glm::vec2>& _uvs,
+				const std::vector<glm::vec3>& _normals,
+				const std::vector<glm::vec3>& _tangents,
+				const glm::vec3& _boundsMin,
+				const glm::vec3& _boundsMax,
+				std::vector<unsigned char>& _vertices,
+				glm::mat4& _dequantization,
+				QuantizationError& _error)
+		{
+				const uint stride = _layout.getStride();
+				_vertices.resize(_positions.size() * stride);
+				_error = QuantizationError();
+				_dequantization = glm::mat4(1.0f);
+
+				//normalized positions use a uniform scale, so the normal matrix of the world matrix stays valid
+				glm::vec3 extents = _boundsMax - _boundsMin;
+				float scale = glm::max(extents.x, glm::max(extents.y, extents.z));
+				if (scale <= 0.0f)
+				{
+						scale = 1.0f;
+				}
+
+				if (_layout.position == PositionFormat::UNORM16_4)
+				{
+						_dequantization = glm::scale(glm::translate(glm::mat4(1.0f), _boundsMin), glm::vec3(scale));
+				}
+
+				for (size_t i = 0; i < _positions.size(); i++)
+				{
+						unsigned char* vertex = _vertices.data() + i * stride;
+
+						const glm::vec3& position = _positions[i];
+						switch (_layout.position)
+						{
+						case PositionFormat::FLOAT3:
+						{
+								std::memcpy(vertex, &position[0], sizeof(glm::vec3));
+								break;
+						}
+						case PositionFormat::HALF4:
+						{
+								unsigned short half[4] = { glm::packHalf1x16(position.x), glm::packHalf1x16(position.y), glm::packHalf1x16(position.z), glm::packHalf1x16(1.0f) };
+								std::memcpy(vertex, half, sizeof(half));
+
+								glm::vec3 decoded(glm::unpackHalf1x16(half[0]), glm::unpackHalf1x16(half[1]), glm::unpackHalf1x16(half[2]));
+								_error.position = glm::max(_error.position, glm::length(decoded - position));
+								break;
+						}
+						case PositionFormat::UNORM16_4:
+						{
+								glm::vec3 normalized = glm::clamp((position - _boundsMin) / scale, 0.0f, 1.0f);
+								unsigned short quantized[4] =
+								{
+										static_cast<unsigned short>(glm::round(normalized.x * 65535.0f)),
+										static_cast<unsigned short>(glm::round(normalized.y * 65535.0f)),
+										static_cast<unsigned short>(glm::round(normalized.z * 65535.0f)),
+										65535
+								};
+								std::memcpy(vertex, quantized, sizeof(quantized));
+
+								glm::vec3 decoded = _boundsMin + glm::vec3(quantized[0], quantized[1], quantized[2]) / 65535.0f * scale;
+								_error.position = glm::max(_error.position, glm::length(decoded - position));
+								break;
+						}
+						}
+
+						const glm::vec2& uv = _uvs[i];
+						if (_layout.texcoord == TexcoordFormat::FLOAT2)
+						{
+								std::memcpy(vertex + _layout.getTexcoordOffset(), &uv[0], sizeof(glm::vec2));
+						}
+						else
+						{
+								unsigned short half[2] = { glm::packHalf1x16(uv.x), glm::packHalf1x16(uv.y) };
+								std::memcpy(vertex + _layout.getTexcoordOffset(), half, sizeof(half));
+
+								glm::vec2 decoded(glm::unpackHalf1x16(half[0]), glm::unpackHalf1x16(half[1]));
+								_error.texcoord = glm::max(_error.texcoord, glm::length(decoded - uv));
+						}
+
+						_error.normal = glm::max(_error.normal, encodeDirection(_layout.normal, _normals[i], vertex + _layout.getNormalOffset()));
+						_error.tangent = glm::max(_error.tangent, encodeDirection(_layout.tangent, _tangents[i], vertex + _layout.getTangentOffset()));
+				}
+		}
+}
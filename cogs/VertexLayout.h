@@ -0,0 +1,114 @@
+#ifndef VERTEX_LAYOUT_H
+#define VERTEX_LAYOUT_H
+
+#include <vector>
+#include <glm\vec2.hpp>
+#include <glm\vec3.hpp>
+#include <glm\mat4x4.hpp>
+
+namespace cogs
+{
+		using uint = unsigned int;
+
+		/**
+		* \brief Encodings of the vertex positions
+		*/
+		enum class PositionFormat
+		{
+				FLOAT3,			///< 3 floats, 12 bytes
+				HALF4,				///< 4 half floats, 8 bytes
+				UNORM16_4		///< 4 normalized unsigned shorts relative to the mesh bounds, 8 bytes. Needs Mesh::getDequantization
+		};
+
+		/**
+		* \brief Encodings of the texture coordinates
+		*/
+		enum class TexcoordFormat
+		{
+				FLOAT2,		///< 2 floats, 8 bytes
+				HALF2			///< 2 half floats, 4 bytes
+		};
+
+		/**
+		* \brief Encodings of the normals and tangents
+		*/
+		enum class DirectionFormat
+		{
+				FLOAT3,			///< 3 floats, 12 bytes
+				OCTAHEDRAL		///< octahedral mapping in xy of a GL_INT_2_10_10_10_REV with w = 0, 4 bytes. Decoded in the vertex shader
+		};
+
+		/**
+		* \brief Layout of the interleaved vertices in the mesh pool.
+		* The shaders don't need to know the layout: half floats and normalized integers are converted by GL,
+		* normalized positions are undone by folding Mesh::getDequantization into the world matrix,
+		* and octahedral directions are told apart from float ones by their w component (0 instead of the default 1)
+		*/
+		struct VertexLayout
+		{
+				PositionFormat position{ PositionFormat::FLOAT3 };
+				TexcoordFormat texcoord{ TexcoordFormat::FLOAT2 };
+				DirectionFormat normal{ DirectionFormat::FLOAT3 };
+				DirectionFormat tangent{ DirectionFormat::FLOAT3 };
+
+				/**
+				* \brief the size of an interleaved vertex in bytes and the offsets of the attributes in it
+				*/
+				uint getStride() const;
+				uint getTexcoordOffset() const;
+				uint getNormalOffset() const;
+				uint getTangentOffset() const;
+
+				/**
+				* \brief Sets the attribute pointers of locations 0-3 for the buffer bound to GL_ARRAY_BUFFER
+				*/
+				void setupAttributes() const;
+
+				bool operator==(const VertexLayout& _other) const
+				{
+						return position == _other.position && texcoord == _other.texcoord && normal == _other.normal && tangent == _other.tangent;
+				}
+				bool operator!=(const VertexLayout& _other) const { return !(*this == _other); }
+
+				/**
+				* \brief 44 bytes per vertex, lossless
+				*/
+				static VertexLayout standard() { return VertexLayout(); }
+
+				/**
+				* \brief 20 bytes per vertex: normalized positions, half uvs and octahedral normals and tangents
+				*/
+				static VertexLayout compact();
+		};
+
+		/**
+		* \brief The largest errors introduced by encoding the vertices of a mesh
+		*/
+		struct QuantizationError
+		{
+				float position{ 0.0f };		///< in model space units
+				float texcoord{ 0.0f };		///< in uv units
+				float normal{ 0.0f };				///< in degrees
+				float tangent{ 0.0f };			///< in degrees
+		};
+
+		/**
+		* \brief Encodes vertices into the interleaved layout
+		* \param[in] _boundsMin, _boundsMax - the bounds of the positions, for normalized positions
+		* \param[out] _vertices - the encoded vertices
+		* \param[out] _dequantization - matrix turning the stored positions back into model space (identity if not normalized)
+		* \param[out] _error - the largest errors of the encoding
+		*/
+		extern void encodeVertices(const VertexLayout& _layout,
+				const std::vector<glm::vec3>& _positions,
+				const std::vector<glm::vec2>& _uvs,
+				const std::vector<glm::vec3>& _normals,
+				const std::vector<glm::vec3>& _tangents,
+				const glm::vec3& _boundsMin,
+				const glm::vec3& _boundsMax,
+				std::vector<unsigned char>& _vertices,
+				glm::mat4& _dequantization,
+				QuantizationError& _error);
+}
+
+#endif // !VERTEX_LAYOUT_H
@@ -0,0 +1,195 @@
+#include "ViewCuller.h"
+
+#include "Camera.h"
+#include "Mesh.h"
+#include "MeshRenderer.h"
+#include "Entity.h"
+#include "SceneTree.h"
+#include "LODSelector.h"
+#include "InstanceBatches.h"
+#include "ImpostorBatches.h"
+#include "Parallel.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace cogs
+{
+		namespace
+		{
+				/**
+				* \brief the gathered entities tested against the views per batch of the worker pool at least,
+				* every entity costs a sphere and maybe a box test per view, so a batch outweighs waking the workers
+				*/
+				const size_t VIEW_CULL_BATCH = 1024;
+		}
+
+		void ViewCuller::begin(const std::vector<std::weak_ptr<Camera>>& _cameras)
+		{
+				clear();
+				for (std::weak_ptr<Camera> camera : _cameras)
+				{
+						if (camera.expired())
+						{
+								continue;
+						}
+						if (m_views.size() == MAX_VIEWS)
+						{
+								printf("WARNING: only the first 32 views are drawn\n");
+								break;
+						}
+						m_views.push_back(camera);
+				}
+		}
+
+		void ViewCuller::clear()
+		{
+				m_views.clear();
+				m_gathered.clear();
+		}
+
+		int ViewCuller::findView(const Camera* _camera) const
+		{
+				for (size_t i = 0; i < m_views.size(); i++)
+				{
+						if (m_views[i].lock().get() == _camera)
+						{
+								return static_cast<int>(i);
+						}
+				}
+				return -1;
+		}
+
+		void ViewCuller::getDepthRange(float& _near, float& _far) const
+		{
+				_near = std::numeric_limits<float>::max();
+				_far = 0.0f;
+				for (std::weak_ptr<Camera> view : m_views)
+				{
+						_near = glm::min(_near, view.lock()->getNear());
+						_far = glm::max(_far, view.lock()->getFar());
+				}
+		}
+
+		void ViewCuller::gather(const Entity* _entity)
+		{
+				std::shared_ptr<Mesh> mesh = _entity->getComponent<MeshRenderer>().lock()->getMesh().lock();
+				std::shared_ptr<Transform> transform = _entity->getComponent<Transform>().lock();
+
+				GatheredEntity gathered;
+				gathered.entity = _entity;
+				gathered.meshRenderer = _entity->getComponent<MeshRenderer>().lock().get();
+				gathered.mesh = mesh;
+				gathered.toWorldMat = transform->worldTransform();
+
+				const MeshBoundingSphere& sphereBounds = mesh->getSphereBounds();
+				const glm::vec3 scale = transform->worldScale();
+				gathered.center = glm::vec3(gathered.toWorldMat * glm::vec4(sphereBounds.m_center, 1.0f));
+				gathered.radius = sphereBounds.m_radius * glm::max(scale.x, glm::max(scale.y, scale.z));
+
+				m_gathered.push_back(gathered);
+		}
+
+		void ViewCuller::gather(const SceneTree& _sceneTree)
+		{
+				m_viewProxies.clear();
+				for (std::weak_ptr<Camera> view : m_views)
+				{
+						_sceneTree.queryFrustum(view.lock()->getFrustum(), [this](int _proxy, unsigned int)
+						{
+								m_viewProxies.push_back(_proxy);
+						});
+				}
+
+				//an entity in several views is gathered once
+				std::sort(m_viewProxies.begin(), m_viewProxies.end());
+				m_viewProxies.erase(std::unique(m_viewProxies.begin(), m_viewProxies.end()), m_viewProxies.end());
+
+				for (int proxy : m_viewProxies)
+				{
+						const Entity* entity = _sceneTree.getEntity(proxy);
+						if (entity->isActiveInHierarchy())
+						{
+								gather(entity);
+						}
+				}
+		}
+
+		void ViewCuller::cull(LODSelector& _lodSelector, InstanceBatches& _batches, ImpostorBatches& _impostors)
+		{
+				std::vector<std::shared_ptr<Camera>> cameras;
+				for (std::weak_ptr<Camera> view : m_views)
+				{
+						cameras.push_back(view.lock());
+				}
+
+				//one pass over the entities tests each against all views, the sphere rejects most, the oriented box decides for the ones it crosses the border with
+				m_gatheredMasks.assign(m_gathered.size(), 0);
+				parallelFor(m_gathered.size(), VIEW_CULL_BATCH, [this, &cameras](size_t _begin, size_t _end, unsigned int)
+				{
+						for (size_t i = _begin; i < _end; i++)
+						{
+								const GatheredEntity& gathered = m_gathered[i];
+								const MeshBoundingBox& boxBounds = gathered.mesh.lock()->getBoxBounds();
+
+								uint viewMask{ 0 };
+								for (size_t view = 0; view < cameras.size(); view++)
+								{
+										const Frustum& frustum = cameras[view]->getFrustum();
+										unsigned int planeMask = Frustum::ALL_PLANES;
+										unsigned int lastPlane{ 0 };
+
+										Containment containment = frustum.sphereInFrustum(gathered.center, gathered.radius, planeMask, lastPlane);
+										if (containment == Containment::INTERSECTS)
+										{
+												containment = frustum.boxInFrustum(boxBounds.m_min, boxBounds.m_max, gathered.toWorldMat, planeMask, lastPlane);
+										}
+										if (containment != Containment::OUTSIDE)
+										{
+												viewMask |= 1u << view;
+										}
+								}
+								m_gatheredMasks[i] = viewMask;
+						}
+				});
+
+				//every visible entity becomes a single instance shared by its views
+				for (size_t i = 0; i < m_gathered.size(); i++)
+				{
+						const uint viewMask = m_gatheredMasks[i];
+						if (viewMask == 0)
+						{
+								continue;
+						}
+
+						const GatheredEntity& gathered = m_gathered[i];
+						std::shared_ptr<Mesh> mesh = gathered.mesh.lock();
+
+						//the lod is picked by the closest view
+						size_t closestView{ 0 };
+						float closestDepth = std::numeric_limits<float>::max();
+						for (size_t view = 0; view < cameras.size(); view++)
+						{
+								if (viewMask & (1u << view))
+								{
+										const float depth = -(cameras[view]->getViewMatrix() * glm::vec4(gathered.center, 1.0f)).z;
+										if (depth < closestDepth)
+										{
+												closestDepth = depth;
+												closestView = view;
+										}
+								}
+						}
+
+						//far enough away from all its views to be drawn as a billboard, the views it's outside of clip it
+						if (_impostors.add(*mesh, gathered.toWorldMat, closestDepth - gathered.radius))
+						{
+								continue;
+						}
+
+						const unsigned int lod = _lodSelector.select(gathered.entity, mesh.get(), closestDepth, gathered.radius, *cameras[closestView]);
+						_batches.addToViews(mesh, lod, gathered.toWorldMat, closestDepth - gathered.radius,
+								_batches.addMaterialParams(*gathered.meshRenderer), viewMask);
+				}
+		}
+}
@@ -0,0 +1,90 @@
+#ifndef VIEW_CULLER_H
+#define VIEW_CULLER_H
+
+#include <glm\vec3.hpp>
+#include <glm\mat4x4.hpp>
+#include <memory>
+#include <vector>
+
+namespace cogs
+{
+		class Entity;
+		class Mesh;
+		class MeshRenderer;
+		class Camera;
+		class SceneTree;
+		class LODSelector;
+		class InstanceBatches;
+		class ImpostorBatches;
+
+		using uint = unsigned int;
+
+		/**
+		* \brief Culls the entities of a frame drawn from several cameras (at most 32) against all of them in one pass.
+		* The entities are gathered once with everything the views share, every visible one becomes a single instance with the mask of its views
+		*/
+		class ViewCuller
+		{
+		public:
+				static const size_t MAX_VIEWS = 32;
+
+				/**
+				* \brief starts a frame of several views, the expired cameras are left out
+				*/
+				void begin(const std::vector<std::weak_ptr<Camera>>& _cameras);
+
+				/**
+				* \brief forgets the views and the gathered entities
+				*/
+				void clear();
+
+				const std::vector<std::weak_ptr<Camera>>& getViews() const noexcept { return m_views; }
+
+				/**
+				* \brief the index of the view of a camera, -1 if it's not one of them
+				*/
+				int findView(const Camera* _camera) const;
+
+				/**
+				* \brief the depth range over all views
+				*/
+				void getDepthRange(float& _near, float& _far) const;
+
+				/**
+				* \brief gathers an entity with a mesh renderer
+				*/
+				void gather(const Entity* _entity);
+
+				/**
+				* \brief gathers the active entities of a scene tree in any of the views
+				*/
+				void gather(const SceneTree& _sceneTree);
+
+				/**
+				* \brief tests the gathered entities against all views and adds the visible ones to the batches,
+				* the lod of an instance and whether it becomes a billboard are picked by its closest view
+				*/
+				void cull(LODSelector& _lodSelector, InstanceBatches& _batches, ImpostorBatches& _impostors);
+
+		private:
+				/**
+				* \brief an entity submitted in a frame of several views, with everything the views share
+				*/
+				struct GatheredEntity
+				{
+						const Entity* entity{ nullptr };
+						const MeshRenderer* meshRenderer{ nullptr };
+						std::weak_ptr<Mesh> mesh;
+						glm::mat4 toWorldMat{ 1.0f };
+						glm::vec3 center{ 0.0f }; ///< the world bounding sphere
+						float radius{ 0.0f };
+				};
+
+				std::vector<std::weak_ptr<Camera>> m_views;
+				std::vector<GatheredEntity> m_gathered;
+				std::vector<uint> m_gatheredMasks; ///< the views every gathered entity is visible in
+				std::vector<int> m_viewProxies; ///< scratch buffer of the scene tree proxies visible in any view
+		};
+}
+
+#endif // !VIEW_CULLER_H
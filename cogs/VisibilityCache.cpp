@@ -0,0 +1,125 @@
+#include "VisibilityCache.h"
+
+#include "Camera.h"
+#include "Frustum.h"
+
+#include <glm\geometric.hpp>
+#include <glm\common.hpp>
+#include <glm\trigonometric.hpp>
+
+namespace cogs
+{
+		void VisibilityCache::begin(const Camera* _camera)
+		{
+				m_current = nullptr;
+				if (_camera == nullptr)
+				{
+						return;
+				}
+
+				const glm::mat4 cameraWorld = glm::inverse(_camera->getViewMatrix());
+				CameraPose pose;
+				pose.position = glm::vec3(cameraWorld[3]);
+				pose.forward = -glm::vec3(cameraWorld[2]);
+				pose.up = glm::vec3(cameraWorld[1]);
+				pose.projection = _camera->getProjectionMatrix();
+
+				auto inserted = m_caches.insert(std::make_pair(_camera, CameraCache()));
+				CameraCache& cache = inserted.first->second;
+				if (inserted.second)
+				{
+						cache.poses[0] = pose;
+				}
+				else if (!isPoseWithin(cache.poses[cache.generation & 1], pose, 1.0f))
+				{
+						//a new generation starts from here, the results of the old one are refreshed a slice per frame
+						cache.generation++;
+						cache.poses[cache.generation & 1] = pose;
+				}
+
+				//the results are tested within the thresholds of their generation's pose and widened by three times them,
+				//so the previous generation holds while the camera is within twice the thresholds of its pose
+				cache.previousValid = cache.generation > 0 && isPoseWithin(cache.poses[(cache.generation - 1) & 1], pose, 2.0f);
+				cache.position = pose.position;
+				cache.lastFrame = m_frame;
+
+				m_current = &cache;
+		}
+
+		bool VisibilityCache::isPoseWithin(const CameraPose& _reference, const CameraPose& _pose, float _factor) const
+		{
+				if (_reference.projection != _pose.projection)
+				{
+						return false;
+				}
+
+				const float angle = glm::max(glm::acos(glm::clamp(glm::dot(_reference.forward, _pose.forward), -1.0f, 1.0f)),
+						glm::acos(glm::clamp(glm::dot(_reference.up, _pose.up), -1.0f, 1.0f)));
+
+				return glm::distance(_reference.position, _pose.position) <= m_distance * _factor && angle <= m_angle * _factor;
+		}
+
+		bool VisibilityCache::test(const MeshRenderer* _meshRenderer, const glm::vec3& _center, float _radius, const Frustum& _frustum, unsigned int& _planeMask)
+		{
+				CameraCache& cache = *m_current;
+
+				auto inserted = cache.entries.insert(std::make_pair(_meshRenderer, CachedVisibility()));
+				CachedVisibility& entry = inserted.first->second;
+				if (inserted.second)
+				{
+						entry.slot = static_cast<unsigned int>(cache.entries.size());
+				}
+				entry.lastFrame = m_frame;
+
+				bool valid = !inserted.second && entry.center == _center && entry.radius == _radius;
+				if (valid && entry.generation != cache.generation)
+				{
+						//the results of the previous generation are refreshed a slice per frame while they still hold
+						valid = entry.generation + 1 == cache.generation && cache.previousValid
+								&& (entry.slot + m_frame) % m_refreshFrames != 0;
+				}
+
+				if (!valid)
+				{
+						//a turn moves a point sideways by its distance times the angle
+						const float distance = glm::distance(_center, cache.position) + _radius;
+						const float margin = 3.0f * (m_distance + distance * m_angle);
+
+						unsigned int lastPlane{ 0 };
+						entry.planeMask = Frustum::ALL_PLANES;
+						entry.outside = _frustum.sphereInFrustum(_center, _radius + margin, entry.planeMask, lastPlane) == Containment::OUTSIDE;
+						entry.center = _center;
+						entry.radius = _radius;
+						entry.generation = cache.generation;
+				}
+
+				_planeMask &= entry.planeMask;
+				return !entry.outside;
+		}
+
+		void VisibilityCache::forget(const MeshRenderer* _meshRenderer)
+		{
+				for (auto& it : m_caches)
+				{
+						it.second.entries.erase(_meshRenderer);
+				}
+		}
+
+		void VisibilityCache::nextFrame()
+		{
+				if ((++m_frame & 255) != 0)
+				{
+						return;
+				}
+
+				for (auto it = m_caches.begin(); it != m_caches.end();)
+				{
+						std::unordered_map<const MeshRenderer*, CachedVisibility>& entries = it->second.entries;
+						for (auto entry = entries.begin(); entry != entries.end();)
+						{
+								entry = m_frame - entry->second.lastFrame > 255 ? entries.erase(entry) : std::next(entry);
+						}
+						it = m_frame - it->second.lastFrame > 255 ? m_caches.erase(it) : std::next(it);
+				}
+		}
+}
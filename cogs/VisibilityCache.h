@@ -0,0 +1,107 @@
+#ifndef VISIBILITY_CACHE_H
+#define VISIBILITY_CACHE_H
+
+#include <glm\vec3.hpp>
+#include <glm\mat4x4.hpp>
+#include <unordered_map>
+
+namespace cogs
+{
+		class Camera;
+		class Frustum;
+		class MeshRenderer;
+
+		/**
+		* \brief The frustum tests of static mesh renderers kept between frames, per camera.
+		* They are tested against a frustum widened by the thresholds, so the results hold while the camera stays close to where they were made.
+		* Once it moves or turns past the thresholds a new generation of results starts, the old one is refreshed a slice per frame
+		*/
+		class VisibilityCache
+		{
+		public:
+				/**
+				* \brief how far in world units and how much in radians the camera may move and turn before the results get refreshed
+				*/
+				void setThresholds(float _distance, float _angle) { m_distance = _distance; m_angle = _angle; }
+
+				/**
+				* \brief over how many frames the results are refreshed once the camera passed the thresholds
+				*/
+				void setRefreshFrames(unsigned int _frames) { m_refreshFrames = _frames > 0 ? _frames : 1; }
+				unsigned int getRefreshFrames() const noexcept { return m_refreshFrames; }
+
+				/**
+				* \brief picks the results of a camera for the following tests and starts a new generation of them if the camera passed the thresholds.
+				* nullptr leaves the following entities untested
+				*/
+				void begin(const Camera* _camera);
+				bool isActive() const noexcept { return m_current != nullptr; }
+
+				/**
+				* \brief the cached frustum test of a static mesh renderer, retested against the frustum if it's stale
+				* \param[in,out] _planeMask - the planes the entity has to be tested against, the ones it's known to be inside of are removed
+				* \return false if the entity is outside of the frustum
+				*/
+				bool test(const MeshRenderer* _meshRenderer, const glm::vec3& _center, float _radius, const Frustum& _frustum, unsigned int& _planeMask);
+
+				/**
+				* \brief drops the results of a mesh renderer, called when it's destroyed
+				*/
+				void forget(const MeshRenderer* _meshRenderer);
+
+				/**
+				* \brief starts the next frame, every now and then the results of entities and cameras which haven't been drawn for a while are forgotten
+				*/
+				void nextFrame();
+
+		private:
+				/**
+				* \brief the widened frustum test of a static entity
+				*/
+				struct CachedVisibility
+				{
+						glm::vec3 center{ 0.0f }; ///< the bounding sphere tested, a moved entity is retested
+						float radius{ 0.0f };
+						unsigned int generation{ 0 }; ///< the generation of the cache the test was made in
+						unsigned int slot{ 0 }; ///< decides the frame of the refresh
+						unsigned int planeMask{ 0 }; ///< the planes the widened sphere crosses
+						bool outside{ false };
+						unsigned int lastFrame{ 0 };
+				};
+
+				/**
+				* \brief where the camera was when a generation of results started
+				*/
+				struct CameraPose
+				{
+						glm::vec3 position{ 0.0f };
+						glm::vec3 forward{ 0.0f };
+						glm::vec3 up{ 0.0f };
+						glm::mat4 projection{ 1.0f };
+				};
+
+				struct CameraCache
+				{
+						CameraPose poses[2]; ///< the poses of the current and the previous generation, by parity
+						unsigned int generation{ 0 };
+						bool previousValid{ false }; ///< whether the results of the previous generation still hold
+						glm::vec3 position{ 0.0f }; ///< the camera position of this frame
+						unsigned int lastFrame{ 0 };
+						std::unordered_map<const MeshRenderer*, CachedVisibility> entries;
+				};
+
+				/**
+				* \brief whether a pose is within the thresholds times a factor of another one
+				*/
+				bool isPoseWithin(const CameraPose& _reference, const CameraPose& _pose, float _factor) const;
+
+				std::unordered_map<const Camera*, CameraCache> m_caches;
+				CameraCache* m_current{ nullptr }; ///< the cache of the camera of the following tests
+				unsigned int m_frame{ 0 };
+				float m_distance{ 0.5f }; ///< the distance threshold in world units
+				float m_angle{ 0.02f }; ///< the angle threshold in radians
+				unsigned int m_refreshFrames{ 8 };
+		};
+}
+
+#endif // !VISIBILITY_CACHE_H
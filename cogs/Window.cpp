@@ -1,7 +1,18 @@
 #include "Window.h"
 #include "Color.h"
+#include "Framebuffer.h"
+#include "RenderBackend.h"
 
 #include <iostream>
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <SOIL2\SOIL2.h>
+
+#ifdef COGS_USE_EGL
+#include <EGL\egl.h>
+#include <EGL\eglext.h>
+#endif
 
 namespace cogs
 {
@@ -11,6 +22,17 @@ namespace cogs
 		int Window::create(const std::string& _windowName, int _screenWidth,
 				int _screenHeight, const WindowCreationFlags& _windowFlags)
 		{
+				if (_windowFlags & WindowCreationFlags::HEADLESS)
+				{
+						m_title = _windowName;
+						m_width = _screenWidth;
+						m_height = _screenHeight;
+
+						initHeadless();
+
+						return 0; //Success!
+				}
+
 				initSDL();
 
 				Uint32 flags = SDL_WINDOW_OPENGL; //base needed flag
@@ -71,6 +93,33 @@ namespace cogs
 
 		void Window::close()
 		{
+				if (m_headless)
+				{
+						//the offscreen target must go before the context does
+						Framebuffer::setDefault(std::weak_ptr<Framebuffer>());
+						m_offscreenTarget.reset();
+				}
+
+#ifdef COGS_USE_EGL
+				if (m_eglDisplay != nullptr)
+				{
+						eglMakeCurrent(m_eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+						if (m_eglSurface != nullptr)
+						{
+								eglDestroySurface(m_eglDisplay, m_eglSurface);
+						}
+						eglDestroyContext(m_eglDisplay, m_eglContext);
+						eglTerminate(m_eglDisplay);
+
+						m_eglSurface = nullptr;
+						m_eglContext = nullptr;
+						m_eglDisplay = nullptr;
+
+						SDL_Quit();
+						return;
+				}
+#endif
+
 				SDL_GL_DeleteContext(m_glContext);
 				SDL_DestroyWindow(m_sdlWindow);
 				SDL_Quit();
@@ -208,9 +257,109 @@ namespace cogs
 
 		void Window::swapBuffer()
 		{
+				if (m_headless)
+				{
+						//nothing to present, just make sure the frame gets submitted
+						glFlush();
+						return;
+				}
+
 				SDL_GL_SwapWindow(m_sdlWindow);
 		}
 
+		void Window::makeCurrent()
+		{
+#ifdef COGS_USE_EGL
+				if (m_eglDisplay != nullptr)
+				{
+						if (eglMakeCurrent(m_eglDisplay, m_eglSurface, m_eglSurface, m_eglContext) != EGL_TRUE)
+						{
+								printf("Failed to make the EGL context current: 0x%x\n", eglGetError());
+						}
+						return;
+				}
+#endif
+				if (SDL_GL_MakeCurrent(m_sdlWindow, m_glContext) != 0)
+				{
+						printf("Failed to make the GL context current: %s\n", SDL_GetError());
+				}
+		}
+
+		void Window::releaseContext()
+		{
+#ifdef COGS_USE_EGL
+				if (m_eglDisplay != nullptr)
+				{
+						eglMakeCurrent(m_eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+						return;
+				}
+#endif
+				SDL_GL_MakeCurrent(m_sdlWindow, nullptr);
+		}
+
+		bool Window::isContextCurrent()
+		{
+#ifdef COGS_USE_EGL
+				if (eglGetCurrentContext() != EGL_NO_CONTEXT)
+				{
+						return true;
+				}
+#endif
+				return SDL_GL_GetCurrentContext() != nullptr;
+		}
+
+		void Window::readPixels(std::vector<unsigned char>& _pixels) const
+		{
+				_pixels.resize(m_width * m_height * 4);
+
+				GLint previousFramebuffer{ 0 };
+				glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &previousFramebuffer);
+
+				glBindFramebuffer(GL_READ_FRAMEBUFFER, m_offscreenTarget != nullptr ? m_offscreenTarget->getFBO() : 0);
+				glPixelStorei(GL_PACK_ALIGNMENT, 1);
+				glReadPixels(0, 0, m_width, m_height, GL_RGBA, GL_UNSIGNED_BYTE, _pixels.data());
+
+				glBindFramebuffer(GL_READ_FRAMEBUFFER, previousFramebuffer);
+		}
+
+		bool Window::saveFrame(const std::string& _filePath) const
+		{
+				std::vector<unsigned char> pixels;
+				readPixels(pixels);
+
+				//GL's origin is the bottom left corner, images start at the top
+				const size_t rowSize = m_width * 4;
+				std::vector<unsigned char> row(rowSize);
+				for (int y = 0; y < m_height / 2; y++)
+				{
+						unsigned char* top = &pixels[y * rowSize];
+						unsigned char* bottom = &pixels[(m_height - 1 - y) * rowSize];
+						memcpy(row.data(), top, rowSize);
+						memcpy(top, bottom, rowSize);
+						memcpy(bottom, row.data(), rowSize);
+				}
+
+				std::string extension = _filePath.substr(_filePath.find_last_of('.') + 1);
+				std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+
+				int saveType = SOIL_SAVE_TYPE_PNG;
+				if (extension == "bmp")
+				{
+						saveType = SOIL_SAVE_TYPE_BMP;
+				}
+				else if (extension == "tga")
+				{
+						saveType = SOIL_SAVE_TYPE_TGA;
+				}
+
+				if (SOIL_save_image(_filePath.c_str(), saveType, m_width, m_height, 4, pixels.data()) == 0)
+				{
+						printf("SOIL saving error: '%s'\n", SOIL_last_result());
+						return false;
+				}
+				return true;
+		}
+
 		void Window::clear(bool _color, bool _depth, bool _stencil /* = false */)
 		{
 				GLbitfield mask = 0;
@@ -314,6 +463,139 @@ namespace cogs
 						throw std::runtime_error("Glew could not be initialized");
 				}
 
+				initGLState();
+		}
+
+		void Window::initHeadless()
+		{
+				m_headless = true;
+
+#ifdef COGS_USE_EGL
+				//no video subsystem without a window, only events and timers
+				SDL_Init(SDL_INIT_EVENTS | SDL_INIT_TIMER);
+
+				EGLDisplay display = EGL_NO_DISPLAY;
+
+				//prefer the surfaceless platform, it doesn't need a display server at all
+				PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+						(PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+				if (getPlatformDisplay != nullptr)
+				{
+						display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+				}
+				if (display == EGL_NO_DISPLAY)
+				{
+						display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+				}
+				if (display == EGL_NO_DISPLAY || eglInitialize(display, nullptr, nullptr) != EGL_TRUE)
+				{
+						throw std::runtime_error("EGL display could not be initialized");
+				}
+
+				if (eglBindAPI(EGL_OPENGL_API) != EGL_TRUE)
+				{
+						throw std::runtime_error("EGL could not bind the OpenGL API");
+				}
+
+				const EGLint configAttribs[] =
+				{
+						EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+						EGL_RED_SIZE, 8,
+						EGL_GREEN_SIZE, 8,
+						EGL_BLUE_SIZE, 8,
+						EGL_ALPHA_SIZE, 8,
+						EGL_DEPTH_SIZE, 24,
+						EGL_STENCIL_SIZE, 8,
+						EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+						EGL_NONE
+				};
+
+				EGLConfig config;
+				EGLint numConfigs{ 0 };
+				if (eglChooseConfig(display, configAttribs, &config, 1, &numConfigs) != EGL_TRUE || numConfigs == 0)
+				{
+						throw std::runtime_error("No suitable EGL config found");
+				}
+
+				const EGLint contextAttribs[] =
+				{
+						EGL_CONTEXT_MAJOR_VERSION, 3,
+						EGL_CONTEXT_MINOR_VERSION, 3,
+						EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+						EGL_NONE
+				};
+
+				EGLContext context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttribs);
+				if (context == EGL_NO_CONTEXT)
+				{
+						throw std::runtime_error("EGL context could not be created");
+				}
+
+				//everything is rendered into a framebuffer, so a surface is only needed if surfaceless contexts aren't supported
+				EGLSurface surface = EGL_NO_SURFACE;
+				const char* extensions = eglQueryString(display, EGL_EXTENSIONS);
+				if (extensions == nullptr || strstr(extensions, "EGL_KHR_surfaceless_context") == nullptr)
+				{
+						const EGLint pbufferAttribs[] = { EGL_WIDTH, m_width, EGL_HEIGHT, m_height, EGL_NONE };
+						surface = eglCreatePbufferSurface(display, config, pbufferAttribs);
+						if (surface == EGL_NO_SURFACE)
+						{
+								throw std::runtime_error("EGL pbuffer surface could not be created");
+						}
+				}
+
+				if (eglMakeCurrent(display, surface, surface, context) != EGL_TRUE)
+				{
+						throw std::runtime_error("EGL context could not be made current");
+				}
+
+				m_eglDisplay = display;
+				m_eglContext = context;
+				m_eglSurface = surface == EGL_NO_SURFACE ? nullptr : surface;
+
+				//Set up glew
+				glewExperimental = GL_TRUE;
+				GLenum error = glewInit();
+#ifdef GLEW_ERROR_NO_GLX_DISPLAY
+				//glew looks for a GLX display first, the GL entry points are loaded anyway
+				if (error == GLEW_ERROR_NO_GLX_DISPLAY)
+				{
+						error = GLEW_OK;
+				}
+#endif
+				if (error != GLEW_OK)
+				{
+						throw std::runtime_error("Glew could not be initialized");
+				}
+
+				initGLState();
+#else
+				//no EGL, use a hidden window for the context instead
+				initSDL();
+
+				//the offscreen framebuffer isn't multisampled, no need for it on the window either
+				SDL_GL_SetAttribute(SDL_GL_MULTISAMPLEBUFFERS, 0);
+				SDL_GL_SetAttribute(SDL_GL_MULTISAMPLESAMPLES, 0);
+
+				m_sdlWindow = SDL_CreateWindow(m_title.c_str(), SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED,
+						m_width, m_height, SDL_WINDOW_OPENGL | SDL_WINDOW_HIDDEN);
+
+				if (m_sdlWindow == nullptr)
+				{
+						throw std::runtime_error("Window could not be created");
+				}
+
+				initGL();
+#endif
+
+				//render into an offscreen framebuffer instead of the window
+				m_offscreenTarget = Framebuffer::create(m_width, m_height);
+				Framebuffer::setDefault(m_offscreenTarget);
+				m_offscreenTarget->bind();
+		}
+
+		void Window::initGLState()
+		{
 				//check the openGL version
 				std::cout << "INFO: Using GLEW " << glewGetString(GLEW_VERSION) << std::endl;
 
@@ -322,6 +604,9 @@ namespace cogs
 				std::cout << "INFO: OpenGL Version: " << glGetString(GL_VERSION) << std::endl;
 				std::cout << "INFO: OpenGL Shading Language Version: " << glGetString(GL_SHADING_LANGUAGE_VERSION) << std::endl;
 
+				//check the optional features the renderers can use
+				RenderBackend::detectCaps();
+
 				//Set the background color to black
 				glClearColor(0.0f, 0.0f, 0.0f, 1.0);
 
@@ -5,11 +5,15 @@
 #include <GL\glew.h>
 #include <glm\vec2.hpp>
 #include <string>
+#include <vector>
+#include <memory>
 
 #include "Color.h"
 
 namespace cogs
 {
+		class Framebuffer;
+
 		/**
 		* \brief Flags with which the window can be created
 		*/
@@ -24,6 +28,7 @@ namespace cogs
 				MINIMIZED = 32,							  //window is minimized
 				MAXIMIZED = 64,							  //window is maximized
 				INPUT_GRABBED = 128,				//window has grabbed input focus
+				HEADLESS = 256,										//no visible window, renders into an offscreen framebuffer and never swaps
 		};
 
 		/**
@@ -64,6 +69,34 @@ namespace cogs
 				*/
 				void swapBuffer();
 
+				/**
+				* \brief Makes the GL context current on the calling thread
+				*/
+				void makeCurrent();
+
+				/**
+				* \brief Releases the GL context from the calling thread, so another thread can make it current
+				*/
+				void releaseContext();
+
+				/**
+				* \brief Whether a GL context is current on the calling thread, to check that GL calls aren't made from another thread
+				*/
+				static bool isContextCurrent();
+
+				/**
+				* \brief Reads back the pixels of the default render target (the offscreen framebuffer when headless)
+				* \param[out] _pixels - RGBA8 pixels, bottom row first
+				*/
+				void readPixels(std::vector<unsigned char>& _pixels) const;
+
+				/**
+				* \brief Reads back the default render target and saves it as an image (for golden-image checks)
+				* \param[in] _filePath - the file to save to, the extension selects the format (.png, .bmp or .tga)
+				* \return true if the image was saved
+				*/
+				bool saveFrame(const std::string& _filePath) const;
+
 				/**
 				* \brief Clear the current active framebuffer
 				*/
@@ -87,6 +120,7 @@ namespace cogs
 				inline bool hasKeyboardFocus()										const noexcept { return m_keyboardFocus; }
 				inline bool isMinimized()															const noexcept { return m_minimized; }
 				inline bool wasResized()									 						const noexcept { return m_wasResized; }
+				inline bool isHeadless()															const noexcept { return m_headless; }
 
 				/**
 				* \brief static getters for width and height,
@@ -100,10 +134,20 @@ namespace cogs
 				void initSDL();
 				//OGL context must be initialized after window creation
 				void initGL();
+				//Create the context without a visible window (EGL if available, hidden SDL window otherwise)
+				void initHeadless();
+				//Set up the default GL state, after the context has been created
+				void initGLState();
 
 		private:
 				SDL_Window* m_sdlWindow = nullptr; ///< the sdl handle of the window
-				SDL_GLContext m_glContext; ///< the sdl GL context
+				SDL_GLContext m_glContext{ nullptr }; ///< the sdl GL context
+
+				bool m_headless{ false }; ///< created with WindowCreationFlags::HEADLESS
+				std::shared_ptr<Framebuffer> m_offscreenTarget; ///< the default render target when headless
+				void* m_eglDisplay{ nullptr }; ///< EGL display when headless with EGL
+				void* m_eglContext{ nullptr }; ///< EGL context when headless with EGL
+				void* m_eglSurface{ nullptr }; ///< EGL pbuffer surface if surfaceless contexts are not supported
 
 				static int m_width; ///< window width
 				static int m_height; ///< window height